@@ -0,0 +1,133 @@
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unistd.h>
+#include <uv.h>
+#include <vector>
+
+#include "../src/helper/common.h"
+#include "../src/helper/libuv.h"
+#include "../src/log.h"
+#include "../src/message_buffer.h"
+#include "../src/worker/linux/cookie_jar.h"
+#include "../src/worker/linux/watch_registry.h"
+#include "../src/worker/recent_file_cache.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+using std::chrono::duration_cast;
+using std::chrono::nanoseconds;
+using std::chrono::steady_clock;
+
+// Measure the throughput of `WatchRegistry::consume()` while logging is disabled: the cost of reading inotify events
+// and translating them into messages, excluding the system calls that generate them.
+//
+// Usage: consume_bench <scratch-directory> [file-count] [rounds]
+//
+// Each round writes to every file within the scratch directory, then consumes the resulting events. The scratch
+// directory is created if necessary and populated with `file-count` empty files.
+//
+// The `consume_bench_unguarded` target is built from the same source and linked against `watcher_core_unguarded`, a
+// copy of the core compiled with `WATCHER_UNGUARDED_LOGGING` defined, so that every `LOG_AT()` line is formatted into
+// the disabled logger as it was before logging levels existed.
+
+static bool populate(const string &dir, size_t file_count, vector<string> &file_paths)
+{
+  FSReq mkdir_req;
+  int err = uv_fs_mkdir(nullptr, &mkdir_req.req, dir.c_str(), 0755, nullptr);
+  if (err != 0 && err != UV_EEXIST) {
+    cerr << "Unable to create " << dir << ": " << uv_strerror(err) << endl;
+    return false;
+  }
+
+  for (size_t i = 0; i < file_count; i++) {
+    file_paths.push_back(path_join(dir, "file-" + std::to_string(i) + ".txt"));
+
+    int fd = open(file_paths.back().c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+      cerr << "Unable to create " << file_paths.back() << ": " << std::strerror(errno) << endl;
+      return false;
+    }
+    close(fd);
+  }
+
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  if (argc < 2) {
+    cerr << "Usage: " << argv[0] << " <scratch-directory> [file-count] [rounds]" << endl;
+    return 1;
+  }
+
+  string dir(argv[1]);
+  size_t file_count = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1000;
+  size_t rounds = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 100;
+
+  vector<string> file_paths;
+  if (!populate(dir, file_count, file_paths)) return 1;
+
+  Logger::disable();
+
+  WatchRegistry registry;
+  if (!registry.is_healthy()) {
+    cerr << "Unable to initialize inotify: " << registry.get_message() << endl;
+    return 1;
+  }
+
+  vector<string> poll;
+  Result<> ar = registry.add(1, dir, true, EVENT_DEFAULT, nullptr, nullptr, poll);
+  if (ar.is_error()) {
+    cerr << "Unable to watch " << dir << ": " << ar << endl;
+    return 1;
+  }
+
+  CookieJar jar;
+  RecentFileCache cache(4096);
+
+  nanoseconds consume_time(0);
+  size_t message_count = 0;
+
+  for (size_t round = 0; round < rounds; round++) {
+    for (const string &file_path : file_paths) {
+      int fd = open(file_path.c_str(), O_WRONLY | O_APPEND);
+      if (fd == -1 || write(fd, "x", 1) != 1) {
+        cerr << "Unable to write to " << file_path << ": " << std::strerror(errno) << endl;
+        return 1;
+      }
+      close(fd);
+    }
+
+    MessageBuffer messages;
+    steady_clock::time_point start = steady_clock::now();
+    Result<> cr = registry.consume(messages, jar, cache);
+    consume_time += duration_cast<nanoseconds>(steady_clock::now() - start);
+    if (cr.is_error()) {
+      cerr << "Unable to consume events: " << cr << endl;
+      return 1;
+    }
+
+    message_count += messages.size();
+  }
+
+  // Each write produces a single IN_MODIFY event.
+  size_t event_count = rounds * file_count;
+  double seconds = static_cast<double>(consume_time.count()) / 1e9;
+
+  cout << event_count << " inotify events consumed in " << consume_time.count() / 1000 << "us" << endl;
+  cout << message_count << " messages produced" << endl;
+  if (seconds > 0) {
+    cout << static_cast<size_t>(static_cast<double>(event_count) / seconds) << " events per second" << endl;
+  }
+  cout << consume_time.count() / (event_count > 0 ? event_count : 1) << "ns per event" << endl;
+  return 0;
+}
@@ -0,0 +1,345 @@
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <uv.h>
+#include <vector>
+
+#include "../src/helper/common.h"
+#include "../src/helper/libuv.h"
+#include "../src/log.h"
+#include "../src/message.h"
+#include "../src/message_buffer.h"
+#include "../src/polling/polled_root.h"
+#include "../src/queue.h"
+#include "../src/worker/recent_file_cache.h"
+
+#ifdef PLATFORM_LINUX
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../src/worker/linux/cookie_jar.h"
+#include "../src/worker/linux/watch_registry.h"
+#endif
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::ofstream;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+using std::chrono::duration_cast;
+using std::chrono::nanoseconds;
+using std::chrono::steady_clock;
+
+// Benchmark the native core outside of Node.js. This is linked against the `watcher_core` static library, which is
+// built from the same sources as the addon without V8, so that it can be profiled with `perf record` and compared
+// between commits without the event loop in the way.
+//
+// Usage: core_bench <scratch-directory> [suite-filter] [scale]
+//
+// Micro suites exercise a single class in memory. Macro suites drive classes through real filesystem activity within
+// subdirectories of the scratch directory, which are created as necessary and left in place. Only suites whose names
+// contain `suite-filter` are run. Every suite's iteration count is multiplied by `scale`.
+
+static const size_t UNLIMITED = static_cast<size_t>(-1) / 2;
+
+// Accumulate the time spent within the measured portions of a suite, leaving out its setup.
+class Stopwatch
+{
+public:
+  Stopwatch() : elapsed{0} {}
+
+  void start() { started = steady_clock::now(); }
+
+  void stop() { elapsed += duration_cast<nanoseconds>(steady_clock::now() - started); }
+
+  nanoseconds get_elapsed() const { return elapsed; }
+
+private:
+  steady_clock::time_point started;
+  nanoseconds elapsed;
+};
+
+// A suite returns the number of operations it timed, or 0 if it was unable to run.
+using SuiteFunction = size_t (*)(const string &scratch, size_t scale, Stopwatch &watch);
+
+struct Suite
+{
+  const char *name;
+  SuiteFunction run;
+};
+
+static vector<string> generate_paths(const string &dir, size_t count)
+{
+  vector<string> paths;
+  paths.reserve(count);
+  for (size_t i = 0; i < count; i++) {
+    paths.push_back(path_join(dir, "entry-" + std::to_string(i) + ".txt"));
+  }
+  return paths;
+}
+
+// Create `dir` along with `count` empty files beneath it, skipping any that already exist.
+static bool populate(const string &dir, size_t count, vector<string> &paths)
+{
+  FSReq mkdir_req;
+  int err = uv_fs_mkdir(nullptr, &mkdir_req.req, dir.c_str(), 0755, nullptr);
+  if (err != 0 && err != UV_EEXIST) {
+    cerr << "Unable to create " << dir << ": " << uv_strerror(err) << endl;
+    return false;
+  }
+
+  paths = generate_paths(dir, count);
+  for (const string &path : paths) {
+    FSReq stat_req;
+    if (uv_fs_lstat(nullptr, &stat_req.req, path.c_str(), nullptr) == 0) continue;
+
+    ofstream out(path);
+    if (!out) {
+      cerr << "Unable to create " << path << endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool touch(const string &path)
+{
+  ofstream out(path, std::ios::app);
+  out << "x";
+  if (!out) {
+    cerr << "Unable to write to " << path << endl;
+    return false;
+  }
+  return true;
+}
+
+// Micro suites
+
+static size_t queue_enqueue_accept(const string & /*scratch*/, size_t scale, Stopwatch &watch)
+{
+  const size_t batch_size = 64;
+  size_t batch_count = 2000 * scale;
+  vector<string> paths = generate_paths("/root", batch_size);
+  Queue queue;
+
+  for (size_t batch = 0; batch < batch_count; batch++) {
+    vector<Message> messages;
+    messages.reserve(batch_size);
+    for (const string &path : paths) {
+      messages.emplace_back(FileSystemPayload::modified(1, string(path), KIND_FILE));
+    }
+
+    watch.start();
+    queue.enqueue_all(messages.begin(), messages.end());
+    unique_ptr<vector<Message>> accepted = queue.accept_all();
+    watch.stop();
+  }
+  return batch_count * batch_size;
+}
+
+static size_t message_buffer_fill(const string & /*scratch*/, size_t scale, Stopwatch &watch)
+{
+  size_t count = 10000;
+  size_t rounds = 20 * scale;
+  vector<string> paths = generate_paths("/root", count);
+
+  for (size_t round = 0; round < rounds; round++) {
+    MessageBuffer buffer;
+    watch.start();
+    buffer.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+      if (i % 4 == 3) {
+        buffer.renamed(1, string(paths[i - 1]), string(paths[i]), KIND_FILE);
+      } else {
+        buffer.modified(1, string(paths[i]), KIND_FILE);
+      }
+    }
+    watch.stop();
+  }
+  return count * rounds;
+}
+
+static size_t recent_file_cache_lookup(const string &scratch, size_t scale, Stopwatch &watch)
+{
+  size_t count = 1000;
+  vector<string> paths;
+  if (!populate(path_join(scratch, "cache"), count, paths)) return 0;
+
+  RecentFileCache cache(count * 2);
+  cache.prepopulate(path_join(scratch, "cache"), count, false);
+
+  // Alternate between entries that were prepopulated and entries that were never seen.
+  vector<string> missing = generate_paths(path_join(scratch, "absent"), count);
+  size_t rounds = 200 * scale;
+  watch.start();
+  for (size_t round = 0; round < rounds; round++) {
+    for (size_t i = 0; i < count; i++) {
+      cache.former_at_path(paths[i], true, false, false);
+      cache.former_at_path(missing[i], true, false, false);
+    }
+  }
+  watch.stop();
+  return rounds * count * 2;
+}
+
+#ifdef PLATFORM_LINUX
+static size_t cookie_jar_renames(const string & /*scratch*/, size_t scale, Stopwatch &watch)
+{
+  size_t count = 10000;
+  size_t rounds = 20 * scale;
+  vector<string> from_paths = generate_paths("/from", count);
+  vector<string> to_paths = generate_paths("/to", count);
+  RecentFileCache cache(0);
+  CookieJar jar;
+
+  // Most renames pair within a batch. Every eighth loses its IN_MOVED_TO and expires as a deletion.
+  for (size_t round = 0; round < rounds; round++) {
+    MessageBuffer messages;
+    watch.start();
+    for (size_t i = 0; i < count; i++) {
+      auto cookie = static_cast<uint32_t>(round * count + i);
+      jar.moved_from(messages, 1, cookie, string(from_paths[i]), KIND_FILE);
+      if (i % 8 != 0) jar.moved_to(messages, 1, cookie, string(to_paths[i]), KIND_FILE);
+    }
+    jar.flush_oldest_batch(messages, cache);
+    watch.stop();
+  }
+  return rounds * count;
+}
+#endif
+
+// Macro suites
+
+#ifdef PLATFORM_LINUX
+static size_t watch_registry_consume(const string &scratch, size_t scale, Stopwatch &watch)
+{
+  size_t count = 1000;
+  size_t rounds = 20 * scale;
+  string dir = path_join(scratch, "registry");
+  vector<string> paths;
+  if (!populate(dir, count, paths)) return 0;
+
+  WatchRegistry registry;
+  if (!registry.is_healthy()) {
+    cerr << "Unable to initialize inotify: " << registry.get_message() << endl;
+    return 0;
+  }
+
+  vector<string> poll;
+  Result<> ar = registry.add(1, dir, true, EVENT_DEFAULT, nullptr, nullptr, poll);
+  if (ar.is_error()) {
+    cerr << "Unable to watch " << dir << ": " << ar << endl;
+    return 0;
+  }
+
+  CookieJar jar;
+  RecentFileCache cache(4096);
+
+  for (size_t round = 0; round < rounds; round++) {
+    for (const string &path : paths) {
+      int fd = open(path.c_str(), O_WRONLY | O_APPEND);
+      if (fd == -1 || write(fd, "x", 1) != 1) {
+        cerr << "Unable to write to " << path << ": " << std::strerror(errno) << endl;
+        return 0;
+      }
+      close(fd);
+    }
+
+    MessageBuffer messages;
+    watch.start();
+    Result<> cr = registry.consume(messages, jar, cache);
+    watch.stop();
+    if (cr.is_error()) {
+      cerr << "Unable to consume events: " << cr << endl;
+      return 0;
+    }
+  }
+
+  // Each write produces a single IN_MODIFY event.
+  return rounds * count;
+}
+#endif
+
+static size_t directory_record_pass(const string &scratch, size_t scale, Stopwatch &watch)
+{
+  size_t count = 10000;
+  size_t passes = 5 * scale;
+  string dir = path_join(scratch, "polled");
+  vector<string> paths;
+  if (!populate(dir, count, paths)) return 0;
+
+  PolledRoot root(string(dir), 1, false, EVENT_DEFAULT, nullptr, false);
+
+  // The first pass populates the records without emitting events.
+  MessageBuffer initial;
+  root.advance(initial, UNLIMITED);
+
+  // Modify one entry in a hundred before each pass, so that the diff has something to find.
+  for (size_t pass = 0; pass < passes; pass++) {
+    for (size_t i = pass % 100; i < paths.size(); i += 100) {
+      if (!touch(paths[i])) return 0;
+    }
+
+    MessageBuffer buffer;
+    watch.start();
+    root.advance(buffer, UNLIMITED);
+    watch.stop();
+  }
+  return passes * count;
+}
+
+static const Suite SUITES[] = {{"micro/queue_enqueue_accept", queue_enqueue_accept},
+  {"micro/message_buffer_fill", message_buffer_fill},
+  {"micro/recent_file_cache_lookup", recent_file_cache_lookup},
+#ifdef PLATFORM_LINUX
+  {"micro/cookie_jar_renames", cookie_jar_renames},
+  {"macro/watch_registry_consume", watch_registry_consume},
+#endif
+  {"macro/directory_record_pass", directory_record_pass}};
+
+int main(int argc, char **argv)
+{
+  if (argc < 2) {
+    cerr << "Usage: " << argv[0] << " <scratch-directory> [suite-filter] [scale]" << endl;
+    return 1;
+  }
+
+  string scratch(argv[1]);
+  string filter(argc > 2 ? argv[2] : "");
+  size_t scale = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 1;
+  if (scale == 0) scale = 1;
+
+  FSReq mkdir_req;
+  int err = uv_fs_mkdir(nullptr, &mkdir_req.req, scratch.c_str(), 0755, nullptr);
+  if (err != 0 && err != UV_EEXIST) {
+    cerr << "Unable to create " << scratch << ": " << uv_strerror(err) << endl;
+    return 1;
+  }
+
+  Logger::disable();
+
+  bool failed = false;
+  for (const Suite &suite : SUITES) {
+    if (string(suite.name).find(filter) == string::npos) continue;
+
+    Stopwatch watch;
+    size_t operations = suite.run(scratch, scale, watch);
+    if (operations == 0) {
+      cout << suite.name << ": failed" << endl;
+      failed = true;
+      continue;
+    }
+
+    auto elapsed = static_cast<size_t>(watch.get_elapsed().count());
+    cout << suite.name << ": " << operations << " operations in " << elapsed / 1000 << "us, "
+         << elapsed / operations << "ns per operation" << endl;
+  }
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,130 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <new>
+#include <string>
+#include <uv.h>
+#include <vector>
+
+#include "../src/polling/entry_table.h"
+
+using std::cout;
+using std::endl;
+using std::map;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+using std::chrono::duration_cast;
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+
+// Compare the heap memory used to remember the stat results of a large polled tree as a map of full `uv_stat_t`
+// results per directory, as `DirectoryRecord` once did, with the `EntryTable` of `StatFingerprints` that it uses now.
+//
+// Usage: entry_table_bench [entry-count] [entries-per-directory]
+
+// Track live heap bytes by replacing the global allocation functions. GCC can't tell that these replacements pair
+// `malloc()` with `free()` correctly once it's inlined them into the standard containers.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+static size_t live_bytes = 0;
+
+// Room for the block size ahead of each allocation, keeping the block itself suitably aligned for any type.
+static const size_t HEADER_SIZE = alignof(std::max_align_t);
+
+void *operator new(size_t size)
+{
+  auto *block = static_cast<char *>(std::malloc(size + HEADER_SIZE));
+  if (block == nullptr) throw std::bad_alloc();
+  *reinterpret_cast<size_t *>(block) = size;
+  live_bytes += size;
+  return block + HEADER_SIZE;
+}
+
+void operator delete(void *ptr) noexcept
+{
+  if (ptr == nullptr) return;
+  char *block = static_cast<char *>(ptr) - HEADER_SIZE;
+  live_bytes -= *reinterpret_cast<size_t *>(block);
+  std::free(block);
+}
+
+static const char *const STEMS[] = {"index", "README", "component", "test_helper", "a", "LICENSE", "package-lock", "x"};
+
+static const char *const EXTENSIONS[] = {".js", ".json", ".md", "", ".cpp", ".h", ".pyc", ".min.js"};
+
+static string entry_name(size_t i)
+{
+  string name(STEMS[i % 8]);
+  name += '_';
+  name += std::to_string(i);
+  name += EXTENSIONS[(i / 8) % 8];
+  return name;
+}
+
+static uv_stat_t stat_for(size_t i)
+{
+  uv_stat_t stat;
+  std::memset(&stat, 0, sizeof(stat));
+  stat.st_ino = 1000000 + i;
+  stat.st_mode = 0100644;
+  stat.st_size = i * 37;
+  stat.st_mtim.tv_sec = 1500000000 + static_cast<long>(i);
+  stat.st_ctim = stat.st_mtim;
+  return stat;
+}
+
+template <class Fill>
+static void measure(const char *label, size_t entry_count, Fill fill)
+{
+  size_t before = live_bytes;
+  steady_clock::time_point start = steady_clock::now();
+  auto structure = fill();
+  milliseconds elapsed = duration_cast<milliseconds>(steady_clock::now() - start);
+  size_t used = live_bytes - before;
+
+  cout << label << ": " << used / (1024 * 1024) << "MiB, " << (entry_count > 0 ? used / entry_count : 0)
+       << " bytes per entry, filled in " << elapsed.count() << "ms" << endl;
+}
+
+int main(int argc, char **argv)
+{
+  size_t entry_count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000000;
+  size_t per_directory = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1000;
+  if (per_directory == 0) per_directory = 1;
+  size_t directory_count = (entry_count + per_directory - 1) / per_directory;
+
+  cout << entry_count << " entries in " << directory_count << " directories" << endl;
+  cout << "sizeof(uv_stat_t) = " << sizeof(uv_stat_t) << ", sizeof(StatFingerprint) = " << sizeof(StatFingerprint)
+       << endl;
+
+  measure("std::map<string, uv_stat_t>", entry_count, [&]() {
+    vector<unique_ptr<map<string, uv_stat_t>>> directories;
+    for (size_t d = 0; d < directory_count; d++) {
+      directories.emplace_back(new map<string, uv_stat_t>());
+      for (size_t i = d * per_directory; i < entry_count && i < (d + 1) * per_directory; i++) {
+        directories.back()->emplace(entry_name(i), stat_for(i));
+      }
+    }
+    return directories;
+  });
+
+  measure("EntryTable", entry_count, [&]() {
+    vector<unique_ptr<EntryTable>> directories;
+    for (size_t d = 0; d < directory_count; d++) {
+      directories.emplace_back(new EntryTable());
+      for (size_t i = d * per_directory; i < entry_count && i < (d + 1) * per_directory; i++) {
+        directories.back()->put(entry_name(i), StatFingerprint(stat_for(i)));
+      }
+    }
+    return directories;
+  });
+
+  return 0;
+}
@@ -0,0 +1,122 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../src/log.h"
+#include "../src/message.h"
+#include "../src/message_buffer.h"
+#include "../src/worker/linux/cookie_jar.h"
+#include "../src/worker/linux/inotify_source.h"
+#include "../src/worker/linux/watch_registry.h"
+#include "../src/worker/recent_file_cache.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+using std::chrono::duration_cast;
+using std::chrono::nanoseconds;
+using std::chrono::steady_clock;
+
+// Replay a recording of a worker thread's inotify activity through `WatchRegistry::consume()`, the `CookieJar`, and
+// the `RecentFileCache`, without touching the disk. Record a workload by running an application with the
+// `WATCHER_RECORD_INOTIFY` environment variable set to the path of a file to write.
+//
+// Usage: inotify_replay <recording> [rounds] [print]
+//
+// Each round replays the entire recording into a fresh registry, jar, and cache, timing only the consumption of events
+// and the expiry of rename cookies. Passing `print` writes every message produced by the first round to stdout, one
+// per line, so that the translation of a workload can be compared between commits. Exclusions and .gitignore rules in
+// effect while the recording was made are not applied.
+
+static const size_t DEFAULT_CACHE_SIZE = 4096;
+
+// Replay the recording once. Return false if it couldn't be replayed.
+static bool replay(const string &filename, bool print, nanoseconds &elapsed, size_t &message_count)
+{
+  auto *source = new ReplayInotifySource(filename);
+  WatchRegistry registry{unique_ptr<InotifySource>(source)};
+  if (!source->get_error().empty()) {
+    cerr << "Unable to load " << filename << ": " << source->get_error() << endl;
+    return false;
+  }
+
+  CookieJar jar;
+  RecentFileCache cache(DEFAULT_CACHE_SIZE);
+  cache.set_stat_source(source);
+
+  vector<string> poll;
+  for (const RecordedRoot &root : source->get_roots()) {
+    Result<> ar = registry.add(root.channel_id, root.root, root.recursive, root.events, nullptr, nullptr, poll);
+    if (ar.is_error()) {
+      cerr << "Unable to watch " << root.root << ": " << ar << endl;
+      return false;
+    }
+  }
+
+  ReplayInotifySource::Step step = source->next_step();
+  while (step != ReplayInotifySource::STEP_END) {
+    MessageBuffer messages;
+
+    steady_clock::time_point start = steady_clock::now();
+    if (step == ReplayInotifySource::STEP_EVENTS) {
+      Result<> cr = registry.consume(messages, jar, cache);
+      if (cr.is_error()) cerr << "Unable to consume events: " << cr << endl;
+    } else {
+      jar.flush_oldest_batch(messages, cache);
+    }
+    elapsed += duration_cast<nanoseconds>(steady_clock::now() - start);
+
+    message_count += messages.size();
+    if (print) {
+      for (Message &message : messages) {
+        cout << message << endl;
+      }
+    }
+
+    step = source->next_step();
+  }
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  if (argc < 2) {
+    cerr << "Usage: " << argv[0] << " <recording> [rounds] [print]" << endl;
+    return 1;
+  }
+
+  string filename(argv[1]);
+  size_t rounds = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 10;
+  bool print = argc > 3 && string(argv[3]) == "print";
+
+  Logger::disable();
+
+  size_t event_count = 0;
+  {
+    ReplayInotifySource source(filename);
+    if (!source.get_error().empty()) {
+      cerr << "Unable to load " << filename << ": " << source.get_error() << endl;
+      return 1;
+    }
+    event_count = source.count_events() * rounds;
+  }
+
+  nanoseconds elapsed(0);
+  size_t message_count = 0;
+  for (size_t round = 0; round < rounds; round++) {
+    if (!replay(filename, print && round == 0, elapsed, message_count)) return 1;
+  }
+
+  // Keep the summary out of the way of printed messages.
+  std::ostream &summary = print ? cerr : cout;
+  summary << event_count << " inotify events replayed in " << elapsed.count() / 1000 << "us" << endl;
+  summary << message_count << " messages produced" << endl;
+  summary << elapsed.count() / (event_count > 0 ? event_count : 1) << "ns per event" << endl;
+  return 0;
+}
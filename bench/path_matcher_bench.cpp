@@ -0,0 +1,135 @@
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "../src/path_matcher.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::ifstream;
+using std::istreambuf_iterator;
+using std::string;
+using std::vector;
+using std::chrono::duration_cast;
+using std::chrono::nanoseconds;
+using std::chrono::steady_clock;
+
+// Measure the per-path cost of testing paths from a plausible project tree against a large ignore file.
+//
+// Usage: path_matcher_bench [ignore-file] [path-count] [rounds]
+
+static const char *const DIRECTORIES[] = {"src",
+  "lib",
+  "test",
+  "docs",
+  "node_modules",
+  "build",
+  "packages",
+  "components",
+  "assets",
+  "vendor",
+  "scripts",
+  ".idea",
+  "target",
+  "bin",
+  "obj",
+  "__pycache__",
+  "fixtures",
+  "utils"};
+
+static const char *const EXTENSIONS[] = {".js",
+  ".ts",
+  ".json",
+  ".md",
+  ".cpp",
+  ".h",
+  ".py",
+  ".pyc",
+  ".log",
+  ".o",
+  ".class",
+  ".java",
+  ".css",
+  ".html",
+  ".png",
+  ".tmp",
+  ".suo",
+  ".yml"};
+
+template <class T, size_t N>
+static size_t count_of(T (&)[N])
+{
+  return N;
+}
+
+static vector<string> generate_paths(const string &root, size_t count)
+{
+  vector<string> paths;
+  paths.reserve(count);
+
+  // A small linear congruential generator keeps the tree identical from run to run.
+  unsigned long long seed = 0x5eed;
+  auto next = [&seed](size_t bound) {
+    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    return static_cast<size_t>((seed >> 33) % bound);
+  };
+
+  for (size_t i = 0; i < count; i++) {
+    string path(root);
+
+    size_t depth = 1 + next(6);
+    for (size_t d = 0; d < depth; d++) {
+      path += '/';
+      path += DIRECTORIES[next(count_of(DIRECTORIES))];
+    }
+
+    path += "/file";
+    path += std::to_string(i % 1000);
+    path += EXTENSIONS[next(count_of(EXTENSIONS))];
+    paths.push_back(path);
+  }
+
+  return paths;
+}
+
+int main(int argc, char **argv)
+{
+  string ignore_path = argc > 1 ? argv[1] : "bench/fixtures/large.gitignore";
+  size_t path_count = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 100000;
+  size_t rounds = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 10;
+
+  ifstream in(ignore_path, std::ios::in | std::ios::binary);
+  if (!in) {
+    cerr << "Unable to read " << ignore_path << endl;
+    return 1;
+  }
+  string patterns((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+
+  steady_clock::time_point compile_start = steady_clock::now();
+  PathMatcher matcher(string("/project"), patterns);
+  nanoseconds compile_time = duration_cast<nanoseconds>(steady_clock::now() - compile_start);
+
+  vector<string> paths = generate_paths("/project", path_count);
+
+  size_t excluded = 0;
+  steady_clock::time_point match_start = steady_clock::now();
+  for (size_t round = 0; round < rounds; round++) {
+    for (const string &path : paths) {
+      if (matcher.excludes(path, false)) excluded++;
+    }
+  }
+  nanoseconds match_time = duration_cast<nanoseconds>(steady_clock::now() - match_start);
+
+  size_t matches = paths.size() * rounds;
+  cout << matcher << endl;
+  cout << "compiled in " << compile_time.count() / 1000 << "us" << endl;
+  cout << matches << " matches in " << match_time.count() / 1000000 << "ms: "
+       << (matches > 0 ? match_time.count() / matches : 0) << "ns per path, " << excluded / (rounds > 0 ? rounds : 1)
+       << " of " << paths.size() << " paths excluded" << endl;
+  return 0;
+}
@@ -0,0 +1,105 @@
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <uv.h>
+
+#include "../src/helper/common.h"
+#include "../src/helper/libuv.h"
+#include "../src/message_buffer.h"
+#include "../src/polling/polled_root.h"
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::ofstream;
+using std::string;
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+using std::chrono::steady_clock;
+
+// Measure the cost of polling a single directory containing a large number of entries: the `scandir()` and diff
+// against the previous scan performed at the start of each pass, and each complete pass including an `lstat()` of
+// every entry.
+//
+// Usage: polling_bench <scratch-directory> [entry-count] [passes] [structure]
+//
+// Passing `structure` polls as a channel that only asked for creation and deletion events would.
+//
+// The scratch directory is created if necessary and populated with `entry-count` empty files on the first run. It's
+// left in place so that later runs can skip that step.
+
+static const size_t UNLIMITED = static_cast<size_t>(-1) / 2;
+
+static bool populate(const string &dir, size_t entry_count)
+{
+  FSReq mkdir_req;
+  int err = uv_fs_mkdir(nullptr, &mkdir_req.req, dir.c_str(), 0755, nullptr);
+  if (err != 0 && err != UV_EEXIST) {
+    cerr << "Unable to create " << dir << ": " << uv_strerror(err) << endl;
+    return false;
+  }
+
+  for (size_t i = 0; i < entry_count; i++) {
+    string entry_path(path_join(dir, "entry-" + std::to_string(i) + ".txt"));
+
+    FSReq stat_req;
+    if (uv_fs_lstat(nullptr, &stat_req.req, entry_path.c_str(), nullptr) == 0) continue;
+
+    ofstream out(entry_path);
+    if (!out) {
+      cerr << "Unable to create " << entry_path << endl;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  if (argc < 2) {
+    cerr << "Usage: " << argv[0] << " <scratch-directory> [entry-count] [passes] [structure]" << endl;
+    return 1;
+  }
+
+  string dir(argv[1]);
+  size_t entry_count = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 100000;
+  size_t passes = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 10;
+  EventMask events = argc > 4 && string(argv[4]) == "structure" ? EVENT_CREATED | EVENT_DELETED : EVENT_DEFAULT;
+
+  if (!populate(dir, entry_count)) return 1;
+
+  PolledRoot root(string(dir), 1, false, events, nullptr, false);
+
+  // The first pass populates the records without emitting events.
+  MessageBuffer initial;
+  root.advance(initial, UNLIMITED);
+
+  microseconds scan_time(0);
+  microseconds pass_time(0);
+  size_t event_count = 0;
+
+  for (size_t pass = 0; pass < passes; pass++) {
+    MessageBuffer buffer;
+
+    // A single operation performs the scandir() and diff of the root directory.
+    steady_clock::time_point start = steady_clock::now();
+    root.advance(buffer, 1);
+    steady_clock::time_point scanned = steady_clock::now();
+    root.advance(buffer, UNLIMITED);
+    steady_clock::time_point finished = steady_clock::now();
+
+    scan_time += duration_cast<microseconds>(scanned - start);
+    pass_time += duration_cast<microseconds>(finished - start);
+    event_count += buffer.size();
+  }
+
+  size_t divisor = passes > 0 ? passes : 1;
+  cout << root.count_entries() << " entries polled " << passes << " times" << endl;
+  cout << "scan and diff: " << scan_time.count() / divisor << "us per pass" << endl;
+  cout << "complete pass: " << pass_time.count() / divisor << "us per pass" << endl;
+  cout << event_count << " unexpected events" << endl;
+  return 0;
+}
@@ -1,25 +1,55 @@
 {
-    "targets": [{
-        "target_name": "watcher",
-        "sources": [
-            "src/binding.cpp",
-            "src/hub.cpp",
+    "variables": {
+        "build_benchmarks%": "false",
+        # Everything within the addon except its V8 bindings, shared with the `watcher_core` libraries that the native
+        # benchmarks link against.
+        "core_sources": [
             "src/log.cpp",
+            "src/latency_histogram.cpp",
+            "src/binary_logger.cpp",
             "src/errable.cpp",
             "src/queue.cpp",
             "src/lock.cpp",
             "src/message.cpp",
             "src/message_buffer.cpp",
+            "src/path_matcher.cpp",
+            "src/gitignore.cpp",
+            "src/path_router.cpp",
             "src/thread_starter.cpp",
             "src/thread.cpp",
             "src/status.cpp",
+            "src/openmetrics.cpp",
+            "src/trace.cpp",
             "src/worker/worker_thread.cpp",
             "src/worker/recent_file_cache.cpp",
+            "src/polling/directory_handle.cpp",
+            "src/polling/inode_jar.cpp",
+            "src/polling/polling_snapshot.cpp",
             "src/polling/directory_record.cpp",
+            "src/polling/entry_table.cpp",
             "src/polling/polled_root.cpp",
             "src/polling/polling_iterator.cpp",
+            "src/polling/polling_pool.cpp",
             "src/polling/polling_thread.cpp",
-            "src/helper/libuv.cpp",
+            "src/helper/libuv.cpp"
+        ],
+        "core_linux_sources": [
+            "src/helper/common_posix.cpp",
+            "src/worker/linux/pipe.cpp",
+            "src/worker/linux/side_effect.cpp",
+            "src/worker/linux/cookie_jar.cpp",
+            "src/worker/linux/inotify_source.cpp",
+            "src/worker/linux/watched_directory.cpp",
+            "src/worker/linux/watch_registry.cpp",
+            "src/worker/linux/linux_worker_platform.cpp"
+        ]
+    },
+    "targets": [{
+        "target_name": "watcher",
+        "sources": [
+            "src/binding.cpp",
+            "src/hub.cpp",
+            "<@(core_sources)",
             "src/nan/async_callback.cpp",
             "src/nan/all_callback.cpp",
             "src/nan/functional_callback.cpp",
@@ -71,13 +101,7 @@
                     'PLATFORM_LINUX'
                 ],
                 "sources": [
-                    "src/helper/common_posix.cpp",
-                    "src/worker/linux/pipe.cpp",
-                    "src/worker/linux/side_effect.cpp",
-                    "src/worker/linux/cookie_jar.cpp",
-                    "src/worker/linux/watched_directory.cpp",
-                    "src/worker/linux/watch_registry.cpp",
-                    "src/worker/linux/linux_worker_platform.cpp"
+                    "<@(core_linux_sources)"
                 ]
             }]
         ],
@@ -103,6 +127,185 @@
             }
         }
     }],
+    "conditions": [
+        ["build_benchmarks=='true'", {
+            "targets": [{
+                # Everything within the addon except its V8 bindings, for native benchmarks to link against.
+                "target_name": "watcher_core",
+                "type": "static_library",
+                "sources": [
+                    "<@(core_sources)"
+                ],
+                "conditions": [
+                    ["OS=='mac'", {
+                        "defines": [
+                            'PLATFORM_MACOS'
+                        ],
+                        "direct_dependent_settings": {
+                            "defines": [
+                                'PLATFORM_MACOS'
+                            ]
+                        },
+                        "sources": [
+                            "src/helper/common_posix.cpp",
+                            "src/helper/macos/helper.cpp",
+                            "src/worker/macos/macos_worker_platform.cpp",
+                            "src/worker/macos/batch_handler.cpp",
+                            "src/worker/macos/rename_buffer.cpp",
+                            "src/worker/macos/subscription.cpp"
+                        ],
+                        "link_settings": {
+                            "libraries": [
+                                "-luv"
+                            ],
+                            "xcode_settings": {
+                                "OTHER_LDFLAGS": [
+                                    "-framework CoreServices"
+                                ]
+                            }
+                        }
+                    }],
+                    ["OS=='win'", {
+                        "defines": [
+                            'PLATFORM_WINDOWS'
+                        ],
+                        "direct_dependent_settings": {
+                            "defines": [
+                                'PLATFORM_WINDOWS'
+                            ]
+                        },
+                        "sources": [
+                            "src/helper/common_win.cpp",
+                            "src/helper/windows/helper.cpp",
+                            "src/worker/windows/subscription.cpp",
+                            "src/worker/windows/windows_worker_platform.cpp"
+                        ]
+                    }],
+                    ["OS=='linux'", {
+                        "defines": [
+                            'PLATFORM_LINUX'
+                        ],
+                        "direct_dependent_settings": {
+                            "defines": [
+                                'PLATFORM_LINUX'
+                            ]
+                        },
+                        "sources": [
+                            "<@(core_linux_sources)"
+                        ],
+                        # Outside of the node binary, libuv must come from the system.
+                        "link_settings": {
+                            "libraries": [
+                                "-luv",
+                                "-lpthread"
+                            ]
+                        }
+                    }]
+                ]
+            }, {
+                "target_name": "core_bench",
+                "type": "executable",
+                "dependencies": [
+                    "watcher_core"
+                ],
+                "sources": [
+                    "bench/core_bench.cpp"
+                ]
+            }, {
+                "target_name": "path_matcher_bench",
+                "type": "executable",
+                "sources": [
+                    "src/path_matcher.cpp",
+                    "bench/path_matcher_bench.cpp"
+                ],
+                "conditions": [
+                    ["OS=='win'", {
+                        "defines": [
+                            'PLATFORM_WINDOWS'
+                        ]
+                    }]
+                ]
+            }, {
+                "target_name": "entry_table_bench",
+                "type": "executable",
+                "sources": [
+                    "src/polling/entry_table.cpp",
+                    "bench/entry_table_bench.cpp"
+                ],
+                "conditions": [
+                    ["OS=='win'", {
+                        "defines": [
+                            'PLATFORM_WINDOWS'
+                        ]
+                    }]
+                ]
+            }, {
+                "target_name": "polling_bench",
+                "type": "executable",
+                "dependencies": [
+                    "watcher_core"
+                ],
+                "sources": [
+                    "bench/polling_bench.cpp"
+                ]
+            }]
+        }],
+        ["build_benchmarks=='true' and OS=='linux'", {
+            "targets": [{
+                "target_name": "inotify_replay",
+                "type": "executable",
+                "dependencies": [
+                    "watcher_core"
+                ],
+                "sources": [
+                    "bench/inotify_replay.cpp"
+                ]
+            }, {
+                "target_name": "consume_bench",
+                "type": "executable",
+                "dependencies": [
+                    "watcher_core"
+                ],
+                "sources": [
+                    "bench/consume_bench.cpp"
+                ]
+            }, {
+                # The core compiled again with `WATCHER_UNGUARDED_LOGGING`, which changes the logging macros expanded
+                # within every translation unit, for `consume_bench_unguarded` to compare against.
+                "target_name": "watcher_core_unguarded",
+                "type": "static_library",
+                "sources": [
+                    "<@(core_sources)",
+                    "<@(core_linux_sources)"
+                ],
+                "defines": [
+                    'PLATFORM_LINUX',
+                    'WATCHER_UNGUARDED_LOGGING'
+                ],
+                "direct_dependent_settings": {
+                    "defines": [
+                        'PLATFORM_LINUX',
+                        'WATCHER_UNGUARDED_LOGGING'
+                    ]
+                },
+                "link_settings": {
+                    "libraries": [
+                        "-luv",
+                        "-lpthread"
+                    ]
+                }
+            }, {
+                "target_name": "consume_bench_unguarded",
+                "type": "executable",
+                "dependencies": [
+                    "watcher_core_unguarded"
+                ],
+                "sources": [
+                    "bench/consume_bench.cpp"
+                ]
+            }]
+        }]
+    ],
     "target_defaults": {
         "cflags_cc": [
             "-std=c++11",
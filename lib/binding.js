@@ -1,3 +1,5 @@
+const path = require('path')
+
 const logger = require('./logger')
 
 let watcher = null
@@ -17,6 +19,17 @@ const DISABLE = Symbol('disable')
 const STDERR = Symbol('stderr')
 const STDOUT = Symbol('stdout')
 
+// Private: Native logging destination that writes compact binary records to a file from a background thread.
+class BinaryLog {
+  constructor (filename) {
+    this.filename = filename
+  }
+}
+
+function binaryLog (filename) {
+  return new BinaryLog(filename)
+}
+
 function logOption (baseName, options, normalized) {
   const value = options[baseName]
 
@@ -42,7 +55,24 @@ function logOption (baseName, options, normalized) {
     return
   }
 
-  throw new Error(`option ${baseName} must be DISABLE, STDERR, STDOUT, or a filename`)
+  if (value instanceof BinaryLog) {
+    normalized[`${baseName}Binary`] = value.filename
+    return
+  }
+
+  throw new Error(`option ${baseName} must be DISABLE, STDERR, STDOUT, binaryLog(), or a filename`)
+}
+
+function logLevelOption (baseName, options, normalized) {
+  const value = options[`${baseName}Level`]
+  if (value === undefined) return
+
+  if (typeof value === 'string' || value instanceof String) {
+    normalized[`${baseName}Level`] = String(value)
+    return
+  }
+
+  throw new Error(`option ${baseName}Level must be a string like "info,events=debug"`)
 }
 
 function jsLogOption (value) {
@@ -81,10 +111,32 @@ function configure (options) {
   logOption('mainLog', options, normalized)
   logOption('workerLog', options, normalized)
   logOption('pollingLog', options, normalized)
+  logLevelOption('mainLog', options, normalized)
+  logLevelOption('workerLog', options, normalized)
+  logLevelOption('pollingLog', options, normalized)
   jsLogOption(options.jsLog)
 
   if (options.workerCacheSize) normalized.workerCacheSize = options.workerCacheSize
   if (options.pollingThrottle) normalized.pollingThrottle = options.pollingThrottle
+  if (options.pollingWorkers) normalized.pollingWorkers = options.pollingWorkers
+  if (options.pollingHotShare !== undefined) {
+    if (!Number.isInteger(options.pollingHotShare) || options.pollingHotShare < 0 || options.pollingHotShare > 100) {
+      return Promise.reject(new Error('option pollingHotShare must be an integer percentage between 0 and 100'))
+    }
+    normalized.pollingHotShare = options.pollingHotShare
+  }
+  if (options.pollingBudget !== undefined) {
+    if (!Number.isInteger(options.pollingBudget) || options.pollingBudget < 0 || options.pollingBudget > 100) {
+      return Promise.reject(new Error('option pollingBudget must be an integer percentage between 0 and 100'))
+    }
+    normalized.pollingBudget = options.pollingBudget
+  }
+  if (options.pollingSnapshots !== undefined) {
+    if (typeof options.pollingSnapshots !== 'string') {
+      return Promise.reject(new Error('option pollingSnapshots must be a directory path or an empty string'))
+    }
+    normalized.pollingSnapshots = options.pollingSnapshots === '' ? '' : path.resolve(options.pollingSnapshots)
+  }
   if (options.pollingInterval) normalized.pollingInterval = options.pollingInterval
 
   return new Promise((resolve, reject) => {
@@ -92,11 +144,95 @@ function configure (options) {
   })
 }
 
-function status () {
+// Private: Bits corresponding to each event class accepted by the `events` option of {watchPath}. These must match the
+// `EventClass` enumeration in src/message.h.
+const EVENT_CLASSES = {
+  created: 1 << 0,
+  deleted: 1 << 1,
+  modified: 1 << 2,
+  renamed: 1 << 3,
+  attributes: 1 << 4,
+  settled: 1 << 5
+}
+
+function eventMaskOption (events) {
+  if (!Array.isArray(events)) {
+    throw new Error('option events must be an Array of event class names')
+  }
+
+  let mask = 0
+  for (const eventClass of events) {
+    const bit = EVENT_CLASSES[eventClass]
+    if (bit === undefined) {
+      throw new Error(`option events contains an unrecognized event class: ${eventClass}`)
+    }
+    mask |= bit
+  }
+  return mask
+}
+
+function exclusionsOption (exclude) {
+  if (!Array.isArray(exclude)) {
+    throw new Error('option exclude must be an Array of patterns')
+  }
+
+  for (const pattern of exclude) {
+    if (typeof pattern !== 'string' && !(pattern instanceof String)) {
+      throw new Error('option exclude must contain only String patterns')
+    }
+    if (/[\r\n]/.test(pattern)) {
+      throw new Error(`option exclude contains a pattern spanning multiple lines: ${JSON.stringify(pattern)}`)
+    }
+  }
+
+  return exclude.join('\n')
+}
+
+function gitignoreOption (gitignore) {
+  if (typeof gitignore !== 'boolean') {
+    throw new Error('option gitignore must be a Boolean')
+  }
+  return gitignore
+}
+
+function watch (rootPath, options, ackCallback, eventCallback) {
+  const normalized = Object.assign({}, options)
+  if (options.events !== undefined) {
+    normalized.eventMask = eventMaskOption(options.events)
+    delete normalized.events
+  }
+  if (options.exclude !== undefined) {
+    normalized.exclusions = exclusionsOption(options.exclude)
+    delete normalized.exclude
+  }
+  if (options.gitignore !== undefined) {
+    normalized.gitignore = gitignoreOption(options.gitignore)
+  }
+
+  return getWatcher().watch(rootPath, normalized, ackCallback, eventCallback)
+}
+
+function status (options = {}) {
+  const normalized = {}
+  if (options.perChannel !== undefined) normalized.perChannel = options.perChannel
+  if (options.top !== undefined) normalized.top = options.top
+
   return new Promise((resolve, reject) => {
     getWatcher().status((err, st) => {
       if (err) { reject(err) } else { resolve(st) }
-    })
+    }, normalized)
+  })
+}
+
+function openMetrics (options = {}) {
+  const normalized = { format: 'openmetrics' }
+  if (options.perChannel !== undefined) normalized.perChannel = options.perChannel
+  if (options.top !== undefined) normalized.top = options.top
+
+  return new Promise((resolve, reject) => {
+    getWatcher().status((err, text) => {
+      if (err) { reject(err) } else { resolve(text) }
+    }, normalized)
   })
 }
 
@@ -107,10 +243,20 @@ function lazy (key) {
 }
 
 module.exports = {
-  watch: lazy('watch'),
+  watch,
   unwatch: lazy('unwatch'),
+  route: lazy('route'),
+  unroute: lazy('unroute'),
   configure,
   status,
+  openMetrics,
+  metrics: lazy('metrics'),
+  startTracing: lazy('startTracing'),
+  stopTracing: lazy('stopTracing'),
+  eventMaskOption,
+  exclusionsOption,
+  gitignoreOption,
+  binaryLog,
 
   DISABLE,
   STDERR,
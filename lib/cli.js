@@ -2,11 +2,25 @@
 
 const path = require('path')
 const watcher = require('./index')
+const { decodeLogFile } = require('./log-decoder')
 
 function usage () {
   console.log('Usage: watcher <pattern> [<pattern>...] [options]')
+  console.log('       watcher --decode-log <file>')
   console.log('  -h, --help\tShow help')
   console.log('  -v, --verbose\tMake output more verbose')
+  console.log('  --decode-log\tPrint a binary native log as text')
+}
+
+function decode (logFile) {
+  try {
+    for (const line of decodeLogFile(logFile)) {
+      console.log(line)
+    }
+  } catch (err) {
+    console.error('Error:', err.message)
+    process.exitCode = 1
+  }
 }
 
 function start (dirs, verbose) {
@@ -44,6 +58,7 @@ function start (dirs, verbose) {
 function main (argv) {
   const dirs = []
   let verbose = false
+  let logFile = null
 
   argv.forEach((arg, i) => {
     if (i === 0) {
@@ -56,11 +71,19 @@ function main (argv) {
       return usage()
     } else if (arg === '-v' || arg === '--verbose') {
       verbose = true
+    } else if (arg === '--decode-log') {
+      logFile = argv[i + 1] || ''
+    } else if (logFile !== null && argv[i - 1] === '--decode-log') {
+      return
     } else {
       dirs.push(arg)
     }
   })
 
+  if (logFile !== null) {
+    return logFile ? decode(logFile) : usage()
+  }
+
   if (dirs.length === 0) {
     return usage()
   }
@@ -1,5 +1,16 @@
 const { PathWatcherManager } = require('./path-watcher-manager')
-const { configure, status, DISABLE, STDERR, STDOUT } = require('./binding')
+const {
+  configure,
+  status,
+  openMetrics,
+  metrics,
+  startTracing,
+  stopTracing,
+  binaryLog,
+  DISABLE,
+  STDERR,
+  STDOUT
+} = require('./binding')
 
 // Extended: Invoke a callback with each filesystem event that occurs beneath a specified path.
 //
@@ -73,6 +84,11 @@ module.exports = {
   printWatchers,
   configure,
   status,
+  openMetrics,
+  metrics,
+  startTracing,
+  stopTracing,
+  binaryLog,
   DISABLE,
   STDERR,
   STDOUT
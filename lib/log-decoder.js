@@ -0,0 +1,103 @@
+const fs = require('fs')
+const os = require('os')
+
+// Private: Layout of files written by a native `BinaryLogger`. Keep these in sync with src/binary_logger.cpp.
+const LOG_MAGIC = 'watchlog'
+const LOG_VERSION = 1
+const LOG_BYTE_ORDER = 0x01020304
+const HEADER_LENGTH = 16
+const RECORD_HEADER_LENGTH = 16
+const SITE_DEFINITION = 0x80000000
+const SITE_DROPPED = 0x7fffffff
+
+// Private: Parse the contents of a binary log file.
+//
+// * `buffer` {Buffer} containing the bytes of the file.
+//
+// Returns an {Array} of records, each an object with a `time` {Date}, the `nanoseconds` within its second as a
+// {Number}, and either a `text` {String} with its `site` {String} or `null` if the line had no location, or a
+// `dropped` {Number} of records that were discarded before it because the logging thread outpaced the disk. Throws
+// an {Error} if the file isn't a binary log this version can read. A record that was cut off by a crash is ignored.
+function decodeLog (buffer) {
+  if (buffer.length < HEADER_LENGTH || buffer.toString('latin1', 0, LOG_MAGIC.length) !== LOG_MAGIC) {
+    throw new Error('Not a binary watcher log')
+  }
+
+  // Integers are written in the byte order of the machine that wrote the log.
+  let littleEndian = os.endianness() === 'LE'
+  const readUInt32 = offset => littleEndian ? buffer.readUInt32LE(offset) : buffer.readUInt32BE(offset)
+  const readUInt64 = offset => {
+    const low = readUInt32(offset + (littleEndian ? 0 : 4))
+    const high = readUInt32(offset + (littleEndian ? 4 : 0))
+    return { high, low }
+  }
+
+  if (readUInt32(12) !== LOG_BYTE_ORDER) {
+    littleEndian = !littleEndian
+    if (readUInt32(12) !== LOG_BYTE_ORDER) throw new Error('Unrecognized byte order marker')
+  }
+
+  const version = readUInt32(8)
+  if (version !== LOG_VERSION) {
+    throw new Error(`Unsupported binary log version ${version}`)
+  }
+
+  const sites = new Map()
+  const records = []
+  let offset = HEADER_LENGTH
+  while (offset + RECORD_HEADER_LENGTH <= buffer.length) {
+    const length = readUInt32(offset)
+    const site = readUInt32(offset + 4)
+    const timestamp = readUInt64(offset + 8)
+    const payloadStart = offset + RECORD_HEADER_LENGTH
+    const payloadEnd = payloadStart + length
+    if (payloadEnd > buffer.length) break
+    offset = payloadEnd
+
+    if (site >= SITE_DEFINITION) {
+      sites.set(site - SITE_DEFINITION, buffer.toString('utf8', payloadStart, payloadEnd))
+      continue
+    }
+
+    // Split the nanosecond timestamp into whole seconds and a remainder without exceeding a double's precision.
+    const seconds = Math.floor((timestamp.high * 0x100000000) / 1e9 + timestamp.low / 1e9)
+    const nanoseconds = timestamp.high * 0x100000000 - seconds * 1e9 + timestamp.low
+    const record = { time: new Date(seconds * 1000), nanoseconds: Math.max(0, Math.min(999999999, nanoseconds)) }
+
+    if (site === SITE_DROPPED) {
+      const count = readUInt64(payloadStart)
+      record.dropped = count.high * 0x100000000 + count.low
+    } else {
+      record.site = site === 0 ? null : sites.get(site) || `site ${site}`
+      record.text = buffer.toString('utf8', payloadStart, payloadEnd)
+    }
+    records.push(record)
+  }
+
+  return records
+}
+
+// Private: Render a record from `decodeLog()` as a line of text.
+function formatRecord (record) {
+  const fraction = String(Math.floor(record.nanoseconds / 1000)).padStart(6, '0')
+  const time = record.time.toISOString().replace(/\.\d+Z$/, `.${fraction}Z`)
+
+  if (record.dropped !== undefined) {
+    return `${time} [${record.dropped} record${record.dropped === 1 ? '' : 's'} dropped]`
+  }
+  if (record.site === null) {
+    return `${time} ${record.text}`
+  }
+  return `${time} [${record.site}] ${record.text}`
+}
+
+// Private: Read the binary log at `filePath` and return its records rendered as an {Array} of lines.
+function decodeLogFile (filePath) {
+  return decodeLog(fs.readFileSync(filePath)).map(formatRecord)
+}
+
+module.exports = {
+  decodeLog,
+  formatRecord,
+  decodeLogFile
+}
@@ -9,13 +9,58 @@ const { Tree } = require('./registry/tree')
 // 2. Subscribing to an existing {NativeWatcher} on a parent of a desired directory.
 // 3. Replacing multiple {NativeWatcher} instances on child directories with a single new {NativeWatcher} on the
 //    parent.
+//
+// Watchers that restrict the classes of events they receive with the `events` option are tracked in a separate tree
+// for each distinct set of event classes, because a {NativeWatcher} with a narrower event mask can't serve them.
+// Watchers with `exclude` patterns are tracked in a separate tree for each root and pattern set, because patterns are
+// interpreted relative to the watched directory. Watchers that honor `.gitignore` files are likewise kept apart by
+// root, because only the `.gitignore` files beneath the watched directory are read.
 class NativeWatcherRegistry {
   // Private: Instantiate an empty registry.
   //
   // * `createNative` {Function} that will be called with a normalized filesystem path to create a new native
   //   filesystem watcher.
   constructor (createNative) {
+    this.createNative = createNative
     this.tree = new Tree([], createNative)
+    this.filteredTrees = new Map()
+  }
+
+  // Private: Locate the {Tree} containing native watchers that deliver the events requested by an options {Object}
+  // for a watcher at `normalizedDirectory`, creating it if necessary.
+  treeFor (normalizedDirectory, options) {
+    const gitignore = options.gitignore === true
+    if (options.events === undefined && options.exclude === undefined && !gitignore) return this.tree
+
+    const filters = {}
+    const keyParts = []
+    if (options.events !== undefined) {
+      filters.events = Array.from(new Set(options.events)).sort()
+      keyParts.push(`events ${filters.events.join(',')}`)
+    }
+    if (options.exclude !== undefined) {
+      filters.exclude = options.exclude
+      keyParts.push(`exclude ${JSON.stringify(options.exclude)}`)
+    }
+    if (gitignore) {
+      filters.gitignore = true
+      keyParts.push('gitignore')
+    }
+    if (options.exclude !== undefined || gitignore) {
+      keyParts.push(`root ${normalizedDirectory}`)
+    }
+
+    const key = keyParts.join(' ')
+    let tree = this.filteredTrees.get(key)
+    if (!tree) {
+      // Nodes reconstruct their options when watchers are split or consolidated, so ensure that every native watcher
+      // created within this tree receives the same filters.
+      tree = new Tree([], (normalizedPath, nativeOptions) => {
+        return this.createNative(normalizedPath, Object.assign({}, nativeOptions, filters))
+      })
+      this.filteredTrees.set(key, tree)
+    }
+    return tree
   }
 
   // Private: Attach a watcher to a directory, assigning it a {NativeWatcher}. If a suitable {NativeWatcher} already
@@ -34,7 +79,8 @@ class NativeWatcherRegistry {
     const pathSegments = normalizedDirectory.split(path.sep).filter(segment => segment.length > 0)
 
     log('adding watcher %s to tree.', watcher)
-    this.tree.add(pathSegments, watcher.getOptions(), (native, nativePath, options) => {
+    const options = watcher.getOptions()
+    this.treeFor(normalizedDirectory, options).add(pathSegments, options, (native, nativePath, options) => {
       watcher.attachToNative(native, nativePath, options)
     })
     log('watcher %s added. tree state:\n%s', watcher, this.print())
@@ -45,7 +91,11 @@ class NativeWatcherRegistry {
   //
   // Returns a {String} showing the tree structure.
   print () {
-    return this.tree.print()
+    let output = this.tree.print()
+    for (const [key, tree] of this.filteredTrees) {
+      output += `${key}:\n${tree.print()}`
+    }
+    return output
   }
 }
 
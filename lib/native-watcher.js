@@ -36,6 +36,9 @@ class NativeWatcher {
     this.channel = null
     this.state = STOPPED
 
+    // Subscribers that receive only the events beneath a path. Their events are filtered natively.
+    this.routes = new Set()
+
     this.onEvents = this.onEvents.bind(this)
     this.onError = this.onError.bind(this)
 
@@ -73,6 +76,9 @@ class NativeWatcher {
     log('NativeWatcher %s assigned channel %d.', this, this.channel)
 
     this.state = RUNNING
+    for (const route of this.routes) {
+      this.openRoute(route)
+    }
     this.emitter.emit('did-start')
   }
 
@@ -99,12 +105,31 @@ class NativeWatcher {
   //
   // Returns: A {Disposable} to revoke the subscription.
   onDidChange (callback) {
+    return this.onDidChangeWithin(this.normalizedPath, this.options.recursive !== false, callback)
+  }
+
+  // Private: Register a callback to be invoked with the normalized filesystem events that occur at or beneath a path
+  // within this watcher's root. Events are filtered by the native module, which also reports renames that cross
+  // `routePath` as a deletion or creation of the side that lies within it. Starts the watcher automatically if it is
+  // not already running. The watcher will be stopped automatically when all subscribers dispose their subscriptions.
+  //
+  // * `routePath` {String} absolute path of the directory or file to receive events from.
+  // * `recursive` {Boolean} if false, only events on `routePath` and its immediate children will be delivered.
+  // * `callback` {Function} to be called with each batch of matching events.
+  //
+  // Returns: A {Disposable} to revoke the subscription.
+  onDidChangeWithin (routePath, recursive, callback) {
     this.start()
 
-    const sub = this.emitter.on('did-change', callback)
+    const route = { path: routePath, recursive, callback, id: null }
+    this.routes.add(route)
+    if (this.state === RUNNING) this.openRoute(route)
+
     return new Disposable(() => {
-      sub.dispose()
-      if (this.emitter.listenerCountForEventName('did-change') === 0) {
+      if (!this.routes.delete(route)) return
+      this.closeRoute(route)
+
+      if (this.routes.size === 0) {
         log('Last subscriber disposed on NativeWatcher %s.', this)
         this.stop()
       }
@@ -183,6 +208,10 @@ class NativeWatcher {
     await new Promise((resolve, reject) => {
       binding.unwatch(this.channel, err => (err ? reject(err) : resolve()))
     })
+    // Unwatching a channel removes its native routes.
+    for (const route of this.routes) {
+      route.id = null
+    }
     this.channel = null
     this.state = STOPPED
     log('NativeWatcher %s has been stopped.', this)
@@ -190,8 +219,30 @@ class NativeWatcher {
     this.emitter.emit('did-stop')
   }
 
-  // Private: Callback function invoked by the native watcher when a debounced group of filesystem events arrive.
-  // Normalize and re-broadcast them to any subscribers.
+  // Private: Begin delivering native events to a subscriber registered with {onDidChangeWithin}.
+  openRoute (route) {
+    if (route.id !== null) return
+
+    route.id = binding.route(this.channel, route.path, route.recursive, (err, events) => {
+      if (err) {
+        return this.onError(err)
+      }
+
+      route.callback(this.translate(events))
+    })
+    log('NativeWatcher %s routing events beneath %s to route %d.', this, route.path, route.id)
+  }
+
+  // Private: Stop delivering native events to a subscriber registered with {onDidChangeWithin}.
+  closeRoute (route) {
+    if (route.id === null) return
+
+    binding.unroute(route.id)
+    route.id = null
+  }
+
+  // Private: Callback function invoked by the native watcher when a debounced group of filesystem events arrive
+  // outside of any route. Normalize and re-broadcast them to any subscribers.
   //
   // * `events` An Array of filesystem events.
   onEvents (err, events) {
@@ -199,7 +250,12 @@ class NativeWatcher {
       return this.onError(err)
     }
 
-    const translated = events.map(event => {
+    this.emitter.emit('did-change', this.translate(events))
+  }
+
+  // Private: Normalize a batch of events from the native module.
+  translate (events) {
+    return events.map(event => {
       const n = {
         action: ACTIONS.get(event.action),
         kind: ENTRIES.get(event.kind),
@@ -210,8 +266,6 @@ class NativeWatcher {
 
       return n
     })
-
-    this.emitter.emit('did-change', translated)
   }
 
   // Private: Callback function invoked by the native watcher when an error occurs.
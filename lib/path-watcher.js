@@ -3,6 +3,7 @@ const path = require('path')
 
 const { Emitter, CompositeDisposable, Disposable } = require('event-kit')
 const { log } = require('./logger')
+const { eventMaskOption, exclusionsOption, gitignoreOption } = require('./binding')
 
 // Extended: Manage a subscription to filesystem events that occur beneath a root directory. Construct these by
 // calling `watchPath`.
@@ -64,6 +65,7 @@ class PathWatcher {
     log('create PathWatcher at %s with options %j.', watchedPath, options)
 
     this.normalizedPath = null
+    this.routePath = null
     this.native = null
     this.changeCallbacks = new Map()
 
@@ -84,6 +86,11 @@ class PathWatcher {
       fs.stat(watchedPath)
     ]).then(([real, stat]) => {
       log('normalized and stat path %s to %s.', watchedPath, real)
+      if (this.options.events !== undefined) eventMaskOption(this.options.events)
+      if (this.options.exclude !== undefined) exclusionsOption(this.options.exclude)
+      if (this.options.gitignore !== undefined) gitignoreOption(this.options.gitignore)
+
+      this.routePath = real
       if (stat.isDirectory()) {
         this.normalizedPath = real
       } else {
@@ -155,7 +162,7 @@ class PathWatcher {
   // Returns a {Disposable} that will stop the underlying watcher when all callbacks mapped to it have been disposed.
   onDidChange (callback) {
     if (this.native) {
-      const sub = this.native.onDidChange(events => this.onNativeEvents(events, callback))
+      const sub = this.subscribeToNative(this.native, callback)
       this.changeCallbacks.set(callback, sub)
 
       this.native.start()
@@ -208,7 +215,7 @@ class PathWatcher {
       if (this.native === native) {
         log('transferring %d existing event subscriptions to new native %s.', this.changeCallbacks.size, native)
         for (const [callback, formerSub] of this.changeCallbacks) {
-          const newSub = native.onDidChange(events => this.onNativeEvents(events, callback))
+          const newSub = this.subscribeToNative(native, callback)
           this.changeCallbacks.set(callback, newSub)
           formerSub.dispose()
         }
@@ -242,19 +249,19 @@ class PathWatcher {
     this.resolveAttachedPromise()
   }
 
-  // Private: Invoked when the attached native watcher creates a batch of native filesystem events. The native watcher's
-  // events may include events for paths above this watcher's root path, so filter them to only include the relevant
-  // ones, then re-broadcast them to our subscribers.
-  onNativeEvents (events, callback) {
-    const isWatchedPath = eventPath => {
-      if (!eventPath.startsWith(this.normalizedPath)) return false
-      if (!this.options.recursive) {
-        if (path.dirname(eventPath) !== this.normalizedPath && eventPath !== this.normalizedPath) return false
-      }
-      if (!this.options.include(eventPath)) return false
+  // Private: Subscribe to the events beneath this watcher's root from a native watcher that may be watching one of its
+  // parent directories.
+  subscribeToNative (native, callback) {
+    return native.onDidChangeWithin(this.routePath, this.options.recursive, events => {
+      this.onNativeEvents(events, callback)
+    })
+  }
 
-      return true
-    }
+  // Private: Invoked when the attached native watcher delivers a batch of filesystem events beneath this watcher's
+  // root path. The native module has already narrowed them to our subtree and converted renames that cross its
+  // boundary, so apply any remaining filters, then re-broadcast them to our subscribers.
+  onNativeEvents (events, callback) {
+    const isWatchedPath = eventPath => this.options.include(eventPath)
 
     const shouldRewrite = !this.watchedPath.startsWith(this.normalizedPath)
     const modifyPath = shouldRewrite
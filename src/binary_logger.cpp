@@ -0,0 +1,309 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <ostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <uv.h>
+
+#include "binary_logger.h"
+#include "lock.h"
+#include "log.h"
+
+using std::endl;
+using std::ofstream;
+using std::ostringstream;
+using std::string;
+using std::chrono::duration_cast;
+using std::chrono::nanoseconds;
+using std::chrono::system_clock;
+
+static const char LOG_MAGIC[8] = {'w', 'a', 't', 'c', 'h', 'l', 'o', 'g'};
+
+// Incremented whenever the layout of the file changes.
+static const uint32_t LOG_VERSION = 1;
+
+// Read back as a different value on a machine with the opposite byte order.
+static const uint32_t LOG_BYTE_ORDER = 0x01020304;
+
+// Bytes of ring buffer allocated to each logger. Must be a power of two.
+static const size_t RING_SIZE = 1 << 20;
+
+// Lines longer than this are truncated, so that a single record can never fill the ring.
+static const size_t MAX_PAYLOAD = 64 * 1024;
+
+// Set within the site ID of a record that names a site rather than logging a line from it.
+static const uint32_t SITE_DEFINITION = 0x80000000u;
+
+// Site ID of a record whose payload is the 64-bit count of records dropped before it.
+static const uint32_t SITE_DROPPED = 0x7fffffffu;
+
+// Site IDs are unique across every logger within the process, so that threads logging to the same file don't
+// redefine each other's sites.
+static std::atomic<uint32_t> next_site{1};
+
+// Time that the flusher thread sleeps between drains.
+static const uint64_t FLUSH_INTERVAL_NS = 20 * 1000 * 1000;
+
+struct RecordHeader
+{
+  uint32_t length;
+  uint32_t site;
+  uint64_t timestamp;
+};
+
+// Drains the rings of every live `BinaryLogger` to their files from a single background thread.
+class BinaryLogFlusher
+{
+public:
+  static BinaryLogFlusher &get()
+  {
+    static BinaryLogFlusher flusher;
+    return flusher;
+  }
+
+  // Begin draining `logger`, starting the thread if it isn't already running.
+  void add(BinaryLogger *logger)
+  {
+    Lock lock(mutex);
+    loggers.insert(logger);
+
+    if (!started) {
+      started = uv_thread_create(&thread, &BinaryLogFlusher::thread_main, this) == 0;
+    }
+  }
+
+  // Stop draining `logger` after writing whatever remains within its ring.
+  void remove(BinaryLogger *logger)
+  {
+    Lock lock(mutex);
+    logger->drain();
+
+    // The ring is empty now, so a count of records dropped at the very end always fits.
+    if (logger->dropped > 0 && logger->append_dropped()) logger->drain();
+    loggers.erase(logger);
+  }
+
+  BinaryLogFlusher(const BinaryLogFlusher &) = delete;
+  BinaryLogFlusher(BinaryLogFlusher &&) = delete;
+  BinaryLogFlusher &operator=(const BinaryLogFlusher &) = delete;
+  BinaryLogFlusher &operator=(BinaryLogFlusher &&) = delete;
+
+private:
+  BinaryLogFlusher() : started{false}, stopping{false}
+  {
+    uv_mutex_init(&mutex);
+    uv_cond_init(&wake_cond);
+  }
+
+  // Write out anything still buffered when the process exits.
+  ~BinaryLogFlusher()
+  {
+    {
+      Lock lock(mutex);
+      stopping = true;
+      uv_cond_signal(&wake_cond);
+    }
+    if (started) uv_thread_join(&thread);
+
+    uv_cond_destroy(&wake_cond);
+    uv_mutex_destroy(&mutex);
+  }
+
+  static void thread_main(void *arg) { static_cast<BinaryLogFlusher *>(arg)->run(); }
+
+  void run()
+  {
+    Lock lock(mutex);
+    while (true) {
+      for (BinaryLogger *logger : loggers) {
+        logger->drain();
+      }
+      if (stopping) return;
+
+      uv_cond_timedwait(&wake_cond, &mutex, FLUSH_INTERVAL_NS);
+    }
+  }
+
+  // Protects `loggers`, the files of each logger, and `stopping`. Never taken by a logging thread while it logs.
+  uv_mutex_t mutex{};
+  uv_cond_t wake_cond{};
+  uv_thread_t thread{};
+  bool started;
+  bool stopping;
+
+  std::set<BinaryLogger *> loggers;
+};
+
+BinaryLogger::BinaryLogger(const char *filename) :
+  log_file{filename, std::ios::out | std::ios::app | std::ios::binary},
+  line_buffer{this},
+  line_stream{&line_buffer},
+  line_started{false},
+  site_file{nullptr},
+  site_line{0},
+  line_timestamp{0},
+  dropped{0},
+  ring{new char[RING_SIZE]},
+  head{0},
+  tail{0}
+{
+  if (!log_file) {
+    int stream_errno = errno;
+
+    ostringstream msg;
+    msg << "Unable to log to " << filename << ": " << std::strerror(stream_errno);
+    err = msg.str();
+    return;
+  }
+
+  // A file that's being appended to already has its header.
+  if (log_file.tellp() == 0) {
+    log_file.write(LOG_MAGIC, sizeof(LOG_MAGIC));
+    log_file.write(reinterpret_cast<const char *>(&LOG_VERSION), sizeof(LOG_VERSION));
+    log_file.write(reinterpret_cast<const char *>(&LOG_BYTE_ORDER), sizeof(LOG_BYTE_ORDER));
+    log_file.flush();
+  }
+
+  BinaryLogger::prefix(__FILE__, __LINE__);
+  line_stream << "BinaryLogger opened." << endl;
+
+  BinaryLogFlusher::get().add(this);
+}
+
+BinaryLogger::~BinaryLogger()
+{
+  if (!err.empty()) return;
+
+  complete_line();
+  BinaryLogFlusher::get().remove(this);
+}
+
+Logger *BinaryLogger::prefix(const char *file, int line_number)
+{
+  complete_line();
+
+  line_timestamp = static_cast<uint64_t>(duration_cast<nanoseconds>(system_clock::now().time_since_epoch()).count());
+  line_started = true;
+  site_file = file;
+  site_line = line_number;
+  return this;
+}
+
+BinaryLogger::LineBuffer::int_type BinaryLogger::LineBuffer::overflow(int_type c)
+{
+  if (!traits_type::eq_int_type(c, traits_type::eof())) {
+    logger->line.push_back(traits_type::to_char_type(c));
+  }
+  return traits_type::not_eof(c);
+}
+
+std::streamsize BinaryLogger::LineBuffer::xsputn(const char *s, std::streamsize n)
+{
+  logger->line.append(s, static_cast<size_t>(n));
+  return n;
+}
+
+int BinaryLogger::LineBuffer::sync()
+{
+  logger->complete_line();
+  return 0;
+}
+
+void BinaryLogger::complete_line()
+{
+  if (!line_started && line.empty()) return;
+
+  if (!line.empty() && line.back() == '\n') line.pop_back();
+  if (line.size() > MAX_PAYLOAD) line.resize(MAX_PAYLOAD);
+  if (!line_started) {
+    line_timestamp = static_cast<uint64_t>(duration_cast<nanoseconds>(system_clock::now().time_since_epoch()).count());
+  }
+
+  // A line logged without a prefix has no site.
+  uint32_t site = 0;
+  bool written = append_dropped() && (!line_started || define_site(site))
+    && append(site, line_timestamp, line.data(), line.size());
+  if (!written) dropped++;
+
+  line.clear();
+  line_started = false;
+}
+
+bool BinaryLogger::define_site(uint32_t &site)
+{
+  auto key = std::make_pair(site_file, site_line);
+  auto existing = sites.find(key);
+  if (existing != sites.end()) {
+    site = existing->second;
+    return true;
+  }
+
+  // A site whose definition doesn't fit is defined again the next time it logs.
+  uint32_t id = next_site.fetch_add(1, std::memory_order_relaxed);
+  string name(site_file);
+  name += ':';
+  name += std::to_string(site_line);
+  if (!append(SITE_DEFINITION | id, line_timestamp, name.data(), name.size())) return false;
+
+  sites.emplace(key, id);
+  site = id;
+  return true;
+}
+
+bool BinaryLogger::append_dropped()
+{
+  if (dropped == 0) return true;
+
+  uint64_t timestamp =
+    static_cast<uint64_t>(duration_cast<nanoseconds>(system_clock::now().time_since_epoch()).count());
+  if (!append(SITE_DROPPED, timestamp, reinterpret_cast<const char *>(&dropped), sizeof(dropped))) return false;
+
+  dropped = 0;
+  return true;
+}
+
+bool BinaryLogger::append(uint32_t site, uint64_t timestamp, const char *payload, size_t payload_length)
+{
+  size_t length = sizeof(RecordHeader) + payload_length;
+  size_t h = head.load(std::memory_order_relaxed);
+  if (RING_SIZE - (h - tail.load(std::memory_order_acquire)) < length) return false;
+
+  RecordHeader header{static_cast<uint32_t>(payload_length), site, timestamp};
+  copy_in(h, reinterpret_cast<const char *>(&header), sizeof(header));
+  copy_in(h + sizeof(header), payload, payload_length);
+
+  head.store(h + length, std::memory_order_release);
+  return true;
+}
+
+void BinaryLogger::copy_in(size_t position, const char *bytes, size_t length)
+{
+  size_t offset = position & (RING_SIZE - 1);
+  size_t first = std::min(length, RING_SIZE - offset);
+  std::memcpy(ring.get() + offset, bytes, first);
+  std::memcpy(ring.get(), bytes + first, length - first);
+}
+
+void BinaryLogger::drain()
+{
+  size_t h = head.load(std::memory_order_acquire);
+  size_t t = tail.load(std::memory_order_relaxed);
+  if (h == t) return;
+
+  while (t != h) {
+    size_t offset = t & (RING_SIZE - 1);
+    size_t chunk = std::min(h - t, RING_SIZE - offset);
+    log_file.write(ring.get() + offset, static_cast<std::streamsize>(chunk));
+    t += chunk;
+  }
+  log_file.flush();
+
+  tail.store(t, std::memory_order_release);
+}
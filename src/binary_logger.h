@@ -0,0 +1,113 @@
+#ifndef BINARY_LOGGER_H
+#define BINARY_LOGGER_H
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <utility>
+
+#include "log.h"
+
+// A `Logger` that never waits for the disk.
+//
+// Each line is formatted on the logging thread as usual, then appended as a compact binary record to a lock-free ring
+// buffer owned by this logger. A single background flusher thread shared by every `BinaryLogger` drains the rings to
+// their files. If a ring fills because the flusher has fallen behind, records are dropped rather than blocking the
+// logging thread, and the number dropped is recorded in their place.
+//
+// The file begins with the 8-byte magic `watchlog`, a 32-bit format version, and a 32-bit byte order marker. A series
+// of records follows, each made of a 32-bit payload length, a 32-bit site ID, a 64-bit timestamp in nanoseconds since
+// the Unix epoch, and the payload. The first time each `__FILE__` and `__LINE__` pair logs, a site definition record
+// carrying its name is written, so the location isn't repeated with every line. Integers are stored in the native byte
+// order. `watcher --decode-log` renders a file as text.
+class BinaryLogger : public Logger
+{
+public:
+  // Open `filename` and register with the flusher thread. Check `get_error()` for failure.
+  explicit BinaryLogger(const char *filename);
+
+  // Deregister from the flusher thread, writing any records that remain within the ring.
+  ~BinaryLogger() override;
+
+  Logger *prefix(const char *file, int line) override;
+
+  std::ostream &stream() override { return line_stream; }
+
+  std::string get_error() const override { return err; }
+
+  BinaryLogger(const BinaryLogger &) = delete;
+  BinaryLogger(BinaryLogger &&) = delete;
+  BinaryLogger &operator=(const BinaryLogger &) = delete;
+  BinaryLogger &operator=(BinaryLogger &&) = delete;
+
+private:
+  // Collects the text of the current line. Flushing the stream, as `std::endl` does, completes the line.
+  class LineBuffer : public std::streambuf
+  {
+  public:
+    explicit LineBuffer(BinaryLogger *logger) : logger{logger} {}
+
+  protected:
+    int_type overflow(int_type c) override;
+
+    std::streamsize xsputn(const char *s, std::streamsize n) override;
+
+    int sync() override;
+
+  private:
+    BinaryLogger *logger;
+  };
+
+  // Append the current line, if there is one, to the ring as a record.
+  void complete_line();
+
+  // Look up the site ID of the current line, appending a record that defines it if this is the first time it's logged.
+  // Return `false` if there wasn't room for the definition.
+  bool define_site(uint32_t &site);
+
+  // Append a record of the count of records dropped so far, if any were. Return `false` if there wasn't room for it.
+  bool append_dropped();
+
+  // Append a single record to the ring. Return `false` if there wasn't room for it.
+  bool append(uint32_t site, uint64_t timestamp, const char *payload, size_t payload_length);
+
+  // Copy `length` bytes into the ring at the logical offset `position`, wrapping around its end if necessary.
+  void copy_in(size_t position, const char *bytes, size_t length);
+
+  // Called on the flusher thread to write every complete record to the file.
+  void drain();
+
+  std::ofstream log_file;
+  std::string err;
+
+  LineBuffer line_buffer;
+  std::ostream line_stream;
+
+  // Text and metadata of the line being formatted.
+  std::string line;
+  bool line_started;
+  const char *site_file;
+  int site_line;
+  uint64_t line_timestamp;
+
+  // Site IDs assigned to each `__FILE__` and `__LINE__` pair, on the logging thread.
+  std::map<std::pair<const char *, int>, uint32_t> sites;
+
+  // Records dropped since the last one that fit. Only touched by the logging thread.
+  uint64_t dropped;
+
+  // Single-producer, single-consumer ring. `head` and `tail` count bytes ever written and drained, so the number
+  // in use is `head - tail`. The logging thread advances `head`; the flusher thread advances `tail`.
+  std::unique_ptr<char[]> ring;
+  std::atomic<size_t> head;
+  std::atomic<size_t> tail;
+
+  friend class BinaryLogFlusher;
+};
+
+#endif
@@ -8,6 +8,8 @@
 #include "nan/all_callback.h"
 #include "nan/async_callback.h"
 #include "nan/options.h"
+#include "path_matcher.h"
+#include "trace.h"
 
 using std::endl;
 using std::move;
@@ -24,22 +26,35 @@ using v8::Value;
 void configure(const Nan::FunctionCallbackInfo<Value> &info)
 {
   string main_log_file;
+  string main_log_binary;
   bool main_log_disable = false;
   bool main_log_stderr = false;
   bool main_log_stdout = false;
+  string main_log_level;
 
   string worker_log_file;
+  string worker_log_binary;
   bool worker_log_disable = false;
   bool worker_log_stderr = false;
   bool worker_log_stdout = false;
+  string worker_log_level;
   uint_fast32_t worker_cache_size = 0;
 
   string polling_log_file;
+  string polling_log_binary;
   bool polling_log_disable = false;
   bool polling_log_stderr = false;
   bool polling_log_stdout = false;
+  string polling_log_level;
   uint_fast32_t polling_interval = 0;
   uint_fast32_t polling_throttle = 0;
+  uint_fast32_t polling_workers = 0;
+  uint_fast32_t polling_hot_share = 0;
+  bool polling_hot_share_set = false;
+  uint_fast32_t polling_budget = 0;
+  bool polling_budget_set = false;
+  string polling_snapshots;
+  bool polling_snapshots_set = false;
 
   Nan::MaybeLocal<Object> maybe_options = Nan::To<Object>(info[0]);
   if (maybe_options.IsEmpty()) {
@@ -49,22 +64,40 @@ void configure(const Nan::FunctionCallbackInfo<Value> &info)
 
   Local<Object> options = maybe_options.ToLocalChecked();
   if (!get_string_option(options, "mainLogFile", main_log_file)) return;
+  if (!get_string_option(options, "mainLogBinary", main_log_binary)) return;
   if (!get_bool_option(options, "mainLogDisable", main_log_disable)) return;
   if (!get_bool_option(options, "mainLogStderr", main_log_stderr)) return;
   if (!get_bool_option(options, "mainLogStdout", main_log_stdout)) return;
+  if (!get_string_option(options, "mainLogLevel", main_log_level)) return;
 
   if (!get_string_option(options, "workerLogFile", worker_log_file)) return;
+  if (!get_string_option(options, "workerLogBinary", worker_log_binary)) return;
   if (!get_bool_option(options, "workerLogDisable", worker_log_disable)) return;
   if (!get_bool_option(options, "workerLogStderr", worker_log_stderr)) return;
   if (!get_bool_option(options, "workerLogStdout", worker_log_stdout)) return;
+  if (!get_string_option(options, "workerLogLevel", worker_log_level)) return;
   if (!get_uint_option(options, "workerCacheSize", worker_cache_size)) return;
 
   if (!get_string_option(options, "pollingLogFile", polling_log_file)) return;
+  if (!get_string_option(options, "pollingLogBinary", polling_log_binary)) return;
   if (!get_bool_option(options, "pollingLogDisable", polling_log_disable)) return;
   if (!get_bool_option(options, "pollingLogStderr", polling_log_stderr)) return;
   if (!get_bool_option(options, "pollingLogStdout", polling_log_stdout)) return;
+  if (!get_string_option(options, "pollingLogLevel", polling_log_level)) return;
   if (!get_uint_option(options, "pollingInterval", polling_interval)) return;
   if (!get_uint_option(options, "pollingThrottle", polling_throttle)) return;
+  if (!get_uint_option(options, "pollingWorkers", polling_workers)) return;
+
+  // Zero is a meaningful share, so note whether or not the option was provided at all.
+  polling_hot_share_set = Nan::Has(options, Nan::New<String>("pollingHotShare").ToLocalChecked()).FromMaybe(false);
+  if (!get_uint_option(options, "pollingHotShare", polling_hot_share)) return;
+
+  polling_budget_set = Nan::Has(options, Nan::New<String>("pollingBudget").ToLocalChecked()).FromMaybe(false);
+  if (!get_uint_option(options, "pollingBudget", polling_budget)) return;
+
+  // An empty directory disables snapshots.
+  polling_snapshots_set = Nan::Has(options, Nan::New<String>("pollingSnapshots").ToLocalChecked()).FromMaybe(false);
+  if (!get_string_option(options, "pollingSnapshots", polling_snapshots)) return;
 
   unique_ptr<AsyncCallback> callback(new AsyncCallback("@atom/watcher:configure", info[1].As<Function>()));
   shared_ptr<AllCallback> all = AllCallback::create(move(callback));
@@ -75,17 +108,27 @@ void configure(const Nan::FunctionCallbackInfo<Value> &info)
     r &= Hub::get()->disable_main_log();
   } else if (!main_log_file.empty()) {
     r &= Hub::get()->use_main_log_file(move(main_log_file));
+  } else if (!main_log_binary.empty()) {
+    r &= Hub::get()->use_main_log_binary_file(move(main_log_binary));
   } else if (main_log_stderr) {
     r &= Hub::get()->use_main_log_stderr();
   } else if (main_log_stdout) {
     r &= Hub::get()->use_main_log_stdout();
   }
 
+  // Levels are set after the log itself, so that a log created by this call begins with them.
+  if (!main_log_level.empty()) {
+    r &= Hub::get()->set_main_log_levels(main_log_level);
+  }
+
   if (worker_log_disable) {
     r &= Hub::get()->disable_worker_log(all->create_callback("@atom/watcher:binding.configure.disable_worker_log"));
   } else if (!worker_log_file.empty()) {
     r &= Hub::get()->use_worker_log_file(
       move(worker_log_file), all->create_callback("@atom/watcher:binding.configure.use_worker_log_file"));
+  } else if (!worker_log_binary.empty()) {
+    r &= Hub::get()->use_worker_log_binary_file(
+      move(worker_log_binary), all->create_callback("@atom/watcher:binding.configure.use_worker_log_binary_file"));
   } else if (worker_log_stderr) {
     r &=
       Hub::get()->use_worker_log_stderr(all->create_callback("@atom/watcher:binding.configure.use_worker_log_stderr"));
@@ -94,6 +137,11 @@ void configure(const Nan::FunctionCallbackInfo<Value> &info)
       Hub::get()->use_worker_log_stdout(all->create_callback("@atom/watcher:binding.configure.use_worker_log_stdout"));
   }
 
+  if (!worker_log_level.empty()) {
+    r &= Hub::get()->set_worker_log_levels(
+      move(worker_log_level), all->create_callback("@atom/watcher:binding.configure.set_worker_log_levels"));
+  }
+
   if (worker_cache_size > 0) {
     r &= Hub::get()->worker_cache_size(
       worker_cache_size, all->create_callback("@atom/watcher:binding.configure.worker_cache_size"));
@@ -104,6 +152,9 @@ void configure(const Nan::FunctionCallbackInfo<Value> &info)
   } else if (!polling_log_file.empty()) {
     r &= Hub::get()->use_polling_log_file(
       move(polling_log_file), all->create_callback("@atom/watcher:binding.configure.use_polling_log_file"));
+  } else if (!polling_log_binary.empty()) {
+    r &= Hub::get()->use_polling_log_binary_file(
+      move(polling_log_binary), all->create_callback("@atom/watcher:binding.configure.use_polling_log_binary_file"));
   } else if (polling_log_stderr) {
     r &= Hub::get()->use_polling_log_stderr(
       all->create_callback("@atom/watcher:binding.configure.use_polling_log_stderr"));
@@ -112,6 +163,11 @@ void configure(const Nan::FunctionCallbackInfo<Value> &info)
       all->create_callback("@atom/watcher:binding.configure.use_polling_log_stdout"));
   }
 
+  if (!polling_log_level.empty()) {
+    r &= Hub::get()->set_polling_log_levels(
+      move(polling_log_level), all->create_callback("@atom/watcher:binding.configure.set_polling_log_levels"));
+  }
+
   if (polling_interval > 0) {
     r &= Hub::get()->set_polling_interval(
       polling_interval, all->create_callback("@atom/watcher:binding.configure.set_polling_interval"));
@@ -122,6 +178,26 @@ void configure(const Nan::FunctionCallbackInfo<Value> &info)
       polling_throttle, all->create_callback("@atom/watcher:binding.configure.set_polling_throttle"));
   }
 
+  if (polling_workers > 0) {
+    r &= Hub::get()->set_polling_workers(
+      polling_workers, all->create_callback("@atom/watcher:binding.configure.set_polling_workers"));
+  }
+
+  if (polling_hot_share_set) {
+    r &= Hub::get()->set_polling_hot_share(
+      polling_hot_share, all->create_callback("@atom/watcher:binding.configure.set_polling_hot_share"));
+  }
+
+  if (polling_budget_set) {
+    r &= Hub::get()->set_polling_budget(
+      polling_budget, all->create_callback("@atom/watcher:binding.configure.set_polling_budget"));
+  }
+
+  if (polling_snapshots_set) {
+    r &= Hub::get()->set_polling_snapshots(
+      move(polling_snapshots), all->create_callback("@atom/watcher:binding.configure.set_polling_snapshots"));
+  }
+
   all->set_result(move(r));
   all->fire_if_empty(true);
 }
@@ -154,14 +230,28 @@ void watch(const Nan::FunctionCallbackInfo<Value> &info)
 
   bool poll = false;
   bool recursive = true;
+  uint_fast32_t events = EVENT_DEFAULT;
+  string exclusion_patterns;
+  bool gitignore = false;
   if (!get_bool_option(options, "poll", poll)) return;
   if (!get_bool_option(options, "recursive", recursive)) return;
+  if (!get_uint_option(options, "eventMask", events)) return;
+  if (!get_string_option(options, "exclusions", exclusion_patterns)) return;
+  if (!get_bool_option(options, "gitignore", gitignore)) return;
+
+  // Compile exclusions once, here, to be shared by the worker and polling threads.
+  shared_ptr<const PathMatcher> exclusions;
+  if (!exclusion_patterns.empty()) {
+    shared_ptr<PathMatcher> matcher(new PathMatcher(string(root_str), exclusion_patterns));
+    if (!matcher->empty()) exclusions = move(matcher);
+  }
 
   unique_ptr<AsyncCallback> ack_callback(new AsyncCallback("@atom/watcher:binding.watch.ack", info[2].As<Function>()));
   unique_ptr<AsyncCallback> event_callback(
     new AsyncCallback("@atom/watcher:binding.watch.event", info[3].As<Function>()));
 
-  Result<> r = Hub::get()->watch(move(root_str), poll, recursive, move(ack_callback), move(event_callback));
+  Result<> r = Hub::get()->watch(
+    move(root_str), poll, recursive, events, move(exclusions), gitignore, move(ack_callback), move(event_callback));
   if (r.is_error()) {
     Nan::ThrowError(r.get_error().c_str());
   }
@@ -189,15 +279,113 @@ void unwatch(const Nan::FunctionCallbackInfo<Value> &info)
   }
 }
 
+void route(const Nan::FunctionCallbackInfo<Value> &info)
+{
+  if (info.Length() != 4) {
+    Nan::ThrowError("route() requires four arguments");
+    return;
+  }
+
+  Nan::Maybe<uint32_t> maybe_channel_id = Nan::To<uint32_t>(info[0]);
+  if (maybe_channel_id.IsNothing()) {
+    Nan::ThrowError("route() requires a channel ID as its first argument");
+    return;
+  }
+  auto channel_id = static_cast<ChannelID>(maybe_channel_id.FromJust());
+
+  Nan::MaybeLocal<String> maybe_path = Nan::To<String>(info[1]);
+  if (maybe_path.IsEmpty()) {
+    Nan::ThrowError("route() requires a string as argument two");
+    return;
+  }
+  Nan::Utf8String path_utf8(maybe_path.ToLocalChecked());
+  if (*path_utf8 == nullptr) {
+    Nan::ThrowError("route() argument two must be a valid UTF-8 string");
+    return;
+  }
+  string path_str(*path_utf8, path_utf8.length());
+
+  bool recursive = Nan::To<bool>(info[2]).FromMaybe(true);
+
+  if (!info[3]->IsFunction()) {
+    Nan::ThrowError("route() requires a callback as argument four");
+    return;
+  }
+  unique_ptr<AsyncCallback> event_callback(
+    new AsyncCallback("@atom/watcher:binding.route.event", info[3].As<Function>()));
+
+  Result<RouteID> r = Hub::get()->route(channel_id, move(path_str), recursive, move(event_callback));
+  if (r.is_error()) {
+    Nan::ThrowError(r.get_error().c_str());
+    return;
+  }
+
+  info.GetReturnValue().Set(Nan::New<v8::Uint32>(static_cast<uint32_t>(r.get_value())));
+}
+
+void unroute(const Nan::FunctionCallbackInfo<Value> &info)
+{
+  Nan::Maybe<uint32_t> maybe_route_id = Nan::To<uint32_t>(info[0]);
+  if (info.Length() != 1 || maybe_route_id.IsNothing()) {
+    Nan::ThrowError("unroute() requires a route ID as its only argument");
+    return;
+  }
+
+  Result<> r = Hub::get()->unroute(static_cast<RouteID>(maybe_route_id.FromJust()));
+  if (r.is_error()) {
+    Nan::ThrowError(r.get_error().c_str());
+  }
+}
+
 void status(const Nan::FunctionCallbackInfo<Value> &info)
 {
+  Hub::StatusOptions status_options;
+  if (info.Length() > 1) {
+    Nan::MaybeLocal<Object> maybe_options = Nan::To<Object>(info[1]);
+    if (maybe_options.IsEmpty()) {
+      Nan::ThrowError("status() requires an option object as argument two");
+      return;
+    }
+    Local<Object> options = maybe_options.ToLocalChecked();
+
+    string format;
+    uint_fast32_t top = 0;
+    if (!get_string_option(options, "format", format)) return;
+    if (!get_bool_option(options, "perChannel", status_options.per_channel)) return;
+    if (!get_uint_option(options, "top", top)) return;
+
+    if (format == "openmetrics") {
+      status_options.format = Hub::STATUS_OPENMETRICS;
+    } else if (!format.empty() && format != "object") {
+      Nan::ThrowError("status() option format must be \"object\" or \"openmetrics\"");
+      return;
+    }
+    status_options.top = static_cast<size_t>(top);
+  }
+
   unique_ptr<AsyncCallback> callback(new AsyncCallback("@atom/watcher:binding.status", info[0].As<Function>()));
-  Hub::get()->status(move(callback));
+  Hub::get()->status(move(callback), status_options);
+}
+
+void metrics(const Nan::FunctionCallbackInfo<Value> &info)
+{
+  info.GetReturnValue().Set(Hub::get()->metrics());
+}
+
+void start_tracing(const Nan::FunctionCallbackInfo<Value> & /*info*/)
+{
+  Tracer::start();
+}
+
+void stop_tracing(const Nan::FunctionCallbackInfo<Value> &info)
+{
+  info.GetReturnValue().Set(Nan::New<String>(Tracer::stop()).ToLocalChecked());
 }
 
 void initialize(Local<Object> exports)
 {
   Logger::from_env("WATCHER_LOG_MAIN");
+  Tracer::name_thread("main thread");
 
   LOGGER << "Initializing module" << endl;
   Nan::Set(exports,
@@ -209,9 +397,24 @@ void initialize(Local<Object> exports)
   Nan::Set(exports,
     Nan::New<String>("unwatch").ToLocalChecked(),
     Nan::GetFunction(Nan::New<FunctionTemplate>(unwatch)).ToLocalChecked());
+  Nan::Set(exports,
+    Nan::New<String>("route").ToLocalChecked(),
+    Nan::GetFunction(Nan::New<FunctionTemplate>(route)).ToLocalChecked());
+  Nan::Set(exports,
+    Nan::New<String>("unroute").ToLocalChecked(),
+    Nan::GetFunction(Nan::New<FunctionTemplate>(unroute)).ToLocalChecked());
   Nan::Set(exports,
     Nan::New<String>("status").ToLocalChecked(),
     Nan::GetFunction(Nan::New<FunctionTemplate>(status)).ToLocalChecked());
+  Nan::Set(exports,
+    Nan::New<String>("metrics").ToLocalChecked(),
+    Nan::GetFunction(Nan::New<FunctionTemplate>(metrics)).ToLocalChecked());
+  Nan::Set(exports,
+    Nan::New<String>("startTracing").ToLocalChecked(),
+    Nan::GetFunction(Nan::New<FunctionTemplate>(start_tracing)).ToLocalChecked());
+  Nan::Set(exports,
+    Nan::New<String>("stopTracing").ToLocalChecked(),
+    Nan::GetFunction(Nan::New<FunctionTemplate>(stop_tracing)).ToLocalChecked());
 }
 
 NODE_MODULE(watcher, initialize);  // NOLINT
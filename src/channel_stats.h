@@ -0,0 +1,61 @@
+#ifndef CHANNEL_STATS_H
+#define CHANNEL_STATS_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Work attributed to a single channel, so that the watched root responsible for a burst of load can be found. Each
+// thread counts its own share, and the shares are combined when `status()` is answered.
+struct ChannelStats
+{
+  // Main thread
+
+  // Filesystem events received, by action.
+  uint64_t created{0};
+  uint64_t modified{0};
+  uint64_t deleted{0};
+  uint64_t renamed{0};
+
+  // Bytes of path carried by those events.
+  uint64_t bytes_emitted{0};
+
+  // Events received per second since the channel was watched or since its rate was last reported, whichever is later.
+  double events_per_second{0};
+
+  // Worker thread
+
+  // Native events read for directories that the channel watches.
+  uint64_t worker_events_read{0};
+
+  // Calls to `lstat()` made while interpreting those events. A call shared by several channels watching the same
+  // directory is charged to the first one that needed it, so the counts of every channel add up to the thread's.
+  uint64_t worker_stats{0};
+
+  // Watch descriptors held for the channel.
+  size_t worker_watch_count{0};
+
+  // Polling thread
+
+  // Filesystem entries recorded by the channel's polled root.
+  size_t polling_entry_count{0};
+
+  // Calls to `lstat()` and `readdir()` made to poll the channel's root.
+  uint64_t polling_operations{0};
+
+  uint64_t events() const { return created + modified + deleted + renamed; }
+
+  void assimilate_worker_stats(const ChannelStats &other)
+  {
+    worker_events_read = other.worker_events_read;
+    worker_stats = other.worker_stats;
+    worker_watch_count = other.worker_watch_count;
+  }
+
+  void assimilate_polling_stats(const ChannelStats &other)
+  {
+    polling_entry_count = other.polling_entry_count;
+    polling_operations = other.polling_operations;
+  }
+};
+
+#endif
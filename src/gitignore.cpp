@@ -0,0 +1,117 @@
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "gitignore.h"
+#include "helper/common.h"
+#include "path_matcher.h"
+
+using std::ifstream;
+using std::istreambuf_iterator;
+using std::move;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+static const string GITIGNORE(".gitignore");
+
+#ifdef PLATFORM_WINDOWS
+static bool is_separator(char c)
+{
+  return c == '/' || c == '\\';
+}
+#else
+static bool is_separator(char c)
+{
+  return c == '/';
+}
+#endif
+
+GitIgnore::GitIgnore(string &&root) : root(move(root))
+{
+  while (!this->root.empty() && is_separator(this->root.back())) {
+    this->root.pop_back();
+  }
+}
+
+bool GitIgnore::excludes(const string &path, bool directory)
+{
+  if (path.size() <= root.size() + 1 || path.compare(0, root.size(), root) != 0) return false;
+  if (!is_separator(path[root.size()])) return false;
+
+  // Offsets of the end of each successively longer prefix of `path`, beginning with the root.
+  vector<size_t> ends{root.size()};
+  for (size_t i = root.size() + 1; i <= path.size(); i++) {
+    if ((i == path.size() || is_separator(path[i])) && i > ends.back() + 1) ends.push_back(i);
+  }
+
+  // Compiled rules of the directory at each prefix, read only once the prefix is known not to be excluded.
+  vector<const PathMatcher *> rules;
+  rules.reserve(ends.size());
+
+  for (size_t count = 1; count < ends.size(); count++) {
+    rules.push_back(rules_for(path.substr(0, ends[count - 1])));
+
+    string prefix(path, 0, ends[count]);
+    bool is_directory = count + 1 < ends.size() || directory;
+
+    // The deepest `.gitignore` with an opinion about this prefix decides.
+    for (size_t depth = count; depth-- > 0;) {
+      if (rules[depth] == nullptr) continue;
+
+      MatchResult result = rules[depth]->match(prefix, is_directory);
+      if (result == MATCH_NONE) continue;
+      if (result == MATCH_EXCLUDED) return true;
+      break;
+    }
+  }
+
+  return false;
+}
+
+bool GitIgnore::changed(const string &path)
+{
+  if (!is_gitignore(path)) return false;
+
+  string directory(path, 0, path.size() - GITIGNORE.size() - 1);
+  return loaded.erase(directory) > 0;
+}
+
+bool GitIgnore::is_gitignore(const string &path)
+{
+  if (path.size() <= GITIGNORE.size()) return false;
+  if (!is_separator(path[path.size() - GITIGNORE.size() - 1])) return false;
+  return path.compare(path.size() - GITIGNORE.size(), GITIGNORE.size(), GITIGNORE) == 0;
+}
+
+size_t GitIgnore::size() const
+{
+  size_t count = 0;
+  for (auto &pair : loaded) {
+    if (pair.second) count++;
+  }
+  return count;
+}
+
+const PathMatcher *GitIgnore::rules_for(const string &directory)
+{
+  auto existing = loaded.find(directory);
+  if (existing != loaded.end()) return existing->second.get();
+
+  unique_ptr<PathMatcher> rules;
+
+  ifstream in(path_join(directory, GITIGNORE), std::ios::in | std::ios::binary);
+  if (in) {
+    string contents((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    rules.reset(new PathMatcher(string(directory), contents));
+    if (rules->empty()) rules.reset();
+  }
+
+  const PathMatcher *result = rules.get();
+  loaded.emplace(directory, move(rules));
+  return result;
+}
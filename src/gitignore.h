@@ -0,0 +1,62 @@
+#ifndef GITIGNORE_H
+#define GITIGNORE_H
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "path_matcher.h"
+
+// Exclude the paths within a watched tree that are ignored by the `.gitignore` files found within it.
+//
+// Each `.gitignore` is read and compiled into a `PathMatcher` the first time a path within its directory is queried,
+// then cached until a change to it is reported with `GitIgnore::changed()`. Rules in deeper `.gitignore` files take
+// precedence over those in their parents. `.gitignore` files within excluded directories are never read.
+//
+// A `GitIgnore` is mutable and isn't thread-safe, so each thread that consults a channel's ignore rules owns its own
+// instance.
+class GitIgnore
+{
+public:
+  // Prepare to read `.gitignore` files beneath the absolute path `root`, which is never itself excluded.
+  explicit GitIgnore(std::string &&root);
+
+  GitIgnore(const GitIgnore &) = delete;
+  GitIgnore(GitIgnore &&) = delete;
+  ~GitIgnore() = default;
+  GitIgnore &operator=(const GitIgnore &) = delete;
+  GitIgnore &operator=(GitIgnore &&) = delete;
+
+  // Return `true` if the absolute `path`, or one of its parent directories, is excluded by the `.gitignore` files
+  // between it and the root. `directory` should be `true` if `path` is known to be a directory.
+  bool excludes(const std::string &path, bool directory);
+
+  // Note that the entry at absolute `path` has been created, modified, deleted, or renamed. If it's a `.gitignore`
+  // file, discard its cached rules so that they'll be read again, and return `true`.
+  bool changed(const std::string &path);
+
+  // Return `true` if `path` names a `.gitignore` file.
+  static bool is_gitignore(const std::string &path);
+
+  // Count the `.gitignore` files that are currently compiled.
+  size_t size() const;
+
+private:
+  // Access the compiled rules for the `.gitignore` within `directory`, reading it if necessary. Return null if it
+  // doesn't exist or has no rules.
+  const PathMatcher *rules_for(const std::string &directory);
+
+  std::string root;
+
+  // Compiled rules keyed by the absolute path of the directory containing their `.gitignore`. Directories without a
+  // `.gitignore` map to null, so that they're only checked once.
+  std::unordered_map<std::string, std::unique_ptr<PathMatcher>> loaded;
+
+  friend std::ostream &operator<<(std::ostream &out, const GitIgnore &gitignore)
+  {
+    return out << "GitIgnore{root=" << gitignore.root << " files=" << gitignore.size() << "}";
+  }
+};
+
+#endif
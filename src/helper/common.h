@@ -5,6 +5,9 @@
 
 std::string path_join(const std::string &left, const std::string &right);
 
+// Join `left` and `right` into `joined`, reusing its existing capacity.
+void path_join_into(std::string &joined, const std::string &left, const std::string &right);
+
 std::wstring wpath_join(const std::wstring &left, const std::wstring &right);
 
 #endif
@@ -28,6 +28,13 @@ string path_join(const string &left, const string &right)  // NOLINT
   return _path_join_impl<string>(left, right, DIRECTORY_SEPARATOR);
 }
 
+void path_join_into(string &joined, const string &left, const string &right)  // NOLINT
+{
+  joined.assign(left);
+  if (left.back() != DIRECTORY_SEPARATOR && right.front() != DIRECTORY_SEPARATOR) joined += DIRECTORY_SEPARATOR;
+  joined += right;
+}
+
 wstring wpath_join(const wstring &left, const wstring &right)  // NOLINT
 {
   return _path_join_impl<wstring>(left, right, W_DIRECTORY_SEPARATOR);
@@ -1,28 +1,39 @@
+#include <algorithm>
 #include <map>
 #include <memory>
 #include <nan.h>
 #include <set>
+#include <sstream>
 #include <string>
 #include <utility>
 #include <uv.h>
 #include <v8.h>
 #include <vector>
 
+#include "channel_stats.h"
 #include "hub.h"
+#include "latency_histogram.h"
 #include "log.h"
 #include "message.h"
+#include "metrics.h"
 #include "nan/all_callback.h"
 #include "nan/async_callback.h"
 #include "nan/functional_callback.h"
+#include "openmetrics.h"
+#include "path_router.h"
 #include "polling/polling_thread.h"
+#include "probes.h"
 #include "result.h"
 #include "status.h"
+#include "trace.h"
 #include "worker/worker_thread.h"
 
 using std::endl;
 using std::map;
 using std::move;
 using std::multimap;
+using std::ostringstream;
+using std::pair;
 using std::set;
 using std::shared_ptr;
 using std::string;
@@ -36,6 +47,168 @@ using v8::String;
 using v8::Uint32;
 using v8::Value;
 
+static Local<Object> js_event_for(FileSystemAction action,
+  EntryKind kind,
+  const string &old_path,
+  const string &path)
+{
+  v8::Local<v8::Context> context = Nan::GetCurrentContext();
+  Local<Object> js_event = Nan::New<Object>();
+  js_event->Set(context, Nan::New<String>("action").ToLocalChecked(), Nan::New<Number>(static_cast<int>(action)));
+  js_event->Set(context, Nan::New<String>("kind").ToLocalChecked(), Nan::New<Number>(static_cast<int>(kind)));
+  js_event->Set(context, Nan::New<String>("oldPath").ToLocalChecked(), Nan::New<String>(old_path).ToLocalChecked());
+  js_event->Set(context, Nan::New<String>("path").ToLocalChecked(), Nan::New<String>(path).ToLocalChecked());
+  return js_event;
+}
+
+static Local<Array> js_array_for(const vector<Local<Object>> &js_events)
+{
+  Local<Array> js_array = Nan::New<Array>(js_events.size());
+
+  v8::Local<v8::Context> context = Nan::GetCurrentContext();
+  int index = 0;
+  for (auto &js_event : js_events) {
+    js_array->Set(context, index, js_event);
+    index++;
+  }
+  return js_array;
+}
+
+// Nanoseconds between two readings of `monotonic_ns()`, or zero if they're out of order.
+static uint64_t elapsed(uint64_t from, uint64_t to)
+{
+  return to > from ? to - from : 0;
+}
+
+static Local<Object> js_histogram_for(const LatencyHistogram &histogram)
+{
+  Local<Object> js_histogram = Nan::New<Object>();
+  Nan::Set(js_histogram,
+    Nan::New<String>("count").ToLocalChecked(),
+    Nan::New<Number>(static_cast<double>(histogram.get_count())));
+  Nan::Set(js_histogram,
+    Nan::New<String>("p50").ToLocalChecked(),
+    Nan::New<Number>(static_cast<double>(histogram.percentile(0.5))));
+  Nan::Set(js_histogram,
+    Nan::New<String>("p90").ToLocalChecked(),
+    Nan::New<Number>(static_cast<double>(histogram.percentile(0.9))));
+  Nan::Set(js_histogram,
+    Nan::New<String>("p99").ToLocalChecked(),
+    Nan::New<Number>(static_cast<double>(histogram.percentile(0.99))));
+  Nan::Set(js_histogram,
+    Nan::New<String>("p999").ToLocalChecked(),
+    Nan::New<Number>(static_cast<double>(histogram.percentile(0.999))));
+  Nan::Set(js_histogram,
+    Nan::New<String>("max").ToLocalChecked(),
+    Nan::New<Number>(static_cast<double>(histogram.get_max())));
+  return js_histogram;
+}
+
+static Local<Object> js_latency_for(const DeliveryLatency &latency)
+{
+  Local<Object> js_latency = Nan::New<Object>();
+  Nan::Set(js_latency, Nan::New<String>("kernelToQueue").ToLocalChecked(), js_histogram_for(latency.kernel_to_queue));
+  Nan::Set(js_latency, Nan::New<String>("queueToMain").ToLocalChecked(), js_histogram_for(latency.queue_to_main));
+  Nan::Set(js_latency, Nan::New<String>("total").ToLocalChecked(), js_histogram_for(latency.total));
+  return js_latency;
+}
+
+// Count a filesystem event received on a channel.
+static void count_event(const FileSystemPayload &fs, ChannelStats &stats)
+{
+  switch (fs.get_filesystem_action()) {
+    case ACTION_CREATED: stats.created++; break;
+    case ACTION_DELETED: stats.deleted++; break;
+    case ACTION_MODIFIED: stats.modified++; break;
+    case ACTION_RENAMED: stats.renamed++; break;
+    default: break;
+  }
+  stats.bytes_emitted += fs.get_old_path().size() + fs.get_path().size();
+}
+
+// Order the channels within `status` by the rate of events that they're receiving, busiest first, and keep the first
+// `top` of them. Keep every channel if `top` is zero.
+static vector<pair<uint_fast32_t, ChannelStats>> busiest_channels(const Status &status, size_t top)
+{
+  vector<pair<uint_fast32_t, ChannelStats>> channels(status.channel_stats.begin(), status.channel_stats.end());
+  std::stable_sort(channels.begin(),
+    channels.end(),
+    [](const pair<uint_fast32_t, ChannelStats> &a, const pair<uint_fast32_t, ChannelStats> &b) {
+      return a.second.events_per_second > b.second.events_per_second;
+    });
+  if (top > 0 && channels.size() > top) channels.resize(top);
+  return channels;
+}
+
+static Local<Object> js_channel_stats_for(uint_fast32_t channel_id, const ChannelStats &stats)
+{
+  Local<Object> js_stats = Nan::New<Object>();
+  auto set = [&js_stats](const char *key, double value) {
+    Nan::Set(js_stats, Nan::New<String>(key).ToLocalChecked(), Nan::New<Number>(value));
+  };
+
+  set("channel", static_cast<double>(channel_id));
+  set("eventsPerSecond", stats.events_per_second);
+  set("created", static_cast<double>(stats.created));
+  set("modified", static_cast<double>(stats.modified));
+  set("deleted", static_cast<double>(stats.deleted));
+  set("renamed", static_cast<double>(stats.renamed));
+  set("bytesEmitted", static_cast<double>(stats.bytes_emitted));
+  set("workerEventsRead", static_cast<double>(stats.worker_events_read));
+  set("workerStats", static_cast<double>(stats.worker_stats));
+  set("workerWatchCount", static_cast<double>(stats.worker_watch_count));
+  set("pollingEntryCount", static_cast<double>(stats.polling_entry_count));
+  set("pollingOperations", static_cast<double>(stats.polling_operations));
+  return js_stats;
+}
+
+// Append a filesystem event to the batch of each route that contains it. A rename that crosses the boundary of a
+// route's subtree is delivered to that route as a deletion or creation of the side that it can see. Event objects are
+// only created for the variations that some route needs, and are shared among the routes that receive them.
+static void route_event(const FileSystemPayload &fs,
+  const PathRouter &router,
+  map<RouteID, vector<Local<Object>>> &to_route)
+{
+  vector<RouteID> matches;
+  router.match(fs.get_path(), matches);
+
+  if (fs.get_filesystem_action() != ACTION_RENAMED) {
+    if (matches.empty()) return;
+
+    Local<Object> js_event =
+      js_event_for(fs.get_filesystem_action(), fs.get_entry_kind(), fs.get_old_path(), fs.get_path());
+    for (RouteID route_id : matches) {
+      to_route[route_id].push_back(js_event);
+    }
+    return;
+  }
+
+  vector<RouteID> old_matches;
+  router.match(fs.get_old_path(), old_matches);
+  std::sort(matches.begin(), matches.end());
+  std::sort(old_matches.begin(), old_matches.end());
+
+  Local<Object> renamed, created, deleted;
+  size_t i = 0;
+  size_t j = 0;
+  while (i < matches.size() || j < old_matches.size()) {
+    if (j == old_matches.size() || (i < matches.size() && matches[i] < old_matches[j])) {
+      if (created.IsEmpty()) created = js_event_for(ACTION_CREATED, fs.get_entry_kind(), string(), fs.get_path());
+      to_route[matches[i++]].push_back(created);
+    } else if (i == matches.size() || old_matches[j] < matches[i]) {
+      if (deleted.IsEmpty()) deleted = js_event_for(ACTION_DELETED, fs.get_entry_kind(), string(), fs.get_old_path());
+      to_route[old_matches[j++]].push_back(deleted);
+    } else {
+      if (renamed.IsEmpty()) {
+        renamed = js_event_for(ACTION_RENAMED, fs.get_entry_kind(), fs.get_old_path(), fs.get_path());
+      }
+      to_route[matches[i]].push_back(renamed);
+      i++;
+      j++;
+    }
+  }
+}
+
 void handle_events_helper(uv_async_t * /*handle*/)
 {
   Hub::get()->handle_events();
@@ -48,7 +221,8 @@ Hub::Hub() :
   polling_thread(&event_handler),
   next_command_id{NULL_COMMAND_ID + 1},
   next_channel_id{NULL_CHANNEL_ID + 1},
-  next_request_id{NULL_REQUEST_ID + 1}
+  next_request_id{NULL_REQUEST_ID + 1},
+  next_route_id{NULL_ROUTE_ID + 1}
 {
   int err;
 
@@ -67,6 +241,9 @@ Hub::Hub() :
 Result<> Hub::watch(string &&root,
   bool poll,
   bool recursive,
+  EventMask events,
+  shared_ptr<const PathMatcher> &&exclusions,
+  bool gitignore,
   unique_ptr<AsyncCallback> ack_callback,
   unique_ptr<AsyncCallback> event_callback)
 {
@@ -76,14 +253,17 @@ Result<> Hub::watch(string &&root,
   next_channel_id++;
 
   channel_callbacks.emplace(channel_id, move(event_callback));
+  channel_latency.emplace(channel_id, DeliveryLatency());
+  channel_activity.emplace(channel_id, ChannelActivity{ChannelStats(), monotonic_ns(), 0});
+
+  CommandPayloadBuilder builder = CommandPayloadBuilder::add(channel_id, move(root), recursive, 1);
+  builder.set_events(events).set_exclusions(exclusions).set_gitignore(gitignore);
 
   if (poll) {
-    return send_command(
-      polling_thread, CommandPayloadBuilder::add(channel_id, move(root), recursive, 1), move(ack_callback));
+    return send_command(polling_thread, move(builder), move(ack_callback));
   }
 
-  return send_command(
-    worker_thread, CommandPayloadBuilder::add(channel_id, move(root), recursive, 1), move(ack_callback));
+  return send_command(worker_thread, move(builder), move(ack_callback));
 }
 
 Result<> Hub::unwatch(ChannelID channel_id, unique_ptr<AsyncCallback> &&ack_callback)
@@ -100,6 +280,10 @@ Result<> Hub::unwatch(ChannelID channel_id, unique_ptr<AsyncCallback> &&ack_call
     CommandPayloadBuilder::remove(channel_id),
     all->create_callback("@atom/worker:hub.unwatch.polling"));
 
+  unroute_channel(channel_id);
+  channel_latency.erase(channel_id);
+  channel_activity.erase(channel_id);
+
   auto maybe_event_callback = channel_callbacks.find(channel_id);
   if (maybe_event_callback == channel_callbacks.end()) {
     LOGGER << "Channel " << channel_id << " already has no event callback." << endl;
@@ -109,18 +293,95 @@ Result<> Hub::unwatch(ChannelID channel_id, unique_ptr<AsyncCallback> &&ack_call
   return r;
 }
 
-Result<> Hub::status(std::unique_ptr<AsyncCallback> &&status_callback)
+Result<RouteID> Hub::route(ChannelID channel_id,
+  string &&path,
+  bool recursive,
+  unique_ptr<AsyncCallback> event_callback)
+{
+  if (channel_callbacks.find(channel_id) == channel_callbacks.end()) {
+    string msg("Unable to route events from unknown channel ");
+    msg += std::to_string(channel_id);
+    return Result<RouteID>::make_error(move(msg));
+  }
+
+  RouteID route_id = next_route_id;
+  next_route_id++;
+
+  unique_ptr<PathRouter> &router = channel_routers[channel_id];
+  if (!router) router.reset(new PathRouter());
+  router->add(route_id, path, recursive);
+
+  routes.emplace(route_id, Route{channel_id, shared_ptr<AsyncCallback>(move(event_callback))});
+
+  LOGGER << "Routing events on channel " << channel_id << " at " << path << (recursive ? "" : " (non-recursively)")
+         << " to route " << route_id << "." << endl;
+  return ok_result(move(route_id));
+}
+
+Result<> Hub::unroute(RouteID route_id)
+{
+  auto route = routes.find(route_id);
+  if (route == routes.end()) {
+    LOGGER << "Route " << route_id << " has already been removed." << endl;
+    return ok_result();
+  }
+
+  auto router = channel_routers.find(route->second.channel_id);
+  if (router != channel_routers.end()) {
+    router->second->remove(route_id);
+    if (router->second->empty()) channel_routers.erase(router);
+  }
+
+  routes.erase(route);
+  return ok_result();
+}
+
+void Hub::unroute_channel(ChannelID channel_id)
+{
+  auto router = channel_routers.find(channel_id);
+  if (router == channel_routers.end()) return;
+  channel_routers.erase(router);
+
+  auto route = routes.begin();
+  while (route != routes.end()) {
+    if (route->second.channel_id == channel_id) {
+      route = routes.erase(route);
+    } else {
+      ++route;
+    }
+  }
+}
+
+Result<> Hub::status(std::unique_ptr<AsyncCallback> &&status_callback, const StatusOptions &options)
 {
   if (!check_async(status_callback)) return ok_result();
 
   RequestID request_id = next_request_id;
   next_request_id++;
 
-  unique_ptr<StatusReq> req{new StatusReq(move(status_callback))};
+  unique_ptr<StatusReq> req{new StatusReq(move(status_callback), options)};
 
   // Main thread statistics
   req->status.pending_callback_count = pending_callbacks.size();
   req->status.channel_callback_count = channel_callbacks.size();
+  req->status.route_count = routes.size();
+  req->status.channel_latency = channel_latency;
+  req->status.metrics = sample_metrics();
+
+  if (options.per_channel) {
+    uint64_t now = monotonic_ns();
+    for (auto &pair : channel_activity) {
+      ChannelActivity &activity = pair.second;
+      uint64_t events = activity.stats.events();
+      double seconds = static_cast<double>(elapsed(activity.rate_since, now)) / 1e9;
+      activity.stats.events_per_second =
+        seconds > 0 ? static_cast<double>(events - activity.events_at_rate_since) / seconds : 0;
+      activity.rate_since = now;
+      activity.events_at_rate_since = events;
+
+      req->status.channel_stats.emplace(pair.first, activity.stats);
+    }
+  }
 
   status_reqs.emplace(request_id, move(req));
 
@@ -130,6 +391,57 @@ Result<> Hub::status(std::unique_ptr<AsyncCallback> &&status_callback)
   return r;
 }
 
+Local<Object> Hub::metrics()
+{
+  MetricsSample sample = sample_metrics();
+  Local<Object> metrics_object = Nan::New<Object>();
+  auto set = [&metrics_object](const char *key, uint64_t value) {
+    Nan::Set(metrics_object, Nan::New<String>(key).ToLocalChecked(), Nan::New<Number>(static_cast<double>(value)));
+  };
+
+  // Worker thread
+  set("workerEventsRead", sample.worker_events_read);
+  set("workerEventsEmitted", sample.worker_events_emitted);
+  set("workerWatchCount", sample.worker_watch_count);
+  set("workerStats", sample.worker_stats);
+  set("workerCacheHits", sample.worker_cache_hits);
+  set("workerCacheMisses", sample.worker_cache_misses);
+  set("workerInDepth", sample.worker_in_depth);
+  set("workerOutDepth", sample.worker_out_depth);
+
+  // Polling thread
+  set("pollingEventsEmitted", sample.polling_events_emitted);
+  set("pollingOperations", sample.polling_operations);
+  set("pollingInDepth", sample.polling_in_depth);
+  set("pollingOutDepth", sample.polling_out_depth);
+
+  set("bytesInFlight", sample.bytes_in_flight);
+  return metrics_object;
+}
+
+MetricsSample Hub::sample_metrics()
+{
+  Metrics &m = Metrics::get();
+  MetricsSample sample;
+
+  sample.worker_events_read = m.worker_events_read.get();
+  sample.worker_events_emitted = worker_thread.get_events_emitted();
+  sample.worker_watch_count = m.worker_watch_count.get();
+  sample.worker_stats = m.worker_stats.get();
+  sample.worker_cache_hits = m.worker_cache_hits.get();
+  sample.worker_cache_misses = m.worker_cache_misses.get();
+  sample.worker_in_depth = worker_thread.get_in_queue_depth();
+  sample.worker_out_depth = worker_thread.get_out_queue_depth();
+
+  sample.polling_events_emitted = polling_thread.get_events_emitted();
+  sample.polling_operations = m.polling_operations.get();
+  sample.polling_in_depth = polling_thread.get_in_queue_depth();
+  sample.polling_out_depth = polling_thread.get_out_queue_depth();
+
+  sample.bytes_in_flight = worker_thread.get_queued_bytes() + polling_thread.get_queued_bytes();
+  return sample;
+}
+
 void Hub::handle_events()
 {
   handle_events_from(worker_thread);
@@ -164,6 +476,7 @@ bool Hub::check_async(const std::unique_ptr<AsyncCallback> &callback)
 
 void Hub::handle_events_from(Thread &thread)
 {
+  TRACE_SPAN("Hub::handle_events_from");
   Nan::HandleScope scope;
   bool repeat = true;
 
@@ -173,14 +486,20 @@ void Hub::handle_events_from(Thread &thread)
     return;
   }
 
+  uint64_t received_at = monotonic_ns();
+
+  // Events whose total delivery latency is recorded once they're about to be dispatched.
+  vector<pair<ChannelID, uint64_t>> detected;
+
   map<ChannelID, vector<Local<Object>>> to_deliver;
+  map<RouteID, vector<Local<Object>>> to_route;
   multimap<ChannelID, Local<Value>> errors;
   set<ChannelID> to_unwatch;
 
   for (Message &message : *accepted) {
     const AckPayload *ack = message.as_ack();
     if (ack != nullptr) {
-      LOGGER << "Received ack message " << message << "." << endl;
+      LOG_AT(LOG_LEVEL_DEBUG, LOG_EVENTS) << "Received ack message " << message << "." << endl;
 
       auto maybe_callback = pending_callbacks.find(ack->get_key());
       if (maybe_callback == pending_callbacks.end()) {
@@ -206,21 +525,28 @@ void Hub::handle_events_from(Thread &thread)
 
     const FileSystemPayload *fs = message.as_filesystem();
     if (fs != nullptr) {
-      LOGGER << "Received filesystem event message " << message << "." << endl;
+      LOG_AT(LOG_LEVEL_DEBUG, LOG_EVENTS) << "Received filesystem event message " << message << "." << endl;
 
       ChannelID channel_id = fs->get_channel_id();
 
-      v8::Local<v8::Context> context = Nan::GetCurrentContext();
-      Local<Object> js_event = Nan::New<Object>();
-      js_event->Set(context,
-        Nan::New<String>("action").ToLocalChecked(), Nan::New<Number>(static_cast<int>(fs->get_filesystem_action())));
-      js_event->Set(context,
-        Nan::New<String>("kind").ToLocalChecked(), Nan::New<Number>(static_cast<int>(fs->get_entry_kind())));
-      js_event->Set(context,
-        Nan::New<String>("oldPath").ToLocalChecked(), Nan::New<String>(fs->get_old_path()).ToLocalChecked());
-      js_event->Set(context, Nan::New<String>("path").ToLocalChecked(), Nan::New<String>(fs->get_path()).ToLocalChecked());
-
-      to_deliver[channel_id].push_back(js_event);
+      auto activity = channel_activity.find(channel_id);
+      if (activity != channel_activity.end()) count_event(*fs, activity->second.stats);
+
+      auto latency = channel_latency.find(channel_id);
+      if (latency != channel_latency.end()) {
+        latency->second.kernel_to_queue.record(elapsed(fs->get_detected_at(), fs->get_queued_at()));
+        latency->second.queue_to_main.record(elapsed(fs->get_queued_at(), received_at));
+        detected.emplace_back(channel_id, fs->get_detected_at());
+      }
+
+      auto router = channel_routers.find(channel_id);
+      if (router != channel_routers.end()) {
+        route_event(*fs, *router->second, to_route);
+        continue;
+      }
+
+      to_deliver[channel_id].push_back(
+        js_event_for(fs->get_filesystem_action(), fs->get_entry_kind(), fs->get_old_path(), fs->get_path()));
       continue;
     }
 
@@ -294,6 +620,13 @@ void Hub::handle_events_from(Thread &thread)
     LOGGER << "Received unexpected message " << message << "." << endl;
   }
 
+  // Ack callbacks may have unwatched a channel since its events were received.
+  uint64_t dispatched_at = monotonic_ns();
+  for (auto &event : detected) {
+    auto latency = channel_latency.find(event.first);
+    if (latency != channel_latency.end()) latency->second.total.record(elapsed(event.second, dispatched_at));
+  }
+
   for (auto &pair : to_deliver) {
     const ChannelID &channel_id = pair.first;
     vector<Local<Object>> &js_events = pair.second;
@@ -305,19 +638,25 @@ void Hub::handle_events_from(Thread &thread)
     }
     shared_ptr<AsyncCallback> callback = maybe_callback->second;
 
-    LOGGER << "Dispatching " << js_events.size() << " event(s) on channel " << channel_id << " to the node callback."
-           << endl;
+    LOG_AT(LOG_LEVEL_DEBUG, LOG_EVENTS) << "Dispatching " << js_events.size() << " event(s) on channel " << channel_id
+                                        << " to the node callback." << endl;
+    WATCHER_PROBE2(hub_deliver, channel_id, js_events.size());
+
+    Local<Value> argv[] = {Nan::Null(), js_array_for(js_events)};
+    callback->Call(2, argv);
+  }
 
-    Local<Array> js_array = Nan::New<Array>(js_events.size());
+  for (auto &pair : to_route) {
+    const RouteID &route_id = pair.first;
 
-    v8::Local<v8::Context> context = Nan::GetCurrentContext();
-    int index = 0;
-    for (auto &js_event : js_events) {
-      js_array->Set(context, index, js_event);
-      index++;
-    }
+    auto route = routes.find(route_id);
+    if (route == routes.end()) continue;
+    shared_ptr<AsyncCallback> callback = route->second.callback;
+
+    LOG_AT(LOG_LEVEL_DEBUG, LOG_EVENTS) << "Dispatching " << pair.second.size() << " event(s) on route " << route_id
+                                        << " to the node callback." << endl;
 
-    Local<Value> argv[] = {Nan::Null(), js_array};
+    Local<Value> argv[] = {Nan::Null(), js_array_for(pair.second)};
     callback->Call(2, argv);
   }
 
@@ -350,6 +689,22 @@ void Hub::handle_completed_status(StatusReq &req)
 {
   Status &status = req.status;
 
+  vector<pair<uint_fast32_t, ChannelStats>> top_channels = busiest_channels(status, req.options.top);
+  if (req.options.top > 0) {
+    // Leave only the reported channels for the OpenMetrics exposition.
+    status.channel_stats.clear();
+    status.channel_stats.insert(top_channels.begin(), top_channels.end());
+  }
+
+  if (req.options.format == STATUS_OPENMETRICS) {
+    ostringstream exposition;
+    write_openmetrics(exposition, status);
+
+    Local<Value> argv[] = {Nan::Null(), Nan::New<String>(exposition.str()).ToLocalChecked()};
+    req.callback->Call(2, argv);
+    return;
+  }
+
   Local<Object> status_object = Nan::New<Object>();
 
   // Main thread
@@ -359,6 +714,26 @@ void Hub::handle_completed_status(StatusReq &req)
   Nan::Set(status_object,
     Nan::New<String>("channelCallbackCount").ToLocalChecked(),
     Nan::New<Uint32>(static_cast<uint32_t>(status.channel_callback_count)));
+  Nan::Set(status_object,
+    Nan::New<String>("routeCount").ToLocalChecked(),
+    Nan::New<Uint32>(static_cast<uint32_t>(status.route_count)));
+
+  Local<Object> channel_latency_object = Nan::New<Object>();
+  for (auto &pair : status.channel_latency) {
+    Nan::Set(channel_latency_object, Nan::New<Number>(pair.first), js_latency_for(pair.second));
+  }
+  Nan::Set(status_object, Nan::New<String>("channelLatency").ToLocalChecked(), channel_latency_object);
+  Nan::Set(status_object, Nan::New<String>("deliveryLatency").ToLocalChecked(), js_latency_for(status.total_latency()));
+
+  if (req.options.per_channel) {
+    Local<Array> channels_array = Nan::New<Array>(static_cast<int>(top_channels.size()));
+    for (size_t i = 0; i < top_channels.size(); i++) {
+      Nan::Set(channels_array,
+        static_cast<uint32_t>(i),
+        js_channel_stats_for(top_channels[i].first, top_channels[i].second));
+    }
+    Nan::Set(status_object, Nan::New<String>("channels").ToLocalChecked(), channels_array);
+  }
 
   // Worker thread
   Nan::Set(status_object,
@@ -383,6 +758,9 @@ void Hub::handle_completed_status(StatusReq &req)
   Nan::Set(status_object,
     Nan::New<String>("workerSubscriptionCount").ToLocalChecked(),
     Nan::New<Uint32>(static_cast<uint32_t>(status.worker_subscription_count)));
+  Nan::Set(status_object,
+    Nan::New<String>("workerConsumeDuration").ToLocalChecked(),
+    js_histogram_for(status.worker_consume_duration));
 #ifdef PLATFORM_MACOS
   Nan::Set(status_object,
     Nan::New<String>("workerRenameBufferSize").ToLocalChecked(),
@@ -425,9 +803,21 @@ void Hub::handle_completed_status(StatusReq &req)
   Nan::Set(status_object,
     Nan::New<String>("pollingRootCount").ToLocalChecked(),
     Nan::New<Uint32>(static_cast<uint32_t>(status.polling_root_count)));
+  Nan::Set(status_object,
+    Nan::New<String>("pollingWorkerCount").ToLocalChecked(),
+    Nan::New<Uint32>(static_cast<uint32_t>(status.polling_worker_count)));
   Nan::Set(status_object,
     Nan::New<String>("pollingEntryCount").ToLocalChecked(),
     Nan::New<Uint32>(static_cast<uint32_t>(status.polling_entry_count)));
+  Nan::Set(status_object,
+    Nan::New<String>("pollingHotDirectoryCount").ToLocalChecked(),
+    Nan::New<Uint32>(static_cast<uint32_t>(status.polling_hot_directory_count)));
+  Nan::Set(status_object,
+    Nan::New<String>("pollingThroughput").ToLocalChecked(),
+    Nan::New<Uint32>(static_cast<uint32_t>(status.polling_throughput)));
+  Nan::Set(status_object,
+    Nan::New<String>("pollingCycleDuration").ToLocalChecked(),
+    js_histogram_for(status.polling_cycle_duration));
 
   Local<Value> argv[] = {Nan::Null(), status_object};
   req.callback->Call(2, argv);
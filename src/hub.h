@@ -1,6 +1,8 @@
 #ifndef HUB_H
 #define HUB_H
 
+#include <cstdint>
+#include <map>
 #include <memory>
 #include <nan.h>
 #include <string>
@@ -8,10 +10,14 @@
 #include <utility>
 #include <uv.h>
 
+#include "channel_stats.h"
 #include "errable.h"
+#include "latency_histogram.h"
 #include "log.h"
 #include "message.h"
+#include "metrics.h"
 #include "nan/async_callback.h"
+#include "path_router.h"
 #include "polling/polling_thread.h"
 #include "result.h"
 #include "worker/worker_thread.h"
@@ -61,6 +67,15 @@ public:
     return r.empty() ? ok_result() : error_result(std::move(r));
   }
 
+  Result<> use_main_log_binary_file(std::string &&main_log_file)
+  {
+    Result<> h = health_err_result();
+    if (h.is_error()) return h;
+
+    std::string r = Logger::to_binary_file(main_log_file.c_str());
+    return r.empty() ? ok_result() : error_result(std::move(r));
+  }
+
   Result<> disable_main_log()
   {
     Result<> h = health_err_result();
@@ -70,6 +85,15 @@ public:
     return r.empty() ? ok_result() : error_result(std::move(r));
   }
 
+  Result<> set_main_log_levels(const std::string &spec)
+  {
+    Result<> h = health_err_result();
+    if (h.is_error()) return h;
+
+    std::string r = Logger::set_levels(spec.c_str());
+    return r.empty() ? ok_result() : error_result(std::move(r));
+  }
+
   Result<> use_worker_log_file(std::string &&worker_log_file, std::unique_ptr<AsyncCallback> callback)
   {
     if (!check_async(callback)) return ok_result();
@@ -92,6 +116,14 @@ public:
     return send_command(worker_thread, CommandPayloadBuilder::log_to_stdout(), std::move(callback));
   }
 
+  Result<> use_worker_log_binary_file(std::string &&worker_log_file, std::unique_ptr<AsyncCallback> callback)
+  {
+    if (!check_async(callback)) return ok_result();
+
+    return send_command(
+      worker_thread, CommandPayloadBuilder::log_to_binary_file(std::move(worker_log_file)), std::move(callback));
+  }
+
   Result<> disable_worker_log(std::unique_ptr<AsyncCallback> callback)
   {
     if (!check_async(callback)) return ok_result();
@@ -99,6 +131,13 @@ public:
     return send_command(worker_thread, CommandPayloadBuilder::log_disable(), std::move(callback));
   }
 
+  Result<> set_worker_log_levels(std::string &&spec, std::unique_ptr<AsyncCallback> callback)
+  {
+    if (!check_async(callback)) return ok_result();
+
+    return send_command(worker_thread, CommandPayloadBuilder::log_levels(std::move(spec)), std::move(callback));
+  }
+
   Result<> worker_cache_size(size_t cache_size, std::unique_ptr<AsyncCallback> callback)
   {
     if (!check_async(callback)) return ok_result();
@@ -128,6 +167,14 @@ public:
     return send_command(polling_thread, CommandPayloadBuilder::log_to_stdout(), std::move(callback));
   }
 
+  Result<> use_polling_log_binary_file(std::string &&polling_log_file, std::unique_ptr<AsyncCallback> callback)
+  {
+    if (!check_async(callback)) return ok_result();
+
+    return send_command(
+      polling_thread, CommandPayloadBuilder::log_to_binary_file(std::move(polling_log_file)), std::move(callback));
+  }
+
   Result<> disable_polling_log(std::unique_ptr<AsyncCallback> callback)
   {
     if (!check_async(callback)) return ok_result();
@@ -135,6 +182,13 @@ public:
     return send_command(polling_thread, CommandPayloadBuilder::log_disable(), std::move(callback));
   }
 
+  Result<> set_polling_log_levels(std::string &&spec, std::unique_ptr<AsyncCallback> callback)
+  {
+    if (!check_async(callback)) return ok_result();
+
+    return send_command(polling_thread, CommandPayloadBuilder::log_levels(std::move(spec)), std::move(callback));
+  }
+
   Result<> set_polling_interval(uint_fast32_t interval, std::unique_ptr<AsyncCallback> callback)
   {
     if (!check_async(callback)) return ok_result();
@@ -149,22 +203,89 @@ public:
     return send_command(polling_thread, CommandPayloadBuilder::polling_throttle(throttle), std::move(callback));
   }
 
+  Result<> set_polling_workers(uint_fast32_t workers, std::unique_ptr<AsyncCallback> callback)
+  {
+    if (!check_async(callback)) return ok_result();
+
+    return send_command(polling_thread, CommandPayloadBuilder::polling_workers(workers), std::move(callback));
+  }
+
+  Result<> set_polling_hot_share(uint_fast32_t percent, std::unique_ptr<AsyncCallback> callback)
+  {
+    if (!check_async(callback)) return ok_result();
+
+    return send_command(polling_thread, CommandPayloadBuilder::polling_hot_share(percent), std::move(callback));
+  }
+
+  Result<> set_polling_budget(uint_fast32_t percent, std::unique_ptr<AsyncCallback> callback)
+  {
+    if (!check_async(callback)) return ok_result();
+
+    return send_command(polling_thread, CommandPayloadBuilder::polling_budget(percent), std::move(callback));
+  }
+
+  Result<> set_polling_snapshots(std::string &&directory, std::unique_ptr<AsyncCallback> callback)
+  {
+    if (!check_async(callback)) return ok_result();
+
+    return send_command(
+      polling_thread, CommandPayloadBuilder::polling_snapshots(std::move(directory)), std::move(callback));
+  }
+
   Result<> watch(std::string &&root,
     bool poll,
     bool recursive,
+    EventMask events,
+    std::shared_ptr<const PathMatcher> &&exclusions,
+    bool gitignore,
     std::unique_ptr<AsyncCallback> ack_callback,
     std::unique_ptr<AsyncCallback> event_callback);
 
   Result<> unwatch(ChannelID channel_id, std::unique_ptr<AsyncCallback> &&ack_callback);
 
-  Result<> status(std::unique_ptr<AsyncCallback> &&status_callback);
+  // Deliver the events on `channel_id` that occur at `path`, or beneath it if `recursive` is true, to
+  // `event_callback`. Once a channel has any routes, its events are delivered only through them, so each callback
+  // receives a batch that has already been filtered to its own subtree.
+  Result<RouteID> route(ChannelID channel_id,
+    std::string &&path,
+    bool recursive,
+    std::unique_ptr<AsyncCallback> event_callback);
+
+  // Stop delivering events to a route created by `route()`.
+  Result<> unroute(RouteID route_id);
+
+  // Shapes that `status()` can deliver its summary in.
+  enum StatusFormat
+  {
+    STATUS_OBJECT,  // A JavaScript object.
+    STATUS_OPENMETRICS  // A string in the OpenMetrics text exposition format, ready to serve to a Prometheus scraper.
+  };
+
+  struct StatusOptions
+  {
+    StatusFormat format{STATUS_OBJECT};
+
+    // Collect the work attributed to each channel.
+    bool per_channel{false};
+
+    // Report only this many of the channels receiving the most events per second. Zero reports every channel.
+    size_t top{0};
+  };
+
+  Result<> status(std::unique_ptr<AsyncCallback> &&status_callback, const StatusOptions &options);
+
+  // Sample the counters that each thread publishes as it works and return them immediately. Unlike `status()`, this
+  // doesn't wait for either thread to respond, so it's cheap enough to call on every frame of a dashboard.
+  v8::Local<v8::Object> metrics();
 
   void handle_events();
 
 private:
   struct StatusReq
   {
-    explicit StatusReq(std::unique_ptr<AsyncCallback> &&callback) : callback{std::move(callback)}
+    StatusReq(std::unique_ptr<AsyncCallback> &&callback, const StatusOptions &options) :
+      callback{std::move(callback)},
+      options(options)
     {
       //
     }
@@ -179,6 +300,7 @@ private:
 
     Status status;
     std::unique_ptr<AsyncCallback> callback;
+    StatusOptions options;
   };
 
   Hub();
@@ -191,6 +313,12 @@ private:
 
   void handle_completed_status(StatusReq &req);
 
+  // Read every lock-free counter for `metrics()` and `status()`.
+  MetricsSample sample_metrics();
+
+  // Remove every route on a channel that's been unwatched.
+  void unroute_channel(ChannelID channel_id);
+
   static Hub *the_hub;
 
   uv_async_t event_handler{};
@@ -201,10 +329,33 @@ private:
   CommandID next_command_id;
   ChannelID next_channel_id;
   RequestID next_request_id;
+  RouteID next_route_id;
 
   std::unordered_map<CommandID, std::unique_ptr<AsyncCallback>> pending_callbacks;
   std::unordered_map<RequestID, std::unique_ptr<StatusReq>> status_reqs;
   std::unordered_map<ChannelID, std::shared_ptr<AsyncCallback>> channel_callbacks;
+
+  // Latency of the filesystem events received on each watched channel.
+  std::map<ChannelID, DeliveryLatency> channel_latency;
+
+  // Events received on each watched channel, and the point that its rate will next be measured from.
+  struct ChannelActivity
+  {
+    ChannelStats stats;
+    uint64_t rate_since;
+    uint64_t events_at_rate_since;
+  };
+
+  std::map<ChannelID, ChannelActivity> channel_activity;
+
+  struct Route
+  {
+    ChannelID channel_id;
+    std::shared_ptr<AsyncCallback> callback;
+  };
+
+  std::unordered_map<ChannelID, std::unique_ptr<PathRouter>> channel_routers;
+  std::unordered_map<RouteID, Route> routes;
 };
 
 #endif
@@ -0,0 +1,114 @@
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+
+#include "latency_histogram.h"
+
+using std::ostream;
+
+// Durations below this are counted exactly, one per bucket.
+static const uint64_t LINEAR_LIMIT = 32;
+
+// Each power of two above `LINEAR_LIMIT` is divided into `1 << SUB_BUCKET_BITS` buckets.
+static const int SUB_BUCKET_BITS = 4;
+static const size_t SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+
+// Index of the most significant set bit of `LINEAR_LIMIT`.
+static const int LINEAR_EXPONENT = 5;
+
+static int floor_log2(uint64_t value)
+{
+  int exponent = 0;
+  for (int shift = 32; shift > 0; shift >>= 1) {
+    if ((value >> shift) != 0) {
+      value >>= shift;
+      exponent += shift;
+    }
+  }
+  return exponent;
+}
+
+LatencyHistogram::LatencyHistogram() : count{0}, max{0}, sum{0}
+{
+  counts.fill(0);
+}
+
+void LatencyHistogram::record(uint64_t nanoseconds)
+{
+  counts[bucket_for(nanoseconds)]++;
+  count++;
+  sum += nanoseconds;
+  if (nanoseconds > max) max = nanoseconds;
+}
+
+void LatencyHistogram::record_since(uint64_t start)
+{
+  uint64_t now = monotonic_ns();
+  record(now > start ? now - start : 0);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram &other)
+{
+  for (size_t i = 0; i < BUCKET_COUNT; i++) {
+    counts[i] += other.counts[i];
+  }
+  count += other.count;
+  sum += other.sum;
+  if (other.max > max) max = other.max;
+}
+
+uint64_t LatencyHistogram::percentile(double quantile) const
+{
+  if (count == 0) return 0;
+
+  auto target = static_cast<uint64_t>(std::ceil(quantile * static_cast<double>(count)));
+  if (target < 1) target = 1;
+  if (target > count) target = count;
+
+  uint64_t seen = 0;
+  for (size_t i = 0; i < BUCKET_COUNT; i++) {
+    seen += counts[i];
+    if (seen >= target) {
+      uint64_t highest = highest_value_in(i);
+      return highest < max ? highest : max;
+    }
+  }
+  return max;
+}
+
+uint64_t LatencyHistogram::count_at_or_below(uint64_t bound) const
+{
+  if (bound >= max) return count;
+
+  uint64_t seen = 0;
+  for (size_t i = 0; i < BUCKET_COUNT && highest_value_in(i) <= bound; i++) {
+    seen += counts[i];
+  }
+  return seen;
+}
+
+size_t LatencyHistogram::bucket_for(uint64_t value)
+{
+  if (value < LINEAR_LIMIT) return static_cast<size_t>(value);
+
+  int exponent = floor_log2(value);
+  auto sub_bucket = static_cast<size_t>(value >> (exponent - SUB_BUCKET_BITS)) - SUB_BUCKET_COUNT;
+  size_t bucket = LINEAR_LIMIT + static_cast<size_t>(exponent - LINEAR_EXPONENT) * SUB_BUCKET_COUNT + sub_bucket;
+  return bucket < BUCKET_COUNT ? bucket : BUCKET_COUNT - 1;
+}
+
+uint64_t LatencyHistogram::highest_value_in(size_t bucket)
+{
+  if (bucket < LINEAR_LIMIT) return bucket;
+
+  int exponent = LINEAR_EXPONENT + static_cast<int>((bucket - LINEAR_LIMIT) / SUB_BUCKET_COUNT);
+  uint64_t sub_bucket = SUB_BUCKET_COUNT + (bucket - LINEAR_LIMIT) % SUB_BUCKET_COUNT;
+  return ((sub_bucket + 1) << (exponent - SUB_BUCKET_BITS)) - 1;
+}
+
+ostream &operator<<(ostream &out, const LatencyHistogram &histogram)
+{
+  return out << "LatencyHistogram{count=" << histogram.get_count() << " p50=" << histogram.percentile(0.5)
+             << "ns p99=" << histogram.percentile(0.99) << "ns p999=" << histogram.percentile(0.999)
+             << "ns max=" << histogram.get_max() << "ns}";
+}
@@ -0,0 +1,92 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+
+// Read a monotonic clock in nanoseconds. Used to timestamp events as they move between threads.
+inline uint64_t monotonic_ns()
+{
+  return static_cast<uint64_t>(
+    std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Count durations in nanoseconds in the manner of an HDR histogram.
+//
+// Each power of two is divided into sixteen linear buckets, so any percentile is reported to within about 6% of the
+// true value over a range from a single nanosecond to more than an hour, in a fixed amount of memory. Recording a value
+// costs a handful of shifts and an increment. Durations beyond the range are counted within the highest bucket, but
+// the maximum is tracked exactly.
+//
+// A histogram is only touched by the thread that owns it. Copies are sent to the main thread to answer `status()`.
+class LatencyHistogram
+{
+public:
+  LatencyHistogram();
+
+  // Count a single duration.
+  void record(uint64_t nanoseconds);
+
+  // Count the time elapsed since `start`, a reading of `monotonic_ns()`.
+  void record_since(uint64_t start);
+
+  // Add all of the durations counted by `other` to this histogram.
+  void merge(const LatencyHistogram &other);
+
+  // Return the duration that `quantile`, between 0 and 1, of the counted durations are less than or equal to. Return
+  // zero if nothing has been counted.
+  uint64_t percentile(double quantile) const;
+
+  // Return the number of counted durations that fall within buckets lying entirely at or below `bound`. Durations
+  // slightly below `bound` that share a bucket with longer ones are left out, so this undercounts by at most the width
+  // of one bucket.
+  uint64_t count_at_or_below(uint64_t bound) const;
+
+  uint64_t get_count() const { return count; }
+
+  uint64_t get_max() const { return max; }
+
+  uint64_t get_sum() const { return sum; }
+
+  bool empty() const { return count == 0; }
+
+private:
+  static size_t bucket_for(uint64_t value);
+
+  // The greatest duration that's counted within `bucket`.
+  static uint64_t highest_value_in(size_t bucket);
+
+  static const size_t BUCKET_COUNT = 640;
+
+  std::array<uint64_t, BUCKET_COUNT> counts;
+  uint64_t count;
+  uint64_t max;
+  uint64_t sum;
+};
+
+std::ostream &operator<<(std::ostream &out, const LatencyHistogram &histogram);
+
+// Latency of the filesystem events delivered on a single channel, measured between the stages that they pass through.
+struct DeliveryLatency
+{
+  // From the moment an event was read from the operating system or discovered by polling to its arrival on the output
+  // queue of the thread that produced it.
+  LatencyHistogram kernel_to_queue;
+
+  // From the output queue to its receipt by the main thread.
+  LatencyHistogram queue_to_main;
+
+  // From the moment it was read to the main thread beginning to call JavaScript callbacks with it.
+  LatencyHistogram total;
+
+  void merge(const DeliveryLatency &other)
+  {
+    kernel_to_queue.merge(other.kernel_to_queue);
+    queue_to_main.merge(other.queue_to_main);
+    total.merge(other.total);
+  }
+};
+
+#endif
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cerrno>
 #include <chrono>
 #include <cstdlib>
@@ -5,10 +6,12 @@
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <iterator>
 #include <sstream>
 #include <string>
 #include <uv.h>
 
+#include "binary_logger.h"
 #include "log.h"
 
 using std::cerr;
@@ -27,7 +30,12 @@ using std::chrono::steady_clock;
 class NullLogger : public Logger
 {
 public:
-  NullLogger() = default;
+  NullLogger()
+  {
+    for (LogLevel &level : levels) {
+      level = LOG_LEVEL_OFF;
+    }
+  }
 
   Logger *prefix(const char * /*file*/, int /*line*/) override { return this; }
 
@@ -123,13 +131,37 @@ public:
   }
 };
 
+Logger::Logger()
+{
+  for (LogLevel &level : levels) {
+    level = LOG_LEVEL_DEBUG;
+  }
+}
+
 static uv_key_t current_logger_key;
+static uv_key_t configured_levels_key;
 static NullLogger the_null_logger;
 static uv_once_t make_key_once = UV_ONCE_INIT;
 
 static void make_key()
 {
   uv_key_create(&current_logger_key);
+  uv_key_create(&configured_levels_key);
+}
+
+// Access the levels most recently set on this thread, which every logger it creates begins with. They're kept apart
+// from the current logger so that they can be set while it's disabled.
+static LogLevel *configured_levels()
+{
+  uv_once(&make_key_once, &make_key);
+
+  auto *levels = static_cast<LogLevel *>(uv_key_get(&configured_levels_key));
+  if (levels == nullptr) {
+    levels = new LogLevel[LOG_SUBSYSTEM_COUNT];
+    std::fill(levels, levels + LOG_SUBSYSTEM_COUNT, LOG_LEVEL_DEBUG);
+    uv_key_set(&configured_levels_key, static_cast<void *>(levels));
+  }
+  return levels;
 }
 
 Logger *Logger::current()
@@ -146,7 +178,7 @@ Logger *Logger::current()
   return logger;
 }
 
-string replace_logger(const Logger *new_logger)
+string replace_logger(Logger *new_logger)
 {
   if (new_logger != &the_null_logger) {
     string r = new_logger->get_error();
@@ -156,11 +188,14 @@ string replace_logger(const Logger *new_logger)
     }
   }
 
-  Logger *prior = Logger::current();
-  if (prior != &the_null_logger) {
-    delete prior;
+  if (new_logger != &the_null_logger) {
+    LogLevel *levels = configured_levels();
+    std::copy(levels, levels + LOG_SUBSYSTEM_COUNT, std::begin(new_logger->levels));
   }
 
+  Logger *prior = Logger::current();
+  if (prior != &the_null_logger) delete prior;
+
   uv_key_set(&current_logger_key, (void *) new_logger);
   return "";
 }
@@ -170,6 +205,11 @@ string Logger::to_file(const char *filename)
   return replace_logger(new FileLogger(filename));  // NOLINT(clang-analyzer-cplusplus.NewDeleteLeaks)
 }
 
+string Logger::to_binary_file(const char *filename)
+{
+  return replace_logger(new BinaryLogger(filename));  // NOLINT(clang-analyzer-cplusplus.NewDeleteLeaks)
+}
+
 string Logger::to_stderr()
 {
   return replace_logger(new StderrLogger());  // NOLINT(clang-analyzer-cplusplus.NewDeleteLeaks)
@@ -192,13 +232,87 @@ string Logger::from_env(const char *varname)
     return replace_logger(&the_null_logger);
   }
 
+  string r;
   if (std::strcmp("stdout", value) == 0) {
-    return to_stdout();
+    r = to_stdout();
+  } else if (std::strcmp("stderr", value) == 0) {
+    r = to_stderr();
+  } else if (std::strncmp("binary:", value, 7) == 0) {
+    r = to_binary_file(value + 7);
+  } else {
+    r = to_file(value);
   }
-  if (std::strcmp("stderr", value) == 0) {
-    return to_stderr();
+  if (!r.empty()) return r;
+
+  string level_varname(varname);
+  level_varname += "_LEVEL";
+  const char *levels = std::getenv(level_varname.c_str());
+  if (levels == nullptr) return r;
+
+  return set_levels(levels);
+}
+
+static const char *LEVEL_NAMES[] = {"off", "error", "info", "debug"};
+
+static const char *SUBSYSTEM_NAMES[] = {"general", "events", "polling", "cache"};
+
+// Apply the entries of `spec` to `levels`. Return an error message if `spec` can't be parsed, leaving `levels` partly
+// updated.
+static string parse_levels(const char *spec, LogLevel *levels)
+{
+  std::istringstream in(spec);
+  string entry;
+  while (std::getline(in, entry, ',')) {
+    if (entry.empty()) continue;
+
+    string subsystem_name;
+    string level_name(entry);
+    size_t equals = entry.find('=');
+    if (equals != string::npos) {
+      subsystem_name = entry.substr(0, equals);
+      level_name = entry.substr(equals + 1);
+    }
+
+    auto level = std::find_if(std::begin(LEVEL_NAMES), std::end(LEVEL_NAMES), [&](const char *name) {
+      return level_name == name;
+    });
+    if (level == std::end(LEVEL_NAMES)) return "Unrecognized log level " + level_name;
+    auto level_value = static_cast<LogLevel>(level - std::begin(LEVEL_NAMES));
+
+    if (subsystem_name.empty()) {
+      std::fill(levels, levels + LOG_SUBSYSTEM_COUNT, level_value);
+      continue;
+    }
+
+    auto subsystem = std::find_if(std::begin(SUBSYSTEM_NAMES), std::end(SUBSYSTEM_NAMES), [&](const char *name) {
+      return subsystem_name == name;
+    });
+    if (subsystem == std::end(SUBSYSTEM_NAMES)) return "Unrecognized log subsystem " + subsystem_name;
+    levels[subsystem - std::begin(SUBSYSTEM_NAMES)] = level_value;
   }
-  return to_file(value);
+  return "";
+}
+
+string Logger::check_levels(const char *spec)
+{
+  LogLevel levels[LOG_SUBSYSTEM_COUNT];
+  return parse_levels(spec, levels);
+}
+
+string Logger::set_levels(const char *spec)
+{
+  LogLevel *configured = configured_levels();
+
+  LogLevel levels[LOG_SUBSYSTEM_COUNT];
+  std::copy(configured, configured + LOG_SUBSYSTEM_COUNT, std::begin(levels));
+  string err = parse_levels(spec, levels);
+  if (!err.empty()) return err;
+
+  std::copy(std::begin(levels), std::end(levels), configured);
+
+  Logger *logger = current();
+  if (logger != &the_null_logger) std::copy(std::begin(levels), std::end(levels), std::begin(logger->levels));
+  return "";
 }
 
 string plural(long quantity, const string &singular_form, const string &plural_form)
@@ -6,6 +6,27 @@
 #include <ostream>
 #include <string>
 
+// Severity of a log line. A line is written if its level is at or below the level that the current thread's logger
+// has set for its subsystem.
+enum LogLevel
+{
+  LOG_LEVEL_OFF = 0,
+  LOG_LEVEL_ERROR,  // Failures that are reported or recovered from.
+  LOG_LEVEL_INFO,  // Watches and roots being added and removed, commands, configuration changes.
+  LOG_LEVEL_DEBUG  // Individual events, messages, and polling cycles.
+};
+
+// Area of the codebase that a log line comes from. Each has its own level, so that a noisy subsystem can be silenced
+// while another is being investigated.
+enum LogSubsystem
+{
+  LOG_GENERAL = 0,  // Thread lifecycle, commands, and anything not listed below.
+  LOG_EVENTS,  // Native filesystem events and the messages produced from them.
+  LOG_POLLING,  // Polling cycles and roots.
+  LOG_CACHE,  // The worker thread's stat cache.
+  LOG_SUBSYSTEM_COUNT
+};
+
 class Logger
 {
 public:
@@ -13,15 +34,30 @@ public:
 
   static std::string to_file(const char *filename);
 
+  // Log compact binary records to `filename` from a background thread. See `BinaryLogger`.
+  static std::string to_binary_file(const char *filename);
+
   static std::string to_stderr();
 
   static std::string to_stdout();
 
   static std::string disable();
 
+  // Configure the logger from the environment variable `varname`. A value of `stdout` or `stderr` logs to that stream,
+  // a value beginning with `binary:` logs binary records to the file named by the rest, and any other value names a
+  // text log file. Levels are read from the variable of the same name with a `_LEVEL` suffix, if it's set.
   static std::string from_env(const char *varname);
 
-  Logger() = default;
+  // Set the levels of the current thread's logger from a comma-separated list of entries like `info`, which applies to
+  // every subsystem, or `events=debug`, which applies to one. Later entries override earlier ones. Levels carry over
+  // when the thread switches to a different logger. While the thread's logger is disabled, which writes nothing at any
+  // level, they're kept for the next logger it creates. Return an error message if `spec` can't be parsed.
+  static std::string set_levels(const char *spec);
+
+  // Return an error message if `spec` can't be parsed by `set_levels()`, without changing any levels.
+  static std::string check_levels(const char *spec);
+
+  Logger();
 
   virtual ~Logger() = default;
 
@@ -31,18 +67,50 @@ public:
 
   virtual std::string get_error() const { return ""; }
 
+  // Return `true` if lines at `level` from `subsystem` are written. This is checked before any arguments of a
+  // `LOG_AT()` line are evaluated.
+  bool is_enabled(LogLevel level, LogSubsystem subsystem) const { return level <= levels[subsystem]; }
+
   Logger(const Logger &) = delete;
   Logger(Logger &&) = delete;
   Logger &operator=(const Logger &) = delete;
   Logger &operator=(Logger &&) = delete;
+
+protected:
+  LogLevel levels[LOG_SUBSYSTEM_COUNT];
+
+  friend std::string replace_logger(Logger *new_logger);
+};
+
+// Swallow the stream returned by a `LOG_AT()` line so that both branches of its conditional have type `void`.
+struct LogVoidify
+{
+  void operator&(std::ostream & /*stream*/) {}
 };
 
 std::string plural(long quantity, const std::string &singular_form, const std::string &plural_form);
 
 std::string plural(long quantity, const std::string &singular_form);
 
+// Write a line unconditionally. The prefix and every argument are formatted even when the logger is disabled, so
+// prefer `LOG_AT()` for anything that runs once per event or per entry.
 #define LOGGER (Logger::current()->prefix(__FILE__, __LINE__)->stream())
 
+// Write a line at `level` from `subsystem`. When that level is disabled, which it always is while logging is disabled,
+// nothing to the right of the macro is evaluated:
+//
+//   LOG_AT(LOG_LEVEL_DEBUG, LOG_EVENTS) << "Received " << describe(event) << "." << std::endl;
+//
+// Defining `WATCHER_UNGUARDED_LOGGING` reverts to formatting every line, for comparison by benchmarks.
+#ifdef WATCHER_UNGUARDED_LOGGING
+#define LOG_AT(level, subsystem) LOGGER
+#else
+#define LOG_AT(level, subsystem)                   \
+  !Logger::current()->is_enabled(level, subsystem) \
+    ? (void) 0                                     \
+    : LogVoidify() & (Logger::current()->prefix(__FILE__, __LINE__)->stream())
+#endif
+
 class Timer
 {
 public:
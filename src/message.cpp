@@ -25,6 +25,20 @@ ostream &operator<<(ostream &out, FileSystemAction action)
   return out;
 }
 
+ostream &operator<<(ostream &out, EventClass event_class)
+{
+  switch (event_class) {
+    case EVENT_CREATED: out << "created"; break;
+    case EVENT_DELETED: out << "deleted"; break;
+    case EVENT_MODIFIED: out << "modified"; break;
+    case EVENT_RENAMED: out << "renamed"; break;
+    case EVENT_ATTRIBUTES: out << "attributes"; break;
+    case EVENT_SETTLED: out << "settled"; break;
+    default: out << "!! EventClass=" << static_cast<int>(event_class);
+  }
+  return out;
+}
+
 ostream &operator<<(ostream &out, EntryKind kind)
 {
   switch (kind) {
@@ -47,7 +61,13 @@ FileSystemPayload::FileSystemPayload(ChannelID channel_id,
   EntryKind entry_kind,
   string &&old_path,
   string &&path) :
-  channel_id{channel_id}, action{action}, entry_kind{entry_kind}, old_path{move(old_path)}, path{move(path)}
+  channel_id{channel_id},
+  action{action},
+  entry_kind{entry_kind},
+  old_path{move(old_path)},
+  path{move(path)},
+  detected_at{monotonic_ns()},
+  queued_at{0}
 {
   //
 }
@@ -57,7 +77,9 @@ FileSystemPayload::FileSystemPayload(FileSystemPayload &&original) noexcept :
   action{original.action},
   entry_kind{original.entry_kind},
   old_path{move(original.old_path)},
-  path{move(original.path)}
+  path{move(original.path)},
+  detected_at{original.detected_at},
+  queued_at{original.queued_at}
 {
   //
 }
@@ -81,8 +103,19 @@ CommandPayload::CommandPayload(CommandAction action,
   std::string &&root,
   uint_fast32_t arg,
   bool recursive,
-  size_t split_count) :
-  id{id}, action{action}, root{move(root)}, arg{arg}, recursive{recursive}, split_count{split_count}
+  size_t split_count,
+  EventMask events,
+  std::shared_ptr<const PathMatcher> &&exclusions,
+  bool gitignore) :
+  id{id},
+  action{action},
+  root{move(root)},
+  arg{arg},
+  recursive{recursive},
+  split_count{split_count},
+  events{events},
+  exclusions{move(exclusions)},
+  gitignore{gitignore}
 {
   //
 }
@@ -93,7 +126,10 @@ CommandPayload::CommandPayload(CommandPayload &&original) noexcept :
   root{move(original.root)},
   arg{original.arg},
   recursive{original.recursive},
-  split_count{original.split_count}
+  split_count{original.split_count},
+  events{original.events},
+  exclusions{move(original.exclusions)},
+  gitignore{original.gitignore}
 {
   //
 }
@@ -107,14 +143,35 @@ string CommandPayload::describe() const
     case COMMAND_ADD:
       builder << "add " << root << " at channel " << arg;
       if (!recursive) builder << " (non-recursively)";
+      if (events != EVENT_DEFAULT) {
+        builder << " events (";
+        for (EventMask bit = 1; bit <= EVENT_ALL; bit <<= 1) {
+          if ((events & bit) != 0u) builder << " " << static_cast<EventClass>(bit);
+        }
+        builder << " )";
+      }
+      if (exclusions) builder << " excluding " << *exclusions;
+      if (gitignore) builder << " honoring .gitignore";
       break;
     case COMMAND_REMOVE: builder << "remove channel " << arg; break;
     case COMMAND_LOG_FILE: builder << "log to file " << root; break;
     case COMMAND_LOG_STDERR: builder << "log to stderr" << root; break;
     case COMMAND_LOG_STDOUT: builder << "log to stdout" << root; break;
     case COMMAND_LOG_DISABLE: builder << "disable logging"; break;
+    case COMMAND_LOG_BINARY: builder << "log binary records to file " << root; break;
+    case COMMAND_LOG_LEVELS: builder << "log levels " << root; break;
     case COMMAND_POLLING_INTERVAL: builder << "polling interval " << arg; break;
     case COMMAND_POLLING_THROTTLE: builder << "polling throttle " << arg; break;
+    case COMMAND_POLLING_WORKERS: builder << "polling workers " << arg; break;
+    case COMMAND_POLLING_HOT_SHARE: builder << "polling hot share " << arg << "%"; break;
+    case COMMAND_POLLING_BUDGET: builder << "polling budget " << arg << "%"; break;
+    case COMMAND_POLLING_SNAPSHOTS:
+      if (root.empty()) {
+        builder << "disable polling snapshots";
+      } else {
+        builder << "polling snapshots in " << root;
+      }
+      break;
     case COMMAND_CACHE_SIZE: builder << "cache size " << arg; break;
     case COMMAND_DRAIN: builder << "drain"; break;
     case COMMAND_STATUS: builder << "status request " << arg; break;
@@ -195,6 +252,14 @@ const StatusPayload *Message::as_status() const
   return kind == MSG_STATUS ? &status_payload : nullptr;
 }
 
+bool Message::mark_queued(uint64_t at)
+{
+  if (kind != MSG_FILESYSTEM) return false;
+
+  filesystem_payload.mark_queued(at);
+  return true;
+}
+
 Message Message::ack(const Message &original, bool success, string &&message)
 {
   const CommandPayload *payload = original.as_command();
@@ -259,6 +324,21 @@ Message::~Message()
   };
 }
 
+size_t Message::footprint() const
+{
+  size_t total = sizeof(Message);
+  switch (kind) {
+    case MSG_FILESYSTEM:
+      total += filesystem_payload.get_old_path().size() + filesystem_payload.get_path().size();
+      break;
+    case MSG_COMMAND: total += command_payload.get_root().size(); break;
+    case MSG_ACK: total += ack_payload.get_message().size(); break;
+    case MSG_ERROR: total += error_payload.get_message().size(); break;
+    default: break;
+  };
+  return total;
+}
+
 string Message::describe() const
 {
   ostringstream builder;
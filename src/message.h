@@ -7,6 +7,8 @@
 #include <string>
 #include <utility>
 
+#include "latency_histogram.h"
+#include "path_matcher.h"
 #include "result.h"
 #include "status.h"
 
@@ -46,6 +48,24 @@ enum FileSystemAction
 
 std::ostream &operator<<(std::ostream &out, FileSystemAction action);
 
+// Classes of filesystem events that a channel may subscribe to. Backends use these to avoid requesting or generating
+// events that no consumer of the channel wants.
+enum EventClass
+{
+  EVENT_CREATED = 1 << 0,
+  EVENT_DELETED = 1 << 1,
+  EVENT_MODIFIED = 1 << 2,
+  EVENT_RENAMED = 1 << 3,
+  EVENT_ATTRIBUTES = 1 << 4,
+  EVENT_SETTLED = 1 << 5,  // Report modifications only once a writer has closed the file.
+  EVENT_DEFAULT = EVENT_CREATED | EVENT_DELETED | EVENT_MODIFIED | EVENT_RENAMED | EVENT_ATTRIBUTES,
+  EVENT_ALL = EVENT_DEFAULT | EVENT_SETTLED
+};
+
+using EventMask = uint_fast32_t;
+
+std::ostream &operator<<(std::ostream &out, EventClass event_class);
+
 class FileSystemPayload
 {
 public:
@@ -86,6 +106,15 @@ public:
 
   const std::string &get_path() const { return path; }
 
+  // Reading of `monotonic_ns()` taken when the backend that observed this event built it, immediately after reading
+  // it from the operating system or discovering it by polling.
+  const uint64_t &get_detected_at() const { return detected_at; }
+
+  // Reading of `monotonic_ns()` taken when this event was enqueued for the main thread.
+  const uint64_t &get_queued_at() const { return queued_at; }
+
+  void mark_queued(uint64_t at) { queued_at = at; }
+
   std::string describe() const;
 
   FileSystemPayload(const FileSystemPayload &original) = delete;
@@ -104,6 +133,8 @@ private:
   const EntryKind entry_kind;
   std::string old_path;
   std::string path;
+  const uint64_t detected_at;
+  uint64_t queued_at;
 };
 
 enum CommandAction
@@ -114,8 +145,14 @@ enum CommandAction
   COMMAND_LOG_STDERR,
   COMMAND_LOG_STDOUT,
   COMMAND_LOG_DISABLE,
+  COMMAND_LOG_BINARY,
+  COMMAND_LOG_LEVELS,
   COMMAND_POLLING_INTERVAL,
   COMMAND_POLLING_THROTTLE,
+  COMMAND_POLLING_WORKERS,
+  COMMAND_POLLING_HOT_SHARE,
+  COMMAND_POLLING_BUDGET,
+  COMMAND_POLLING_SNAPSHOTS,
   COMMAND_CACHE_SIZE,
   COMMAND_DRAIN,
   COMMAND_STATUS,
@@ -152,6 +189,12 @@ public:
 
   const size_t &get_split_count() const { return split_count; }
 
+  const EventMask &get_events() const { return events; }
+
+  const std::shared_ptr<const PathMatcher> &get_exclusions() const { return exclusions; }
+
+  const bool &get_gitignore() const { return gitignore; }
+
   std::string describe() const;
 
   CommandPayload &operator=(const CommandPayload &original) = delete;
@@ -163,7 +206,10 @@ private:
     std::string &&root,
     uint_fast32_t arg,
     bool recursive,
-    size_t split_count);
+    size_t split_count,
+    EventMask events,
+    std::shared_ptr<const PathMatcher> &&exclusions,
+    bool gitignore);
 
   const CommandID id;
   const CommandAction action;
@@ -171,6 +217,9 @@ private:
   const uint_fast32_t arg;
   bool recursive;
   const size_t split_count;
+  const EventMask events;
+  std::shared_ptr<const PathMatcher> exclusions;
+  bool gitignore;
 
   friend class CommandPayloadBuilder;
 };
@@ -208,6 +257,16 @@ public:
     return CommandPayloadBuilder(COMMAND_LOG_DISABLE, "", NULL_CHANNEL_ID, false, 1);
   }
 
+  static CommandPayloadBuilder log_to_binary_file(std::string &&log_file)
+  {
+    return CommandPayloadBuilder(COMMAND_LOG_BINARY, std::move(log_file), NULL_CHANNEL_ID, false, 1);
+  }
+
+  static CommandPayloadBuilder log_levels(std::string &&spec)
+  {
+    return CommandPayloadBuilder(COMMAND_LOG_LEVELS, std::move(spec), NULL_CHANNEL_ID, false, 1);
+  }
+
   static CommandPayloadBuilder polling_interval(const uint_fast32_t &interval)
   {
     return CommandPayloadBuilder(COMMAND_POLLING_INTERVAL, "", interval, false, 1);
@@ -218,6 +277,26 @@ public:
     return CommandPayloadBuilder(COMMAND_POLLING_THROTTLE, "", throttle, false, 1);
   }
 
+  static CommandPayloadBuilder polling_workers(const uint_fast32_t &workers)
+  {
+    return CommandPayloadBuilder(COMMAND_POLLING_WORKERS, "", workers, false, 1);
+  }
+
+  static CommandPayloadBuilder polling_hot_share(const uint_fast32_t &percent)
+  {
+    return CommandPayloadBuilder(COMMAND_POLLING_HOT_SHARE, "", percent, false, 1);
+  }
+
+  static CommandPayloadBuilder polling_budget(const uint_fast32_t &percent)
+  {
+    return CommandPayloadBuilder(COMMAND_POLLING_BUDGET, "", percent, false, 1);
+  }
+
+  static CommandPayloadBuilder polling_snapshots(std::string &&directory)
+  {
+    return CommandPayloadBuilder(COMMAND_POLLING_SNAPSHOTS, std::move(directory), NULL_CHANNEL_ID, false, 1);
+  }
+
   static CommandPayloadBuilder cache_size(uint_fast32_t maximum_size)
   {
     return CommandPayloadBuilder(COMMAND_CACHE_SIZE, "", maximum_size, false, 1);
@@ -236,7 +315,10 @@ public:
     root{std::move(original.root)},
     arg{original.arg},
     recursive{original.recursive},
-    split_count{original.split_count}
+    split_count{original.split_count},
+    events{original.events},
+    exclusions{std::move(original.exclusions)},
+    gitignore{original.gitignore}
   {
     //
   }
@@ -249,10 +331,32 @@ public:
     return *this;
   }
 
+  // Restrict the classes of filesystem events that an `add` command's channel will receive.
+  CommandPayloadBuilder &set_events(EventMask events)
+  {
+    this->events = events;
+    return *this;
+  }
+
+  // Prune paths matched by a compiled `PathMatcher` from an `add` command's channel. A null matcher excludes nothing.
+  CommandPayloadBuilder &set_exclusions(const std::shared_ptr<const PathMatcher> &exclusions)
+  {
+    this->exclusions = exclusions;
+    return *this;
+  }
+
+  // Prune paths ignored by the `.gitignore` files within an `add` command's root from its channel.
+  CommandPayloadBuilder &set_gitignore(bool gitignore)
+  {
+    this->gitignore = gitignore;
+    return *this;
+  }
+
   CommandPayload build()
   {
     assert(action >= COMMAND_MIN && action <= COMMAND_MAX);
-    return CommandPayload(action, id, std::move(root), arg, recursive, split_count);
+    return CommandPayload(
+      action, id, std::move(root), arg, recursive, split_count, events, std::move(exclusions), gitignore);
   }
 
   CommandPayloadBuilder(const CommandPayloadBuilder &) = delete;
@@ -265,7 +369,15 @@ private:
     uint_fast32_t arg,
     bool recursive,
     size_t split_count) :
-    id{NULL_COMMAND_ID}, action{action}, root{std::move(root)}, arg{arg}, recursive{recursive}, split_count{split_count}
+    id{NULL_COMMAND_ID},
+    action{action},
+    root{std::move(root)},
+    arg{arg},
+    recursive{recursive},
+    split_count{split_count},
+    events{EVENT_DEFAULT},
+    exclusions{nullptr},
+    gitignore{false}
   {}
 
   CommandID id;
@@ -274,6 +386,9 @@ private:
   uint_fast32_t arg;
   bool recursive;
   size_t split_count;
+  EventMask events;
+  std::shared_ptr<const PathMatcher> exclusions;
+  bool gitignore;
 };
 
 class AckPayload
@@ -399,6 +514,13 @@ public:
 
   const StatusPayload *as_status() const;
 
+  // Record the moment that a filesystem event message was enqueued for the main thread. Other messages are unaffected.
+  // Returns `true` if this is a filesystem event message.
+  bool mark_queued(uint64_t at);
+
+  // Approximate number of bytes of memory held by this message, including the contents of its strings.
+  size_t footprint() const;
+
   std::string describe() const;
 
   Message(const Message &) = delete;
@@ -1,55 +1,64 @@
 #include <iostream>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "gitignore.h"
 #include "log.h"
 #include "message.h"
 #include "message_buffer.h"
+#include "path_matcher.h"
+#include "probes.h"
 
 using std::endl;
 using std::move;
+using std::shared_ptr;
 using std::string;
 
 void MessageBuffer::created(ChannelID channel_id, std::string &&path, const EntryKind &kind)
 {
+  WATCHER_PROBE3(event_emitted, channel_id, ACTION_CREATED, kind);
   Message message(FileSystemPayload::created(channel_id, move(path), kind));
-  LOGGER << "Emitting filesystem message " << message << endl;
+  LOG_AT(LOG_LEVEL_DEBUG, LOG_EVENTS) << "Emitting filesystem message " << message << endl;
   messages.push_back(move(message));
 }
 
 void MessageBuffer::modified(ChannelID channel_id, std::string &&path, const EntryKind &kind)
 {
+  WATCHER_PROBE3(event_emitted, channel_id, ACTION_MODIFIED, kind);
   Message message(FileSystemPayload::modified(channel_id, move(path), kind));
-  LOGGER << "Emitting filesystem message " << message << endl;
+  LOG_AT(LOG_LEVEL_DEBUG, LOG_EVENTS) << "Emitting filesystem message " << message << endl;
   messages.push_back(move(message));
 }
 
 void MessageBuffer::deleted(ChannelID channel_id, std::string &&path, const EntryKind &kind)
 {
+  WATCHER_PROBE3(event_emitted, channel_id, ACTION_DELETED, kind);
   Message message(FileSystemPayload::deleted(channel_id, move(path), kind));
-  LOGGER << "Emitting filesystem message " << message << endl;
+  LOG_AT(LOG_LEVEL_DEBUG, LOG_EVENTS) << "Emitting filesystem message " << message << endl;
   messages.push_back(move(message));
 }
 
 void MessageBuffer::renamed(ChannelID channel_id, std::string &&old_path, std::string &&path, const EntryKind &kind)
 {
+  WATCHER_PROBE3(event_emitted, channel_id, ACTION_RENAMED, kind);
   Message message(FileSystemPayload::renamed(channel_id, move(old_path), move(path), kind));
-  LOGGER << "Emitting filesystem message " << message << endl;
+  LOG_AT(LOG_LEVEL_DEBUG, LOG_EVENTS) << "Emitting filesystem message " << message << endl;
   messages.push_back(move(message));
 }
 
 void MessageBuffer::ack(CommandID command_id, ChannelID channel_id, bool success, string &&msg)
 {
   Message message(AckPayload(command_id, channel_id, success, move(msg)));
-  LOGGER << "Emitting ack message " << message << endl;
+  LOG_AT(LOG_LEVEL_DEBUG, LOG_EVENTS) << "Emitting ack message " << message << endl;
   messages.push_back(move(message));
 }
 
 void MessageBuffer::error(ChannelID channel_id, string &&message, bool fatal)
 {
   Message m(ErrorPayload(channel_id, move(message), fatal));
-  LOGGER << "Emitting error message " << m << endl;
+  LOG_AT(LOG_LEVEL_DEBUG, LOG_EVENTS) << "Emitting error message " << m << endl;
   messages.push_back(move(m));
 }
 
@@ -58,3 +67,29 @@ ChannelMessageBuffer::ChannelMessageBuffer(MessageBuffer &buffer, ChannelID chan
   buffer{buffer} {
     //
   };
+
+ChannelMessageBuffer::ChannelMessageBuffer(MessageBuffer &buffer,
+  ChannelID channel_id,
+  shared_ptr<const PathMatcher> exclusions,
+  shared_ptr<GitIgnore> gitignore) :
+  channel_id{channel_id},
+  buffer{buffer},
+  exclusions{move(exclusions)},
+  gitignore{move(gitignore)}
+{
+  //
+}
+
+void ChannelMessageBuffer::renamed(string &&old_path, string &&path, const EntryKind &kind)
+{
+  bool old_excluded = is_excluded(old_path, kind);
+  bool new_excluded = is_excluded(path, kind);
+
+  if (!old_excluded && !new_excluded) {
+    buffer.renamed(channel_id, move(old_path), move(path), kind);
+  } else if (!old_excluded) {
+    buffer.deleted(channel_id, move(old_path), kind);
+  } else if (!new_excluded) {
+    buffer.created(channel_id, move(path), kind);
+  }
+}
@@ -1,11 +1,14 @@
 #ifndef MESSAGE_BUFFER_H
 #define MESSAGE_BUFFER_H
 
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "gitignore.h"
 #include "message.h"
+#include "path_matcher.h"
 
 class MessageBuffer
 {
@@ -53,6 +56,14 @@ class ChannelMessageBuffer
 {
 public:
   ChannelMessageBuffer(MessageBuffer &buffer, ChannelID channel_id);
+
+  // Construct a buffer that silently discards filesystem events on any paths matched by `exclusions` or ignored by
+  // `gitignore`. Backends that can't prune excluded subtrees at their source use this to keep excluded events from
+  // reaching the main thread. Events that touch a `.gitignore` file also discard its cached rules from `gitignore`.
+  ChannelMessageBuffer(MessageBuffer &buffer,
+    ChannelID channel_id,
+    std::shared_ptr<const PathMatcher> exclusions,
+    std::shared_ptr<GitIgnore> gitignore = nullptr);
   ChannelMessageBuffer(const ChannelMessageBuffer &) = delete;
   ChannelMessageBuffer(ChannelMessageBuffer &&) = delete;
   ~ChannelMessageBuffer() = default;
@@ -60,17 +71,25 @@ public:
   ChannelMessageBuffer &operator=(const ChannelMessageBuffer &) = delete;
   ChannelMessageBuffer &operator=(ChannelMessageBuffer &&) = delete;
 
-  void created(std::string &&path, const EntryKind &kind) { buffer.created(channel_id, std::move(path), kind); }
-
-  void modified(std::string &&path, const EntryKind &kind) { buffer.modified(channel_id, std::move(path), kind); }
+  void created(std::string &&path, const EntryKind &kind)
+  {
+    if (!is_excluded(path, kind)) buffer.created(channel_id, std::move(path), kind);
+  }
 
-  void deleted(std::string &&path, const EntryKind &kind) { buffer.deleted(channel_id, std::move(path), kind); }
+  void modified(std::string &&path, const EntryKind &kind)
+  {
+    if (!is_excluded(path, kind)) buffer.modified(channel_id, std::move(path), kind);
+  }
 
-  void renamed(std::string &&old_path, std::string &&path, const EntryKind &kind)
+  void deleted(std::string &&path, const EntryKind &kind)
   {
-    buffer.renamed(channel_id, std::move(old_path), std::move(path), kind);
+    if (!is_excluded(path, kind)) buffer.deleted(channel_id, std::move(path), kind);
   }
 
+  // A rename that crosses the boundary of an excluded subtree is reported as a creation or deletion of the side that
+  // remains visible.
+  void renamed(std::string &&old_path, std::string &&path, const EntryKind &kind);
+
   void ack(CommandID command_id, bool success, std::string &&msg)
   {
     buffer.ack(command_id, channel_id, success, std::move(msg));
@@ -91,8 +110,19 @@ public:
   ChannelID get_channel_id() { return channel_id; }
 
 private:
+  bool is_excluded(const std::string &path, const EntryKind &kind)
+  {
+    if (exclusions && exclusions->excludes(path, kind == KIND_DIRECTORY)) return true;
+    if (!gitignore) return false;
+
+    gitignore->changed(path);
+    return gitignore->excludes(path, kind == KIND_DIRECTORY);
+  }
+
   ChannelID channel_id;
   MessageBuffer &buffer;
+  std::shared_ptr<const PathMatcher> exclusions;
+  std::shared_ptr<GitIgnore> gitignore;
 };
 
 #endif
@@ -0,0 +1,114 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <cstdint>
+
+// A count that only increases. It's written by a single thread and may be read from any other without locking.
+class MetricCounter
+{
+public:
+  MetricCounter() : value{0} {}
+
+  // Only call from the thread that owns this counter. Avoiding a read-modify-write keeps the cost to that of a plain
+  // increment.
+  void add(uint64_t n) { value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+
+  uint64_t get() const { return value.load(std::memory_order_relaxed); }
+
+  MetricCounter(const MetricCounter &) = delete;
+  MetricCounter(MetricCounter &&) = delete;
+  ~MetricCounter() = default;
+  MetricCounter &operator=(const MetricCounter &) = delete;
+  MetricCounter &operator=(MetricCounter &&) = delete;
+
+private:
+  std::atomic<uint64_t> value;
+};
+
+// A measurement that's overwritten by a single thread, or under a lock, and may be read from any other without locking.
+class MetricGauge
+{
+public:
+  MetricGauge() : value{0} {}
+
+  void set(uint64_t v) { value.store(v, std::memory_order_relaxed); }
+
+  uint64_t get() const { return value.load(std::memory_order_relaxed); }
+
+  MetricGauge(const MetricGauge &) = delete;
+  MetricGauge(MetricGauge &&) = delete;
+  ~MetricGauge() = default;
+  MetricGauge &operator=(const MetricGauge &) = delete;
+  MetricGauge &operator=(MetricGauge &&) = delete;
+
+private:
+  std::atomic<uint64_t> value;
+};
+
+// Values of every counter published by `Metrics`, each `Thread`, and each `Queue`, read at a single moment by the
+// main thread.
+struct MetricsSample
+{
+  uint64_t worker_events_read{0};
+  uint64_t worker_events_emitted{0};
+  uint64_t worker_watch_count{0};
+  uint64_t worker_stats{0};
+  uint64_t worker_cache_hits{0};
+  uint64_t worker_cache_misses{0};
+  uint64_t worker_in_depth{0};
+  uint64_t worker_out_depth{0};
+
+  uint64_t polling_events_emitted{0};
+  uint64_t polling_operations{0};
+  uint64_t polling_in_depth{0};
+  uint64_t polling_out_depth{0};
+
+  uint64_t bytes_in_flight{0};
+};
+
+// Counters published by the internals of the worker and polling threads, so that `metrics()` can sample them from the
+// main thread without a round trip through either thread's command queue. Counts of emitted events and the depths of
+// each queue are kept by each `Thread` and `Queue` instead.
+//
+// Values are read individually with relaxed ordering, so a sample may combine counts from slightly different moments.
+class Metrics
+{
+public:
+  static Metrics &get()
+  {
+    static Metrics metrics;
+    return metrics;
+  }
+
+  // Worker thread
+
+  // Events read from the operating system.
+  MetricCounter worker_events_read;
+
+  // Watch descriptors on Linux, event streams on MacOS, or directory handles on Windows that are currently open.
+  MetricGauge worker_watch_count;
+
+  // Calls to `lstat()` made to learn the kind of an entry that an event touched.
+  MetricCounter worker_stats;
+
+  // Lookups answered by the recent file cache, and those that weren't.
+  MetricCounter worker_cache_hits;
+  MetricCounter worker_cache_misses;
+
+  // Polling thread
+
+  // Calls to `lstat()` and `readdir()` made by the polling workers.
+  MetricCounter polling_operations;
+
+  Metrics(const Metrics &) = delete;
+  Metrics(Metrics &&) = delete;
+  Metrics &operator=(const Metrics &) = delete;
+  Metrics &operator=(Metrics &&) = delete;
+
+private:
+  Metrics() = default;
+  ~Metrics() = default;
+};
+
+#endif
@@ -0,0 +1,302 @@
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "channel_stats.h"
+#include "latency_histogram.h"
+#include "metrics.h"
+#include "openmetrics.h"
+#include "status.h"
+
+using std::ostream;
+using std::string;
+
+// Upper bounds of the buckets reported for each latency histogram, in nanoseconds and as they're written in seconds.
+struct BucketBound
+{
+  uint64_t nanoseconds;
+  const char *seconds;
+};
+
+static const BucketBound BUCKET_BOUNDS[] = {{1000, "0.000001"},
+  {5000, "0.000005"},
+  {10000, "0.00001"},
+  {50000, "0.00005"},
+  {100000, "0.0001"},
+  {500000, "0.0005"},
+  {1000000, "0.001"},
+  {5000000, "0.005"},
+  {10000000, "0.01"},
+  {50000000, "0.05"},
+  {100000000, "0.1"},
+  {500000000, "0.5"},
+  {1000000000, "1.0"},
+  {5000000000, "5.0"},
+  {10000000000, "10.0"}};
+
+static const char *THREAD_STATES[] = {"stopped", "starting", "running", "stopping"};
+
+static void write_family(ostream &out, const char *name, const char *type, const char *help, const char *unit = nullptr)
+{
+  out << "# TYPE " << name << " " << type << "\n";
+  if (unit != nullptr) out << "# UNIT " << name << " " << unit << "\n";
+  out << "# HELP " << name << " " << help << "\n";
+}
+
+// Write a duration in nanoseconds as a decimal number of seconds without losing precision.
+static void write_seconds(ostream &out, uint64_t nanoseconds)
+{
+  out << nanoseconds / 1000000000 << "." << std::setw(9) << std::setfill('0') << nanoseconds % 1000000000
+      << std::setfill(' ');
+}
+
+// Write the samples of a single histogram. `labels` is either empty or a comma-separated list of labels that ends
+// with a comma.
+static void write_histogram(ostream &out, const char *name, const string &labels, const LatencyHistogram &histogram)
+{
+  for (const BucketBound &bound : BUCKET_BOUNDS) {
+    out << name << "_bucket{" << labels << "le=\"" << bound.seconds << "\"} "
+        << histogram.count_at_or_below(bound.nanoseconds) << "\n";
+  }
+  out << name << "_bucket{" << labels << "le=\"+Inf\"} " << histogram.get_count() << "\n";
+
+  string braced = labels.empty() ? "" : "{" + labels.substr(0, labels.size() - 1) + "}";
+  out << name << "_count" << braced << " " << histogram.get_count() << "\n";
+  out << name << "_sum" << braced << " ";
+  write_seconds(out, histogram.get_sum());
+  out << "\n";
+}
+
+// Events of a single action received on a channel.
+struct ActionCount
+{
+  const char *name;
+  uint64_t count;
+};
+
+// The portion of a `Status` that describes one native thread.
+struct ThreadSummary
+{
+  const char *name;
+  const string &state;
+  const string &ok;
+  size_t in_size;
+  const string &in_ok;
+  size_t out_size;
+  const string &out_ok;
+};
+
+// Write one sample of a per-channel family for each channel that was reported.
+template <class Value>
+static void write_per_channel(ostream &out,
+  const Status &status,
+  const char *name,
+  const char *type,
+  const char *help,
+  Value ChannelStats::*field)
+{
+  write_family(out, name, type, help);
+  const char *suffix = string(type) == "counter" ? "_total" : "";
+  for (auto &pair : status.channel_stats) {
+    out << name << suffix << "{channel=\"" << pair.first << "\"} " << pair.second.*field << "\n";
+  }
+}
+
+static void write_gauge(ostream &out, const char *name, const char *help, uint64_t value)
+{
+  write_family(out, name, "gauge", help);
+  out << name << " " << value << "\n";
+}
+
+void write_openmetrics(ostream &out, const Status &status)
+{
+  const MetricsSample &metrics = status.metrics;
+
+  // Counters
+  write_family(out, "watcher_events_read", "counter", "Native filesystem events read from the operating system.");
+  out << "watcher_events_read_total " << metrics.worker_events_read << "\n";
+
+  write_family(out, "watcher_events_emitted", "counter", "Filesystem events handed to the main thread.");
+  out << "watcher_events_emitted_total{thread=\"worker\"} " << metrics.worker_events_emitted << "\n";
+  out << "watcher_events_emitted_total{thread=\"polling\"} " << metrics.polling_events_emitted << "\n";
+
+  write_family(out, "watcher_stats", "counter", "Calls to lstat() made to identify the entries that events touched.");
+  out << "watcher_stats_total " << metrics.worker_stats << "\n";
+
+  write_family(out, "watcher_cache_lookups", "counter", "Lookups made in the worker thread's recent file cache.");
+  out << "watcher_cache_lookups_total{result=\"hit\"} " << metrics.worker_cache_hits << "\n";
+  out << "watcher_cache_lookups_total{result=\"miss\"} " << metrics.worker_cache_misses << "\n";
+
+  write_family(out, "watcher_polling_operations", "counter", "Calls to lstat() and readdir() made by polling.");
+  out << "watcher_polling_operations_total " << metrics.polling_operations << "\n";
+
+  // Main thread
+  write_gauge(
+    out, "watcher_pending_callbacks", "Callbacks awaiting a command acknowledgement.", status.pending_callback_count);
+  write_gauge(out, "watcher_channel_callbacks", "Channels with an event callback.", status.channel_callback_count);
+  write_gauge(out, "watcher_routes", "Routes that deliver a subtree of a channel's events.", status.route_count);
+  write_gauge(
+    out, "watcher_queued_bytes", "Approximate memory held by messages waiting on any queue.", metrics.bytes_in_flight);
+
+  // Threads and their queues
+  const ThreadSummary threads[] = {{"worker",
+                                     status.worker_thread_state,
+                                     status.worker_thread_ok,
+                                     status.worker_in_size,
+                                     status.worker_in_ok,
+                                     status.worker_out_size,
+                                     status.worker_out_ok},
+    {"polling",
+      status.polling_thread_state,
+      status.polling_thread_ok,
+      status.polling_in_size,
+      status.polling_in_ok,
+      status.polling_out_size,
+      status.polling_out_ok}};
+
+  write_family(out, "watcher_thread_state", "stateset", "Lifecycle phase of each native thread.");
+  for (const ThreadSummary &thread : threads) {
+    for (const char *candidate : THREAD_STATES) {
+      out << "watcher_thread_state{thread=\"" << thread.name << "\",watcher_thread_state=\"" << candidate << "\"} "
+          << (thread.state == candidate ? 1 : 0) << "\n";
+    }
+  }
+
+  write_family(out, "watcher_thread_healthy", "gauge", "Whether each native thread has avoided an error.");
+  for (const ThreadSummary &thread : threads) {
+    out << "watcher_thread_healthy{thread=\"" << thread.name << "\"} " << (thread.ok == "ok" ? 1 : 0) << "\n";
+  }
+
+  write_family(out, "watcher_queue_healthy", "gauge", "Whether each queue has avoided an error.");
+  for (const ThreadSummary &thread : threads) {
+    out << "watcher_queue_healthy{thread=\"" << thread.name << "\",queue=\"in\"} " << (thread.in_ok == "ok" ? 1 : 0)
+        << "\n";
+    out << "watcher_queue_healthy{thread=\"" << thread.name << "\",queue=\"out\"} " << (thread.out_ok == "ok" ? 1 : 0)
+        << "\n";
+  }
+
+  write_family(out, "watcher_queue_messages", "gauge", "Messages waiting on each queue.");
+  for (const ThreadSummary &thread : threads) {
+    out << "watcher_queue_messages{thread=\"" << thread.name << "\",queue=\"in\"} " << thread.in_size << "\n";
+    out << "watcher_queue_messages{thread=\"" << thread.name << "\",queue=\"out\"} " << thread.out_size << "\n";
+  }
+
+  // Worker thread
+  write_gauge(
+    out, "watcher_worker_subscriptions", "Roots watched by the worker thread.", status.worker_subscription_count);
+  write_gauge(out, "watcher_worker_watches", "Native watch handles currently open.", metrics.worker_watch_count);
+#ifdef PLATFORM_MACOS
+  write_gauge(out,
+    "watcher_worker_rename_buffer_entries",
+    "Unpaired rename events being held.",
+    status.worker_rename_buffer_size);
+  write_gauge(out,
+    "watcher_worker_recent_file_cache_entries",
+    "Entries within the recent file cache.",
+    status.worker_recent_file_cache_size);
+#endif
+#ifdef PLATFORM_LINUX
+  write_gauge(
+    out, "watcher_worker_watch_descriptors", "Active inotify watch descriptors.", status.worker_watch_descriptor_count);
+  write_gauge(out, "watcher_worker_channels", "Channels with inotify watches.", status.worker_channel_count);
+  write_gauge(out, "watcher_worker_cookies", "Unpaired rename cookies being held.", status.worker_cookie_jar_size);
+#endif
+
+  // Polling thread
+  write_gauge(out, "watcher_polling_roots", "Roots watched by polling.", status.polling_root_count);
+  write_gauge(out, "watcher_polling_workers", "Threads that poll the filesystem.", status.polling_worker_count);
+  write_gauge(out, "watcher_polling_entries", "Filesystem entries tracked by polling.", status.polling_entry_count);
+  write_gauge(out,
+    "watcher_polling_hot_directories",
+    "Directories polled every cycle because they changed recently.",
+    status.polling_hot_directory_count);
+  write_gauge(out, "watcher_polling_throughput", "Polled entries checked per second.", status.polling_throughput);
+
+  // Channels, when requested
+  if (!status.channel_stats.empty()) {
+    write_family(out, "watcher_channel_events", "counter", "Filesystem events received on each channel, by action.");
+    for (auto &pair : status.channel_stats) {
+      const ChannelStats &stats = pair.second;
+      const ActionCount actions[] = {{"created", stats.created},
+        {"modified", stats.modified},
+        {"deleted", stats.deleted},
+        {"renamed", stats.renamed}};
+      for (const ActionCount &action : actions) {
+        out << "watcher_channel_events_total{channel=\"" << pair.first << "\",action=\"" << action.name << "\"} "
+            << action.count << "\n";
+      }
+    }
+
+    write_per_channel(out,
+      status,
+      "watcher_channel_event_rate",
+      "gauge",
+      "Events per second received on each channel since its rate was last reported.",
+      &ChannelStats::events_per_second);
+    write_per_channel(out,
+      status,
+      "watcher_channel_emitted_bytes",
+      "counter",
+      "Bytes of path carried by the events on each channel.",
+      &ChannelStats::bytes_emitted);
+    write_per_channel(out,
+      status,
+      "watcher_channel_native_events",
+      "counter",
+      "Native events read for the directories each channel watches.",
+      &ChannelStats::worker_events_read);
+    write_per_channel(out,
+      status,
+      "watcher_channel_stats",
+      "counter",
+      "Calls to lstat() made while interpreting each channel's native events.",
+      &ChannelStats::worker_stats);
+    write_per_channel(out,
+      status,
+      "watcher_channel_watches",
+      "gauge",
+      "Watch descriptors held for each channel.",
+      &ChannelStats::worker_watch_count);
+    write_per_channel(out,
+      status,
+      "watcher_channel_polled_entries",
+      "gauge",
+      "Filesystem entries recorded by each channel's polled root.",
+      &ChannelStats::polling_entry_count);
+    write_per_channel(out,
+      status,
+      "watcher_channel_polling_operations",
+      "counter",
+      "Calls to lstat() and readdir() made to poll each channel's root.",
+      &ChannelStats::polling_operations);
+  }
+
+  // Histograms
+  write_family(out,
+    "watcher_delivery_latency_seconds",
+    "histogram",
+    "Time for a filesystem event to pass through each stage of delivery.",
+    "seconds");
+  for (auto &pair : status.channel_latency) {
+    string channel = "channel=\"" + std::to_string(pair.first) + "\",";
+    write_histogram(
+      out, "watcher_delivery_latency_seconds", channel + "stage=\"kernel_to_queue\",", pair.second.kernel_to_queue);
+    write_histogram(
+      out, "watcher_delivery_latency_seconds", channel + "stage=\"queue_to_main\",", pair.second.queue_to_main);
+    write_histogram(out, "watcher_delivery_latency_seconds", channel + "stage=\"total\",", pair.second.total);
+  }
+
+  write_family(out,
+    "watcher_worker_consume_duration_seconds",
+    "histogram",
+    "Time spent translating each batch of native events into messages.",
+    "seconds");
+  write_histogram(out, "watcher_worker_consume_duration_seconds", "", status.worker_consume_duration);
+
+  write_family(
+    out, "watcher_polling_cycle_duration_seconds", "histogram", "Time spent on each polling cycle.", "seconds");
+  write_histogram(out, "watcher_polling_cycle_duration_seconds", "", status.polling_cycle_duration);
+
+  out << "# EOF\n";
+}
@@ -0,0 +1,13 @@
+#ifndef OPENMETRICS_H
+#define OPENMETRICS_H
+
+#include <iostream>
+
+#include "status.h"
+
+// Render every counter, gauge, and histogram within `status` in the OpenMetrics text exposition format, so that it can
+// be served to a Prometheus scraper as-is. Latency histograms are labelled by channel ID and stage, and durations are
+// reported in seconds.
+void write_openmetrics(std::ostream &out, const Status &status);
+
+#endif
@@ -0,0 +1,420 @@
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "path_matcher.h"
+
+using std::move;
+using std::string;
+using std::vector;
+
+#ifdef PLATFORM_WINDOWS
+static bool is_separator(char c)
+{
+  return c == '/' || c == '\\';
+}
+#else
+static bool is_separator(char c)
+{
+  return c == '/';
+}
+#endif
+
+// Match a bracket expression beginning at `pattern[p]`, which must be a `[`, against the character `c`. On success,
+// advance `p` past the closing `]`. Return `false` without moving `p` if the expression is unterminated, so that the
+// caller can treat the `[` as a literal character.
+static bool match_class(const string &pattern, size_t &p, char c, bool &matched)
+{
+  size_t i = p + 1;
+  bool negated = false;
+  if (i < pattern.size() && (pattern[i] == '!' || pattern[i] == '^')) {
+    negated = true;
+    i++;
+  }
+
+  bool found = false;
+  bool first = true;
+  while (i < pattern.size() && (first || pattern[i] != ']')) {
+    first = false;
+
+    char low = pattern[i];
+    if (low == '\\' && i + 1 < pattern.size()) low = pattern[++i];
+    i++;
+
+    char high = low;
+    if (i + 1 < pattern.size() && pattern[i] == '-' && pattern[i + 1] != ']') {
+      high = pattern[i + 1];
+      if (high == '\\' && i + 2 < pattern.size()) {
+        high = pattern[i + 2];
+        i++;
+      }
+      i += 2;
+    }
+
+    if (low <= c && c <= high) found = true;
+  }
+
+  if (i >= pattern.size()) return false;
+
+  p = i + 1;
+  matched = found != negated;
+  return true;
+}
+
+// Match a single path component against a glob pattern. `*` matches any run of characters, `?` matches any single
+// character, `[...]` matches a class of characters, and `\` escapes the character that follows it.
+static bool glob_match(const string &pattern, const char *text, size_t length)
+{
+  size_t p = 0;
+  size_t t = 0;
+
+  // Position to resume from when the most recent `*` must consume another character.
+  size_t star_p = string::npos;
+  size_t star_t = 0;
+
+  while (t < length) {
+    if (p < pattern.size()) {
+      char pc = pattern[p];
+
+      if (pc == '*') {
+        star_p = ++p;
+        star_t = t;
+        continue;
+      }
+
+      if (pc == '?') {
+        p++;
+        t++;
+        continue;
+      }
+
+      if (pc == '[') {
+        size_t next = p;
+        bool matched = false;
+        if (match_class(pattern, next, text[t], matched)) {
+          if (matched) {
+            p = next;
+            t++;
+            continue;
+          }
+        } else if (text[t] == '[') {
+          p++;
+          t++;
+          continue;
+        }
+      } else {
+        if (pc == '\\' && p + 1 < pattern.size()) pc = pattern[++p];
+
+        if (pc == text[t]) {
+          p++;
+          t++;
+          continue;
+        }
+      }
+    }
+
+    if (star_p == string::npos) return false;
+    p = star_p;
+    t = ++star_t;
+  }
+
+  while (p < pattern.size() && pattern[p] == '*') {
+    p++;
+  }
+  return p == pattern.size();
+}
+
+PathMatcher::PathMatcher(string &&root, const string &patterns) : root(move(root)), patterns(patterns)
+{
+  while (!this->root.empty() && is_separator(this->root.back())) {
+    this->root.pop_back();
+  }
+
+  size_t line_start = 0;
+  while (line_start <= patterns.size()) {
+    size_t line_end = patterns.find('\n', line_start);
+    if (line_end == string::npos) line_end = patterns.size();
+
+    add_rule(patterns.substr(line_start, line_end - line_start));
+    line_start = line_end + 1;
+  }
+}
+
+bool PathMatcher::excludes(const string &path, bool directory) const
+{
+  if (rules.empty()) return false;
+
+  string relative;
+  vector<Component> components;
+  if (!relativize(path, relative, components)) return false;
+
+  // An entry is excluded if it, or any of its parent directories, is matched by a non-negated rule that is not
+  // overridden by a later negated one.
+  for (size_t count = 1; count <= components.size(); count++) {
+    bool is_directory = count < components.size() || directory;
+    if (match_components(relative, components, count, is_directory) == MATCH_EXCLUDED) return true;
+  }
+
+  return false;
+}
+
+MatchResult PathMatcher::match(const string &path, bool directory) const
+{
+  if (rules.empty()) return MATCH_NONE;
+
+  string relative;
+  vector<Component> components;
+  if (!relativize(path, relative, components)) return MATCH_NONE;
+
+  return match_components(relative, components, components.size(), directory);
+}
+
+bool PathMatcher::relativize(const string &path, string &relative, vector<Component> &components) const
+{
+  if (path.size() <= root.size() + 1 || path.compare(0, root.size(), root) != 0) return false;
+  if (!is_separator(path[root.size()])) return false;
+
+  relative.assign(path, root.size() + 1, string::npos);
+
+  size_t start = 0;
+  for (size_t i = 0; i <= relative.size(); i++) {
+    if (i == relative.size() || is_separator(relative[i])) {
+      if (i < relative.size()) relative[i] = '/';
+      if (i > start) components.emplace_back(start, i - start);
+      start = i + 1;
+    }
+  }
+
+  return !components.empty();
+}
+
+MatchResult PathMatcher::match_components(const string &relative,
+  const vector<Component> &components,
+  size_t count,
+  bool directory) const
+{
+  const size_t none = rules.size();
+  size_t best = none;
+
+  const Component &last = components[count - 1];
+
+  if (!by_name.empty()) {
+    consider(by_name, relative.substr(last.first, last.second), directory, best);
+  }
+
+  for (size_t length : suffix_lengths) {
+    if (length > last.second) continue;
+    consider(by_suffix, relative.substr(last.first + last.second - length, length), directory, best);
+  }
+
+  if (!by_path.empty()) {
+    consider(by_path, relative.substr(0, last.first + last.second), directory, best);
+  }
+
+  const vector<size_t> *headed = nullptr;
+  if (!by_head.empty()) {
+    auto found = by_head.find(relative.substr(components[0].first, components[0].second));
+    if (found != by_head.end()) headed = &found->second;
+  }
+
+  // Only rules that appear after the best indexed match can change the outcome.
+  auto generic_index = generic.rbegin();
+  auto headed_index = headed ? headed->rbegin() : generic.rend();
+  auto headed_end = headed ? headed->rend() : generic.rend();
+  while (generic_index != generic.rend() || headed_index != headed_end) {
+    size_t index = 0;
+    if (headed_index == headed_end || (generic_index != generic.rend() && *generic_index > *headed_index)) {
+      index = *generic_index++;
+    } else {
+      index = *headed_index++;
+    }
+    if (best != none && index < best) break;
+
+    if (rule_matches(rules[index], relative, components, count, directory)) {
+      best = index;
+      break;
+    }
+  }
+
+  if (best == none) return MATCH_NONE;
+  return rules[best].negated ? MATCH_INCLUDED : MATCH_EXCLUDED;
+}
+
+void PathMatcher::consider(const Bucket &bucket, const string &key, bool directory, size_t &best) const
+{
+  auto found = bucket.find(key);
+  if (found == bucket.end()) return;
+
+  const vector<size_t> &indices = found->second;
+  for (auto index = indices.rbegin(); index != indices.rend(); ++index) {
+    if (best != rules.size() && *index < best) return;
+
+    if (!rules[*index].directory_only || directory) {
+      best = *index;
+      return;
+    }
+  }
+}
+
+void PathMatcher::add_rule(const string &line)
+{
+  string pattern(line);
+  if (!pattern.empty() && pattern.back() == '\r') pattern.pop_back();
+
+  // Trailing spaces are ignored unless they're escaped.
+  while (!pattern.empty() && pattern.back() == ' ') {
+    if (pattern.size() >= 2 && pattern[pattern.size() - 2] == '\\') break;
+    pattern.pop_back();
+  }
+
+  if (pattern.empty() || pattern[0] == '#') return;
+
+  Rule rule{vector<string>(), false, false, false, '\0', '\0'};
+
+  if (pattern[0] == '!') {
+    rule.negated = true;
+    pattern.erase(0, 1);
+  } else if (pattern[0] == '\\' && pattern.size() > 1 && (pattern[1] == '!' || pattern[1] == '#')) {
+    pattern.erase(0, 1);
+  }
+
+  if (!pattern.empty() && pattern.back() == '/') {
+    rule.directory_only = true;
+    pattern.pop_back();
+  }
+
+  if (pattern.find('/') != string::npos) {
+    rule.anchored = true;
+    if (pattern[0] == '/') pattern.erase(0, 1);
+  }
+
+  if (pattern.empty()) return;
+
+  size_t start = 0;
+  while (start <= pattern.size()) {
+    size_t end = pattern.find('/', start);
+    if (end == string::npos) end = pattern.size();
+
+    string segment(pattern, start, end - start);
+    if (!segment.empty() && !(segment == "**" && !rule.segments.empty() && rule.segments.back() == "**")) {
+      rule.segments.push_back(move(segment));
+    }
+    start = end + 1;
+  }
+
+  if (rule.segments.empty()) return;
+
+  const string &first = rule.segments.front();
+  if (first.find_first_of("*?[\\") != 0) rule.lead = first[0];
+
+  const string &last = rule.segments.back();
+  if (last.find_last_of("*?]") != last.size() - 1) rule.trail = last.back();
+
+  rules.push_back(move(rule));
+  index_rule(rules.size() - 1);
+}
+
+void PathMatcher::index_rule(size_t index)
+{
+  const Rule &rule = rules[index];
+
+  bool literal = true;
+  for (const string &segment : rule.segments) {
+    if (segment.find_first_of("*?[\\") != string::npos) literal = false;
+  }
+
+  if (literal && rule.anchored) {
+    string key;
+    for (const string &segment : rule.segments) {
+      if (!key.empty()) key += '/';
+      key += segment;
+    }
+    by_path[key].push_back(index);
+    return;
+  }
+
+  if (literal) {
+    by_name[rule.segments.front()].push_back(index);
+    return;
+  }
+
+  if (!rule.anchored) {
+    const string &segment = rule.segments.front();
+    if (segment.size() > 1 && segment[0] == '*' && segment.find_first_of("*?[\\", 1) == string::npos) {
+      string suffix(segment, 1);
+      bool seen = false;
+      for (size_t length : suffix_lengths) {
+        if (length == suffix.size()) seen = true;
+      }
+      if (!seen) suffix_lengths.push_back(suffix.size());
+
+      by_suffix[suffix].push_back(index);
+      return;
+    }
+  }
+
+  if (rule.anchored && rule.segments.size() > 1) {
+    const string &head = rule.segments.front();
+    if (head.find_first_of("*?[\\") == string::npos) {
+      by_head[head].push_back(index);
+      return;
+    }
+  }
+
+  generic.push_back(index);
+}
+
+bool PathMatcher::rule_matches(const Rule &rule,
+  const string &relative,
+  const vector<Component> &components,
+  size_t count,
+  bool directory) const
+{
+  if (rule.directory_only && !directory) return false;
+
+  if (!rule.anchored) {
+    const Component &last = components[count - 1];
+    if (rule.lead != '\0' && relative[last.first] != rule.lead) return false;
+    if (rule.trail != '\0' && relative[last.first + last.second - 1] != rule.trail) return false;
+    return glob_match(rule.segments.front(), relative.data() + last.first, last.second);
+  }
+
+  if (rule.lead != '\0' && relative[components[0].first] != rule.lead) return false;
+  if (rule.trail != '\0') {
+    const Component &last = components[count - 1];
+    if (relative[last.first + last.second - 1] != rule.trail) return false;
+  }
+  return segments_match(rule, 0, relative, components, 0, count);
+}
+
+bool PathMatcher::segments_match(const Rule &rule,
+  size_t segment,
+  const string &relative,
+  const vector<Component> &components,
+  size_t component,
+  size_t count) const
+{
+  while (segment < rule.segments.size()) {
+    const string &pattern = rule.segments[segment];
+
+    if (pattern == "**") {
+      // A trailing `**` matches everything inside of a directory, but not the directory itself.
+      if (segment + 1 == rule.segments.size()) return component < count;
+
+      for (size_t skip = component; skip <= count; skip++) {
+        if (segments_match(rule, segment + 1, relative, components, skip, count)) return true;
+      }
+      return false;
+    }
+
+    if (component >= count) return false;
+
+    const Component &current = components[component];
+    if (!glob_match(pattern, relative.data() + current.first, current.second)) return false;
+
+    segment++;
+    component++;
+  }
+
+  return component == count;
+}
@@ -0,0 +1,156 @@
+#ifndef PATH_MATCHER_H
+#define PATH_MATCHER_H
+
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Outcome of testing a single path against a set of patterns.
+enum MatchResult
+{
+  MATCH_NONE,  // No pattern matched the path.
+  MATCH_EXCLUDED,  // The last pattern to match the path excluded it.
+  MATCH_INCLUDED  // The last pattern to match the path was negated, re-including it.
+};
+
+// Decide which paths beneath a watch root should be excluded from a channel, based on a set of patterns written in
+// `.gitignore` syntax. A `PathMatcher` is compiled once on the main thread, then shared read-only by every thread that
+// crawls or reports events for its channel.
+//
+// As in git, excluding a directory excludes everything beneath it. A negated pattern may re-include an entry, but not
+// one within an excluded directory. This lets callers prune an excluded directory without visiting its contents.
+//
+// Real-world ignore files are dominated by literal names (`node_modules`), extensions (`*.log`), and literal anchored
+// paths (`/build`). Rules of those shapes are indexed by hash so that matching a path component costs a few lookups
+// no matter how many of them there are. Only patterns with other wildcards are tested one at a time.
+class PathMatcher
+{
+public:
+  // Compile newline-separated `patterns` that apply beneath the absolute path `root`. Blank lines and lines beginning
+  // with `#` are ignored.
+  PathMatcher(std::string &&root, const std::string &patterns);
+
+  PathMatcher(const PathMatcher &) = delete;
+  PathMatcher(PathMatcher &&) = delete;
+  ~PathMatcher() = default;
+  PathMatcher &operator=(const PathMatcher &) = delete;
+  PathMatcher &operator=(PathMatcher &&) = delete;
+
+  // Return `true` if the absolute `path` lies beneath the root and is excluded by these patterns, either directly or
+  // because one of its parent directories is. `directory` should be `true` if `path` is known to be a directory.
+  bool excludes(const std::string &path, bool directory) const;
+
+  // Test the absolute `path` against these patterns without considering its parent directories. Used to combine the
+  // rules of several `PathMatchers` with different roots.
+  MatchResult match(const std::string &path, bool directory) const;
+
+  // Return `true` if no patterns were compiled, so that nothing will ever be excluded.
+  bool empty() const { return rules.empty(); }
+
+  // Return the number of compiled patterns.
+  size_t size() const { return rules.size(); }
+
+  const std::string &get_root() const { return root; }
+
+  // Access the pattern source that these rules were compiled from.
+  const std::string &get_patterns() const { return patterns; }
+
+private:
+  // A single parsed line of the pattern source.
+  struct Rule
+  {
+    // Glob patterns for consecutive path components. A segment of `**` matches any number of components.
+    std::vector<std::string> segments;
+
+    // Pattern began with `!`: a match re-includes the path.
+    bool negated;
+
+    // Pattern ended with `/`: it may only match directories.
+    bool directory_only;
+
+    // Pattern contained a `/`, so it's matched against the full path relative to the root. Otherwise, it's matched
+    // against the final path component only.
+    bool anchored;
+
+    // Literal characters that the first matched component must begin with and the last must end with, or `0` where
+    // the pattern has a wildcard instead. Lets most wildcard rules be rejected without running the glob matcher.
+    char lead;
+    char trail;
+  };
+
+  // A path component identified by its offset and length within a relative path.
+  using Component = std::pair<size_t, size_t>;
+
+  // Indices into `rules`, in ascending order, that share a hashed key.
+  using Bucket = std::unordered_map<std::string, std::vector<size_t>>;
+
+  // Parse one line of pattern source into `rules`.
+  void add_rule(const std::string &line);
+
+  // Sort the most recently parsed rule into the index that will find it fastest.
+  void index_rule(size_t index);
+
+  // Split the portion of `path` beneath the root into components. Return `false` if `path` isn't beneath the root.
+  bool relativize(const std::string &path, std::string &relative, std::vector<Component> &components) const;
+
+  // Find the last rule that matches the path formed from the first `count` entries of `components`. Rules that can't be
+  // found by hash are tested in descending order from whichever of `generic` and the `by_head` bucket for the first
+  // component is later, stopping at the first match.
+  MatchResult match_components(const std::string &relative,
+    const std::vector<Component> &components,
+    size_t count,
+    bool directory) const;
+
+  // Consider the rules in `bucket` listed under `key`, raising `best` to the index of the last one that is able to
+  // match a path of this kind.
+  void consider(const Bucket &bucket, const std::string &key, bool directory, size_t &best) const;
+
+  // Determine whether or not `rule` matches the path formed from the first `count` entries of `components`.
+  bool rule_matches(const Rule &rule,
+    const std::string &relative,
+    const std::vector<Component> &components,
+    size_t count,
+    bool directory) const;
+
+  // Match `rule.segments` starting at `segment` against `components` in the range [`component`, `count`).
+  bool segments_match(const Rule &rule,
+    size_t segment,
+    const std::string &relative,
+    const std::vector<Component> &components,
+    size_t component,
+    size_t count) const;
+
+  std::string root;
+
+  std::string patterns;
+
+  std::vector<Rule> rules;
+
+  // Unanchored rules that match a literal entry name, keyed by that name.
+  Bucket by_name;
+
+  // Unanchored rules of the form `*suffix`, keyed by their suffix.
+  Bucket by_suffix;
+
+  // Distinct suffix lengths present in `by_suffix`.
+  std::vector<size_t> suffix_lengths;
+
+  // Anchored rules made entirely of literal segments, keyed by their path relative to the root.
+  Bucket by_path;
+
+  // Anchored rules whose first segment is literal but which contain wildcards elsewhere, keyed by that first segment.
+  Bucket by_head;
+
+  // Indices of every other rule, in ascending order.
+  std::vector<size_t> generic;
+
+  friend std::ostream &operator<<(std::ostream &out, const PathMatcher &matcher)
+  {
+    return out << "PathMatcher{root=" << matcher.root << " rules=" << matcher.rules.size()
+               << " generic=" << matcher.generic.size() << "}";
+  }
+};
+
+#endif
@@ -0,0 +1,145 @@
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "path_router.h"
+
+using std::make_pair;
+using std::move;
+using std::pair;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+#ifdef PLATFORM_WINDOWS
+static bool is_separator(char c)
+{
+  return c == '/' || c == '\\';
+}
+#else
+static bool is_separator(char c)
+{
+  return c == '/';
+}
+#endif
+
+void PathRouter::add(RouteID route_id, const string &path, bool recursive)
+{
+  remove(route_id);
+
+  Node *node = &root;
+  size_t offset = 0;
+  size_t length = 0;
+  while (next_component(path, offset + length, offset, length)) {
+    size_t position = find_child(node->children, path, offset, length);
+    if (position == node->children.size()) {
+      position = position_of(node->children, path, offset, length);
+      unique_ptr<Node> child(new Node());
+      node->children.emplace(node->children.begin() + position, path.substr(offset, length), move(child));
+    }
+    node = node->children[position].second.get();
+  }
+
+  if (recursive) {
+    node->recursive.push_back(route_id);
+  } else {
+    node->shallow.push_back(route_id);
+  }
+  locations.emplace(route_id, make_pair(path, recursive));
+}
+
+bool PathRouter::remove(RouteID route_id)
+{
+  auto location = locations.find(route_id);
+  if (location == locations.end()) return false;
+
+  remove_from(root, location->second.first, 0, route_id);
+  locations.erase(location);
+  return true;
+}
+
+void PathRouter::match(const string &path, vector<RouteID> &out) const
+{
+  size_t offset = 0;
+  size_t length = 0;
+  bool remaining = next_component(path, 0, offset, length);
+
+  const Node *node = &root;
+  while (node != nullptr) {
+    out.insert(out.end(), node->recursive.begin(), node->recursive.end());
+
+    size_t next_offset = 0;
+    size_t next_length = 0;
+    bool following = remaining && next_component(path, offset + length, next_offset, next_length);
+
+    // Shallow routes accept events on their own path and on their immediate children.
+    if (!following) {
+      out.insert(out.end(), node->shallow.begin(), node->shallow.end());
+    }
+
+    if (!remaining) break;
+
+    size_t position = find_child(node->children, path, offset, length);
+    node = position == node->children.size() ? nullptr : node->children[position].second.get();
+    offset = next_offset;
+    length = next_length;
+    remaining = following;
+  }
+}
+
+bool PathRouter::next_component(const string &path, size_t start, size_t &offset, size_t &length)
+{
+  while (start < path.size() && is_separator(path[start])) {
+    start++;
+  }
+  if (start >= path.size()) return false;
+
+  size_t end = start;
+  while (end < path.size() && !is_separator(path[end])) {
+    end++;
+  }
+
+  offset = start;
+  length = end - start;
+  return true;
+}
+
+size_t PathRouter::position_of(const Children &children, const string &path, size_t offset, size_t length)
+{
+  auto position = std::lower_bound(children.begin(),
+    children.end(),
+    make_pair(offset, length),
+    [&path](const Children::value_type &child, const pair<size_t, size_t> &component) {
+      return child.first.compare(0, string::npos, path, component.first, component.second) < 0;
+    });
+  return static_cast<size_t>(position - children.begin());
+}
+
+size_t PathRouter::find_child(const Children &children, const string &path, size_t offset, size_t length)
+{
+  size_t position = position_of(children, path, offset, length);
+  if (position == children.size()) return position;
+
+  return children[position].first.compare(0, string::npos, path, offset, length) == 0 ? position : children.size();
+}
+
+bool PathRouter::remove_from(Node &node, const string &path, size_t start, RouteID route_id)
+{
+  size_t offset = 0;
+  size_t length = 0;
+  if (!next_component(path, start, offset, length)) {
+    node.recursive.erase(std::remove(node.recursive.begin(), node.recursive.end(), route_id), node.recursive.end());
+    node.shallow.erase(std::remove(node.shallow.begin(), node.shallow.end(), route_id), node.shallow.end());
+  } else {
+    size_t position = find_child(node.children, path, offset, length);
+    if (position == node.children.size()) return false;
+
+    if (remove_from(*node.children[position].second, path, offset + length, route_id)) {
+      node.children.erase(node.children.begin() + position);
+    }
+  }
+
+  return node.children.empty() && node.recursive.empty() && node.shallow.empty();
+}
@@ -0,0 +1,90 @@
+#ifndef PATH_ROUTER_H
+#define PATH_ROUTER_H
+
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using RouteID = uint_fast32_t;
+
+const RouteID NULL_ROUTE_ID = 0;
+
+// Deliver the filesystem events of a single channel to the subscribers, or "routes", whose paths contain them.
+//
+// Route paths are stored in a trie keyed by path component, so finding every route that should receive an event costs
+// one binary search per component of the event's path, regardless of how many routes share the channel. Components
+// are compared in place within the event's path, so matching allocates nothing.
+class PathRouter
+{
+public:
+  PathRouter() = default;
+  ~PathRouter() = default;
+
+  // Begin routing events at `path` to `route_id`. If `recursive` is true, events anywhere beneath `path` are routed as
+  // well; otherwise, only events on `path` itself and its immediate children are.
+  void add(RouteID route_id, const std::string &path, bool recursive);
+
+  // Stop routing events to `route_id`. Return `false` if it wasn't known.
+  bool remove(RouteID route_id);
+
+  // Append the ID of every route that should receive an event on `path` to `out`.
+  void match(const std::string &path, std::vector<RouteID> &out) const;
+
+  bool empty() const { return locations.empty(); }
+
+  size_t size() const { return locations.size(); }
+
+  PathRouter(const PathRouter &) = delete;
+  PathRouter(PathRouter &&) = delete;
+  PathRouter &operator=(const PathRouter &) = delete;
+  PathRouter &operator=(PathRouter &&) = delete;
+
+private:
+  struct Node;
+
+  // Sorted by component, so that a child can be found by comparing keys against a slice of a path.
+  using Children = std::vector<std::pair<std::string, std::unique_ptr<Node>>>;
+
+  struct Node
+  {
+    Children children;
+
+    // Routes that receive events anywhere beneath this node.
+    std::vector<RouteID> recursive;
+
+    // Routes that receive events on this node and its immediate children.
+    std::vector<RouteID> shallow;
+  };
+
+  // Find the first non-empty component of `path` at or after `start`, storing its position in `offset` and `length`.
+  // Return `false` if there are none left.
+  static bool next_component(const std::string &path, size_t start, size_t &offset, size_t &length);
+
+  // Return the index within `children` of the child keyed by the component of `path` at `offset`, or the index at
+  // which it belongs if there's none.
+  static size_t position_of(const Children &children, const std::string &path, size_t offset, size_t length);
+
+  // Return the index within `children` of the child keyed by the component of `path` at `offset`, or
+  // `children.size()` if there's none.
+  static size_t find_child(const Children &children, const std::string &path, size_t offset, size_t length);
+
+  // Remove `route_id` from the node beneath `node` at the components of `path` from `start` on, discarding any nodes
+  // left empty. Return `true` if `node` itself is now empty.
+  static bool remove_from(Node &node, const std::string &path, size_t start, RouteID route_id);
+
+  Node root;
+
+  // The path and recursion flag of each route, used to find its node again when it's removed.
+  std::unordered_map<RouteID, std::pair<std::string, bool>> locations;
+
+  friend std::ostream &operator<<(std::ostream &out, const PathRouter &router)
+  {
+    return out << "PathRouter{routes=" << router.locations.size() << "}";
+  }
+};
+
+#endif
@@ -0,0 +1,103 @@
+#include <cstdint>
+#include <string>
+#include <uv.h>
+
+#ifndef PLATFORM_WINDOWS
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "../helper/common.h"
+#include "../helper/libuv.h"
+#include "directory_handle.h"
+#include "entry_table.h"
+
+using std::string;
+
+#ifndef PLATFORM_WINDOWS
+static int64_t to_nanoseconds(const struct timespec &ts)
+{
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000 + static_cast<int64_t>(ts.tv_nsec);
+}
+
+static void fingerprint_from(const struct stat &st, StatFingerprint &fingerprint)
+{
+  fingerprint.ino = static_cast<uint64_t>(st.st_ino);
+  fingerprint.size = static_cast<uint64_t>(st.st_size);
+#ifdef PLATFORM_MACOS
+  fingerprint.mtime = to_nanoseconds(st.st_mtimespec);
+  fingerprint.ctime = to_nanoseconds(st.st_ctimespec);
+#else
+  fingerprint.mtime = to_nanoseconds(st.st_mtim);
+  fingerprint.ctime = to_nanoseconds(st.st_ctim);
+#endif
+  fingerprint.mode = static_cast<uint32_t>(st.st_mode);
+}
+#endif
+
+int DirectoryHandle::open(const string &path, bool follow_symlink)
+{
+  close();
+  this->path = path;
+
+#ifdef PLATFORM_WINDOWS
+  (void) follow_symlink;
+  return 0;
+#else
+  int flags = O_RDONLY | O_DIRECTORY | O_CLOEXEC;
+  if (!follow_symlink) flags |= O_NOFOLLOW;
+
+  do {
+    fd = ::open(path.c_str(), flags);
+  } while (fd == -1 && errno == EINTR);
+
+  return fd == -1 ? uv_translate_sys_error(errno) : 0;
+#endif
+}
+
+void DirectoryHandle::close()
+{
+#ifndef PLATFORM_WINDOWS
+  if (fd != -1) ::close(fd);
+#endif
+  fd = -1;
+}
+
+int DirectoryHandle::lstat(const string &entry_name, StatFingerprint &fingerprint) const
+{
+#ifndef PLATFORM_WINDOWS
+  if (fd != -1) {
+    struct stat st;
+    if (fstatat(fd, entry_name.c_str(), &st, AT_SYMLINK_NOFOLLOW) != 0) return uv_translate_sys_error(errno);
+
+    fingerprint_from(st, fingerprint);
+    return 0;
+  }
+#endif
+
+  FSReq lstat_req;
+  string entry_path(path_join(path, entry_name));
+  int err = uv_fs_lstat(nullptr, &lstat_req.req, entry_path.c_str(), nullptr);
+  if (err == 0) fingerprint = StatFingerprint(lstat_req.req.statbuf);
+  return err;
+}
+
+int DirectoryHandle::stat(StatFingerprint &fingerprint) const
+{
+#ifndef PLATFORM_WINDOWS
+  if (fd != -1) {
+    struct stat st;
+    if (fstat(fd, &st) != 0) return uv_translate_sys_error(errno);
+
+    fingerprint_from(st, fingerprint);
+    return 0;
+  }
+#endif
+
+  FSReq lstat_req;
+  int err = uv_fs_lstat(nullptr, &lstat_req.req, path.c_str(), nullptr);
+  if (err == 0) fingerprint = StatFingerprint(lstat_req.req.statbuf);
+  return err;
+}
@@ -0,0 +1,55 @@
+#ifndef DIRECTORY_HANDLE_H
+#define DIRECTORY_HANDLE_H
+
+#include <iostream>
+#include <string>
+
+#include "entry_table.h"
+
+// An open handle to the directory whose entries a `PollingIterator` is currently visiting.
+//
+// Each entry is stated relative to the handle with `fstatat()`, so the kernel resolves only the entry's own name rather
+// than every component of its full path, and no full path needs to be assembled for entries that haven't changed.
+// Where `fstatat()` isn't available, or the directory couldn't be opened, entries are stated by full path instead.
+class DirectoryHandle
+{
+public:
+  DirectoryHandle() = default;
+
+  ~DirectoryHandle() { close(); }
+
+  // Open the directory at `path`, closing any directory that was open before. Unless `follow_symlink` is true, a
+  // symlink at `path` fails to open rather than opening the directory it leads to. Return 0 on success or a libuv
+  // error code. A handle that failed to open may still be used to `lstat()` entries by their full paths.
+  int open(const std::string &path, bool follow_symlink);
+
+  // Release the directory. Safe to call on a handle that isn't open.
+  void close();
+
+  // Perform an `lstat()` on the entry called `entry_name` within the open directory, storing the result in
+  // `fingerprint`. Return 0 on success or a libuv error code.
+  int lstat(const std::string &entry_name, StatFingerprint &fingerprint) const;
+
+  // Store the fingerprint of the open directory itself in `fingerprint`, with `fstat()` on its descriptor. If it isn't
+  // open, `lstat()` its full path instead. Return 0 on success or a libuv error code.
+  int stat(StatFingerprint &fingerprint) const;
+
+  DirectoryHandle(const DirectoryHandle &) = delete;
+  DirectoryHandle(DirectoryHandle &&) = delete;
+  DirectoryHandle &operator=(const DirectoryHandle &) = delete;
+  DirectoryHandle &operator=(DirectoryHandle &&) = delete;
+
+private:
+  // Full path of the directory, used to construct entry paths when no descriptor is available.
+  std::string path;
+
+  // Open directory file descriptor, or -1. Unused on Windows.
+  int fd{-1};
+
+  friend std::ostream &operator<<(std::ostream &out, const DirectoryHandle &handle)
+  {
+    return out << "DirectoryHandle{" << handle.path << " fd=" << handle.fd << "}";
+  }
+};
+
+#endif
@@ -1,11 +1,13 @@
+#include <chrono>
+#include <cstdint>
 #include <iostream>
 #include <map>
 #include <memory>
-#include <set>
 #include <sstream>
 #include <string>
 #include <utility>
 #include <uv.h>
+#include <vector>
 
 #include "../helper/common.h"
 #include "../helper/libuv.h"
@@ -16,12 +18,33 @@
 
 using std::move;
 using std::ostringstream;
-using std::set;
 using std::shared_ptr;
 using std::string;
+using std::vector;
+using std::chrono::duration_cast;
+using std::chrono::nanoseconds;
+using std::chrono::system_clock;
+
+// Directory timestamps may be as coarse as two seconds. A listing taken within this long of the directory's last change
+// may have been followed by another change that left its timestamps untouched, so structure-only polling mustn't rely
+// on them to skip the next listing.
+static const int64_t RACY_STAT_WINDOW_NS = 2000000000;
+
+static bool is_racy(const StatFingerprint &stat)
+{
+  int64_t now = duration_cast<nanoseconds>(system_clock::now().time_since_epoch()).count();
+  int64_t changed = stat.mtime > stat.ctime ? stat.mtime : stat.ctime;
+  return now - changed < RACY_STAT_WINDOW_NS;
+}
 
 DirectoryRecord::DirectoryRecord(string &&prefix) :
-  parent{nullptr}, name{move(prefix)}, populated{false}, was_present{false}
+  parent{nullptr},
+  name{move(prefix)},
+  populated{false},
+  restored{false},
+  was_present{false},
+  restorable{true},
+  polling_tier{0}
 {
   //
 }
@@ -34,10 +57,28 @@ string DirectoryRecord::path() const
 void DirectoryRecord::scan(BoundPollingIterator *it)
 {
   FSReq scan_req;
-  set<Entry> scanned_entries;
 
-  string dir = path();
-  int scan_err = uv_fs_scandir(nullptr, &scan_req.req, dir.c_str(), 0, nullptr);
+  const string &dir = it->get_current_path();
+  bool structure_only = it->is_structure_only();
+
+  // A directory's modification and change times move whenever an entry is added, removed, or renamed within it, so
+  // while they're unchanged its listing can't have changed either. The directory is stated through the iterator's open
+  // handle, which never follows a symlink that has replaced a subdirectory, so no path is resolved a second time.
+  StatFingerprint dir_stat;
+  bool dir_stated = structure_only && it->stat_current(dir_stat) == 0;
+  if (dir_stated && populated && was_present) {
+    if (dir_stat.ino == listed_stat.ino && !dir_stat.is_modified_from(listed_stat)) {
+      revisit_subdirectories(it);
+      return;
+    }
+  }
+  listed_stat = StatFingerprint();
+
+  // A subdirectory that's been replaced by a symlink is gone, even though the directory it leads to could be listed.
+  int scan_err = UV_ENOTDIR;
+  if (!dir_stated || dir_stat.is_directory()) {
+    scan_err = uv_fs_scandir(nullptr, &scan_req.req, dir.c_str(), 0, nullptr);
+  }
   if (scan_err < 0) {
     if (scan_err == UV_ENOENT || scan_err == UV_ENOTDIR || scan_err == UV_EACCES) {
       if (was_present) {
@@ -53,6 +94,16 @@ void DirectoryRecord::scan(BoundPollingIterator *it)
     return;
   }
 
+  // Entries restored from a snapshot are compared against this scan as if they'd been found by an earlier one, so
+  // that changes made while the root wasn't being polled are reported.
+  if (restorable && !populated) {
+    restorable = false;
+    if (it->restore_entries(entries)) {
+      restored = true;
+      was_present = true;
+    }
+  }
+
   if (!was_present) {
     entry_created(it, dir, KIND_DIRECTORY);
     was_present = true;
@@ -66,9 +117,14 @@ void DirectoryRecord::scan(BoundPollingIterator *it)
     EntryKind entry_kind = KIND_UNKNOWN;
     if (dirent.type == UV_DIRENT_FILE) entry_kind = KIND_FILE;
     if (dirent.type == UV_DIRENT_DIR) entry_kind = KIND_DIRECTORY;
+    if (dirent.type == UV_DIRENT_LINK) entry_kind = KIND_SYMLINK;
 
-    it->push_entry(string(entry_name), entry_kind);
-    if (populated) scanned_entries.emplace(move(entry_name), entry_kind);
+    if (it->has_exclusions() && it->is_excluded(entry_name, entry_kind)) {
+      next_err = uv_fs_scandir_next(&scan_req.req, &dirent);
+      continue;
+    }
+
+    it->push_entry(move(entry_name), entry_kind);
 
     next_err = uv_fs_scandir_next(&scan_req.req, &dirent);
   }
@@ -80,95 +136,139 @@ void DirectoryRecord::scan(BoundPollingIterator *it)
     it->get_buffer().error(msg.str(), false);
   } else {
     // Report entries that were present the last time we scanned this directory, but aren't included in this
-    // scan.
-    auto previous = entries.begin();
-    while (previous != entries.end()) {
-      const string &previous_entry_name = previous->first;
-      const string previous_entry_path(path_join(dir, previous_entry_name));
-      EntryKind previous_entry_kind = kind_from_stat(previous->second);
-      Entry previous_entry(previous_entry_name, previous_entry_kind);
-      Entry unknown_entry(previous_entry_name, KIND_UNKNOWN);
-
-      if (scanned_entries.count(previous_entry) == 0 && scanned_entries.count(unknown_entry) == 0) {
-        entry_deleted(it, previous_entry_path, previous_entry_kind);
-        auto former = previous;
-        ++previous;
-
-        subdirectories.erase(previous_entry_name);
-        entries.erase(former);
-      } else {
-        ++previous;
+    // scan. Both sequences are sorted by name, so a single linear pass over each finds them.
+    vector<Entry> &scanned_entries = it->sorted_entries();
+    auto scanned = scanned_entries.begin();
+
+    // In structure-only mode, note the scanned entries that are already known so that they aren't stated again.
+    vector<bool> known(structure_only ? scanned_entries.size() : 0, false);
+
+    entries.erase_if([&](const string &previous_entry_name, const StatFingerprint &previous_fingerprint) {
+      EntryKind previous_entry_kind = previous_fingerprint.kind();
+
+      while (scanned != scanned_entries.end() && scanned->first < previous_entry_name) {
+        ++scanned;
+      }
+      if (scanned != scanned_entries.end() && scanned->first == previous_entry_name) {
+        // An entry whose kind has changed is reported as deleted here and created again by `entry()`.
+        if (scanned->second == previous_entry_kind || scanned->second == KIND_UNKNOWN) {
+          // `.gitignore` files are always stated, because their contents determine which entries are visited.
+          if (structure_only && !(it->has_gitignore() && previous_entry_name == ".gitignore")) {
+            known[scanned - scanned_entries.begin()] = true;
+          }
+          return false;
+        }
+      }
+
+      // Entries that have become excluded since the last scan are forgotten quietly.
+      if (!it->has_exclusions() || !it->is_excluded(previous_entry_name, previous_entry_kind)) {
+        entry_deleted(it, path_join(dir, previous_entry_name), previous_fingerprint);
+      }
+
+      subdirectories.erase(previous_entry_name);
+      return true;
+    });
+
+    if (structure_only) {
+      size_t kept = 0;
+      for (size_t i = 0; i < scanned_entries.size(); i++) {
+        if (!known[i]) {
+          if (kept != i) scanned_entries[kept] = move(scanned_entries[i]);
+          kept++;
+          continue;
+        }
+
+        auto subdir = subdirectories.find(scanned_entries[i].first);
+        if (subdir != subdirectories.end()) it->push_directory(subdir->second, it->entry_path(subdir->first));
       }
+      scanned_entries.erase(scanned_entries.begin() + kept, scanned_entries.end());
+
+      if (!is_racy(dir_stat)) listed_stat = dir_stat;
     }
   }
 }
 
-void DirectoryRecord::entry(BoundPollingIterator *it,
-  const string &entry_name,
-  const string &entry_path,
-  EntryKind scan_kind)
+void DirectoryRecord::revisit_subdirectories(BoundPollingIterator *it)
+{
+  for (auto &pair : subdirectories) {
+    it->push_directory(pair.second, it->entry_path(pair.first));
+  }
+}
+
+void DirectoryRecord::entry(BoundPollingIterator *it, const string &entry_name, EntryKind scan_kind)
 {
-  FSReq lstat_req;
   EntryKind previous_kind = scan_kind;
   EntryKind current_kind = scan_kind;
+  StatFingerprint current_fingerprint;
 
-  int lstat_err = uv_fs_lstat(nullptr, &lstat_req.req, entry_path.c_str(), nullptr);
+  int lstat_err = it->lstat_entry(entry_name, current_fingerprint);
   if (lstat_err != 0 && lstat_err != UV_ENOENT && lstat_err != UV_EACCES) {
     ostringstream msg;
-    msg << "Unable to stat " << entry_path << ": " << uv_strerror(lstat_err);
+    msg << "Unable to stat " << it->entry_path(entry_name) << ": " << uv_strerror(lstat_err);
     it->get_buffer().error(msg.str(), false);
   }
 
-  auto previous = entries.find(entry_name);
+  const StatFingerprint *previous = entries.find(entry_name);
+  StatFingerprint previous_fingerprint;
 
-  bool existed_before = previous != entries.end();
+  bool existed_before = previous != nullptr;
   bool exists_now = lstat_err == 0;
+  bool replaced = false;
 
-  if (existed_before) previous_kind = kind_from_stat(previous->second);
-  if (exists_now) current_kind = kind_from_stat(lstat_req.req.statbuf);
+  if (existed_before) {
+    previous_fingerprint = *previous;
+    previous_kind = previous_fingerprint.kind();
+  }
+  if (exists_now) {
+    current_kind = current_fingerprint.kind();
+  }
 
   if (existed_before && exists_now) {
     // Modification or no change
-    uv_stat_t &previous_stat = previous->second;
-    uv_stat_t &current_stat = lstat_req.req.statbuf;
-
-    // TODO consider modifications to mode or ownership bits?
-    if (kinds_are_different(previous_kind, current_kind) || previous_stat.st_ino != current_stat.st_ino) {
-      entry_deleted(it, entry_path, previous_kind);
-      entry_created(it, entry_path, current_kind);
-    } else if (previous_stat.st_mode != current_stat.st_mode || previous_stat.st_size != current_stat.st_size
-      || ts_not_equal(previous_stat.st_mtim, current_stat.st_mtim)
-      || ts_not_equal(previous_stat.st_ctim, current_stat.st_ctim)) {
-      entry_modified(it, entry_path, current_kind);
+
+    replaced = kinds_are_different(previous_kind, current_kind) || previous_fingerprint.ino != current_fingerprint.ino;
+    if (replaced) {
+      const string entry_path(it->entry_path(entry_name));
+      entry_deleted(it, entry_path, previous_fingerprint);
+      entry_created(it, entry_path, current_fingerprint);
+    } else if (current_fingerprint.is_content_modified_from(previous_fingerprint)) {
+      entry_modified(it, it->entry_path(entry_name), current_kind, EVENT_MODIFIED | EVENT_SETTLED);
+    } else if (current_fingerprint.is_attribute_modified_from(previous_fingerprint)) {
+      entry_modified(it, it->entry_path(entry_name), current_kind, EVENT_ATTRIBUTES);
     }
 
   } else if (existed_before && !exists_now) {
     // Deletion
 
-    entry_deleted(it, entry_path, previous_kind);
+    entry_deleted(it, it->entry_path(entry_name), previous_fingerprint);
 
   } else if (!existed_before && exists_now) {
     // Creation
 
+    const string entry_path(it->entry_path(entry_name));
     if (kinds_are_different(scan_kind, current_kind)) {
       // Entry was created as a file, deleted, then recreated as a directory between scan() and entry()
       // (or vice versa)
       entry_created(it, entry_path, scan_kind);
       entry_deleted(it, entry_path, scan_kind);
     }
-    entry_created(it, entry_path, current_kind);
+    entry_created(it, entry_path, current_fingerprint);
 
   } else if (!existed_before && !exists_now) {
     // Entry was deleted between scan() and entry().
     // Emit a deletion and creation event pair. Note that the kinds will likely both be KIND_UNKNOWN.
 
+    const string entry_path(it->entry_path(entry_name));
     entry_created(it, entry_path, previous_kind);
     entry_deleted(it, entry_path, current_kind);
   }
 
   // Update entries with the latest stat information
-  if (existed_before) entries.erase(previous);
-  if (exists_now) entries.emplace(entry_name, lstat_req.req.statbuf);
+  if (exists_now) {
+    entries.put(entry_name, current_fingerprint);
+  } else if (existed_before) {
+    entries.erase(entry_name);
+  }
 
   // Update subdirectories if this is or was a subdirectory
   auto dir = subdirectories.find(entry_name);
@@ -178,65 +278,113 @@ void DirectoryRecord::entry(BoundPollingIterator *it,
   if (current_kind == KIND_DIRECTORY && it->is_recursive()) {
     if (dir == subdirectories.end()) {
       shared_ptr<DirectoryRecord> subdir(new DirectoryRecord(this, string(entry_name)));
+      subdir->restorable = has_baseline() && existed_before && !replaced;
       subdirectories.emplace(entry_name, subdir);
-      it->push_directory(subdir);
+      it->push_directory(subdir, it->entry_path(entry_name));
     } else {
-      it->push_directory(dir->second);
+      it->push_directory(dir->second, it->entry_path(entry_name));
     }
   }
 }
 
-bool DirectoryRecord::all_populated() const
+size_t DirectoryRecord::count_entries() const
 {
-  if (!populated) return false;
-
+  // Start with 1 to count the readdir() on this directory.
+  size_t count = 1;
+  entries.for_each([&count](const StatFingerprint &fingerprint) {
+    if (!fingerprint.is_directory()) count++;
+  });
   for (auto &pair : subdirectories) {
-    if (!pair.second->all_populated()) {
-      return false;
-    }
+    count += pair.second->count_entries();
   }
-
-  return true;
+  return count;
 }
 
-size_t DirectoryRecord::count_entries() const
+void DirectoryRecord::write_snapshot(PollingSnapshot::Builder &builder, const string &directory_path) const
 {
-  // Start with 1 to count the readdir() on this directory.
-  size_t count = 1;
-  for (auto &pair : entries) {
-    if ((pair.second.st_mode & S_IFDIR) != S_IFDIR) {
-      count++;
-    }
+  if (!populated) return;
+
+  builder.add_directory(directory_path, entries);
+  for (auto &pair : subdirectories) {
+    pair.second->write_snapshot(builder, path_join(directory_path, pair.first));
   }
+}
+
+size_t DirectoryRecord::memory_usage() const
+{
+  size_t total = sizeof(DirectoryRecord) + name.capacity() + entries.memory_usage();
   for (auto &pair : subdirectories) {
-    count += pair.second->count_entries();
+    // Approximate the map node and the shared_ptr control block along with the subdirectory itself.
+    total += sizeof(pair) + pair.first.capacity() + 4 * sizeof(void *) + pair.second->memory_usage();
   }
-  return count;
+  return total;
 }
 
 DirectoryRecord::DirectoryRecord(DirectoryRecord *parent, string &&name) :
-  parent{parent}, name(move(name)), populated{false}, was_present{false}
+  parent{parent},
+  name(move(name)),
+  populated{false},
+  restored{false},
+  was_present{false},
+  restorable{false},
+  polling_tier{0}
 {
   //
 }
 
 void DirectoryRecord::entry_deleted(BoundPollingIterator *it, const string &entry_path, EntryKind kind)
 {
-  if (!populated) return;
+  it->entry_changed(entry_path);
+  if (!has_baseline() || !it->accepts(EVENT_DELETED)) return;
 
   it->get_buffer().deleted(string(entry_path), kind);
 }
 
 void DirectoryRecord::entry_created(BoundPollingIterator *it, const string &entry_path, EntryKind kind)
 {
-  if (!populated) return;
+  it->entry_changed(entry_path);
+  if (!has_baseline() || !it->accepts(EVENT_CREATED)) return;
 
   it->get_buffer().created(string(entry_path), kind);
 }
 
-void DirectoryRecord::entry_modified(BoundPollingIterator *it, const string &entry_path, EntryKind kind)
+void DirectoryRecord::entry_deleted(BoundPollingIterator *it,
+  const string &entry_path,
+  const StatFingerprint &fingerprint)
 {
-  if (!populated) return;
+  if (!it->accepts(EVENT_RENAMED)) {
+    entry_deleted(it, entry_path, fingerprint.kind());
+    return;
+  }
+
+  it->entry_changed(entry_path);
+  if (!has_baseline()) return;
+
+  it->get_renames().deleted(it->get_buffer(), string(entry_path), fingerprint);
+}
+
+void DirectoryRecord::entry_created(BoundPollingIterator *it,
+  const string &entry_path,
+  const StatFingerprint &fingerprint)
+{
+  if (!it->accepts(EVENT_RENAMED)) {
+    entry_created(it, entry_path, fingerprint.kind());
+    return;
+  }
+
+  it->entry_changed(entry_path);
+  if (!has_baseline()) return;
+
+  it->get_renames().created(it->get_buffer(), string(entry_path), fingerprint);
+}
+
+void DirectoryRecord::entry_modified(BoundPollingIterator *it,
+  const string &entry_path,
+  EntryKind kind,
+  EventMask event_classes)
+{
+  it->entry_changed(entry_path);
+  if (!has_baseline() || !it->accepts(event_classes)) return;
 
   it->get_buffer().modified(string(entry_path), kind);
 }
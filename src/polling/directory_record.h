@@ -8,6 +8,8 @@
 #include <uv.h>
 
 #include "../message.h"
+#include "entry_table.h"
+#include "polling_snapshot.h"
 
 class BoundPollingIterator;
 
@@ -20,7 +22,7 @@ public:
   // tree.
   //
   // The record begins in an unpopulated state, which means that the first scan will discover existing entries, but
-  // not emit any events.
+  // not emit any events, unless the iterator's snapshot records the directory.
   DirectoryRecord(std::string &&prefix);
 
   DirectoryRecord(const DirectoryRecord &) = delete;
@@ -34,37 +36,71 @@ public:
   // This is reasonably expensive on deep filesystems, so you should probably cache it somewhere.
   std::string path() const;
 
-  // Perform a `scandir()` on this directories. If populated, emit deletion events for any entries that were found here
-  // before but are now missing. Store the discovered entries within `it` as part of the iteration state.
+  // Perform a `scandir()` on this directory, which must be the current directory of `it`. If populated, emit deletion
+  // events for any entries that were found here before but are now missing. Store the discovered entries within `it`
+  // as part of the iteration state.
+  //
+  // If `it` is only interested in the structure of the tree, a populated directory is only listed again if its own
+  // `stat()` result has changed since the last listing, and only entries that weren't known before are stored within
+  // `it` to be stated. Known subdirectories are queued for traversal directly.
   void scan(BoundPollingIterator *it);
 
-  // Perform a single `lstat()` on an entry within this directory. If the DirectoryRecord is populated and the entry
-  // has been created, deleted, or modified since the previous `DirectoryRecord::entry()` call, emit the appropriate
-  // events into the `it`'s buffer.
-  void entry(BoundPollingIterator *it,
-    const std::string &entry_name,
-    const std::string &entry_path,
-    EntryKind scan_kind);
+  // Perform a single `lstat()` on an entry within this directory, relative to the directory handle held open by `it`.
+  // If the DirectoryRecord is populated and the entry has been created, deleted, or modified since the previous
+  // `DirectoryRecord::entry()` call, emit the appropriate events into the `it`'s buffer. The entry's full path is
+  // only constructed when there's something to report.
+  void entry(BoundPollingIterator *it, const std::string &entry_name, EntryKind scan_kind);
 
   // Note that this `DirectoryResult` has had an initial `scan()` and set of `entry()` calls completed. Subsequent
   // calls should emit actual events.
   void mark_populated() { populated = true; }
 
-  // Return true if all `DirectoryResults` beneath this one have been populated by an initial scan.
-  bool all_populated() const;
+  // Return true once an initial `scan()` and set of `entry()` calls have been completed.
+  bool is_populated() const { return populated; }
+
+  // Return true if changes to this directory's entries should be reported: either it's been populated, or its initial
+  // scan restored its entries from the iterator's snapshot and is comparing against them.
+  bool has_baseline() const { return populated || restored; }
+
+  // Access the polling tier assigned to this directory by its `PollingIterator`. Tier zero holds directories that are
+  // visited only by complete scans. Directories in higher tiers have changed more recently and are revisited between
+  // complete scans.
+  unsigned get_polling_tier() const { return polling_tier; }
+
+  void set_polling_tier(unsigned tier) { polling_tier = tier; }
 
   // Recursively count the number of stat entries tracked beneath this directory, including this directory itself, as
   // of the last scan.
   size_t count_entries() const;
 
+  // Recursively add this directory and every populated directory beneath it to `builder`. `directory_path` is the
+  // full path of this directory.
+  void write_snapshot(PollingSnapshot::Builder &builder, const std::string &directory_path) const;
+
+  // Recursively estimate the heap memory used to remember this directory and everything beneath it, in bytes.
+  size_t memory_usage() const;
+
 private:
   // Construct a `DirectoryRecord` for a child entry.
   DirectoryRecord(DirectoryRecord *parent, std::string &&name);
 
+  // Queue every known subdirectory within `it` for traversal without listing this directory again.
+  void revisit_subdirectories(BoundPollingIterator *it);
+
   // Use an iterator to emit deletion, creation, or modification events.
   void entry_deleted(BoundPollingIterator *it, const std::string &entry_path, EntryKind kind);
   void entry_created(BoundPollingIterator *it, const std::string &entry_path, EntryKind kind);
-  void entry_modified(BoundPollingIterator *it, const std::string &entry_path, EntryKind kind);
+
+  // Report a change to an entry's contents or attributes, if the channel accepts any of `event_classes`.
+  void entry_modified(BoundPollingIterator *it,
+    const std::string &entry_path,
+    EntryKind kind,
+    EventMask event_classes);
+
+  // Report the deletion or creation of an entry whose stat fingerprint is known. If the channel is interested in
+  // renames, the event is passed through the iterator's `InodeJar` to be correlated with the other half of a rename.
+  void entry_deleted(BoundPollingIterator *it, const std::string &entry_path, const StatFingerprint &fingerprint);
+  void entry_created(BoundPollingIterator *it, const std::string &entry_path, const StatFingerprint &fingerprint);
 
   // The parent directory. May be `null` at the root `DirectoryRecord` of a subtree.
   DirectoryRecord *parent;
@@ -76,24 +112,43 @@ private:
   // Recursive subdirectory records.
   std::map<std::string, std::shared_ptr<DirectoryRecord>> subdirectories;
 
-  // Recorded stat results from previous scans. Includes stat results for *all* entries within the directory that are
-  // not `.` or `..`.
-  std::map<std::string, uv_stat_t> entries;
+  // Fingerprints of the stat results from previous scans. Includes *all* entries within the directory that are not `.`
+  // or `..`.
+  EntryTable entries;
 
   // If true, a complete pass has already filled `entries` and `subdirectories` with initial stat results to compare
   // against. Otherwise, we have nothing to compare against, so we shouldn't emit anything.
   bool populated;
 
+  // If true, the initial scan restored `entries` from the iterator's snapshot, so its `entry()` calls report changes
+  // even though the directory isn't populated until they've all been made.
+  bool restored;
+
   // If true, this directory was present and scannable the last time it was encountered in the polling cycle. Used to
   // prevent duplicate deletion events for missing directories.
   bool was_present;
 
+  // If true, this directory was already known when it was discovered, so its initial scan may restore its entries
+  // from the iterator's snapshot. Set for the root and for subdirectories that are found within a restored directory
+  // where the snapshot recorded them.
+  bool restorable;
+
+  // Polling tier, maintained by the `PollingIterator`.
+  unsigned polling_tier;
+
+  // The `stat()` result of this directory itself, taken just before its entries were last listed completely. Used to
+  // skip listing it again in structure-only mode. Left empty when the listing failed, or when the directory changed so
+  // recently that a later change could leave its timestamps the same.
+  StatFingerprint listed_stat;
+
   // For great logging.
   friend std::ostream &operator<<(std::ostream &out, const DirectoryRecord &record)
   {
     out << "DirectoryRecord{" << record.name << " entries=" << record.entries.size()
         << " subdirectories=" << record.subdirectories.size();
     if (record.populated) out << " populated";
+    if (record.restored && !record.populated) out << " restored";
+    if (record.polling_tier > 0) out << " tier=" << record.polling_tier;
     return out << "}";
   }
 };
@@ -0,0 +1,122 @@
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <uv.h>
+#include <vector>
+
+#include "../message.h"
+#include "entry_table.h"
+
+using std::string;
+using std::vector;
+
+// Keep small directories from repacking their names after every deletion.
+static const size_t MIN_COMPACT_GARBAGE = 256;
+
+static int64_t to_nanoseconds(const uv_timespec_t &ts)
+{
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000 + static_cast<int64_t>(ts.tv_nsec);
+}
+
+StatFingerprint::StatFingerprint(const uv_stat_t &stat) :
+  ino{stat.st_ino},
+  size{stat.st_size},
+  mtime{to_nanoseconds(stat.st_mtim)},
+  ctime{to_nanoseconds(stat.st_ctim)},
+  mode{static_cast<uint32_t>(stat.st_mode)}
+{
+  //
+}
+
+EntryKind StatFingerprint::kind() const
+{
+  if ((mode & S_IFLNK) == S_IFLNK) return KIND_SYMLINK;
+  if ((mode & S_IFDIR) == S_IFDIR) return KIND_DIRECTORY;
+  if ((mode & S_IFREG) == S_IFREG) return KIND_FILE;
+  return KIND_UNKNOWN;
+}
+
+const StatFingerprint *EntryTable::find(const string &name) const
+{
+  auto slot = lower_bound(name);
+  if (slot == slots.end() || !name_equals(*slot, name)) return nullptr;
+  return &slot->fingerprint;
+}
+
+void EntryTable::put(const string &name, const StatFingerprint &fingerprint)
+{
+  auto slot = lower_bound(name);
+  if (slot != slots.end() && name_equals(*slot, name)) {
+    slot->fingerprint = fingerprint;
+    return;
+  }
+
+  Slot inserted{fingerprint, static_cast<uint32_t>(names.size()), static_cast<uint32_t>(name.size())};
+  names.append(name);
+  slots.insert(slot, inserted);
+}
+
+bool EntryTable::erase(const string &name)
+{
+  auto slot = lower_bound(name);
+  if (slot == slots.end() || !name_equals(*slot, name)) return false;
+
+  Slot erased = *slot;
+  slots.erase(slot);
+  release_name(erased);
+  return true;
+}
+
+vector<EntryTable::Slot>::iterator EntryTable::lower_bound(const string &name)
+{
+  // The most common insertion during a scan is past the last entry.
+  if (slots.empty() || names.compare(slots.back().offset, slots.back().length, name) < 0) return slots.end();
+
+  return std::lower_bound(slots.begin(), slots.end(), name, [this](const Slot &slot, const string &n) {
+    return names.compare(slot.offset, slot.length, n) < 0;
+  });
+}
+
+vector<EntryTable::Slot>::const_iterator EntryTable::lower_bound(const string &name) const
+{
+  if (slots.empty() || names.compare(slots.back().offset, slots.back().length, name) < 0) return slots.end();
+
+  return std::lower_bound(slots.begin(), slots.end(), name, [this](const Slot &slot, const string &n) {
+    return names.compare(slot.offset, slot.length, n) < 0;
+  });
+}
+
+void EntryTable::release_name(const Slot &slot)
+{
+  if (slot.offset + slot.length == names.size()) {
+    names.resize(slot.offset);
+  } else {
+    garbage += slot.length;
+  }
+
+  reclaim();
+}
+
+void EntryTable::reclaim()
+{
+  if (slots.empty()) {
+    names.clear();
+    garbage = 0;
+    return;
+  }
+
+  if (garbage <= MIN_COMPACT_GARBAGE || garbage <= names.size() / 2) return;
+
+  string packed;
+  packed.reserve(names.size() - garbage);
+
+  for (Slot &slot : slots) {
+    uint32_t offset = static_cast<uint32_t>(packed.size());
+    packed.append(names, slot.offset, slot.length);
+    slot.offset = offset;
+  }
+
+  names.swap(packed);
+  names.shrink_to_fit();
+  garbage = 0;
+}
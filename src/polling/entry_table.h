@@ -0,0 +1,175 @@
+#ifndef ENTRY_TABLE_H
+#define ENTRY_TABLE_H
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <uv.h>
+#include <vector>
+
+#include "../message.h"
+
+// The subset of an `lstat()` result that a `DirectoryRecord` compares between polling cycles to detect changes.
+//
+// A full `uv_stat_t` occupies 160 bytes. A fingerprint keeps only the inode, mode, size, and modification and change
+// times in 40.
+struct StatFingerprint
+{
+  StatFingerprint() = default;
+
+  explicit StatFingerprint(const uv_stat_t &stat);
+
+  // Classify the entry with the same rules as `kind_from_stat()`.
+  EntryKind kind() const;
+
+  bool is_directory() const { return (mode & S_IFDIR) == S_IFDIR; }
+
+  // Return `true` if the entry's contents or metadata differ from `other`. The caller should already know that they
+  // refer to the same inode.
+  bool is_modified_from(const StatFingerprint &other) const
+  {
+    return is_content_modified_from(other) || is_attribute_modified_from(other);
+  }
+
+  // Return `true` if the entry's contents differ from `other`.
+  bool is_content_modified_from(const StatFingerprint &other) const
+  {
+    return size != other.size || mtime != other.mtime;
+  }
+
+  // Return `true` if the entry's permissions or other metadata differ from `other`. Changes to its contents move its
+  // change time as well, so check `is_content_modified_from()` first to tell the two apart.
+  bool is_attribute_modified_from(const StatFingerprint &other) const
+  {
+    return mode != other.mode || ctime != other.ctime;
+  }
+
+  uint64_t ino{0};
+  uint64_t size{0};
+
+  // Nanoseconds since the epoch.
+  int64_t mtime{0};
+  int64_t ctime{0};
+
+  uint32_t mode{0};
+};
+
+// Map entry names within a single directory to their `StatFingerprints`.
+//
+// Entries are kept in a flat vector sorted by name, and the names themselves are packed end to end in a single
+// per-directory string, so each entry costs its fingerprint, two offsets, and the bytes of its name. Names removed by
+// `erase()` leave gaps in the packed string that are reclaimed once they make up most of it.
+//
+// `scandir()` reports entries in sorted order on most platforms, so the first population of a directory appends to the
+// end of the vector.
+class EntryTable
+{
+public:
+  EntryTable() = default;
+  ~EntryTable() = default;
+
+  // Access the fingerprint recorded for `name`, or null if there is none. The pointer is invalidated by the next call
+  // to `put()` or `erase()`.
+  const StatFingerprint *find(const std::string &name) const;
+
+  // Record `fingerprint` for `name`, replacing any existing fingerprint.
+  void put(const std::string &name, const StatFingerprint &fingerprint);
+
+  // Forget `name`. Return `true` if it was present.
+  bool erase(const std::string &name);
+
+  // Call `fn(name, fingerprint)` for each entry in name order. Entries for which it returns `true` are removed.
+  template <class Fn>
+  void erase_if(Fn fn);
+
+  // Call `fn(fingerprint)` for each entry in name order.
+  template <class Fn>
+  void for_each(Fn fn) const
+  {
+    for (const Slot &slot : slots) {
+      fn(slot.fingerprint);
+    }
+  }
+
+  // Call `fn(name, fingerprint)` for each entry in name order.
+  template <class Fn>
+  void for_each_named(Fn fn) const
+  {
+    std::string name;
+    for (const Slot &slot : slots) {
+      name.assign(names, slot.offset, slot.length);
+      fn(name, slot.fingerprint);
+    }
+  }
+
+  size_t size() const { return slots.size(); }
+
+  bool empty() const { return slots.empty(); }
+
+  // Estimate the heap memory held by this table in bytes.
+  size_t memory_usage() const { return slots.capacity() * sizeof(Slot) + names.capacity(); }
+
+  EntryTable(const EntryTable &) = delete;
+  EntryTable(EntryTable &&) = delete;
+  EntryTable &operator=(const EntryTable &) = delete;
+  EntryTable &operator=(EntryTable &&) = delete;
+
+private:
+  struct Slot
+  {
+    StatFingerprint fingerprint;
+
+    // Location of this entry's name within `names`.
+    uint32_t offset;
+    uint32_t length;
+  };
+
+  // Locate the first slot whose name is not less than `name`.
+  std::vector<Slot>::iterator lower_bound(const std::string &name);
+  std::vector<Slot>::const_iterator lower_bound(const std::string &name) const;
+
+  bool name_equals(const Slot &slot, const std::string &name) const
+  {
+    return names.compare(slot.offset, slot.length, name) == 0;
+  }
+
+  // Note that `slot`'s name is no longer used.
+  void release_name(const Slot &slot);
+
+  // Repack `names` if too much of it has become garbage.
+  void reclaim();
+
+  std::vector<Slot> slots;
+
+  // Every entry name, concatenated without separators.
+  std::string names;
+
+  // Bytes within `names` that no longer belong to any slot.
+  size_t garbage{0};
+
+  friend std::ostream &operator<<(std::ostream &out, const EntryTable &table)
+  {
+    return out << "EntryTable{entries=" << table.slots.size() << " bytes=" << table.memory_usage() << "}";
+  }
+};
+
+template <class Fn>
+void EntryTable::erase_if(Fn fn)
+{
+  std::string name;
+  auto kept = slots.begin();
+  for (auto slot = slots.begin(); slot != slots.end(); ++slot) {
+    name.assign(names, slot->offset, slot->length);
+    if (fn(name, slot->fingerprint)) {
+      garbage += slot->length;
+    } else {
+      *kept = *slot;
+      ++kept;
+    }
+  }
+  slots.erase(kept, slots.end());
+
+  reclaim();
+}
+
+#endif
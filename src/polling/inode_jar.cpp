@@ -0,0 +1,125 @@
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "../message.h"
+#include "../message_buffer.h"
+#include "entry_table.h"
+#include "inode_jar.h"
+
+using std::move;
+using std::string;
+
+// Number of consecutive polling cycles whose deletions are held at once.
+static const size_t DELETION_BATCHES = 2;
+
+InodeJar::InodeJar(EventMask events) : events{events}, deletions(DELETION_BATCHES)
+{
+  //
+}
+
+void InodeJar::deleted(ChannelMessageBuffer &buffer, string &&path, const StatFingerprint &fingerprint)
+{
+  auto creation = creations_by_ino.find(fingerprint.ino);
+  if (creation != creations_by_ino.end()) {
+    Pending &to = *creation->second;
+    if (to.path != path && is_same_entry(fingerprint, to.fingerprint)) {
+      string to_path(move(to.path));
+      to.path.clear();
+      creations_by_ino.erase(creation);
+
+      report_deletion_at(buffer, to_path);
+      buffer.renamed(move(path), move(to_path), to.fingerprint.kind());
+      return;
+    }
+
+    // An entry that appeared and disappeared again within this cycle. Report its creation first.
+    if (to.path == path) report_creation(buffer, to);
+  }
+
+  // Only the most recent disappearance of an inode or a path can be matched.
+  auto previous = deletions_by_ino.find(fingerprint.ino);
+  if (previous != deletions_by_ino.end()) report_deletion(buffer, *previous->second);
+  auto previous_path = deletions_by_path.find(path);
+  if (previous_path != deletions_by_path.end()) report_deletion(buffer, *previous_path->second);
+
+  Batch &batch = deletions.back();
+  batch.emplace_back(move(path), fingerprint);
+  deletions_by_ino[fingerprint.ino] = &batch.back();
+  deletions_by_path[batch.back().path] = &batch.back();
+}
+
+void InodeJar::created(ChannelMessageBuffer &buffer, string &&path, const StatFingerprint &fingerprint)
+{
+  auto deletion = deletions_by_ino.find(fingerprint.ino);
+  if (deletion != deletions_by_ino.end() && is_same_entry(deletion->second->fingerprint, fingerprint)) {
+    Pending &from = *deletion->second;
+    string from_path(move(from.path));
+    from.path.clear();
+    deletions_by_path.erase(from_path);
+    deletions_by_ino.erase(deletion);
+
+    report_deletion_at(buffer, path);
+    buffer.renamed(move(from_path), move(path), fingerprint.kind());
+    return;
+  }
+
+  auto previous = creations_by_ino.find(fingerprint.ino);
+  if (previous != creations_by_ino.end()) report_creation(buffer, *previous->second);
+
+  creations.emplace_back(move(path), fingerprint);
+  creations_by_ino[fingerprint.ino] = &creations.back();
+}
+
+void InodeJar::end_cycle(ChannelMessageBuffer &buffer)
+{
+  for (Pending &creation : creations) {
+    report_creation(buffer, creation);
+  }
+  creations.clear();
+
+  for (Pending &deletion : deletions.front()) {
+    report_deletion(buffer, deletion);
+  }
+  deletions.pop_front();
+  deletions.emplace_back();
+}
+
+bool InodeJar::is_same_entry(const StatFingerprint &from, const StatFingerprint &to)
+{
+  // A rename moves an entry's change time, but leaves its modification time alone.
+  return !kinds_are_different(from.kind(), to.kind()) && from.size == to.size && from.mtime == to.mtime;
+}
+
+void InodeJar::report_deletion(ChannelMessageBuffer &buffer, Pending &deletion)
+{
+  if (deletion.path.empty()) return;
+
+  auto by_ino = deletions_by_ino.find(deletion.fingerprint.ino);
+  if (by_ino != deletions_by_ino.end() && by_ino->second == &deletion) deletions_by_ino.erase(by_ino);
+  deletions_by_path.erase(deletion.path);
+
+  if ((events & EVENT_DELETED) != 0u) buffer.deleted(move(deletion.path), deletion.fingerprint.kind());
+  deletion.path.clear();
+}
+
+void InodeJar::report_deletion_at(ChannelMessageBuffer &buffer, const string &path)
+{
+  auto replaced = deletions_by_path.find(path);
+  if (replaced != deletions_by_path.end()) report_deletion(buffer, *replaced->second);
+}
+
+void InodeJar::report_creation(ChannelMessageBuffer &buffer, Pending &creation)
+{
+  if (creation.path.empty()) return;
+
+  report_deletion_at(buffer, creation.path);
+
+  auto by_ino = creations_by_ino.find(creation.fingerprint.ino);
+  if (by_ino != creations_by_ino.end() && by_ino->second == &creation) creations_by_ino.erase(by_ino);
+
+  if ((events & EVENT_CREATED) != 0u) buffer.created(move(creation.path), creation.fingerprint.kind());
+  creation.path.clear();
+}
@@ -0,0 +1,94 @@
+#ifndef INODE_JAR_H
+#define INODE_JAR_H
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+
+#include "../message.h"
+#include "../message_buffer.h"
+#include "entry_table.h"
+
+// Correlate the disappearance of an entry from one polled path with the appearance of the same inode at another, so
+// that polled roots report renames as `renamed` events just as the inotify backend's `CookieJar` does.
+//
+// Polling may observe either side of a rename first, depending on the order in which directories are visited.
+// Deletions are held until the end of the polling cycle after the one in which they were observed, so that a rename
+// from a directory visited early in one complete scan to a directory visited late in the next is still caught.
+// Creations are only held until the end of the cycle in which they were observed, so that they're never delivered
+// later than they would have been without correlation. Entries that remain unmatched are reported as deletions or
+// creations.
+//
+// An inode may be reused by a newly created entry as soon as its last link is removed, so only entries that also share
+// a kind, size, and modification time are considered to be the same.
+class InodeJar
+{
+public:
+  // Construct a jar for a channel that has asked to hear about the `EventClass` bits in `events`. Unmatched entries
+  // are only reported if `events` accepts their deletion or creation.
+  explicit InodeJar(EventMask events);
+  ~InodeJar() = default;
+
+  // Observe that the entry at `path` with the stat fingerprint `fingerprint` has disappeared. If a matching entry has
+  // appeared elsewhere during this cycle, emit a `renamed` event to `buffer`. Otherwise, hold it to match a later
+  // creation.
+  void deleted(ChannelMessageBuffer &buffer, std::string &&path, const StatFingerprint &fingerprint);
+
+  // Observe that an entry at `path` has appeared with the stat fingerprint `fingerprint`. If a matching entry has
+  // recently disappeared elsewhere, emit a `renamed` event to `buffer`. Otherwise, hold it to match a deletion later
+  // in this cycle.
+  void created(ChannelMessageBuffer &buffer, std::string &&path, const StatFingerprint &fingerprint);
+
+  // Called at the end of each polling cycle. Report held creations from this cycle and held deletions from the
+  // previous one to `buffer`.
+  void end_cycle(ChannelMessageBuffer &buffer);
+
+  InodeJar(const InodeJar &) = delete;
+  InodeJar(InodeJar &&) = delete;
+  InodeJar &operator=(const InodeJar &) = delete;
+  InodeJar &operator=(InodeJar &&) = delete;
+
+private:
+  // An entry waiting to be matched. Once it's been matched or reported, its `path` is cleared.
+  struct Pending
+  {
+    Pending(std::string &&path, const StatFingerprint &fingerprint) : path(std::move(path)), fingerprint(fingerprint)
+    {
+      //
+    }
+
+    std::string path;
+    StatFingerprint fingerprint;
+  };
+
+  // Deletions observed within a single polling cycle, in the order that they were observed. A `std::deque` never
+  // moves its elements when appended to, so the indices below may point into it.
+  using Batch = std::deque<Pending>;
+
+  // Return `true` if `from` and `to` are plausibly the same entry before and after a rename.
+  static bool is_same_entry(const StatFingerprint &from, const StatFingerprint &to);
+
+  // Report a held deletion or creation and forget it.
+  void report_deletion(ChannelMessageBuffer &buffer, Pending &deletion);
+  void report_creation(ChannelMessageBuffer &buffer, Pending &creation);
+
+  // An entry that replaces another at the same path must not be reported before the other's deletion. Report any
+  // deletion held for `path` now.
+  void report_deletion_at(ChannelMessageBuffer &buffer, const std::string &path);
+
+  EventMask events;
+
+  // Held deletions from the previous cycle and the current one, oldest first.
+  std::deque<Batch> deletions;
+
+  // Held creations from the current cycle, in the order that they were observed.
+  Batch creations;
+
+  // Unresolved held entries by inode. Deletions are also indexed by path for `report_deletion_at()`.
+  std::unordered_map<uint64_t, Pending *> deletions_by_ino;
+  std::unordered_map<std::string, Pending *> deletions_by_path;
+  std::unordered_map<uint64_t, Pending *> creations_by_ino;
+};
+
+#endif
@@ -1,16 +1,83 @@
+#include <algorithm>
+#include <cstdint>
+#include <iomanip>
+#include <memory>
+#include <sstream>
 #include <string>
 #include <utility>
 
+#include "../gitignore.h"
 #include "../message.h"
 #include "../message_buffer.h"
+#include "../path_matcher.h"
+#include "../result.h"
 #include "directory_record.h"
 #include "polled_root.h"
+#include "polling_snapshot.h"
 
 using std::move;
+using std::ostringstream;
+using std::shared_ptr;
 using std::string;
+using std::unique_ptr;
 
-PolledRoot::PolledRoot(string &&root_path, ChannelID channel_id, bool recursive) :
-  root(new DirectoryRecord(move(root_path))), channel_id{channel_id}, iterator(root, recursive), all_populated{false}
+// Weight given to each new latency measurement.
+static const double LATENCY_SMOOTHING = 0.25;
+
+// Operations to attempt at a time before a root's latency has been measured.
+static const size_t INITIAL_TIMED_QUANTUM = 16;
+
+// Upper bound on the operations attempted at a time, in case a root is measured as implausibly fast.
+static const size_t MAX_TIMED_QUANTUM = 65536;
+
+// Fold `bytes` into a 64-bit FNV-1a hash. The terminating null is included, so that adjacent fields can't run together.
+static void hash_into(uint64_t &hash, const string &bytes)
+{
+  for (const char *c = bytes.c_str(); c <= bytes.c_str() + bytes.size(); c++) {
+    hash ^= static_cast<unsigned char>(*c);
+    hash *= 1099511628211u;
+  }
+}
+
+// Derive a file name from the settings that determine which entries a root records.
+static string name_snapshot(const string &root_path,
+  bool recursive,
+  EventMask events,
+  const shared_ptr<const PathMatcher> &exclusions,
+  bool gitignore)
+{
+  uint64_t hash = 14695981039346656037u;
+  hash_into(hash, root_path);
+  hash_into(hash, recursive ? "recursive" : "");
+  hash_into(hash, std::to_string(events));
+  hash_into(hash, exclusions ? exclusions->get_patterns() : "");
+  hash_into(hash, gitignore ? "gitignore" : "");
+
+  ostringstream name;
+  name << std::hex << std::setw(16) << std::setfill('0') << hash << ".snapshot";
+  return name.str();
+}
+
+PolledRoot::PolledRoot(string &&root_path,
+  ChannelID channel_id,
+  bool recursive,
+  EventMask events,
+  const shared_ptr<const PathMatcher> &exclusions,
+  bool gitignore) :
+  root(new DirectoryRecord(string(root_path))),
+  channel_id{channel_id},
+  iterator(root,
+    recursive,
+    events,
+    exclusions,
+    unique_ptr<GitIgnore>(gitignore ? new GitIgnore(move(root_path)) : nullptr)),
+  all_populated{false},
+  hot_share{0},
+  latency{0},
+  operation_count{0},
+  snapshot_name(name_snapshot(root->path(), recursive, events, exclusions, gitignore)),
+  snapshot_written{false},
+  snapshot_changes{0}
 {
   //
 }
@@ -20,16 +87,84 @@ size_t PolledRoot::advance(MessageBuffer &buffer, size_t throttle_allocation)
   ChannelMessageBuffer channel_buffer(buffer, channel_id);
   BoundPollingIterator bound_iterator(iterator, channel_buffer);
 
-  size_t progress = bound_iterator.advance(throttle_allocation);
+  size_t progress = 0;
+  if (hot_share > 0) {
+    progress += bound_iterator.advance_hot(std::max(throttle_allocation * hot_share / 100, static_cast<size_t>(1)));
+  }
+  progress += bound_iterator.advance(throttle_allocation > progress ? throttle_allocation - progress : 0);
 
-  if (!all_populated && root->all_populated()) {
+  // Every directory has been walked, and any restored from the snapshot have been compared against it, only once the
+  // complete scan has wrapped back around to the root.
+  if (!all_populated && iterator.has_completed_scan()) {
     all_populated = true;
+    iterator.release_snapshot();
   }
 
   return progress;
 }
 
+void PolledRoot::begin_cycle(size_t hot_share)
+{
+  this->hot_share = std::min(hot_share, static_cast<size_t>(100));
+  if (this->hot_share > 0) iterator.begin_hot_pass();
+}
+
+void PolledRoot::end_cycle(MessageBuffer &buffer)
+{
+  ChannelMessageBuffer channel_buffer(buffer, channel_id);
+  iterator.end_cycle(channel_buffer);
+}
+
+void PolledRoot::use_snapshot(string &&path)
+{
+  snapshot_path = move(path);
+  if (snapshot_path.empty() || root->is_populated()) return;
+
+  iterator.use_snapshot(PollingSnapshot::open(snapshot_path, root->path()));
+}
+
+bool PolledRoot::is_snapshot_due(std::chrono::steady_clock::time_point now,
+  std::chrono::steady_clock::duration interval) const
+{
+  if (snapshot_path.empty() || !all_populated) return false;
+  if (!snapshot_written) return true;
+  return iterator.get_change_count() != snapshot_changes && now - snapshot_time >= interval;
+}
+
+Result<> PolledRoot::write_snapshot(std::chrono::steady_clock::time_point now)
+{
+  string root_path(root->path());
+  PollingSnapshot::Builder builder(root_path);
+  root->write_snapshot(builder, root_path);
+
+  // A failed write is only retried after the next change, once the interval has elapsed again.
+  snapshot_written = true;
+  snapshot_changes = iterator.get_change_count();
+  snapshot_time = now;
+
+  return builder.write(snapshot_path);
+}
+
 size_t PolledRoot::count_entries() const
 {
   return root->count_entries();
 }
+
+void PolledRoot::record_latency(size_t operations, std::chrono::nanoseconds elapsed)
+{
+  if (operations == 0) return;
+  operation_count += operations;
+
+  double sample = static_cast<double>(elapsed.count()) / static_cast<double>(operations);
+  latency = latency > 0 ? latency + LATENCY_SMOOTHING * (sample - latency) : sample;
+}
+
+size_t PolledRoot::operations_within(std::chrono::nanoseconds duration) const
+{
+  if (latency <= 0) return INITIAL_TIMED_QUANTUM;
+
+  double operations = static_cast<double>(duration.count()) / latency;
+  if (operations < 1) return 1;
+  if (operations > MAX_TIMED_QUANTUM) return MAX_TIMED_QUANTUM;
+  return static_cast<size_t>(operations);
+}
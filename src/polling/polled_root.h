@@ -1,11 +1,15 @@
 #ifndef POLLED_ROOT_H
 #define POLLED_ROOT_H
 
+#include <chrono>
+#include <cstdint>
 #include <iostream>
 #include <memory>
 #include <string>
 
 #include "../message.h"
+#include "../path_matcher.h"
+#include "../result.h"
 #include "directory_record.h"
 #include "polling_iterator.h"
 
@@ -14,11 +18,18 @@ class PolledRoot
 {
 public:
   // Begin watching a new root directory. Events produced by changes observed within this subtree should be
-  // sent to `channel_id`.
+  // sent to `channel_id`. Only changes within the `EventClass` bits of `events` are reported, and entries matched by
+  // `exclusions` are never scanned. If `gitignore` is true, entries ignored by `.gitignore` files within the tree are
+  // never scanned either.
   //
   // The newly constructed root does *not* contain any initial scan information, to avoid CPU usage spikes when
   // watching large directory trees. The subtree's records will be populated on the first scan.
-  PolledRoot(std::string &&root_path, ChannelID channel_id, bool recursive);
+  PolledRoot(std::string &&root_path,
+    ChannelID channel_id,
+    bool recursive,
+    EventMask events,
+    const std::shared_ptr<const PathMatcher> &exclusions,
+    bool gitignore);
 
   ~PolledRoot() = default;
 
@@ -30,12 +41,53 @@ public:
   // left ready to begin again at the root directory next time.
   size_t advance(MessageBuffer &buffer, size_t throttle_allocation);
 
+  // Prepare for a new polling cycle. Up to `hot_share` percent of each allocation given to `PolledRoot::advance()`
+  // during the cycle may be spent revisiting recently changed directories, with the rest continuing the complete scan.
+  // The complete scan advances by at least one operation per call regardless.
+  void begin_cycle(size_t hot_share);
+
+  // Finish a polling cycle. Report any deletions and creations that have been held too long to be matched as renames
+  // into `buffer`.
+  void end_cycle(MessageBuffer &buffer);
+
+  // Return `true` if the next call to `PolledRoot::advance()` will begin a new scan at the root directory. The
+  // `PollingPool` uses this to advance each root through at most one complete scan per cycle.
+  bool is_at_scan_start() const { return iterator.at_root(); }
+
   // Return `true` once the first complete scan has been completed by calls to `PolledRoot::advance()`.
   bool is_all_populated() { return all_populated; }
 
   // Count the number of filesystem entries that are covered by this polling thread.
   size_t count_entries() const;
 
+  // Note that `operations` filesystem operations took `elapsed` in total, refining the estimate of this root's latency.
+  void record_latency(size_t operations, std::chrono::nanoseconds elapsed);
+
+  // Estimate the number of operations that this root can perform within `duration`. Return at least one.
+  size_t operations_within(std::chrono::nanoseconds duration) const;
+
+  // Count the filesystem operations performed on this root since it was added.
+  uint64_t get_operation_count() const { return operation_count; }
+
+  // Count the number of directories that are currently being revisited between complete scans.
+  size_t count_hot_directories() const { return iterator.count_hot_directories(); }
+
+  // Compare the initial scan against the snapshot at `path`, if one was written there for this root, and write the
+  // root's state to `path` from time to time afterwards. An empty `path` stops writing snapshots.
+  void use_snapshot(std::string &&path);
+
+  // Access the file name that identifies this root's snapshot. It's derived from the root path and every setting
+  // that determines which entries are recorded, so that a root watched with different settings never restores
+  // another's snapshot.
+  const std::string &get_snapshot_name() const { return snapshot_name; }
+
+  // Return `true` if the root's state should be written to its snapshot at `now`: it's been completely populated and
+  // has changed since its snapshot was last written, and it's been at least `interval` since then.
+  bool is_snapshot_due(std::chrono::steady_clock::time_point now, std::chrono::steady_clock::duration interval) const;
+
+  // Write the root's state to its snapshot.
+  Result<> write_snapshot(std::chrono::steady_clock::time_point now);
+
   PolledRoot(const PolledRoot &) = delete;
   PolledRoot(PolledRoot &&) = delete;
   PolledRoot &operator=(const PolledRoot &) = delete;
@@ -54,6 +106,25 @@ private:
   // Becomes `true` when the first full subtree scan has completed.
   bool all_populated;
 
+  // Percentage of each throttle allocation available to hot passes during the current cycle.
+  size_t hot_share;
+
+  // Exponentially smoothed nanoseconds per filesystem operation, or zero until the first measurement.
+  double latency;
+
+  // Total filesystem operations performed, accumulated by `record_latency()`.
+  uint64_t operation_count;
+
+  // File name and full path of the snapshot. `snapshot_path` is empty while snapshots are disabled.
+  std::string snapshot_name;
+  std::string snapshot_path;
+
+  // The iterator's change count and the time when the snapshot was last written. `snapshot_written` is `false` until
+  // the first write.
+  bool snapshot_written;
+  size_t snapshot_changes;
+  std::chrono::steady_clock::time_point snapshot_time;
+
   // Diagnostics and logging are your friend.
   friend std::ostream &operator<<(std::ostream &out, const PolledRoot &root)
   {
@@ -1,24 +1,52 @@
+#include <algorithm>
 #include <memory>
 #include <queue>
 #include <stack>
 #include <string>
+#include <utility>
 
 #include "../helper/common.h"
 #include "../message_buffer.h"
 #include "directory_record.h"
 #include "polling_iterator.h"
 
+using std::move;
 using std::shared_ptr;
 using std::string;
+using std::unique_ptr;
+
+PollingIterator::PollingIterator(const shared_ptr<DirectoryRecord> &root,
+  bool recursive,
+  EventMask events,
+  const shared_ptr<const PathMatcher> &exclusions,
+  unique_ptr<GitIgnore> &&gitignore) :
+  root(root),
+  recursive{recursive},
+  events{events},
+  exclusions(exclusions),
+  gitignore(move(gitignore)),
+  hot_index{0},
+  hot_pass_count{0},
+  hot_pass_due{false},
+  renames(events),
+  change_count{0},
+  completed_scans{0}
+{
+  cold.current = root;
+  cold.current_path = root->path();
+}
 
-PollingIterator::PollingIterator(const shared_ptr<DirectoryRecord> &root, bool recursive) :
-  root(root), recursive{recursive}, current(root), current_path(root->path()), phase{PollingIterator::SCAN}
+void PollingIterator::begin_hot_pass()
 {
-  //
+  if (hot_pass_due || hot_directories.empty() || at_root()) return;
+
+  hot_index = 0;
+  hot_pass_count++;
+  hot_pass_due = true;
 }
 
 BoundPollingIterator::BoundPollingIterator(PollingIterator &iterator, ChannelMessageBuffer &buffer) :
-  buffer{buffer}, iterator{iterator}
+  buffer{buffer}, iterator{iterator}, visit{&iterator.cold}
 {
   //
 }
@@ -29,60 +57,199 @@ size_t BoundPollingIterator::advance(size_t throttle_allocation)
   size_t count = 0;
 
   while (count < total) {
-    if (iterator.phase == PollingIterator::SCAN) {
+    if (iterator.cold.phase == PollingIterator::SCAN) {
       advance_scan();
-    } else if (iterator.phase == PollingIterator::ENTRIES) {
+    } else if (iterator.cold.phase == PollingIterator::ENTRIES) {
       advance_entry();
-    } else if (iterator.phase == PollingIterator::RESET) {
+    } else if (iterator.cold.phase == PollingIterator::RESET) {
       break;
     }
     count++;
   }
 
-  if (iterator.phase == PollingIterator::RESET) {
-    iterator.current = iterator.root;
-    iterator.current_path = iterator.current->path();
-    iterator.phase = PollingIterator::SCAN;
+  if (iterator.cold.phase == PollingIterator::RESET) {
+    iterator.cold.current = iterator.root;
+    iterator.cold.current_path = iterator.root->path();
+    iterator.cold.phase = PollingIterator::SCAN;
+  }
+
+  return count;
+}
+
+size_t BoundPollingIterator::advance_hot(size_t throttle_allocation)
+{
+  size_t count = 0;
+
+  visit = &iterator.hot;
+  while (count < throttle_allocation && iterator.hot_pass_due) {
+    if (iterator.hot.phase == PollingIterator::ENTRIES) {
+      advance_entry();
+    } else if (next_hot_directory()) {
+      advance_scan();
+    } else {
+      iterator.hot_pass_due = false;
+      break;
+    }
+    count++;
   }
+  visit = &iterator.cold;
 
   return count;
 }
 
+std::vector<Entry> &BoundPollingIterator::sorted_entries()
+{
+  auto by_name = [](const Entry &left, const Entry &right) { return left.first < right.first; };
+  if (!std::is_sorted(visit->entries.begin(), visit->entries.end(), by_name)) {
+    std::sort(visit->entries.begin(), visit->entries.end(), by_name);
+  }
+  return visit->entries;
+}
+
+void BoundPollingIterator::push_directory(const shared_ptr<DirectoryRecord> &subdirectory, string &&subdirectory_path)
+{
+  if (!iterator.recursive) return;
+
+  if (!in_hot_pass()) {
+    iterator.directories.emplace(subdirectory, move(subdirectory_path));
+  } else if (!subdirectory->is_populated()) {
+    promote(subdirectory, subdirectory_path);
+  }
+}
+
+bool BoundPollingIterator::is_excluded(const string &entry_name, EntryKind kind)
+{
+  string &entry_path = visit->excluded_path;
+  path_join_into(entry_path, visit->current_path, entry_name);
+
+  if (iterator.exclusions && iterator.exclusions->excludes(entry_path, kind == KIND_DIRECTORY)) return true;
+  return iterator.gitignore && iterator.gitignore->excludes(entry_path, kind == KIND_DIRECTORY);
+}
+
+void BoundPollingIterator::entry_changed(const string &entry_path)
+{
+  if (iterator.gitignore) iterator.gitignore->changed(entry_path);
+
+  // Changes found by a directory's initial scan say nothing about how active it is, unless it's comparing against
+  // entries restored from the snapshot.
+  if (visit->current->has_baseline()) {
+    iterator.change_count++;
+    promote(visit->current, visit->current_path);
+  }
+}
+
 void BoundPollingIterator::advance_scan()
 {
-  iterator.current->scan(this);
+  // A hot pass that's part of the way through the directory that the complete scan is about to scan gives it up, so
+  // that the two never compare entries against records that the other has just changed.
+  if (!in_hot_pass() && iterator.hot.phase == PollingIterator::ENTRIES && iterator.hot.current == visit->current) {
+    iterator.hot.entries.clear();
+    iterator.hot.current_handle.close();
+    iterator.hot.current.reset();
+    iterator.hot.phase = PollingIterator::SCAN;
+  }
+
+  // Failure to open the directory is reported by the scan. Entries that it finds anyway are stated by full path. Only
+  // the root may be reached through a symlink: a subdirectory that's been replaced by one is no longer the directory
+  // its record describes.
+  visit->current_handle.open(visit->current_path, visit->current == iterator.root);
+  visit->current->scan(this);
 
-  iterator.current_entry = iterator.entries.begin();
-  iterator.phase = PollingIterator::ENTRIES;
+  visit->current_entry = visit->entries.begin();
+  visit->phase = PollingIterator::ENTRIES;
 }
 
 void BoundPollingIterator::advance_entry()
 {
-  if (iterator.current_entry != iterator.entries.end()) {
-    string &entry_name = iterator.current_entry->first;
-    EntryKind kind = iterator.current_entry->second;
+  if (visit->current_entry != visit->entries.end()) {
+    string &entry_name = visit->current_entry->first;
+    EntryKind kind = visit->current_entry->second;
 
-    iterator.current->entry(this, entry_name, path_join(iterator.current_path, entry_name), kind);
-    iterator.current_entry++;
+    visit->current->entry(this, entry_name, kind);
+    visit->current_entry++;
   }
 
-  if (iterator.current_entry != iterator.entries.end()) {
+  if (visit->current_entry != visit->entries.end()) {
     // Remain in ENTRIES phase
     return;
   }
 
-  iterator.current->mark_populated();
-  iterator.entries.clear();
-  iterator.current_entry = iterator.entries.end();
+  visit->current->mark_populated();
+  visit->entries.clear();
+  visit->current_entry = visit->entries.end();
+  visit->current_handle.close();
+
+  if (in_hot_pass()) {
+    // Move on to the next hot directory
+    visit->current.reset();
+    visit->phase = PollingIterator::SCAN;
+    return;
+  }
 
   if (iterator.directories.empty()) {
-    iterator.phase = PollingIterator::RESET;
+    cool_down();
+    iterator.completed_scans++;
+    visit->phase = PollingIterator::RESET;
     return;
   }
 
   // Advance to the next directory in the queue
-  iterator.current = iterator.directories.front();
-  iterator.current_path = iterator.current->path();
+  visit->current = move(iterator.directories.front().first);
+  visit->current_path = move(iterator.directories.front().second);
   iterator.directories.pop();
-  iterator.phase = PollingIterator::SCAN;
+  visit->phase = PollingIterator::SCAN;
+}
+
+bool BoundPollingIterator::next_hot_directory()
+{
+  while (iterator.hot_index < iterator.hot_directories.size()) {
+    auto &candidate = iterator.hot_directories[iterator.hot_index];
+
+    shared_ptr<DirectoryRecord> directory = candidate.first.lock();
+    if (!directory) {
+      // The directory has been deleted and its record discarded
+      iterator.hot_directories.erase(iterator.hot_directories.begin() + iterator.hot_index);
+      continue;
+    }
+    iterator.hot_index++;
+
+    // Visit the top tier on every pass, the next on every second pass, and so on
+    size_t period = static_cast<size_t>(1) << (HOT_TIERS - directory->get_polling_tier());
+    if (iterator.hot_pass_count % period != 0) continue;
+
+    // Leave a directory that the complete scan is part of the way through to the complete scan
+    if (iterator.cold.phase == PollingIterator::ENTRIES && iterator.cold.current == directory) continue;
+
+    iterator.hot.current = move(directory);
+    iterator.hot.current_path = candidate.second;
+    return true;
+  }
+
+  return false;
+}
+
+void BoundPollingIterator::promote(const shared_ptr<DirectoryRecord> &directory, const string &directory_path)
+{
+  if (directory->get_polling_tier() == 0) iterator.hot_directories.emplace_back(directory, directory_path);
+  directory->set_polling_tier(HOT_TIERS);
+}
+
+void BoundPollingIterator::cool_down()
+{
+  auto &hot_directories = iterator.hot_directories;
+  auto kept = hot_directories.begin();
+  for (auto it = hot_directories.begin(); it != hot_directories.end(); ++it) {
+    shared_ptr<DirectoryRecord> directory = it->first.lock();
+    if (!directory) continue;
+
+    unsigned tier = directory->get_polling_tier();
+    if (tier > 0) tier--;
+    directory->set_polling_tier(tier);
+    if (tier == 0) continue;
+
+    if (kept != it) *kept = move(*it);
+    ++kept;
+  }
+  hot_directories.erase(kept, hot_directories.end());
+  iterator.hot_index = std::min(iterator.hot_index, hot_directories.size());
 }
@@ -10,20 +10,41 @@
 #include <uv.h>
 
 #include "../message.h"
+#include "../gitignore.h"
+#include "../helper/common.h"
 #include "../message_buffer.h"
+#include "../path_matcher.h"
+#include "directory_handle.h"
+#include "inode_jar.h"
+#include "polling_snapshot.h"
 
 class DirectoryRecord;
 
+// Number of polling tiers above the cold tier. A directory enters the top tier when a change is observed within it and
+// drops one tier after each complete scan.
+const unsigned HOT_TIERS = 3;
+
 // Persistent state of the iteration over the contents of a `PolledRoot`. This allows `PolledRoot` to partially scan
 // large filesystems, then resume after a pause.
 //
+// The iterator interleaves two traversals. The cold traversal is a complete, breadth-first scan of the tree that
+// resumes where it left off each cycle. Directories in which a change has been observed are also promoted to a hot
+// tier, and a hot pass over them may run at the start of each polling cycle, so that recently active directories are
+// revisited several times during each complete scan of a large tree. Directories in the top tier are visited on every
+// hot pass, the next tier on every second pass, and so on.
+//
 // `BoundPollingIterator` does most of the actual work, but stores all of its persistent state here.
 class PollingIterator
 {
 public:
   // Create an iterator poised to begin at a root `DirectoryRecord`. If `recursive` is true, the iterator will
-  // automatically advance into subdirectories of the root.
-  explicit PollingIterator(const std::shared_ptr<DirectoryRecord> &root, bool recursive);
+  // automatically advance into subdirectories of the root. Only changes belonging to the `EventClass` bits within
+  // `events` will be reported. Entries matched by `exclusions` or `gitignore`, if they're non-null, are never visited.
+  PollingIterator(const std::shared_ptr<DirectoryRecord> &root,
+    bool recursive,
+    EventMask events,
+    const std::shared_ptr<const PathMatcher> &exclusions,
+    std::unique_ptr<GitIgnore> &&gitignore);
 
   PollingIterator(const PollingIterator &) = delete;
   PollingIterator(PollingIterator &&) = delete;
@@ -31,37 +52,116 @@ public:
   PollingIterator &operator=(const PollingIterator &) = delete;
   PollingIterator &operator=(PollingIterator &&) = delete;
 
-private:
-  // The top-level `DirectoryRecord` of the `PolledRoot`, so we know where to reset when we reach the end.
-  std::shared_ptr<DirectoryRecord> root;
+  // Return `true` if the iterator is poised to begin a fresh scan at the root directory.
+  bool at_root() const { return cold.phase == SCAN && cold.current == root; }
 
-  // If `true`, the iterator will automatically descend into subdirectories as they are discovered.
-  bool recursive;
+  // Schedule a pass over the hot directories, unless the previous one is still in progress. No pass is scheduled when
+  // a complete scan is about to begin, because it will visit every hot directory anyway.
+  void begin_hot_pass();
+
+  // Return the number of directories currently assigned to a hot tier.
+  size_t count_hot_directories() const { return hot_directories.size(); }
 
-  // The `DirectoryRecord` that we're on right now.
-  std::shared_ptr<DirectoryRecord> current;
+  // Called at the end of each polling cycle to report deletions and creations that weren't matched as renames.
+  void end_cycle(ChannelMessageBuffer &buffer) { renames.end_cycle(buffer); }
 
-  // Remember the current `DirectoryRecord`'s full, joined path to avoid recursing up the entire tree for each entry.
-  std::string current_path;
+  // Compare the initial scan of each directory recorded within `snapshot` against its recorded entries, rather than
+  // populating it silently.
+  void use_snapshot(std::unique_ptr<PollingSnapshot> &&snapshot) { this->snapshot = std::move(snapshot); }
 
-  // An entry name and `EntryKind` pair reported by a `scandir()` call. Populated by
-  // `BoundPollingIterator::advance_scan()` in the `SCAN` phase.
-  std::vector<Entry> entries;
+  // Unmap the snapshot once every directory has been populated.
+  void release_snapshot() { snapshot.reset(); }
 
-  // Save our place within the `entries` vector during the `ENTRIES` phase.
-  std::vector<Entry>::iterator current_entry;
+  // Return `true` once the complete scan has walked every directory in the tree and wrapped back to the root at least
+  // once. Directories restored from the snapshot aren't populated until then.
+  bool has_completed_scan() const { return completed_scans > 0; }
 
-  // A queue of subdirectories to traverse next. Populated by `BoundPollingIterator::advance_scan()` in the `SCAN`
-  // phase.
-  std::queue<std::shared_ptr<DirectoryRecord>> directories;
+  // Return the number of changes observed within populated directories so far.
+  size_t get_change_count() const { return change_count; }
 
+private:
   // Phases of traversal.
-  enum
+  enum Phase
   {
     SCAN,  // Scan the current `DirectoryRecord` to populate `entries`,
     ENTRIES,  // Compare the next entry to an up-to-date `lstat()` result to see if an entry has changed.
     RESET  // Loop back to the root directory.
-  } phase;
+  };
+
+  // Progress through a single directory: a scan, followed by an `lstat()` of each entry that it found.
+  struct Visit
+  {
+    // The `DirectoryRecord` that we're on right now.
+    std::shared_ptr<DirectoryRecord> current;
+
+    // Remember the current `DirectoryRecord`'s full, joined path to avoid recursing up the entire tree for each entry.
+    std::string current_path;
+
+    // The current directory, held open while its entries are visited so that each can be stated by name.
+    DirectoryHandle current_handle;
+
+    // An entry name and `EntryKind` pair reported by a `scandir()` call. Populated by
+    // `BoundPollingIterator::advance_scan()` in the `SCAN` phase.
+    std::vector<Entry> entries;
+
+    // Save our place within the `entries` vector during the `ENTRIES` phase.
+    std::vector<Entry>::iterator current_entry;
+
+    // Scratch space for the full paths of entries tested against the channel's exclusions. Its capacity is kept from
+    // one entry and directory to the next.
+    std::string excluded_path;
+
+    Phase phase{SCAN};
+  };
+
+  // The top-level `DirectoryRecord` of the `PolledRoot`, so we know where to reset when we reach the end.
+  std::shared_ptr<DirectoryRecord> root;
+
+  // If `true`, the iterator will automatically descend into subdirectories as they are discovered.
+  bool recursive;
+
+  // `EventClass` bits describing the changes that the channel has asked to hear about.
+  EventMask events;
+
+  // Patterns that prune entries from the traversal. May be null.
+  std::shared_ptr<const PathMatcher> exclusions;
+
+  // Rules read from `.gitignore` files within the polled tree. May be null.
+  std::unique_ptr<GitIgnore> gitignore;
+
+  // Position of the complete scan.
+  Visit cold;
+
+  // A queue of subdirectories for the complete scan to traverse next, each with its full path. Populated by
+  // `BoundPollingIterator::advance_entry()` in the `ENTRIES` phase.
+  std::queue<std::pair<std::shared_ptr<DirectoryRecord>, std::string>> directories;
+
+  // Position of the hot pass. Its `phase` is `SCAN` between directories.
+  Visit hot;
+
+  // Directories assigned to a hot tier, with their full paths, in the order that they were promoted.
+  std::vector<std::pair<std::weak_ptr<DirectoryRecord>, std::string>> hot_directories;
+
+  // Index within `hot_directories` of the next directory to consider during the current hot pass.
+  size_t hot_index;
+
+  // Count of hot passes begun, used to visit lower tiers on fewer of them.
+  size_t hot_pass_count;
+
+  // If `true`, a hot pass has been scheduled and hasn't yet finished.
+  bool hot_pass_due;
+
+  // Deletions and creations waiting to be matched as the two halves of a rename.
+  InodeJar renames;
+
+  // The snapshot that directories are restored from by their initial scan. May be null.
+  std::unique_ptr<PollingSnapshot> snapshot;
+
+  // Count of changes observed within populated directories.
+  size_t change_count;
+
+  // Count of complete scans that have reached the end of the tree.
+  size_t completed_scans;
 
   friend class BoundPollingIterator;
 
@@ -69,16 +169,18 @@ private:
   friend std::ostream &operator<<(std::ostream &out, const PollingIterator &iterator)
   {
     out << "PollingIterator{at ";
-    out << iterator.current_path;
+    out << iterator.cold.current_path;
     out << " phase=";
-    switch (iterator.phase) {
+    switch (iterator.cold.phase) {
       case SCAN: out << "SCAN"; break;
       case ENTRIES: out << "ENTRIES"; break;
       case RESET: out << "RESET"; break;
-      default: out << "!!phase=" << iterator.phase; break;
+      default: out << "!!phase=" << iterator.cold.phase; break;
     }
-    out << " entries=" << iterator.entries.size();
+    out << " entries=" << iterator.cold.entries.size();
     out << " directories=" << iterator.directories.size();
+    out << " hot=" << iterator.hot_directories.size();
+    if (iterator.hot_pass_due) out << " hot pass due";
     out << "}";
     return out;
   }
@@ -101,20 +203,72 @@ public:
   BoundPollingIterator &operator=(BoundPollingIterator &&) = delete;
 
   // Called from `DirectoryRecord::scan()` to make note of an entry within the current directory.
-  void push_entry(std::string &&entry, EntryKind kind) { iterator.entries.emplace_back(std::move(entry), kind); }
+  void push_entry(std::string &&entry, EntryKind kind) { visit->entries.emplace_back(std::move(entry), kind); }
 
-  // Called from `DirectoryRecord::entry()` when a subdirectory is encountered to enqueue it for traversal.
-  void push_directory(const std::shared_ptr<DirectoryRecord> &subdirectory)
+  // Called from `DirectoryRecord::scan()` once every entry has been pushed. Sort the entries of the current directory
+  // by name, if `scandir()` didn't already, and return them. Entries removed from the vector won't be visited.
+  std::vector<Entry> &sorted_entries();
+
+  // Called from `DirectoryRecord::entry()` when a subdirectory is encountered to enqueue it for traversal. During a
+  // hot pass, a subdirectory that hasn't been populated yet is promoted to the top tier instead, so that its initial
+  // scan isn't put off until the complete scan reaches it.
+  void push_directory(const std::shared_ptr<DirectoryRecord> &subdirectory, std::string &&subdirectory_path);
+
+  // Access the full path of the directory being scanned or visited.
+  const std::string &get_current_path() { return visit->current_path; }
+
+  // Construct the full path of an entry within the current directory.
+  std::string entry_path(const std::string &entry_name) { return path_join(visit->current_path, entry_name); }
+
+  // Perform an `lstat()` on an entry within the current directory, relative to its open handle. Return 0 on success
+  // or a libuv error code.
+  int lstat_entry(const std::string &entry_name, StatFingerprint &fingerprint)
   {
-    if (iterator.recursive) iterator.directories.push(subdirectory);
+    return visit->current_handle.lstat(entry_name, fingerprint);
   }
 
+  // Fingerprint the current directory itself through its open handle. Return 0 on success or a libuv error code.
+  int stat_current(StatFingerprint &fingerprint) { return visit->current_handle.stat(fingerprint); }
+
   // Access the message buffer to emit events from other classes.
   ChannelMessageBuffer &get_buffer() { return buffer; }
 
+  // Called from `DirectoryRecord::scan()` before the initial scan of a directory that was present when the iterator's
+  // snapshot was written. Fill `entries` with the entries that the snapshot recorded for the current directory. Return
+  // `false` if there's no snapshot or it doesn't record this directory.
+  bool restore_entries(EntryTable &entries)
+  {
+    return iterator.snapshot && iterator.snapshot->load_directory(visit->current_path, entries);
+  }
+
+  // Access the `InodeJar` used to correlate deletions and creations as renames.
+  InodeJar &get_renames() { return iterator.renames; }
+
   // Allow the `DirectoryRecord` to determine whether or not this iteration is recursive.
   bool is_recursive() { return iterator.recursive; }
 
+  // Allow the `DirectoryRecord` to determine whether or not the channel is interested in any of a set of event classes.
+  bool accepts(EventMask event_classes) { return (iterator.events & event_classes) != 0; }
+
+  // Return `true` if the channel only cares about entries appearing and disappearing. Directories are then only listed
+  // again when their own modification or change times move, and entries that are already known aren't stated at all.
+  bool is_structure_only() { return !accepts(EVENT_MODIFIED | EVENT_SETTLED | EVENT_ATTRIBUTES); }
+
+  // Return `true` if `.gitignore` files within the tree are being honored.
+  bool has_gitignore() { return iterator.gitignore != nullptr; }
+
+  // Allow the `DirectoryRecord` to skip entries within the current directory that have been excluded from the channel.
+  // The entry's full path is assembled within a buffer that's reused for every entry, rather than allocated for each.
+  bool is_excluded(const std::string &entry_name, EntryKind kind);
+
+  // Return `true` if any entries may be excluded, so that callers can avoid constructing paths needlessly.
+  bool has_exclusions() { return iterator.exclusions != nullptr || iterator.gitignore != nullptr; }
+
+  // Called from `DirectoryRecord::entry()` when an entry is found to have been created, modified, or deleted, in case
+  // it's a `.gitignore` file whose rules need to be read again. Promotes the current directory to the top tier once
+  // it's been populated.
+  void entry_changed(const std::string &entry_path);
+
   // Perform at most `throttle_allocation` filesystem operations, emitting events and updating records appropriately. If
   // the end of the filesystem tree is reached, the iteration will stop and leave the `PollingIterator` ready to resume
   // at the root on the next call.
@@ -122,6 +276,11 @@ public:
   // Return the number of operations actually performed.
   size_t advance(size_t throttle_allocation);
 
+  // Perform at most `throttle_allocation` filesystem operations to continue a hot pass scheduled by
+  // `PollingIterator::begin_hot_pass()`. Return the number of operations actually performed, which is zero if no pass
+  // is due.
+  size_t advance_hot(size_t throttle_allocation);
+
 private:
   // Scan the current directory with `DirectoryRecord::scan()`, populating our iterator's `entries` map. Leave the
   // iterator ready to advance through the discovered entries.
@@ -129,12 +288,27 @@ private:
 
   // Perform a single stat call with `DirectoryRecord::entry()`. Advance the `current_entry`. If no more entries
   // remain, pop the next `DirectoryRecord` from the queue. If the queue is empty, reset the iterator back to its
-  // root.
+  // root. During a hot pass, move on to the next hot directory instead.
   void advance_entry();
 
+  // Choose the next directory for the hot pass to visit. Return `false` if the pass is complete.
+  bool next_hot_directory();
+
+  // Assign a directory to the top tier.
+  void promote(const std::shared_ptr<DirectoryRecord> &directory, const std::string &directory_path);
+
+  // Lower each hot directory by one tier at the end of a complete scan, returning those that reach tier zero to the
+  // cold tier.
+  void cool_down();
+
+  bool in_hot_pass() const { return visit == &iterator.hot; }
+
   ChannelMessageBuffer &buffer;
   PollingIterator &iterator;
 
+  // The traversal being advanced: either the iterator's complete scan or its hot pass.
+  PollingIterator::Visit *visit;
+
   friend std::ostream &operator<<(std::ostream &out, const BoundPollingIterator &it)
   {
     return out << "Bound{channel=" << it.buffer.get_channel_id() << " " << it.iterator << "}";
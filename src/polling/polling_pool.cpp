@@ -0,0 +1,261 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <uv.h>
+#include <vector>
+
+#include "../lock.h"
+#include "../log.h"
+#include "../message_buffer.h"
+#include "../result.h"
+#include "../trace.h"
+#include "polled_root.h"
+#include "polling_pool.h"
+
+using std::endl;
+using std::move;
+using std::unique_ptr;
+using std::vector;
+using std::chrono::duration_cast;
+using std::chrono::nanoseconds;
+using std::chrono::steady_clock;
+
+// Number of quanta that the throttle is divided into for each root. Smaller quanta spread work more evenly among
+// workers at the cost of more frequent trips through the lane locks.
+static const size_t QUANTA_PER_ROOT = 4;
+
+PollingPool::PollingPool() :
+  worker_count{1},
+  budget{0},
+  performed{0},
+  quantum{1},
+  time_budget{0},
+  time_quantum{0},
+  spent{0},
+  generation{0},
+  participants{0},
+  active{0},
+  stopping{false}
+{
+  lanes.emplace_back(new Lane());
+
+  uv_mutex_init(&mutex);
+  uv_cond_init(&cycle_started);
+  uv_cond_init(&cycle_finished);
+}
+
+PollingPool::~PollingPool()
+{
+  stop();
+
+  uv_cond_destroy(&cycle_finished);
+  uv_cond_destroy(&cycle_started);
+  uv_mutex_destroy(&mutex);
+}
+
+Result<size_t> PollingPool::cycle(const vector<PolledRoot *> &roots,
+  size_t throttle,
+  nanoseconds time_budget,
+  MessageBuffer &buffer)
+{
+  if (roots.empty()) return ok_result(static_cast<size_t>(0));
+
+  size_t workers = std::min(worker_count, roots.size());
+  Result<> hr = ensure_helpers(workers - 1);
+  if (hr.is_error()) {
+    LOGGER << "Unable to start polling helper thread: " << hr << ". Continuing with "
+           << plural(helpers.size() + 1, "worker") << "." << endl;
+    workers = std::min(workers, helpers.size() + 1);
+  }
+
+  vector<unique_ptr<Task>> tasks;
+  tasks.reserve(roots.size());
+  for (size_t i = 0; i < roots.size(); i++) {
+    tasks.emplace_back(new Task(roots[i]));
+    lanes[i % workers]->tasks.push_back(tasks.back().get());
+  }
+
+  budget = throttle;
+  performed = 0;
+  quantum = std::max(throttle / (roots.size() * QUANTA_PER_ROOT), static_cast<size_t>(1));
+  this->time_budget = time_budget;
+  time_quantum = time_budget / (roots.size() * QUANTA_PER_ROOT);
+  spent = 0;
+
+  {
+    Lock lock(mutex);
+    generation++;
+    participants = workers - 1;
+    active = participants;
+    uv_cond_broadcast(&cycle_started);
+  }
+
+  work(0);
+
+  {
+    Lock lock(mutex);
+    while (active > 0) {
+      uv_cond_wait(&cycle_finished, &mutex);
+    }
+  }
+
+  for (unique_ptr<Task> &task : tasks) {
+    for (Message &message : task->buffer) {
+      buffer.add(move(message));
+    }
+  }
+
+  size_t total = performed;
+  return ok_result(move(total));
+}
+
+void PollingPool::stop()
+{
+  if (helpers.empty()) return;
+
+  {
+    Lock lock(mutex);
+    stopping = true;
+    uv_cond_broadcast(&cycle_started);
+  }
+
+  for (uv_thread_t &helper : helpers) {
+    uv_thread_join(&helper);
+  }
+  helpers.clear();
+  helper_starts.clear();
+
+  Lock lock(mutex);
+  stopping = false;
+}
+
+Result<> PollingPool::ensure_helpers(size_t count)
+{
+  while (lanes.size() < count + 1) {
+    lanes.emplace_back(new Lane());
+  }
+
+  while (helpers.size() < count) {
+    unique_ptr<HelperStart> start(new HelperStart{this, helpers.size() + 1, generation});
+
+    uv_thread_t helper{};
+    int err = uv_thread_create(&helper, helper_callback, start.get());
+    if (err != 0) return error_result(uv_strerror(err));
+
+    helpers.push_back(helper);
+    helper_starts.push_back(move(start));
+  }
+
+  return ok_result();
+}
+
+void PollingPool::helper_callback(void *arg)
+{
+  auto *start = static_cast<HelperStart *>(arg);
+  start->pool->helper_main(start->lane, start->generation);
+}
+
+void PollingPool::helper_main(size_t lane, uint_fast64_t seen)
+{
+  Tracer::name_thread("polling helper " + std::to_string(lane));
+
+  uv_mutex_lock(&mutex);
+  while (true) {
+    while (!stopping && generation == seen) {
+      uv_cond_wait(&cycle_started, &mutex);
+    }
+    if (stopping) break;
+
+    seen = generation;
+    if (lane > participants) continue;
+
+    uv_mutex_unlock(&mutex);
+    work(lane);
+    uv_mutex_lock(&mutex);
+
+    active--;
+    if (active == 0) uv_cond_signal(&cycle_finished);
+  }
+  uv_mutex_unlock(&mutex);
+}
+
+void PollingPool::work(size_t lane)
+{
+  Task *task = nullptr;
+  while ((task = take(lane)) != nullptr) {
+    size_t slots = claim(quantum_for(*task->root));
+
+    // Once the budget is spent, roots that have already had their turn wait for the next cycle.
+    if (slots == 0 && task->advanced) continue;
+
+    steady_clock::time_point start = steady_clock::now();
+    size_t progress = 0;
+    {
+      TRACE_SPAN("PolledRoot::advance");
+      progress = task->root->advance(task->buffer, slots);
+    }
+    nanoseconds elapsed = duration_cast<nanoseconds>(steady_clock::now() - start);
+    task->root->record_latency(progress, elapsed);
+    spent += elapsed.count();
+    task->advanced = true;
+    performed += progress;
+    if (progress < slots) budget += slots - progress;
+
+    if (!task->root->is_at_scan_start()) give(lane, task);
+  }
+}
+
+PollingPool::Task *PollingPool::take(size_t lane)
+{
+  {
+    Lane &own = *lanes[lane];
+    Lock lock(own.mutex);
+    if (!own.tasks.empty()) {
+      Task *task = own.tasks.front();
+      own.tasks.pop_front();
+      return task;
+    }
+  }
+
+  size_t lane_count = participants + 1;
+  for (size_t offset = 1; offset < lane_count; offset++) {
+    Lane &other = *lanes[(lane + offset) % lane_count];
+    Lock lock(other.mutex);
+    if (!other.tasks.empty()) {
+      Task *task = other.tasks.back();
+      other.tasks.pop_back();
+      return task;
+    }
+  }
+
+  return nullptr;
+}
+
+void PollingPool::give(size_t lane, Task *task)
+{
+  Lane &own = *lanes[lane];
+  Lock lock(own.mutex);
+  own.tasks.push_back(task);
+}
+
+size_t PollingPool::claim(size_t slots)
+{
+  if (time_budget.count() > 0 && spent.load() >= time_budget.count()) return 0;
+
+  size_t available = budget.load();
+  while (available > 0) {
+    size_t claimed = std::min(available, slots);
+    if (budget.compare_exchange_weak(available, available - claimed)) return claimed;
+  }
+  return 0;
+}
+
+size_t PollingPool::quantum_for(const PolledRoot &root) const
+{
+  if (time_budget.count() <= 0) return quantum;
+  return root.operations_within(time_quantum);
+}
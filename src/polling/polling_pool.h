@@ -0,0 +1,163 @@
+#ifndef POLLING_POOL_H
+#define POLLING_POOL_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <uv.h>
+#include <vector>
+
+#include "../message_buffer.h"
+#include "../result.h"
+#include "polled_root.h"
+
+// Advance many `PolledRoots` concurrently within a single polling cycle.
+//
+// The polling thread itself is always the first worker. Additional helper threads are started as they're needed and
+// parked between cycles. Each worker owns a deque of roots to advance. It advances the root at the front of its own
+// deque by a small quantum of throttle slots, then returns it to the back if its scan isn't finished. A worker whose
+// deque is empty steals from the back of another worker's, so a root on a slow filesystem only ever occupies one worker
+// while the others drain the remaining roots.
+//
+// The throttle is a single budget shared by every worker: quanta are claimed from it atomically and any unused slots
+// are returned to it. Each root is guaranteed at least one operation per cycle, as it was when the throttle was
+// divided evenly among roots.
+//
+// A cycle may instead be limited by the total time that workers spend advancing roots. Each root's quanta are then
+// sized from its own recently measured latency, so that a root on a slow network filesystem performs fewer operations
+// in the same share of time as a root on a local disk.
+//
+// A root is only ever advanced by one worker at a time, so `PolledRoot`, its `DirectoryRecords` and its `GitIgnore`
+// need no locking of their own. Helper threads log through the default null logger.
+class PollingPool
+{
+public:
+  PollingPool();
+
+  // Stop and join any helper threads.
+  ~PollingPool();
+
+  // Set the maximum number of workers, including the polling thread, that may advance roots concurrently.
+  void set_worker_count(size_t count) { worker_count = count > 0 ? count : 1; }
+
+  size_t get_worker_count() const { return worker_count; }
+
+  // Perform a single polling cycle over `roots`, performing roughly `throttle` filesystem operations in total. If
+  // `time_budget` is nonzero, the cycle also ends once workers have spent that long advancing roots between them.
+  // Events are appended to `buffer` grouped by root, in the order that the roots were given. Return the number of
+  // operations actually performed.
+  Result<size_t> cycle(const std::vector<PolledRoot *> &roots,
+    size_t throttle,
+    std::chrono::nanoseconds time_budget,
+    MessageBuffer &buffer);
+
+  // Stop and join any helper threads. They'll be started again by the next call to `cycle()` that needs them.
+  void stop();
+
+  PollingPool(const PollingPool &) = delete;
+  PollingPool(PollingPool &&) = delete;
+  PollingPool &operator=(const PollingPool &) = delete;
+  PollingPool &operator=(PollingPool &&) = delete;
+
+private:
+  // A root to advance during the current cycle, along with the events that it's produced so far.
+  struct Task
+  {
+    explicit Task(PolledRoot *root) : root{root} {}
+
+    PolledRoot *root;
+    MessageBuffer buffer;
+    bool advanced{false};
+  };
+
+  // Tasks waiting to be advanced by a single worker.
+  struct Lane
+  {
+    Lane() { uv_mutex_init(&mutex); }
+    ~Lane() { uv_mutex_destroy(&mutex); }
+
+    Lane(const Lane &) = delete;
+    Lane(Lane &&) = delete;
+    Lane &operator=(const Lane &) = delete;
+    Lane &operator=(Lane &&) = delete;
+
+    uv_mutex_t mutex{};
+    std::deque<Task *> tasks;
+  };
+
+  struct HelperStart
+  {
+    PollingPool *pool;
+    size_t lane;
+
+    // The most recent cycle to begin before the helper was started.
+    uint_fast64_t generation;
+  };
+
+  // Start helper threads until `count` are running.
+  Result<> ensure_helpers(size_t count);
+
+  // Main loop of each helper thread: wait for a cycle after `seen` to begin, work through it, and report completion.
+  void helper_main(size_t lane, uint_fast64_t seen);
+
+  static void helper_callback(void *arg);
+
+  // Advance tasks from `lane`, or stolen from other lanes, until none remain.
+  void work(size_t lane);
+
+  // Remove the next `Task` for a worker on `lane`. Return null when every lane is empty.
+  Task *take(size_t lane);
+
+  // Return a `Task` to the back of `lane`.
+  void give(size_t lane, Task *task);
+
+  // Atomically reserve up to `slots` throttle slots from the cycle's budget. Return the number reserved, which is zero
+  // once either the throttle or the time budget is exhausted.
+  size_t claim(size_t slots);
+
+  // Choose the number of throttle slots to claim for the next advance of `root`.
+  size_t quantum_for(const PolledRoot &root) const;
+
+  size_t worker_count;
+
+  std::vector<std::unique_ptr<Lane>> lanes;
+  std::vector<uv_thread_t> helpers;
+  std::vector<std::unique_ptr<HelperStart>> helper_starts;
+
+  // Throttle slots that remain unclaimed during the current cycle.
+  std::atomic<size_t> budget;
+
+  // Throttle slots performed during the current cycle.
+  std::atomic<size_t> performed;
+
+  // Throttle slots claimed by a worker at a time.
+  size_t quantum;
+
+  // Total time that workers may spend advancing roots during the current cycle, or zero for no limit.
+  std::chrono::nanoseconds time_budget;
+
+  // Time that each root should be advanced for at a time, when `time_budget` is set.
+  std::chrono::nanoseconds time_quantum;
+
+  // Nanoseconds spent advancing roots during the current cycle, summed over every worker.
+  std::atomic<int_fast64_t> spent;
+
+  // Coordinates the start and completion of each cycle between the polling thread and its helpers.
+  uv_mutex_t mutex{};
+  uv_cond_t cycle_started{};
+  uv_cond_t cycle_finished{};
+  uint_fast64_t generation;
+  size_t participants;
+  size_t active;
+  bool stopping;
+
+  friend std::ostream &operator<<(std::ostream &out, const PollingPool &pool)
+  {
+    return out << "PollingPool{workers=" << pool.worker_count << " helpers=" << pool.helpers.size() << "}";
+  }
+};
+
+#endif
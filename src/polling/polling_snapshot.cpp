@@ -0,0 +1,281 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <uv.h>
+#include <vector>
+
+#ifndef PLATFORM_WINDOWS
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "../helper/libuv.h"
+#include "../result.h"
+#include "entry_table.h"
+#include "polling_snapshot.h"
+
+using std::ifstream;
+using std::move;
+using std::ofstream;
+using std::ostringstream;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+static const char SNAPSHOT_MAGIC[8] = {'w', 'a', 't', 'c', 'h', 's', 'n', 'p'};
+
+// Incremented whenever the layout of the file changes.
+static const uint32_t SNAPSHOT_VERSION = 1;
+
+// Read back as a different value on a machine with the opposite byte order.
+static const uint32_t SNAPSHOT_BYTE_ORDER = 0x01020304;
+
+struct SnapshotHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint64_t directory_count;
+  uint64_t entry_count;
+
+  // Bytes of packed paths and names. The root path comes first.
+  uint64_t strings_length;
+  uint64_t root_length;
+};
+
+// Order directories by the bytes of their relative paths.
+static int compare_paths(const char *left, size_t left_length, const char *right, size_t right_length)
+{
+  int c = std::memcmp(left, right, std::min(left_length, right_length));
+  if (c != 0) return c;
+  if (left_length == right_length) return 0;
+  return left_length < right_length ? -1 : 1;
+}
+
+PollingSnapshot::Builder::Builder(const string &root_path) : root_path(root_path)
+{
+  strings.append(root_path);
+}
+
+void PollingSnapshot::Builder::add_directory(const string &directory_path, const EntryTable &table)
+{
+  if (directory_path.compare(0, root_path.size(), root_path) != 0) return;
+
+  Directory directory{strings.size(),
+    static_cast<uint32_t>(directory_path.size() - root_path.size()),
+    static_cast<uint32_t>(table.size()),
+    entries.size()};
+  strings.append(directory_path, root_path.size(), string::npos);
+  directories.push_back(directory);
+
+  table.for_each_named([this](const string &name, const StatFingerprint &fingerprint) {
+    Entry entry{fingerprint.ino,
+      fingerprint.size,
+      fingerprint.mtime,
+      fingerprint.ctime,
+      fingerprint.mode,
+      static_cast<uint32_t>(name.size()),
+      strings.size()};
+    strings.append(name);
+    entries.push_back(entry);
+  });
+}
+
+Result<> PollingSnapshot::Builder::write(const string &path)
+{
+  std::sort(directories.begin(), directories.end(), [this](const Directory &left, const Directory &right) {
+    return compare_paths(strings.data() + left.path_offset,
+             left.path_length,
+             strings.data() + right.path_offset,
+             right.path_length)
+      < 0;
+  });
+
+  SnapshotHeader header{};
+  std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+  header.version = SNAPSHOT_VERSION;
+  header.byte_order = SNAPSHOT_BYTE_ORDER;
+  header.directory_count = directories.size();
+  header.entry_count = entries.size();
+  header.strings_length = strings.size();
+  header.root_length = root_path.size();
+
+  string temp_path(path + ".tmp");
+  {
+    ofstream out(temp_path, std::ios::out | std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(directories.data()), directories.size() * sizeof(Directory));
+    out.write(reinterpret_cast<const char *>(entries.data()), entries.size() * sizeof(Entry));
+    out.write(strings.data(), strings.size());
+    out.close();
+
+    if (!out) {
+      ostringstream msg;
+      msg << "Unable to write polling snapshot " << temp_path;
+      return error_result(msg.str());
+    }
+  }
+
+  FSReq rename_req;
+  int err = uv_fs_rename(nullptr, &rename_req.req, temp_path.c_str(), path.c_str(), nullptr);
+  if (err != 0) {
+    ostringstream msg;
+    msg << "Unable to replace polling snapshot " << path << ": " << uv_strerror(err);
+    return error_result(msg.str());
+  }
+
+  return ok_result();
+}
+
+unique_ptr<PollingSnapshot> PollingSnapshot::open(const string &path, const string &root_path)
+{
+  unique_ptr<PollingSnapshot> snapshot;
+
+#ifdef PLATFORM_WINDOWS
+  ifstream in(path, std::ios::in | std::ios::binary | std::ios::ate);
+  if (!in) return snapshot;
+
+  std::streamoff length = in.tellg();
+  if (length < static_cast<std::streamoff>(sizeof(SnapshotHeader))) return snapshot;
+
+  unique_ptr<char[]> data(new char[static_cast<size_t>(length)]);
+  in.seekg(0);
+  if (!in.read(data.get(), length)) return snapshot;
+
+  snapshot.reset(new PollingSnapshot(string(root_path), data.release(), static_cast<size_t>(length), false));
+#else
+  int fd = -1;
+  do {
+    fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  } while (fd == -1 && errno == EINTR);
+  if (fd == -1) return snapshot;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(SnapshotHeader))) {
+    ::close(fd);
+    return snapshot;
+  }
+
+  size_t length = static_cast<size_t>(st.st_size);
+  void *data = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED) return snapshot;
+
+  snapshot.reset(new PollingSnapshot(string(root_path), static_cast<const char *>(data), length, true));
+#endif
+
+  if (!snapshot->validate()) snapshot.reset();
+  return snapshot;
+}
+
+PollingSnapshot::PollingSnapshot(string &&root_path, const char *data, size_t length, bool mapped) :
+  root_path(move(root_path)), data{data}, length{length}, mapped{mapped}
+{
+  //
+}
+
+PollingSnapshot::~PollingSnapshot()
+{
+#ifndef PLATFORM_WINDOWS
+  if (mapped) {
+    munmap(const_cast<char *>(data), length);
+    return;
+  }
+#endif
+  delete[] data;
+}
+
+bool PollingSnapshot::validate() const
+{
+  const auto *header = reinterpret_cast<const SnapshotHeader *>(data);
+  if (std::memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) return false;
+  if (header->version != SNAPSHOT_VERSION || header->byte_order != SNAPSHOT_BYTE_ORDER) return false;
+
+  // Guard against overflow before computing the expected size.
+  uint64_t available = length - sizeof(SnapshotHeader);
+  if (header->directory_count > available / sizeof(Directory)) return false;
+  available -= header->directory_count * sizeof(Directory);
+  if (header->entry_count > available / sizeof(Entry)) return false;
+  available -= header->entry_count * sizeof(Entry);
+  if (header->strings_length != available) return false;
+
+  if (header->root_length != root_path.size() || header->strings_length < root_path.size()) return false;
+  return root_path.compare(0, string::npos, strings(), root_path.size()) == 0;
+}
+
+const PollingSnapshot::Directory *PollingSnapshot::directories() const
+{
+  return reinterpret_cast<const Directory *>(data + sizeof(SnapshotHeader));
+}
+
+const PollingSnapshot::Entry *PollingSnapshot::entries() const
+{
+  return reinterpret_cast<const Entry *>(directories() + directory_count());
+}
+
+const char *PollingSnapshot::strings() const
+{
+  const auto *header = reinterpret_cast<const SnapshotHeader *>(data);
+  return reinterpret_cast<const char *>(entries() + header->entry_count);
+}
+
+size_t PollingSnapshot::directory_count() const
+{
+  return static_cast<size_t>(reinterpret_cast<const SnapshotHeader *>(data)->directory_count);
+}
+
+bool PollingSnapshot::load_directory(const string &directory_path, EntryTable &into) const
+{
+  if (directory_path.compare(0, root_path.size(), root_path) != 0) return false;
+
+  const auto *header = reinterpret_cast<const SnapshotHeader *>(data);
+  const char *relative = directory_path.data() + root_path.size();
+  size_t relative_length = directory_path.size() - root_path.size();
+
+  const Directory *begin = directories();
+  const Directory *end = begin + directory_count();
+  const char *base = strings();
+  uint64_t strings_length = header->strings_length;
+
+  // Entries with out of range offsets can only come from a damaged file. Treat them as missing.
+  auto in_strings = [strings_length](uint64_t offset, uint64_t count) {
+    return offset <= strings_length && count <= strings_length - offset;
+  };
+
+  const Directory *found = std::lower_bound(begin, end, relative, [&](const Directory &directory, const char *) {
+    if (!in_strings(directory.path_offset, directory.path_length)) return false;
+    return compare_paths(base + directory.path_offset, directory.path_length, relative, relative_length) < 0;
+  });
+  if (found == end || !in_strings(found->path_offset, found->path_length)) return false;
+  if (compare_paths(base + found->path_offset, found->path_length, relative, relative_length) != 0) return false;
+
+  if (found->first_entry > header->entry_count || found->entry_count > header->entry_count - found->first_entry) {
+    return false;
+  }
+
+  string name;
+  const Entry *entry = entries() + found->first_entry;
+  for (uint32_t i = 0; i < found->entry_count; i++, entry++) {
+    if (!in_strings(entry->name_offset, entry->name_length)) continue;
+
+    StatFingerprint fingerprint;
+    fingerprint.ino = entry->ino;
+    fingerprint.size = entry->size;
+    fingerprint.mtime = entry->mtime;
+    fingerprint.ctime = entry->ctime;
+    fingerprint.mode = entry->mode;
+
+    name.assign(base + entry->name_offset, entry->name_length);
+    into.put(name, fingerprint);
+  }
+
+  return true;
+}
@@ -0,0 +1,123 @@
+#ifndef POLLING_SNAPSHOT_H
+#define POLLING_SNAPSHOT_H
+
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../result.h"
+#include "entry_table.h"
+
+// A read-only view of the `DirectoryRecord` tree of a `PolledRoot` as it was last written to disk.
+//
+// A root that's polled again after a restart compares each directory against the snapshot the first time it's
+// visited, rather than silently populating its records, so changes made while nothing was watching are reported. The
+// file is mapped into memory where the platform allows it and each directory's entries are copied out only when that
+// directory is reached, so opening even a large snapshot costs a few validity checks.
+//
+// The file consists of a fixed header, a table of directories sorted by their path relative to the root, a table of
+// entries grouped by directory and sorted by name within each, and a block of packed path and name bytes. Integers are
+// stored in native byte order; a snapshot written on a machine with a different byte order is ignored.
+class PollingSnapshot
+{
+public:
+  // Collect the directories of a `DirectoryRecord` tree to be written with `PollingSnapshot::write()`.
+  class Builder
+  {
+  public:
+    // Begin a snapshot of the tree beneath the absolute path `root_path`.
+    explicit Builder(const std::string &root_path);
+
+    // Record the entries of the directory at the absolute path `directory_path`, which must lie within the root.
+    void add_directory(const std::string &directory_path, const EntryTable &entries);
+
+    // Write the collected directories to `path`. The file is written beside `path` first, then renamed over it, so
+    // that readers never see a partial snapshot.
+    Result<> write(const std::string &path);
+
+    // Count the directories collected so far.
+    size_t directory_count() const { return directories.size(); }
+
+    Builder(const Builder &) = delete;
+    Builder(Builder &&) = delete;
+    ~Builder() = default;
+    Builder &operator=(const Builder &) = delete;
+    Builder &operator=(Builder &&) = delete;
+
+  private:
+    std::string root_path;
+
+    struct Directory
+    {
+      uint64_t path_offset;
+      uint32_t path_length;
+      uint32_t entry_count;
+      uint64_t first_entry;
+    };
+
+    struct Entry
+    {
+      uint64_t ino;
+      uint64_t size;
+      int64_t mtime;
+      int64_t ctime;
+      uint32_t mode;
+      uint32_t name_length;
+      uint64_t name_offset;
+    };
+
+    std::vector<Directory> directories;
+    std::vector<Entry> entries;
+    std::string strings;
+
+    friend class PollingSnapshot;
+  };
+
+  // Open the snapshot at `path` if it exists and was written for the tree at `root_path`. Return null if it doesn't
+  // exist, or if it's unreadable, truncated, or was written for a different root or by an incompatible version.
+  static std::unique_ptr<PollingSnapshot> open(const std::string &path, const std::string &root_path);
+
+  // Release the mapping.
+  ~PollingSnapshot();
+
+  // Fill `into` with the entries recorded for the directory at the absolute path `directory_path`. Return `false`,
+  // leaving `into` untouched, if the snapshot doesn't include that directory.
+  bool load_directory(const std::string &directory_path, EntryTable &into) const;
+
+  // Count the directories recorded within the snapshot.
+  size_t directory_count() const;
+
+  PollingSnapshot(const PollingSnapshot &) = delete;
+  PollingSnapshot(PollingSnapshot &&) = delete;
+  PollingSnapshot &operator=(const PollingSnapshot &) = delete;
+  PollingSnapshot &operator=(PollingSnapshot &&) = delete;
+
+private:
+  PollingSnapshot(std::string &&root_path, const char *data, size_t length, bool mapped);
+
+  // Check that the header and tables lie within the file. Return `false` if the snapshot should be ignored.
+  bool validate() const;
+
+  using Directory = Builder::Directory;
+  using Entry = Builder::Entry;
+
+  const Directory *directories() const;
+  const Entry *entries() const;
+  const char *strings() const;
+
+  std::string root_path;
+
+  // The contents of the file, either mapped or read into a heap allocation.
+  const char *data;
+  size_t length;
+  bool mapped;
+
+  friend std::ostream &operator<<(std::ostream &out, const PollingSnapshot &snapshot)
+  {
+    return out << "PollingSnapshot{root=" << snapshot.root_path << " bytes=" << snapshot.length << "}";
+  }
+};
+
+#endif
@@ -1,19 +1,27 @@
+#include <algorithm>
 #include <chrono>
 #include <cstdint>
 #include <iostream>
 #include <map>
 #include <memory>
 #include <string>
-#include <thread>
 #include <utility>
 #include <uv.h>
 #include <vector>
 
+#include "../channel_stats.h"
+#include "../helper/common.h"
+#include "../helper/libuv.h"
+#include "../latency_histogram.h"
+#include "../lock.h"
 #include "../log.h"
 #include "../message_buffer.h"
+#include "../metrics.h"
+#include "../probes.h"
 #include "../result.h"
 #include "../status.h"
 #include "../thread.h"
+#include "../trace.h"
 #include "polled_root.h"
 #include "polling_thread.h"
 
@@ -24,13 +32,38 @@ using std::string;
 using std::to_string;
 using std::unique_ptr;
 using std::vector;
+using std::chrono::duration_cast;
+using std::chrono::nanoseconds;
+using std::chrono::steady_clock;
+
+// Weight given to each new throughput measurement.
+static const double THROUGHPUT_SMOOTHING = 0.25;
+
+// Throttle given to the pool when only a time budget should limit each cycle.
+static const size_t UNTHROTTLED = static_cast<size_t>(-1) / 2;
 
 PollingThread::PollingThread(uv_async_t *main_callback) :
-  Thread("polling thread", main_callback), poll_interval{DEFAULT_POLL_INTERVAL}, poll_throttle{DEFAULT_POLL_THROTTLE}
+  Thread("polling thread", main_callback),
+  poll_interval{DEFAULT_POLL_INTERVAL},
+  poll_throttle{DEFAULT_POLL_THROTTLE},
+  poll_hot_share{DEFAULT_POLL_HOT_SHARE},
+  poll_budget{DEFAULT_POLL_BUDGET},
+  throughput{0},
+  last_cycle_operations{0},
+  woken{false}
 {
+  uv_mutex_init(&wake_mutex);
+  uv_cond_init(&wake_cond);
+  pool.set_worker_count(DEFAULT_POLL_WORKERS);
   freeze();
 }
 
+PollingThread::~PollingThread()
+{
+  uv_cond_destroy(&wake_cond);
+  uv_mutex_destroy(&wake_mutex);
+}
+
 Result<> PollingThread::init()
 {
   Logger::from_env("WATCHER_LOG_POLLING");
@@ -40,52 +73,128 @@ Result<> PollingThread::init()
 
 Result<> PollingThread::body()
 {
-  while (true) {
-    Timer t;
+  next_cycle = steady_clock::now();
+  last_cycle_start = steady_clock::time_point();
+  throughput = 0;
 
-    LOGGER << "Handling commands." << endl;
+  while (true) {
+    LOG_AT(LOG_LEVEL_DEBUG, LOG_POLLING) << "Handling commands." << endl;
     Result<size_t> cr = handle_commands();
     if (cr.is_error()) {
       LOGGER << "Unable to process incoming commands: " << cr << endl;
     } else if (is_stopping()) {
       LOGGER << "Polling thread stopping." << endl;
+      pool.stop();
       return ok_result();
     }
 
-    Result<> r = cycle();
-    if (r.is_error()) {
-      LOGGER << "Polling cycle failure " << r << "." << endl;
-      return r.propagate_as_void();
+    if (steady_clock::now() >= next_cycle) {
+      Timer t;
+
+      uint64_t cycle_start = monotonic_ns();
+      WATCHER_PROBE1(poll_cycle_start, roots.size());
+      Result<> r = cycle();
+      WATCHER_PROBE2(poll_cycle_end, last_cycle_operations, monotonic_ns() - cycle_start);
+      cycle_durations.record_since(cycle_start);
+      if (r.is_error()) {
+        LOGGER << "Polling cycle failure " << r << "." << endl;
+        pool.stop();
+        return r.propagate_as_void();
+      }
+
+      t.stop();
+      schedule_next_cycle();
+      LOG_AT(LOG_LEVEL_DEBUG, LOG_POLLING)
+        << "Polling cycle complete in " << t << ". Next cycle in "
+        << duration_cast<std::chrono::milliseconds>(next_cycle - steady_clock::now()).count() << "ms." << endl;
     }
 
-    t.stop();
-    LOGGER << "Polling cycle complete in " << t << ". Sleeping for " << poll_interval.count() << "ms." << endl;
-    std::this_thread::sleep_for(poll_interval);
+    sleep_until_next_cycle();
   }
 }
 
+void PollingThread::schedule_next_cycle()
+{
+  steady_clock::time_point now = steady_clock::now();
+  if (poll_interval.count() <= 0) {
+    next_cycle = now;
+    return;
+  }
+
+  next_cycle += poll_interval;
+  if (next_cycle <= now) {
+    // The cycle overran one or more cadence points. Skip them instead of running cycles back to back.
+    next_cycle += poll_interval * ((now - next_cycle) / poll_interval + 1);
+  }
+}
+
+void PollingThread::sleep_until_next_cycle()
+{
+  Lock lock(wake_mutex);
+  while (!woken) {
+    steady_clock::time_point now = steady_clock::now();
+    if (now >= next_cycle) break;
+
+    uint64_t timeout = static_cast<uint64_t>(duration_cast<nanoseconds>(next_cycle - now).count());
+    uv_cond_timedwait(&wake_cond, &wake_mutex, timeout);
+  }
+  woken = false;
+}
+
+Result<> PollingThread::wake()
+{
+  Lock lock(wake_mutex);
+  woken = true;
+  uv_cond_signal(&wake_cond);
+  return ok_result();
+}
+
 Result<> PollingThread::cycle()
 {
+  TRACE_SPAN("PollingThread::cycle");
   MessageBuffer buffer;
-  size_t remaining = poll_throttle;
 
-  size_t roots_left = roots.size();
-  LOGGER << "Polling " << plural(roots_left, "root") << " with " << plural(poll_throttle, "throttle slot") << "."
-         << endl;
+  steady_clock::time_point start = steady_clock::now();
+  if (last_cycle_start != steady_clock::time_point()) {
+    double seconds = std::chrono::duration<double>(start - last_cycle_start).count();
+    if (seconds > 0) {
+      double sample = static_cast<double>(last_cycle_operations) / seconds;
+      throughput = throughput > 0 ? throughput + THROUGHPUT_SMOOTHING * (sample - throughput) : sample;
+    }
+  }
+  last_cycle_start = start;
 
+  vector<PolledRoot *> to_poll;
+  to_poll.reserve(roots.size());
   for (auto &it : roots) {
-    PolledRoot &root = it.second;
-    size_t allotment = remaining / roots_left;
+    it.second.begin_cycle(poll_hot_share);
+    to_poll.push_back(&it.second);
+  }
 
-    LOGGER << "Polling " << root << " with an allotment of " << plural(allotment, "throttle slot") << "." << endl;
+  size_t throttle = poll_throttle;
+  nanoseconds time_budget(0);
+  if (poll_budget > 0) {
+    // The time budget alone limits the cycle.
+    throttle = UNTHROTTLED;
+    time_budget = duration_cast<nanoseconds>(poll_interval) * poll_budget / 100;
+
+    LOG_AT(LOG_LEVEL_DEBUG, LOG_POLLING)
+      << "Polling " << plural(to_poll.size(), "root") << " for up to "
+      << duration_cast<std::chrono::microseconds>(time_budget).count() << "us among " << pool << "." << endl;
+  } else {
+    LOG_AT(LOG_LEVEL_DEBUG, LOG_POLLING) << "Polling " << plural(to_poll.size(), "root") << " with "
+                                         << plural(poll_throttle, "throttle slot") << " among " << pool << "." << endl;
+  }
 
-    size_t progress = root.advance(buffer, allotment);
-    remaining -= progress;
-    if (progress != allotment) {
-      LOGGER << root << " only consumed " << plural(progress, "throttle slot") << "." << endl;
-    }
+  Result<size_t> pr = pool.cycle(to_poll, throttle, time_budget, buffer);
+  if (pr.is_error()) return pr.propagate_as_void();
+  last_cycle_operations = pr.get_value();
+  Metrics::get().polling_operations.add(last_cycle_operations);
+  LOG_AT(LOG_LEVEL_DEBUG, LOG_POLLING) << "Consumed " << plural(pr.get_value(), "throttle slot") << "." << endl;
 
-    roots_left--;
+  for (PolledRoot *root : to_poll) {
+    root->end_cycle(buffer);
+    write_snapshot_if_due(*root, SNAPSHOT_INTERVAL);
   }
 
   // Ack any commands whose roots are now fully populated.
@@ -112,6 +221,28 @@ Result<> PollingThread::cycle()
   return emit_all(buffer.begin(), buffer.end());
 }
 
+void PollingThread::write_snapshot_if_due(PolledRoot &root, steady_clock::duration interval)
+{
+  steady_clock::time_point now = steady_clock::now();
+  if (!root.is_snapshot_due(now, interval)) return;
+
+  Timer t;
+  Result<> r = root.write_snapshot(now);
+  t.stop();
+
+  if (r.is_error()) {
+    LOG_AT(LOG_LEVEL_ERROR, LOG_POLLING) << "Unable to write snapshot of " << root << ": " << r << "." << endl;
+  } else {
+    LOG_AT(LOG_LEVEL_DEBUG, LOG_POLLING) << "Wrote snapshot of " << root << " in " << t << "." << endl;
+  }
+}
+
+string PollingThread::snapshot_path_for(const PolledRoot &root) const
+{
+  if (snapshot_directory.empty()) return string();
+  return path_join(snapshot_directory, root.get_snapshot_name());
+}
+
 Result<Thread::OfflineCommandOutcome> PollingThread::handle_offline_command(const CommandPayload *command)
 {
   Result<OfflineCommandOutcome> r = Thread::handle_offline_command(command);
@@ -129,6 +260,22 @@ Result<Thread::OfflineCommandOutcome> PollingThread::handle_offline_command(cons
     handle_polling_throttle_command(command);
   }
 
+  if (command->get_action() == COMMAND_POLLING_WORKERS) {
+    handle_polling_workers_command(command);
+  }
+
+  if (command->get_action() == COMMAND_POLLING_HOT_SHARE) {
+    handle_polling_hot_share_command(command);
+  }
+
+  if (command->get_action() == COMMAND_POLLING_BUDGET) {
+    handle_polling_budget_command(command);
+  }
+
+  if (command->get_action() == COMMAND_POLLING_SNAPSHOTS) {
+    handle_polling_snapshots_command(command);
+  }
+
   if (command->get_action() == COMMAND_STATUS) {
     handle_status_command(command);
   }
@@ -143,9 +290,19 @@ Result<Thread::CommandOutcome> PollingThread::handle_add_command(const CommandPa
   logline << " to channel " << command->get_channel_id() << " with " << plural(command->get_split_count(), "split")
           << "." << endl;
 
-  roots.emplace(std::piecewise_construct,
+  auto added = roots.emplace(std::piecewise_construct,
     std::forward_as_tuple(command->get_channel_id()),
-    std::forward_as_tuple(string(command->get_root()), command->get_channel_id(), command->get_recursive()));
+    std::forward_as_tuple(string(command->get_root()),
+      command->get_channel_id(),
+      command->get_recursive(),
+      command->get_events(),
+      command->get_exclusions(),
+      command->get_gitignore()));
+  added->second.use_snapshot(snapshot_path_for(added->second));
+
+  // Populate the new root right away rather than waiting for the next cadence point, so that the watch is established
+  // promptly.
+  next_cycle = steady_clock::now();
 
   auto existing = pending_splits.find(command->get_channel_id());
   if (existing != pending_splits.end()) {
@@ -202,7 +359,12 @@ Result<Thread::CommandOutcome> PollingThread::handle_remove_command(const Comman
   const ChannelID &channel_id = command->get_channel_id();
   LOGGER << "Removing poll roots at channel " << channel_id << "." << endl;
 
-  roots.erase(command->get_channel_id());
+  // Record any changes observed since the last snapshot, so that they aren't reported again when the root is re-added.
+  auto removed = roots.equal_range(channel_id);
+  for (auto root = removed.first; root != removed.second; ++root) {
+    write_snapshot_if_due(root->second, steady_clock::duration::zero());
+  }
+  roots.erase(removed.first, removed.second);
 
   // Ensure that we ack the ADD command even if the REMOVE command arrives before all of its splits populate.
   auto pending = pending_splits.find(channel_id);
@@ -226,6 +388,9 @@ Result<Thread::CommandOutcome> PollingThread::handle_remove_command(const Comman
 Result<Thread::CommandOutcome> PollingThread::handle_polling_interval_command(const CommandPayload *command)
 {
   poll_interval = std::chrono::milliseconds(command->get_arg());
+
+  // Bring the next cycle forward if the interval has been shortened.
+  next_cycle = std::min(next_cycle, steady_clock::now() + poll_interval);
   return ok_result(ACK);
 }
 
@@ -235,6 +400,40 @@ Result<Thread::CommandOutcome> PollingThread::handle_polling_throttle_command(co
   return ok_result(ACK);
 }
 
+Result<Thread::CommandOutcome> PollingThread::handle_polling_workers_command(const CommandPayload *command)
+{
+  pool.set_worker_count(command->get_arg());
+  return ok_result(ACK);
+}
+
+Result<Thread::CommandOutcome> PollingThread::handle_polling_hot_share_command(const CommandPayload *command)
+{
+  poll_hot_share = command->get_arg();
+  return ok_result(ACK);
+}
+
+Result<Thread::CommandOutcome> PollingThread::handle_polling_budget_command(const CommandPayload *command)
+{
+  poll_budget = command->get_arg();
+  return ok_result(ACK);
+}
+
+Result<Thread::CommandOutcome> PollingThread::handle_polling_snapshots_command(const CommandPayload *command)
+{
+  snapshot_directory = command->get_root();
+
+  if (!snapshot_directory.empty()) {
+    // The directory may already exist. Any other failure surfaces when the first snapshot is written.
+    FSReq mkdir_req;
+    uv_fs_mkdir(nullptr, &mkdir_req.req, snapshot_directory.c_str(), 0777, nullptr);
+  }
+
+  for (auto &pair : roots) {
+    pair.second.use_snapshot(snapshot_path_for(pair.second));
+  }
+  return ok_result(ACK);
+}
+
 Result<Thread::CommandOutcome> PollingThread::handle_status_command(const CommandPayload *command)
 {
   unique_ptr<Status> status{new Status()};
@@ -247,10 +446,20 @@ Result<Thread::CommandOutcome> PollingThread::handle_status_command(const Comman
   status->polling_out_ok = get_out_queue_error();
 
   status->polling_root_count = roots.size();
+  status->polling_worker_count = pool.get_worker_count();
+  status->polling_throughput = static_cast<size_t>(throughput);
+  status->polling_cycle_duration = cycle_durations;
 
   status->polling_entry_count = 0;
+  status->polling_hot_directory_count = 0;
   for (auto &pair : roots) {
-    status->polling_entry_count += pair.second.count_entries();
+    ChannelStats &stats = status->channel_stats[pair.first];
+    size_t entry_count = pair.second.count_entries();
+    stats.polling_entry_count += entry_count;
+    stats.polling_operations += pair.second.get_operation_count();
+
+    status->polling_entry_count += entry_count;
+    status->polling_hot_directory_count += pair.second.count_hot_directories();
   }
 
   Result<> r = emit(Message(StatusPayload(command->get_request_id(), move(status))));
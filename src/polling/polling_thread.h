@@ -5,31 +5,53 @@
 #include <cstdint>
 #include <map>
 #include <set>
+#include <string>
 #include <utility>
 #include <uv.h>
 
+#include "../latency_histogram.h"
 #include "../result.h"
 #include "../status.h"
 #include "../thread.h"
 #include "polled_root.h"
+#include "polling_pool.h"
 
 const std::chrono::milliseconds DEFAULT_POLL_INTERVAL = std::chrono::milliseconds(100);
 const uint_fast32_t DEFAULT_POLL_THROTTLE = 1000;
+const uint_fast32_t DEFAULT_POLL_WORKERS = 4;
+const uint_fast32_t DEFAULT_POLL_HOT_SHARE = 25;
+const uint_fast32_t DEFAULT_POLL_BUDGET = 0;
+
+// Minimum time between writes of a root's snapshot while it's changing.
+const std::chrono::seconds SNAPSHOT_INTERVAL = std::chrono::seconds(30);
 
 // The PollingThread observes filesystem changes by repeatedly calling scandir() and lstat() on registered root
 // directories. It runs automatically when a `COMMAND_ADD` message is sent to it, and stops automatically when a
 // `COMMAND_REMOVE` message removes the last polled root.
 //
 // It has a configurable "throttle" which roughly corresponds to the number of filesystem calls performed within each
-// polling cycle. The throttle is distributed among polled roots so that small directories won't be starved by large
-// ones.
+// polling cycle. The throttle is a budget shared by a `PollingPool` of workers that advance polled roots concurrently,
+// so that small directories won't be starved by large or slow ones. Alternatively, each cycle may be limited to a
+// percentage of the polling interval, measured as the time that workers spend performing filesystem calls, which adapts
+// to the latency of the filesystems being polled.
+//
+// When a root is too large to scan completely within a single cycle, part of each cycle is spent revisiting the
+// directories in which changes have recently been observed. The rest continues the complete scan, so changes elsewhere
+// are still detected within a bounded number of cycles.
+//
+// Cycles begin at fixed cadence points spaced by the polling interval, regardless of how long each one takes. Between
+// cycles the thread waits on a condition variable, so commands sent to it are handled as soon as they arrive.
+//
+// If a snapshot directory is configured, each root's records are written there once its initial scan is complete, then
+// again every `SNAPSHOT_INTERVAL` while it's changing and when it's removed. A root that's added again later compares
+// its initial scan against its snapshot, so changes made while it wasn't being polled are reported as events.
 class PollingThread : public Thread
 {
 public:
   explicit PollingThread(uv_async_t *main_callback);
   PollingThread(const PollingThread &) = delete;
   PollingThread(PollingThread &&) = delete;
-  ~PollingThread() override = default;
+  ~PollingThread() override;
 
   PollingThread &operator=(const PollingThread &) = delete;
   PollingThread &operator=(PollingThread &&) = delete;
@@ -43,6 +65,22 @@ private:
   // Perform a single polling cycle.
   Result<> cycle();
 
+  // Write the snapshot of `root` if it's changed and at least `interval` has passed since it was last written.
+  // Failures are logged, but otherwise don't interrupt polling.
+  void write_snapshot_if_due(PolledRoot &root, std::chrono::steady_clock::duration interval);
+
+  // Construct the full path of a root's snapshot within `snapshot_directory`, or an empty string if none is set.
+  std::string snapshot_path_for(const PolledRoot &root) const;
+
+  // Move `next_cycle` to the first cadence point after the current time.
+  void schedule_next_cycle();
+
+  // Block until `next_cycle` arrives or `PollingThread::wake()` is called.
+  void sleep_until_next_cycle();
+
+  // Interrupt the sleep between cycles to handle newly arrived commands.
+  Result<> wake() override;
+
   // Wake up when a `COMMAND_ADD` message is received while stopped.
   Result<OfflineCommandOutcome> handle_offline_command(const CommandPayload *command) override;
 
@@ -56,16 +94,51 @@ private:
   // Configure the number of system calls to perform during each `cycle()`.
   Result<CommandOutcome> handle_polling_throttle_command(const CommandPayload *command) override;
 
+  // Configure the number of workers that may advance roots concurrently during each `cycle()`.
+  Result<CommandOutcome> handle_polling_workers_command(const CommandPayload *command) override;
+
+  // Configure the percentage of each root's throttle allocation that may be spent revisiting recently changed
+  // directories.
+  Result<CommandOutcome> handle_polling_hot_share_command(const CommandPayload *command) override;
+
+  // Configure the percentage of each polling interval that workers may spend polling. Zero reverts to the throttle.
+  Result<CommandOutcome> handle_polling_budget_command(const CommandPayload *command) override;
+
+  // Configure the directory in which snapshots of each root are written and read. An empty directory disables them.
+  Result<CommandOutcome> handle_polling_snapshots_command(const CommandPayload *command) override;
+
   // Respond to a request for collecting status.
   Result<CommandOutcome> handle_status_command(const CommandPayload *command) override;
 
   std::chrono::milliseconds poll_interval;
+  std::chrono::steady_clock::time_point next_cycle;
   uint_fast32_t poll_throttle;
+  uint_fast32_t poll_hot_share;
+  uint_fast32_t poll_budget;
+
+  // Directory that holds a snapshot of each root, or empty if snapshots are disabled.
+  std::string snapshot_directory;
+
+  // Smoothed rate at which filesystem operations have been performed, in operations per second of wall time, measured
+  // between the starts of consecutive cycles.
+  double throughput;
+  std::chrono::steady_clock::time_point last_cycle_start;
+  size_t last_cycle_operations;
+
+  // Time spent on each cycle, reported by `status()`.
+  LatencyHistogram cycle_durations;
 
   std::multimap<ChannelID, PolledRoot> roots;
 
+  PollingPool pool;
+
   using PendingSplit = std::pair<CommandID, size_t>;
   std::map<ChannelID, PendingSplit> pending_splits;
+
+  // Protects `woken`, which is set by `PollingThread::wake()` from other threads.
+  uv_mutex_t wake_mutex{};
+  uv_cond_t wake_cond{};
+  bool woken;
 };
 
 #endif
@@ -0,0 +1,81 @@
+#ifndef PROBES_H
+#define PROBES_H
+
+#include <cstdint>
+
+// Static tracepoints that bpftrace, perf, and SystemTap can attach to while the addon is running, with no rebuild and
+// no logging. They're published under the "watcher" provider:
+//
+//   bpftrace -e 'usdt:./build/Release/watcher.node:watcher:inotify_read { @events = hist(arg1); }'
+//
+// Every argument is passed as an unsigned 64-bit integer. An unattached probe is a single `nop` instruction, although
+// its arguments are still computed, so keep them to values that are already at hand.
+//
+// The probes are described in a `.note.stapsdt` ELF section. <sys/sdt.h> from systemtap-sdt-dev is used to write it
+// when it's available; otherwise an equivalent note is emitted directly on x86-64 and AArch64 Linux. Everywhere else
+// the probes compile away.
+
+#if defined(PLATFORM_LINUX) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#define WATCHER_PROBES_SYS_SDT
+#include <sys/sdt.h>
+#endif
+#endif
+
+#if defined(WATCHER_PROBES_SYS_SDT)
+
+#define WATCHER_PROBE0(name) DTRACE_PROBE(watcher, name)
+#define WATCHER_PROBE1(name, a) DTRACE_PROBE1(watcher, name, static_cast<uint64_t>(a))
+#define WATCHER_PROBE2(name, a, b) DTRACE_PROBE2(watcher, name, static_cast<uint64_t>(a), static_cast<uint64_t>(b))
+#define WATCHER_PROBE3(name, a, b, c)                                                                                 \
+  DTRACE_PROBE3(watcher, name, static_cast<uint64_t>(a), static_cast<uint64_t>(b), static_cast<uint64_t>(c))
+
+#elif defined(PLATFORM_LINUX) && defined(__GNUC__) && (defined(__x86_64__) || defined(__aarch64__))
+
+// A version 3 stapsdt note: the probe's address, the address of the `.stapsdt.base` section used to correct it when the
+// library is relocated, a zero semaphore address, then the provider, name, and argument descriptions.
+#define WATCHER_PROBE_NOTE(name, arguments)                                                                           \
+  "990: nop\n"                                                                                                        \
+  ".pushsection .note.stapsdt,\"?\",\"note\"\n"                                                                       \
+  ".balign 4\n"                                                                                                       \
+  ".4byte 992f-991f, 994f-993f, 3\n"                                                                                  \
+  "991: .asciz \"stapsdt\"\n"                                                                                         \
+  "992: .balign 4\n"                                                                                                  \
+  "993: .8byte 990b\n"                                                                                                \
+  ".8byte _.stapsdt.base\n"                                                                                           \
+  ".8byte 0\n"                                                                                                        \
+  ".asciz \"watcher\"\n"                                                                                              \
+  ".asciz \"" #name "\"\n"                                                                                            \
+  ".asciz \"" arguments "\"\n"                                                                                        \
+  "994: .balign 4\n"                                                                                                  \
+  ".popsection\n"                                                                                                     \
+  ".ifndef _.stapsdt.base\n"                                                                                          \
+  ".pushsection .stapsdt.base,\"aG\",\"progbits\",.stapsdt.base,comdat\n"                                             \
+  ".weak _.stapsdt.base\n"                                                                                            \
+  ".hidden _.stapsdt.base\n"                                                                                          \
+  "_.stapsdt.base: .space 1\n"                                                                                        \
+  ".size _.stapsdt.base, 1\n"                                                                                         \
+  ".popsection\n"                                                                                                     \
+  ".endif\n"
+
+#define WATCHER_PROBE_ARG(a) "nor"(static_cast<uint64_t>(a))
+
+#define WATCHER_PROBE0(name) __asm__ __volatile__(WATCHER_PROBE_NOTE(name, "") ::)
+#define WATCHER_PROBE1(name, a) __asm__ __volatile__(WATCHER_PROBE_NOTE(name, "8@%0") ::WATCHER_PROBE_ARG(a))
+#define WATCHER_PROBE2(name, a, b)                                                                                    \
+  __asm__ __volatile__(WATCHER_PROBE_NOTE(name, "8@%0 8@%1") ::WATCHER_PROBE_ARG(a), WATCHER_PROBE_ARG(b))
+#define WATCHER_PROBE3(name, a, b, c)                                                                                 \
+  __asm__ __volatile__(                                                                                               \
+    WATCHER_PROBE_NOTE(name, "8@%0 8@%1 8@%2") ::WATCHER_PROBE_ARG(a), WATCHER_PROBE_ARG(b), WATCHER_PROBE_ARG(c))
+
+#else
+
+// Arguments are named within `sizeof` so that values computed only for a probe don't warn as unused.
+#define WATCHER_PROBE0(name) static_cast<void>(0)
+#define WATCHER_PROBE1(name, a) static_cast<void>(sizeof(a))
+#define WATCHER_PROBE2(name, a, b) static_cast<void>(sizeof(a) + sizeof(b))
+#define WATCHER_PROBE3(name, a, b, c) static_cast<void>(sizeof(a) + sizeof(b) + sizeof(c))
+
+#endif
+
+#endif
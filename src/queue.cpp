@@ -33,7 +33,9 @@ Queue::~Queue()
 void Queue::enqueue(Message &&message)
 {
   Lock lock(mutex);
+  active_bytes.set(active_bytes.get() + message.footprint());
   active->push_back(move(message));
+  active_depth.set(active->size());
 }
 
 unique_ptr<vector<Message>> Queue::accept_all()
@@ -47,6 +49,8 @@ unique_ptr<vector<Message>> Queue::accept_all()
 
   unique_ptr<vector<Message>> consumed = move(active);
   active.reset(new vector<Message>);
+  active_depth.set(0);
+  active_bytes.set(0);
   return consumed;
 }
 
@@ -12,6 +12,7 @@
 #include "errable.h"
 #include "lock.h"
 #include "message.h"
+#include "metrics.h"
 #include "result.h"
 
 // Primary channel of communication between threads.
@@ -35,7 +36,13 @@ public:
   void enqueue_all(InputIt begin, InputIt end)
   {
     Lock lock(mutex);
+    size_t bytes = active_bytes.get();
+    for (InputIt it = begin; it != end; ++it) {
+      bytes += it->footprint();
+    }
     std::move(begin, end, std::back_inserter(*active));
+    active_depth.set(active->size());
+    active_bytes.set(bytes);
   }
 
   // Atomically consume the current contents of the queue, emptying it.
@@ -47,6 +54,12 @@ public:
   // Atomically report the number of items waiting on the queue.
   size_t size();
 
+  // Report the number of Messages waiting on the queue and the memory they occupy without locking. Either may lag
+  // slightly behind the queue's true contents.
+  size_t approximate_size() const { return static_cast<size_t>(active_depth.get()); }
+
+  size_t approximate_bytes() const { return static_cast<size_t>(active_bytes.get()); }
+
   Queue(const Queue &) = delete;
   Queue(Queue &&) = delete;
   Queue &operator=(const Queue &) = delete;
@@ -55,6 +68,10 @@ public:
 private:
   uv_mutex_t mutex{};
   std::unique_ptr<std::vector<Message>> active;
+
+  // Only written while holding `mutex`.
+  MetricGauge active_depth;
+  MetricGauge active_bytes;
 };
 
 #endif
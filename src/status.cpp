@@ -17,6 +17,11 @@ void Status::assimilate_worker_status(const Status &other)
   worker_out_ok = other.worker_out_ok;
 
   worker_subscription_count = other.worker_subscription_count;
+  worker_consume_duration = other.worker_consume_duration;
+  for (auto &pair : other.channel_stats) {
+    auto existing = channel_stats.find(pair.first);
+    if (existing != channel_stats.end()) existing->second.assimilate_worker_stats(pair.second);
+  }
 #ifdef PLATFORM_MACOS
   worker_rename_buffer_size = other.worker_rename_buffer_size;
   worker_recent_file_cache_size = other.worker_recent_file_cache_size;
@@ -40,17 +45,40 @@ void Status::assimilate_polling_status(const Status &other)
   polling_out_ok = other.polling_out_ok;
 
   polling_root_count = other.polling_root_count;
+  polling_worker_count = other.polling_worker_count;
   polling_entry_count = other.polling_entry_count;
+  polling_hot_directory_count = other.polling_hot_directory_count;
+  polling_throughput = other.polling_throughput;
+  polling_cycle_duration = other.polling_cycle_duration;
+  for (auto &pair : other.channel_stats) {
+    auto existing = channel_stats.find(pair.first);
+    if (existing != channel_stats.end()) existing->second.assimilate_polling_stats(pair.second);
+  }
 
   polling_received = true;
 }
 
+DeliveryLatency Status::total_latency() const
+{
+  DeliveryLatency total;
+  for (auto &pair : channel_latency) {
+    total.merge(pair.second);
+  }
+  return total;
+}
+
 ostream &operator<<(ostream &out, const Status &status)
 {
+  DeliveryLatency latency = status.total_latency();
+
   out << "WATCHER STATUS SUMMARY\n"
       << "* main thread:\n"
       << "  - " << plural(status.pending_callback_count, "pending callback") << "\n"
       << "  - " << plural(status.channel_callback_count, "channel callback") << "\n"
+      << "  - " << plural(status.route_count, "route") << "\n"
+      << "  - kernel to queue latency: " << latency.kernel_to_queue << "\n"
+      << "  - queue to main thread latency: " << latency.queue_to_main << "\n"
+      << "  - delivery latency: " << latency.total << "\n"
       << "* worker thread:\n"
       << "  - state: " << status.worker_thread_state << "\n"
       << "  - health: " << status.worker_thread_ok << "\n"
@@ -58,7 +86,8 @@ ostream &operator<<(ostream &out, const Status &status)
       << "  - " << plural(status.worker_in_size, "in queue message") << "\n"
       << "  - out queue health: " << status.worker_out_ok << "\n"
       << "  - " << plural(status.worker_out_size, "out queue message") << "* polling thread\n"
-      << "  - " << plural(status.worker_subscription_count, "subscription") << endl;
+      << "  - " << plural(status.worker_subscription_count, "subscription") << "\n"
+      << "  - consume durations: " << status.worker_consume_duration << endl;
 #ifdef PLATFORM_MACOS
   out << "  - " << plural(status.worker_rename_buffer_size, "rename buffer entry", "rename buffer entries") << "\n"
       << "  - " << plural(status.worker_recent_file_cache_size, "recent cache entry", "recent cache entries") << "\n";
@@ -76,7 +105,11 @@ ostream &operator<<(ostream &out, const Status &status)
       << "  - out queue health: " << status.worker_out_ok << "\n"
       << "  - " << plural(status.polling_out_size, "out queue message") << "\n"
       << "  - " << plural(status.polling_root_count, "polled root") << "\n"
+      << "  - " << plural(status.polling_worker_count, "polling worker") << "\n"
       << "  - " << plural(status.polling_entry_count, "polled entry", "polled entries") << "\n"
+      << "  - " << plural(status.polling_hot_directory_count, "hot polled directory", "hot polled directories") << "\n"
+      << "  - " << plural(status.polling_throughput, "polled entry", "polled entries") << " checked per second\n"
+      << "  - cycle durations: " << status.polling_cycle_duration << "\n"
       << endl;
   return out;
 }
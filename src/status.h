@@ -1,9 +1,15 @@
 #ifndef STATUS_H
 #define STATUS_H
 
+#include <cstdint>
 #include <iostream>
+#include <map>
 #include <string>
 
+#include "channel_stats.h"
+#include "latency_histogram.h"
+#include "metrics.h"
+
 // Summarize the module's health. This includes information like the health of all Errable resources and the sizes of
 // internal queues and buffers.
 class Status
@@ -12,6 +18,16 @@ public:
   // Main thread
   size_t pending_callback_count{0};
   size_t channel_callback_count{0};
+  size_t route_count{0};
+
+  // Latency of the filesystem events delivered on each channel, by channel ID.
+  std::map<uint_fast32_t, DeliveryLatency> channel_latency{};
+
+  // Work attributed to each channel by every thread, by channel ID. Only collected when requested.
+  std::map<uint_fast32_t, ChannelStats> channel_stats{};
+
+  // Lock-free counters, sampled when the status was requested.
+  MetricsSample metrics{};
 
   // Worker thread
   std::string worker_thread_state{};
@@ -22,6 +38,9 @@ public:
   std::string worker_out_ok{};
 
   size_t worker_subscription_count{0};
+
+  // Time spent translating each batch of native events into messages.
+  LatencyHistogram worker_consume_duration{};
 #ifdef PLATFORM_MACOS
   size_t worker_rename_buffer_size{0};
   size_t worker_recent_file_cache_size{0};
@@ -41,7 +60,13 @@ public:
   std::string polling_out_ok{};
 
   size_t polling_root_count{0};
+  size_t polling_worker_count{0};
   size_t polling_entry_count{0};
+  size_t polling_hot_directory_count{0};
+  size_t polling_throughput{0};
+
+  // Time spent on each polling cycle.
+  LatencyHistogram polling_cycle_duration{};
 
   bool worker_received{false};
   bool polling_received{false};
@@ -50,6 +75,9 @@ public:
 
   void assimilate_polling_status(const Status &other);
 
+  // Combine the latency of every channel.
+  DeliveryLatency total_latency() const;
+
   bool complete() { return worker_received && polling_received; }
 };
 
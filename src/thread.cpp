@@ -6,10 +6,12 @@
 #include <uv.h>
 #include <vector>
 
+#include "latency_histogram.h"
 #include "log.h"
 #include "message.h"
 #include "result.h"
 #include "thread.h"
+#include "trace.h"
 
 using std::bind;
 using std::endl;
@@ -35,8 +37,14 @@ Thread::DispatchTable::DispatchTable()
   handlers[COMMAND_LOG_STDERR] = &Thread::handle_log_stderr_command;
   handlers[COMMAND_LOG_STDOUT] = &Thread::handle_log_stdout_command;
   handlers[COMMAND_LOG_DISABLE] = &Thread::handle_log_disable_command;
+  handlers[COMMAND_LOG_BINARY] = &Thread::handle_log_binary_command;
+  handlers[COMMAND_LOG_LEVELS] = &Thread::handle_log_levels_command;
   handlers[COMMAND_POLLING_INTERVAL] = &Thread::handle_polling_interval_command;
   handlers[COMMAND_POLLING_THROTTLE] = &Thread::handle_polling_throttle_command;
+  handlers[COMMAND_POLLING_WORKERS] = &Thread::handle_polling_workers_command;
+  handlers[COMMAND_POLLING_HOT_SHARE] = &Thread::handle_polling_hot_share_command;
+  handlers[COMMAND_POLLING_BUDGET] = &Thread::handle_polling_budget_command;
+  handlers[COMMAND_POLLING_SNAPSHOTS] = &Thread::handle_polling_snapshots_command;
   handlers[COMMAND_CACHE_SIZE] = &Thread::handle_cache_size_command;
   handlers[COMMAND_DRAIN] = &Thread::handle_unknown_command;
   handlers[COMMAND_STATUS] = &Thread::handle_status_command;
@@ -140,6 +148,7 @@ Result<bool> Thread::drain()
 
 void Thread::start()
 {
+  Tracer::name_thread(name);
   mark_running();
 
   // Artificially enqueue any messages that establish the thread's starting state.
@@ -173,7 +182,9 @@ void Thread::start()
 
 Result<> Thread::emit(Message &&message)
 {
+  bool is_event = message.mark_queued(monotonic_ns());
   out.enqueue(move(message));
+  if (is_event) events_emitted.add(1);
 
   int uv_err = uv_async_send(main_callback);
   if (uv_err != 0) {
@@ -187,10 +198,17 @@ Result<Thread::OfflineCommandOutcome> Thread::handle_offline_command(const Comma
 {
   CommandAction action = payload->get_action();
   if (action == COMMAND_LOG_FILE || action == COMMAND_LOG_STDOUT || action == COMMAND_LOG_STDERR
-    || action == COMMAND_LOG_DISABLE) {
+    || action == COMMAND_LOG_DISABLE || action == COMMAND_LOG_BINARY) {
     starter->set_logging(payload);
   }
 
+  if (action == COMMAND_LOG_LEVELS) {
+    string err = Logger::check_levels(payload->get_root().c_str());
+    if (!err.empty()) return Result<OfflineCommandOutcome>::make_error(move(err));
+
+    starter->set_log_levels(payload);
+  }
+
   return ok_result(OFFLINE_ACK);
 }
 
@@ -304,6 +322,24 @@ Result<Thread::CommandOutcome> Thread::handle_log_disable_command(const CommandP
   return ok_result(ACK);
 }
 
+Result<Thread::CommandOutcome> Thread::handle_log_binary_command(const CommandPayload *payload)
+{
+  string err = Logger::to_binary_file(payload->get_root().c_str());
+  if (!err.empty()) return Result<CommandOutcome>::make_error(move(err));
+
+  starter->set_logging(payload);
+  return ok_result(ACK);
+}
+
+Result<Thread::CommandOutcome> Thread::handle_log_levels_command(const CommandPayload *payload)
+{
+  string err = Logger::set_levels(payload->get_root().c_str());
+  if (!err.empty()) return Result<CommandOutcome>::make_error(move(err));
+
+  starter->set_log_levels(payload);
+  return ok_result(ACK);
+}
+
 Result<Thread::CommandOutcome> Thread::handle_polling_interval_command(const CommandPayload *payload)
 {
   return handle_unknown_command(payload);
@@ -314,6 +350,26 @@ Result<Thread::CommandOutcome> Thread::handle_polling_throttle_command(const Com
   return handle_unknown_command(payload);
 }
 
+Result<Thread::CommandOutcome> Thread::handle_polling_workers_command(const CommandPayload *payload)
+{
+  return handle_unknown_command(payload);
+}
+
+Result<Thread::CommandOutcome> Thread::handle_polling_hot_share_command(const CommandPayload *payload)
+{
+  return handle_unknown_command(payload);
+}
+
+Result<Thread::CommandOutcome> Thread::handle_polling_budget_command(const CommandPayload *payload)
+{
+  return handle_unknown_command(payload);
+}
+
+Result<Thread::CommandOutcome> Thread::handle_polling_snapshots_command(const CommandPayload *payload)
+{
+  return handle_unknown_command(payload);
+}
+
 Result<Thread::CommandOutcome> Thread::handle_cache_size_command(const CommandPayload *payload)
 {
   return handle_unknown_command(payload);
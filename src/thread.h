@@ -12,7 +12,9 @@
 #include <vector>
 
 #include "errable.h"
+#include "latency_histogram.h"
 #include "message.h"
+#include "metrics.h"
 #include "queue.h"
 #include "result.h"
 #include "status.h"
@@ -66,6 +68,12 @@ public:
   // run again.
   Result<bool> drain();
 
+  // Sample counters for `metrics()` without locking or waking the thread.
+  uint64_t get_events_emitted() const { return events_emitted.get(); }
+  size_t get_in_queue_depth() const { return in.approximate_size(); }
+  size_t get_out_queue_depth() const { return out.approximate_size(); }
+  size_t get_queued_bytes() const { return in.approximate_bytes() + out.approximate_bytes(); }
+
 protected:
   // Invoked on the newly created thread. Responsible for performing thread startup, consuming any `ThreadStart`
   // initialization and transitioning to the `RUNNING` phase. Calls `Thread::init()` to perform any one-time setup,
@@ -141,12 +149,29 @@ protected:
   // Disable logging from this thread.
   Result<CommandOutcome> handle_log_disable_command(const CommandPayload *payload);
 
+  // Configure this thread to log binary records to a file from a background flusher thread.
+  Result<CommandOutcome> handle_log_binary_command(const CommandPayload *payload);
+
+  // Set the levels of this thread's current and future loggers.
+  Result<CommandOutcome> handle_log_levels_command(const CommandPayload *payload);
+
   // Configure the polling thread's sleep interval.
   virtual Result<CommandOutcome> handle_polling_interval_command(const CommandPayload *payload);
 
   // Configure the number of system calls to perform during each polling cycle.
   virtual Result<CommandOutcome> handle_polling_throttle_command(const CommandPayload *payload);
 
+  virtual Result<CommandOutcome> handle_polling_workers_command(const CommandPayload *payload);
+
+  // Configure the share of each polling cycle that may be spent revisiting recently changed directories.
+  virtual Result<CommandOutcome> handle_polling_hot_share_command(const CommandPayload *payload);
+
+  // Configure the share of the polling interval that polling workers may spend performing system calls.
+  virtual Result<CommandOutcome> handle_polling_budget_command(const CommandPayload *payload);
+
+  // Configure the directory in which the polling thread persists the state of each polled root.
+  virtual Result<CommandOutcome> handle_polling_snapshots_command(const CommandPayload *payload);
+
   // Configure the number of stat() entries to cache on MacOS.
   virtual Result<CommandOutcome> handle_cache_size_command(const CommandPayload *payload);
 
@@ -163,8 +188,8 @@ protected:
   //   to acknowledge synchronously; or
   // * Return `TRIGGER_RUN` to cause the thread to automatically start (and consume this message on startup).
   //
-  // The base class implementation records logging configurations in its `ThreadStart` and ack's all other commands
-  // without effect. Override and call the base to handle logging by default.
+  // The base class implementation records logging configurations and levels in its `ThreadStart` and ack's all other
+  // commands without effect. Override and call the base to handle logging by default.
   virtual Result<OfflineCommandOutcome> handle_offline_command(const CommandPayload *payload);
 
   // Method dispatch table for command actions.
@@ -224,6 +249,9 @@ private:
   Queue in;
   Queue out;
 
+  // Filesystem event messages enqueued for the main thread. Only written by this thread.
+  MetricCounter events_emitted;
+
   // Handle used to trigger the main thread to consume `Messages` waiting on the output queue with
   // `Thread::receive_all()`.
   uv_async_t *main_callback;
@@ -307,7 +335,13 @@ Result<bool> Thread::send_all(InputIt begin, InputIt end)
 template <class InputIt>
 Result<> Thread::emit_all(InputIt begin, InputIt end)
 {
+  uint64_t now = monotonic_ns();
+  uint64_t event_count = 0;
+  for (InputIt it = begin; it != end; ++it) {
+    if (it->mark_queued(now)) event_count++;
+  }
   out.enqueue_all(begin, end);
+  events_emitted.add(event_count);
 
   int uv_err = uv_async_send(main_callback);
   if (uv_err) {
@@ -16,6 +16,9 @@ vector<Message> ThreadStarter::get_messages()
   if (logging) {
     results.emplace_back(wrap_command(logging));
   }
+  if (log_levels) {
+    results.emplace_back(wrap_command(log_levels));
+  }
   return results;
 }
 
@@ -21,6 +21,8 @@ public:
 
   void set_logging(const CommandPayload *payload) { set_command(logging, payload); }
 
+  void set_log_levels(const CommandPayload *payload) { set_command(log_levels, payload); }
+
 protected:
   void set_command(std::unique_ptr<CommandPayload> &dest, const CommandPayload *src);
 
@@ -28,6 +30,9 @@ protected:
 
 private:
   std::unique_ptr<CommandPayload> logging;
+
+  // Levels are tracked apart from the log's destination, so that setting one doesn't forget the other.
+  std::unique_ptr<CommandPayload> log_levels;
 };
 
 #endif
@@ -0,0 +1,181 @@
+#include <atomic>
+#include <cstdint>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <uv.h>
+#include <vector>
+
+#include "latency_histogram.h"
+#include "lock.h"
+#include "trace.h"
+
+using std::ostream;
+using std::ostringstream;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+// Spans recorded by a single thread beyond this many are counted, but discarded.
+static const size_t MAX_SPANS_PER_THREAD = 1 << 18;
+
+std::atomic<bool> Tracer::enabled{false};
+
+struct TraceEvent
+{
+  const char *name;
+  uint64_t start;
+  uint64_t end;
+};
+
+// Spans recorded by a single thread. Only that thread appends to it, but the main thread reads it while collecting a
+// trace, so access is guarded by a mutex that's almost never contended.
+struct TraceBuffer
+{
+  explicit TraceBuffer(size_t tid) : tid{tid}, dropped{0} { uv_mutex_init(&mutex); }
+
+  ~TraceBuffer() { uv_mutex_destroy(&mutex); }
+
+  TraceBuffer(const TraceBuffer &) = delete;
+  TraceBuffer(TraceBuffer &&) = delete;
+  TraceBuffer &operator=(const TraceBuffer &) = delete;
+  TraceBuffer &operator=(TraceBuffer &&) = delete;
+
+  uv_mutex_t mutex{};
+  size_t tid;
+  string thread_name;
+  vector<TraceEvent> events;
+  uint64_t dropped;
+};
+
+// Every buffer that's been created, and the thread-local key used to find the calling thread's own. Buffers outlive
+// their threads, so that spans recorded by a thread that's since exited are still exported.
+class TraceRegistry
+{
+public:
+  // Never destroyed, because native threads may still be recording spans while static destructors run at exit.
+  static TraceRegistry &get()
+  {
+    static auto *registry = new TraceRegistry();
+    return *registry;
+  }
+
+  TraceBuffer *current()
+  {
+    auto *buffer = static_cast<TraceBuffer *>(uv_key_get(&key));
+    if (buffer != nullptr) return buffer;
+
+    Lock lock(mutex);
+    buffers.emplace_back(new TraceBuffer(buffers.size() + 1));
+    buffer = buffers.back().get();
+    uv_key_set(&key, buffer);
+    return buffer;
+  }
+
+  void clear(uint64_t now)
+  {
+    Lock lock(mutex);
+    started_at = now;
+    for (unique_ptr<TraceBuffer> &buffer : buffers) {
+      Lock buffer_lock(buffer->mutex);
+      buffer->events.clear();
+      buffer->dropped = 0;
+    }
+  }
+
+  void write_json(ostream &out)
+  {
+    Lock lock(mutex);
+    int pid = uv_os_getpid();
+
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    for (unique_ptr<TraceBuffer> &buffer : buffers) {
+      vector<TraceEvent> events;
+      uint64_t dropped = 0;
+      string name;
+      {
+        Lock buffer_lock(buffer->mutex);
+        events.swap(buffer->events);
+        dropped = buffer->dropped;
+        name = buffer->thread_name;
+      }
+      if (name.empty()) name = "thread " + std::to_string(buffer->tid);
+      if (!first) out << ",";
+      first = false;
+      out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << buffer->tid
+          << ",\"args\":{\"name\":\"" << name << "\",\"dropped\":" << dropped << "}}";
+
+      for (TraceEvent &event : events) {
+        if (event.start < started_at || event.end < event.start) continue;
+
+        out << ",{\"name\":\"" << event.name << "\",\"cat\":\"watcher\",\"ph\":\"X\",\"pid\":" << pid
+            << ",\"tid\":" << buffer->tid << ",\"ts\":";
+        write_microseconds(out, event.start - started_at);
+        out << ",\"dur\":";
+        write_microseconds(out, event.end - event.start);
+        out << "}";
+      }
+    }
+    out << "]}";
+  }
+
+  TraceRegistry(const TraceRegistry &) = delete;
+  TraceRegistry(TraceRegistry &&) = delete;
+  TraceRegistry &operator=(const TraceRegistry &) = delete;
+  TraceRegistry &operator=(TraceRegistry &&) = delete;
+
+private:
+  TraceRegistry() : started_at{0}
+  {
+    uv_key_create(&key);
+    uv_mutex_init(&mutex);
+  }
+
+  // Trace timestamps are in microseconds. Keep nanosecond precision as a fraction.
+  static void write_microseconds(ostream &out, uint64_t nanoseconds)
+  {
+    out << nanoseconds / 1000 << "." << std::setw(3) << std::setfill('0') << nanoseconds % 1000 << std::setfill(' ');
+  }
+
+  uv_key_t key{};
+
+  // Protects `buffers` and `started_at`.
+  uv_mutex_t mutex{};
+  vector<unique_ptr<TraceBuffer>> buffers;
+  uint64_t started_at;
+};
+
+void Tracer::start()
+{
+  TraceRegistry::get().clear(monotonic_ns());
+  enabled.store(true, std::memory_order_relaxed);
+}
+
+string Tracer::stop()
+{
+  enabled.store(false, std::memory_order_relaxed);
+
+  ostringstream out;
+  TraceRegistry::get().write_json(out);
+  return out.str();
+}
+
+void Tracer::name_thread(const string &name)
+{
+  TraceBuffer *buffer = TraceRegistry::get().current();
+  Lock lock(buffer->mutex);
+  buffer->thread_name = name;
+}
+
+void Tracer::record(const char *name, uint64_t start, uint64_t end)
+{
+  TraceBuffer *buffer = TraceRegistry::get().current();
+  Lock lock(buffer->mutex);
+  if (buffer->events.size() < MAX_SPANS_PER_THREAD) {
+    buffer->events.push_back(TraceEvent{name, start, end});
+  } else {
+    buffer->dropped++;
+  }
+}
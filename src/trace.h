@@ -0,0 +1,71 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "latency_histogram.h"
+
+// Record spans of work on every thread, to be exported as Chrome trace-event JSON and loaded into Perfetto or
+// chrome://tracing to see how the threads' phases interleave.
+//
+// Tracing is off until `Tracer::start()` is called. While it's off, a `TraceSpan` costs a single branch on a relaxed
+// atomic load. While it's on, each thread appends its spans to a buffer of its own, which is only contended while the
+// trace is being collected.
+class Tracer
+{
+public:
+  static bool is_enabled() { return enabled.load(std::memory_order_relaxed); }
+
+  // Discard any previously recorded spans and begin recording.
+  static void start();
+
+  // Stop recording and return every span recorded since `Tracer::start()` as a Chrome trace-event JSON document.
+  static std::string stop();
+
+  // Name the calling thread within exported traces. Threads that aren't named are labelled by their order of
+  // appearance.
+  static void name_thread(const std::string &name);
+
+  // Append a completed span to the calling thread's buffer. `name` must be a string literal.
+  static void record(const char *name, uint64_t start, uint64_t end);
+
+private:
+  static std::atomic<bool> enabled;
+};
+
+// Record the lifetime of this object as a span on the current thread, if tracing was enabled when it was created.
+class TraceSpan
+{
+public:
+  explicit TraceSpan(const char *name) : name{nullptr}, start{0}
+  {
+    if (Tracer::is_enabled()) {
+      this->name = name;
+      start = monotonic_ns();
+    }
+  }
+
+  ~TraceSpan()
+  {
+    if (name != nullptr) Tracer::record(name, start, monotonic_ns());
+  }
+
+  TraceSpan(const TraceSpan &) = delete;
+  TraceSpan(TraceSpan &&) = delete;
+  TraceSpan &operator=(const TraceSpan &) = delete;
+  TraceSpan &operator=(TraceSpan &&) = delete;
+
+private:
+  const char *name;
+  uint64_t start;
+};
+
+#define TRACE_SPAN_NAME_(line) trace_span_##line
+#define TRACE_SPAN_NAME(line) TRACE_SPAN_NAME_(line)
+
+// Trace the remainder of the enclosing scope as a span called `name`.
+#define TRACE_SPAN(name) TraceSpan TRACE_SPAN_NAME(__LINE__)(name)
+
+#endif
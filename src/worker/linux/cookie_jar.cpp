@@ -7,9 +7,11 @@
 
 #include "../../message.h"
 #include "../../message_buffer.h"
+#include "../../probes.h"
 #include "../recent_file_cache.h"
 #include "cookie_jar.h"
 
+using std::make_pair;
 using std::move;
 using std::string;
 using std::unique_ptr;
@@ -32,7 +34,8 @@ void CookieBatch::moved_from(MessageBuffer &messages,
   string &&old_path,
   EntryKind kind)
 {
-  auto existing = from_paths.find(cookie);
+  auto key = make_pair(channel_id, cookie);
+  auto existing = from_paths.find(key);
   if (existing != from_paths.end()) {
     // Duplicate IN_MOVED_FROM cookie.
     // Resolve the old one as a deletion.
@@ -42,12 +45,12 @@ void CookieBatch::moved_from(MessageBuffer &messages,
   }
 
   Cookie c(channel_id, move(old_path), kind);
-  from_paths.emplace(cookie, move(c));
+  from_paths.emplace(key, move(c));
 }
 
-unique_ptr<Cookie> CookieBatch::yoink(uint32_t cookie)
+unique_ptr<Cookie> CookieBatch::yoink(ChannelID channel_id, uint32_t cookie)
 {
-  auto from = from_paths.find(cookie);
+  auto from = from_paths.find(make_pair(channel_id, cookie));
   if (from == from_paths.end()) {
     return unique_ptr<Cookie>(nullptr);
   }
@@ -60,6 +63,7 @@ unique_ptr<Cookie> CookieBatch::yoink(uint32_t cookie)
 void CookieBatch::flush(MessageBuffer &messages, RecentFileCache &cache)
 {
   for (auto &pair : from_paths) {
+    WATCHER_PROBE2(cookie_expired, pair.first.first, pair.first.second);
     Cookie dup(move(pair.second));
     cache.evict(dup.get_from_path());
     messages.deleted(dup.get_channel_id(), dup.move_from_path(), dup.get_kind());
@@ -91,7 +95,7 @@ void CookieJar::moved_to(MessageBuffer &messages,
 {
   unique_ptr<Cookie> from;
   for (auto &batch : batches) {
-    unique_ptr<Cookie> found = batch.yoink(cookie);
+    unique_ptr<Cookie> found = batch.yoink(channel_id, cookie);
     if (found) {
       if (from) {
         // Multiple IN_MOVED_FROM results.
@@ -110,7 +114,7 @@ void CookieJar::moved_to(MessageBuffer &messages,
     return;
   }
 
-  if (from->get_channel_id() != channel_id || kinds_are_different(from->get_kind(), kind)) {
+  if (kinds_are_different(from->get_kind(), kind)) {
     // Existing IN_MOVED_FROM with this cookie does not match.
     // Resolve it as a deletion/creation pair.
     messages.deleted(from->get_channel_id(), from->move_from_path(), from->get_kind());
@@ -118,6 +122,7 @@ void CookieJar::moved_to(MessageBuffer &messages,
     return;
   }
 
+  WATCHER_PROBE2(cookie_matched, channel_id, cookie);
   messages.renamed(channel_id, from->move_from_path(), move(new_path), kind);
 }
 
@@ -50,16 +50,16 @@ public:
   ~CookieBatch() = default;
 
   // Insert a new Cookie to eventually match an IN_MOVED_FROM event. If an existing Cookie already exists for this
-  // cookie value, immediately age the old Cookie off and buffer a deletion event.
+  // cookie value on the same channel, immediately age the old Cookie off and buffer a deletion event.
   void moved_from(MessageBuffer &messages,
     ChannelID channel_id,
     uint32_t cookie,
     std::string &&old_path,
     EntryKind kind);
 
-  // Remove a Cookie from this batch that has the specified cookie value. Return nullptr instead if no such cookie
-  // exists.
-  std::unique_ptr<Cookie> yoink(uint32_t cookie);
+  // Remove a Cookie from this batch that has the specified channel and cookie value. Return nullptr instead if no such
+  // cookie exists.
+  std::unique_ptr<Cookie> yoink(ChannelID channel_id, uint32_t cookie);
 
   // Age off all Cookies within this batch by buffering them as deletion events. Evict them from the cache.
   void flush(MessageBuffer &messages, RecentFileCache &cache);
@@ -72,7 +72,8 @@ public:
   CookieBatch &operator=(CookieBatch &&) = delete;
 
 private:
-  std::map<uint32_t, Cookie> from_paths;
+  // Channels that watch the same directory each see the same rename, so cookies are only unique within a channel.
+  std::map<std::pair<ChannelID, uint32_t>, Cookie> from_paths;
 };
 
 // Associate IN_MOVED_FROM and IN_MOVED_TO events from inotify received within a configurable number of consecutive
@@ -100,10 +101,10 @@ public:
     std::string &&old_path,
     EntryKind kind);
 
-  // Observe an IN_MOVED_TO event. Search the current CookieBatches for a recent IN_MOVED_FROM event with a matching
-  // `cookie` value. If no match is found, emit a creation event for the entry. If a match is found but the channel
-  // or entry kind don't match, emit a delete/create event pair for the old and new entries. Otherwise, emit the
-  // successfully correlated rename event.
+  // Observe an IN_MOVED_TO event. Search the current CookieBatches for a recent IN_MOVED_FROM event on the same
+  // channel with a matching `cookie` value. If no match is found, emit a creation event for the entry. If a match is
+  // found but the entry kind doesn't match, emit a delete/create event pair for the old and new entries. Otherwise,
+  // emit the successfully correlated rename event.
   void moved_to(MessageBuffer &messages, ChannelID channel_id, uint32_t cookie, std::string &&new_path, EntryKind kind);
 
   // Buffer deletion events for any Cookies that have not been matched within `max_batches` CookieBatches. Add a
@@ -0,0 +1,466 @@
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <sys/inotify.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <utility>
+#include <uv.h>
+#include <vector>
+
+#include "../../helper/libuv.h"
+#include "../../log.h"
+#include "../../message.h"
+#include "inotify_source.h"
+
+using std::endl;
+using std::ifstream;
+using std::move;
+using std::ofstream;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+static const char RECORDING_MAGIC[8] = {'w', 'a', 't', 'c', 'h', 'i', 'n', 'o'};
+
+static const uint32_t RECORDING_VERSION = 1;
+
+static const uint32_t RECORDING_BYTE_ORDER = 0x01020304;
+
+// Record types
+static const uint8_t RECORD_ROOT = 1;
+static const uint8_t RECORD_WATCH = 2;
+static const uint8_t RECORD_LISTING = 3;
+static const uint8_t RECORD_READ = 4;
+static const uint8_t RECORD_STAT = 5;
+static const uint8_t RECORD_COOKIES_EXPIRED = 6;
+
+// Longer fields can only come from a corrupted recording.
+static const size_t MAX_FIELD_LENGTH = 16 * 1024 * 1024;
+
+unique_ptr<InotifySource> InotifySource::from_env(const char *var)
+{
+  const char *filename = std::getenv(var);
+  if (filename == nullptr || *filename == '\0') return unique_ptr<InotifySource>(new SystemInotifySource());
+
+  unique_ptr<RecordingInotifySource> recording(new RecordingInotifySource(filename));
+  if (!recording->get_error().empty()) {
+    LOGGER << "Unable to record inotify activity: " << recording->get_error() << "." << endl;
+    return unique_ptr<InotifySource>(new SystemInotifySource());
+  }
+
+  LOGGER << "Recording inotify activity to " << filename << "." << endl;
+  return unique_ptr<InotifySource>(recording.release());
+}
+
+int SystemInotifySource::init()
+{
+  return inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+}
+
+int SystemInotifySource::add_watch(int fd, const string &path, uint32_t mask)
+{
+  return inotify_add_watch(fd, path.c_str(), mask);
+}
+
+int SystemInotifySource::remove_watch(int fd, int wd)
+{
+  return inotify_rm_watch(fd, wd);
+}
+
+ssize_t SystemInotifySource::read_events(int fd, char *buf, size_t size)
+{
+  return read(fd, buf, size);
+}
+
+int SystemInotifySource::list_directories(const string &path, vector<string> &names)
+{
+  DIR *dir = opendir(path.c_str());
+  if (dir == nullptr) return errno;
+
+  errno = 0;
+  dirent *entry = readdir(dir);
+  while (entry != nullptr) {
+    string basename(entry->d_name);
+
+#ifdef _DIRENT_HAVE_D_TYPE
+    bool maybe_directory = entry->d_type == DT_DIR || entry->d_type == DT_UNKNOWN;
+#else
+    bool maybe_directory = true;
+#endif
+    if (maybe_directory && basename != "." && basename != "..") names.push_back(move(basename));
+
+    errno = 0;
+    entry = readdir(dir);
+  }
+  int readdir_errno = errno;
+
+  closedir(dir);
+  return readdir_errno;
+}
+
+int SystemInotifySource::lstat(const string &path, uv_stat_t &stat)
+{
+  FSReq lstat_req;
+  int lstat_err = uv_fs_lstat(nullptr, &lstat_req.req, path.c_str(), nullptr);
+  if (lstat_err == 0) stat = lstat_req.req.statbuf;
+  return lstat_err;
+}
+
+RecordingInotifySource::RecordingInotifySource(const string &filename) :
+  out(filename, std::ios::out | std::ios::binary | std::ios::trunc)
+{
+  if (!out) {
+    err = "Unable to open " + filename + ": " + std::strerror(errno);
+    return;
+  }
+
+  write_raw(RECORDING_MAGIC, sizeof(RECORDING_MAGIC));
+  write_u32(RECORDING_VERSION);
+  write_u32(RECORDING_BYTE_ORDER);
+}
+
+int RecordingInotifySource::add_watch(int fd, const string &path, uint32_t mask)
+{
+  int wd = SystemInotifySource::add_watch(fd, path, mask);
+  int watch_errno = errno;
+
+  write_u8(RECORD_WATCH);
+  write_string(path);
+  write_i64(wd);
+  write_i64(wd == -1 ? watch_errno : 0);
+
+  errno = watch_errno;
+  return wd;
+}
+
+ssize_t RecordingInotifySource::read_events(int fd, char *buf, size_t size)
+{
+  ssize_t result = SystemInotifySource::read_events(fd, buf, size);
+  int read_errno = errno;
+
+  write_u8(RECORD_READ);
+  write_i64(result);
+  write_i64(result < 0 ? read_errno : 0);
+  if (result > 0) write_raw(buf, static_cast<size_t>(result));
+
+  // The last read of each batch returns nothing. Flush then, so that little is lost if the process is killed.
+  if (result <= 0) out.flush();
+
+  errno = read_errno;
+  return result;
+}
+
+int RecordingInotifySource::list_directories(const string &path, vector<string> &names)
+{
+  size_t first = names.size();
+  int list_errno = SystemInotifySource::list_directories(path, names);
+
+  write_u8(RECORD_LISTING);
+  write_string(path);
+  write_i64(list_errno);
+  write_u32(static_cast<uint32_t>(names.size() - first));
+  for (size_t i = first; i < names.size(); i++) {
+    write_string(names[i]);
+  }
+
+  return list_errno;
+}
+
+int RecordingInotifySource::lstat(const string &path, uv_stat_t &stat)
+{
+  int lstat_err = SystemInotifySource::lstat(path, stat);
+
+  // Only the fields that identify an entry are kept.
+  write_u8(RECORD_STAT);
+  write_string(path);
+  write_i64(lstat_err);
+  write_u64(lstat_err == 0 ? stat.st_mode : 0);
+  write_u64(lstat_err == 0 ? stat.st_ino : 0);
+  write_u64(lstat_err == 0 ? stat.st_size : 0);
+
+  return lstat_err;
+}
+
+void RecordingInotifySource::root_added(ChannelID channel_id, const string &root, bool recursive, EventMask events)
+{
+  write_u8(RECORD_ROOT);
+  write_u64(channel_id);
+  write_string(root);
+  write_u8(recursive ? 1 : 0);
+  write_u32(events);
+}
+
+void RecordingInotifySource::cookies_expired()
+{
+  write_u8(RECORD_COOKIES_EXPIRED);
+  out.flush();
+}
+
+void RecordingInotifySource::write_string(const string &value)
+{
+  write_u32(static_cast<uint32_t>(value.size()));
+  write_raw(value.data(), value.size());
+}
+
+void RecordingInotifySource::write_raw(const void *bytes, size_t length)
+{
+  if (!err.empty()) return;
+
+  out.write(static_cast<const char *>(bytes), static_cast<std::streamsize>(length));
+  if (!out) err = "Unable to write to recording";
+}
+
+// Read the fields of a recording in the order they were written, remembering the first failure.
+class RecordingReader
+{
+public:
+  explicit RecordingReader(const string &filename) : in(filename, std::ios::in | std::ios::binary) {}
+
+  bool is_open() const { return static_cast<bool>(in); }
+
+  bool at_end() { return in.peek() == std::char_traits<char>::eof(); }
+
+  bool is_healthy() const { return !failed; }
+
+  uint8_t u8() { return raw<uint8_t>(); }
+
+  uint32_t u32() { return raw<uint32_t>(); }
+
+  int64_t i64() { return raw<int64_t>(); }
+
+  uint64_t u64() { return raw<uint64_t>(); }
+
+  string bytes(size_t length)
+  {
+    if (length > MAX_FIELD_LENGTH) {
+      failed = true;
+      return string();
+    }
+
+    string value(length, '\0');
+    if (length > 0 && !in.read(&value[0], static_cast<std::streamsize>(length))) failed = true;
+    return value;
+  }
+
+  string str() { return bytes(u32()); }
+
+private:
+  template <class T>
+  T raw()
+  {
+    T value{};
+    if (!in.read(reinterpret_cast<char *>(&value), sizeof(value))) failed = true;
+    return value;
+  }
+
+  ifstream in;
+  bool failed{false};
+};
+
+// Return true if `bytes` is made of whole `inotify_event` records, each followed by the name its `len` promises.
+static bool holds_whole_events(const string &bytes)
+{
+  const char *current = bytes.data();
+  size_t remaining = bytes.size();
+  while (remaining > 0) {
+    if (remaining < sizeof(inotify_event)) return false;
+
+    inotify_event header{};
+    std::memcpy(&header, current, sizeof(inotify_event));
+    if (header.len > remaining - sizeof(inotify_event)) return false;
+
+    size_t event_size = sizeof(inotify_event) + header.len;
+    current += event_size;
+    remaining -= event_size;
+  }
+  return true;
+}
+
+ReplayInotifySource::ReplayInotifySource(const string &filename)
+{
+  RecordingReader reader(filename);
+  if (!reader.is_open()) {
+    err = "Unable to open " + filename + ": " + std::strerror(errno);
+    return;
+  }
+
+  string magic = reader.bytes(sizeof(RECORDING_MAGIC));
+  uint32_t version = reader.u32();
+  uint32_t byte_order = reader.u32();
+  if (!reader.is_healthy() || magic != string(RECORDING_MAGIC, sizeof(RECORDING_MAGIC))) {
+    err = filename + " is not an inotify recording";
+    return;
+  }
+  if (version != RECORDING_VERSION) {
+    err = "Unsupported recording version " + std::to_string(version);
+    return;
+  }
+  if (byte_order != RECORDING_BYTE_ORDER) {
+    err = "The recording was made on a machine with a different byte order";
+    return;
+  }
+
+  RecordedBatch pending;
+  while (reader.is_healthy() && !reader.at_end()) {
+    uint8_t type = reader.u8();
+
+    if (type == RECORD_ROOT) {
+      RecordedRoot root;
+      root.channel_id = static_cast<ChannelID>(reader.u64());
+      root.root = reader.str();
+      root.recursive = reader.u8() != 0;
+      root.events = static_cast<EventMask>(reader.u32());
+      if (reader.is_healthy()) roots.push_back(move(root));
+    } else if (type == RECORD_WATCH) {
+      string path = reader.str();
+      RecordedWatch watch{};
+      watch.wd = static_cast<int>(reader.i64());
+      watch.watch_errno = static_cast<int>(reader.i64());
+      if (reader.is_healthy()) watches[path].replies.push_back(watch);
+    } else if (type == RECORD_LISTING) {
+      string path = reader.str();
+      RecordedListing listing;
+      listing.list_errno = static_cast<int>(reader.i64());
+      uint32_t count = reader.u32();
+      for (uint32_t i = 0; i < count && reader.is_healthy(); i++) {
+        listing.names.push_back(reader.str());
+      }
+      if (reader.is_healthy()) listings[path].replies.push_back(move(listing));
+    } else if (type == RECORD_READ) {
+      RecordedRead read;
+      read.result = static_cast<ssize_t>(reader.i64());
+      read.read_errno = static_cast<int>(reader.i64());
+      if (read.result > 0) read.bytes = reader.bytes(static_cast<size_t>(read.result));
+      if (!reader.is_healthy()) break;
+
+      // Every buffer is walked by trusting the length of each event within it, so refuse any that would overrun.
+      if (!holds_whole_events(read.bytes)) {
+        err = "Recording " + filename + " contains a malformed inotify event buffer";
+        return;
+      }
+
+      bool last = read.result <= 0;
+      pending.push_back(move(read));
+      if (last) {
+        batches.push_back(move(pending));
+        pending.clear();
+      }
+    } else if (type == RECORD_STAT) {
+      string path = reader.str();
+      RecordedStat stat{};
+      stat.lstat_err = static_cast<int>(reader.i64());
+      stat.mode = reader.u64();
+      stat.ino = reader.u64();
+      stat.size = reader.u64();
+      if (reader.is_healthy()) stats[path].replies.push_back(stat);
+    } else if (type == RECORD_COOKIES_EXPIRED) {
+      batches.emplace_back();
+    } else {
+      err = "Unrecognized record type " + std::to_string(type);
+      return;
+    }
+  }
+
+  // A recording that ends partway through a record, as it will if the recording process was killed, is replayed up to
+  // its last complete batch.
+  if (!reader.is_healthy()) {
+    LOGGER << "Recording " << filename << " is truncated." << endl;
+  }
+}
+
+int ReplayInotifySource::init()
+{
+  return open("/dev/null", O_RDONLY | O_CLOEXEC);
+}
+
+int ReplayInotifySource::add_watch(int /*fd*/, const string &path, uint32_t /*mask*/)
+{
+  const RecordedWatch *watch = watches[path].take();
+  if (watch == nullptr) {
+    errno = ENOENT;
+    return -1;
+  }
+
+  if (watch->wd == -1) errno = watch->watch_errno;
+  return watch->wd;
+}
+
+int ReplayInotifySource::remove_watch(int /*fd*/, int /*wd*/)
+{
+  return 0;
+}
+
+ssize_t ReplayInotifySource::read_events(int /*fd*/, char *buf, size_t size)
+{
+  if (next_batch == 0 || next_read >= batches[next_batch - 1].size()) {
+    errno = EAGAIN;
+    return -1;
+  }
+
+  const RecordedRead &read = batches[next_batch - 1][next_read++];
+  if (read.result < 0) {
+    errno = read.read_errno;
+    return read.result;
+  }
+  if (read.bytes.size() > size) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  std::memcpy(buf, read.bytes.data(), read.bytes.size());
+  return read.result;
+}
+
+int ReplayInotifySource::list_directories(const string &path, vector<string> &names)
+{
+  const RecordedListing *listing = listings[path].take();
+  if (listing == nullptr) return ENOENT;
+
+  names.insert(names.end(), listing->names.begin(), listing->names.end());
+  return listing->list_errno;
+}
+
+int ReplayInotifySource::lstat(const string &path, uv_stat_t &stat)
+{
+  const RecordedStat *recorded = stats[path].take();
+  if (recorded == nullptr) return UV_ENOENT;
+  if (recorded->lstat_err != 0) return recorded->lstat_err;
+
+  stat = uv_stat_t{};
+  stat.st_mode = recorded->mode;
+  stat.st_ino = recorded->ino;
+  stat.st_size = recorded->size;
+  return 0;
+}
+
+ReplayInotifySource::Step ReplayInotifySource::next_step()
+{
+  if (next_batch >= batches.size()) return STEP_END;
+
+  next_read = 0;
+  return batches[next_batch++].empty() ? STEP_COOKIES_EXPIRED : STEP_EVENTS;
+}
+
+size_t ReplayInotifySource::count_events() const
+{
+  size_t count = 0;
+  for (const RecordedBatch &batch : batches) {
+    for (const RecordedRead &read : batch) {
+      const char *current = read.bytes.data();
+      const char *end = current + read.bytes.size();
+      while (current < end) {
+        const auto *event = reinterpret_cast<const inotify_event *>(current);
+        current += sizeof(inotify_event) + event->len;
+        count++;
+      }
+    }
+  }
+  return count;
+}
@@ -0,0 +1,264 @@
+#ifndef INOTIFY_SOURCE_H
+#define INOTIFY_SOURCE_H
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <sys/types.h>
+#include <unordered_map>
+#include <uv.h>
+#include <vector>
+
+#include "../../message.h"
+#include "../recent_file_cache.h"
+
+// Every system call that a WatchRegistry, and the RecentFileCache used alongside it, makes to learn about the
+// filesystem. Substituting a source that records each call's results, then one that replays them, reproduces a
+// production workload deterministically without touching the disk.
+class InotifySource : public StatSource
+{
+public:
+  // Create the source for a worker thread: one that records to the file named by the environment variable `var` if
+  // it's set, or one that only makes system calls otherwise.
+  static std::unique_ptr<InotifySource> from_env(const char *var);
+
+  InotifySource() = default;
+
+  ~InotifySource() override = default;
+
+  // Create an inotify instance. Return its file descriptor, or -1 with errno set.
+  virtual int init() = 0;
+
+  // Add to or create a watch on the directory at `path`. Return its watch descriptor, or -1 with errno set.
+  virtual int add_watch(int fd, const std::string &path, uint32_t mask) = 0;
+
+  // Remove a watch descriptor. Return 0, or -1 with errno set.
+  virtual int remove_watch(int fd, int wd) = 0;
+
+  // Read a buffer of inotify events, with the same results as `read()`.
+  virtual ssize_t read_events(int fd, char *buf, size_t size) = 0;
+
+  // Append the names of the entries within the directory at `path` that may be subdirectories to `names`. Return 0 or
+  // an errno value.
+  virtual int list_directories(const std::string &path, std::vector<std::string> &names) = 0;
+
+  // A channel has begun watching `root`.
+  virtual void root_added(ChannelID /*channel_id*/,
+    const std::string & /*root*/,
+    bool /*recursive*/,
+    EventMask /*events*/)
+  {
+    //
+  }
+
+  // No events arrived for long enough that the oldest batch of unpaired rename cookies was expired.
+  virtual void cookies_expired()
+  {
+    //
+  }
+
+  InotifySource(const InotifySource &) = delete;
+  InotifySource(InotifySource &&) = delete;
+  InotifySource &operator=(const InotifySource &) = delete;
+  InotifySource &operator=(InotifySource &&) = delete;
+};
+
+// Make each call of the system.
+class SystemInotifySource : public InotifySource
+{
+public:
+  SystemInotifySource() = default;
+
+  ~SystemInotifySource() override = default;
+
+  int init() override;
+
+  int add_watch(int fd, const std::string &path, uint32_t mask) override;
+
+  int remove_watch(int fd, int wd) override;
+
+  ssize_t read_events(int fd, char *buf, size_t size) override;
+
+  int list_directories(const std::string &path, std::vector<std::string> &names) override;
+
+  int lstat(const std::string &path, uv_stat_t &stat) override;
+
+  SystemInotifySource(const SystemInotifySource &) = delete;
+  SystemInotifySource(SystemInotifySource &&) = delete;
+  SystemInotifySource &operator=(const SystemInotifySource &) = delete;
+  SystemInotifySource &operator=(SystemInotifySource &&) = delete;
+};
+
+// Make each call of the system, and append its arguments and results to a recording file.
+//
+// The file begins with the 8-byte magic `watchino`, a 32-bit format version, and a 32-bit byte order marker. A series
+// of records follows, each made of an 8-bit record type and its fields. Strings are written as a 32-bit length followed
+// by their bytes, and integers are stored in the native byte order. Raw `inotify_event` buffers are kept as they were
+// read, so a recording can only be replayed on the architecture that made it.
+class RecordingInotifySource : public SystemInotifySource
+{
+public:
+  // Open `filename` for writing. Check `get_error()` for failure.
+  explicit RecordingInotifySource(const std::string &filename);
+
+  ~RecordingInotifySource() override = default;
+
+  int add_watch(int fd, const std::string &path, uint32_t mask) override;
+
+  ssize_t read_events(int fd, char *buf, size_t size) override;
+
+  int list_directories(const std::string &path, std::vector<std::string> &names) override;
+
+  int lstat(const std::string &path, uv_stat_t &stat) override;
+
+  void root_added(ChannelID channel_id, const std::string &root, bool recursive, EventMask events) override;
+
+  void cookies_expired() override;
+
+  const std::string &get_error() const { return err; }
+
+  RecordingInotifySource(const RecordingInotifySource &) = delete;
+  RecordingInotifySource(RecordingInotifySource &&) = delete;
+  RecordingInotifySource &operator=(const RecordingInotifySource &) = delete;
+  RecordingInotifySource &operator=(RecordingInotifySource &&) = delete;
+
+private:
+  void write_u8(uint8_t value) { write_raw(&value, sizeof(value)); }
+
+  void write_u32(uint32_t value) { write_raw(&value, sizeof(value)); }
+
+  void write_i64(int64_t value) { write_raw(&value, sizeof(value)); }
+
+  void write_u64(uint64_t value) { write_raw(&value, sizeof(value)); }
+
+  void write_string(const std::string &value);
+
+  void write_raw(const void *bytes, size_t length);
+
+  std::ofstream out;
+
+  std::string err;
+};
+
+// A channel watched while a recording was made.
+struct RecordedRoot
+{
+  ChannelID channel_id;
+  std::string root;
+  bool recursive;
+  EventMask events;
+};
+
+// Answer each call with the results captured by a `RecordingInotifySource`.
+//
+// Recorded `read()` results are returned in their original order, grouped into the batches consumed by each call to
+// `WatchRegistry::consume()`. Watches, directory listings, and `lstat()` results are matched to calls by path, in the
+// order they were recorded for that path, so a replay stays meaningful when a change to the code makes more or fewer
+// of those calls. A path that has no recorded results left behaves as though it doesn't exist.
+class ReplayInotifySource : public InotifySource
+{
+public:
+  // What the worker thread did next within the recording.
+  enum Step
+  {
+    // A batch of events is ready to be read by `WatchRegistry::consume()`.
+    STEP_EVENTS,
+
+    // The oldest batch of rename cookies expired. Call `CookieJar::flush_oldest_batch()`.
+    STEP_COOKIES_EXPIRED,
+
+    // The recording is complete.
+    STEP_END
+  };
+
+  // Load the recording within `filename`. Check `get_error()` for failure, including a buffer of events that isn't
+  // made of whole `inotify_event` records.
+  explicit ReplayInotifySource(const std::string &filename);
+
+  ~ReplayInotifySource() override = default;
+
+  // Return a file descriptor for `/dev/null`, which can be safely closed by the WatchRegistry.
+  int init() override;
+
+  int add_watch(int fd, const std::string &path, uint32_t mask) override;
+
+  int remove_watch(int fd, int wd) override;
+
+  ssize_t read_events(int fd, char *buf, size_t size) override;
+
+  int list_directories(const std::string &path, std::vector<std::string> &names) override;
+
+  int lstat(const std::string &path, uv_stat_t &stat) override;
+
+  // Advance to the next step of the recording.
+  Step next_step();
+
+  const std::vector<RecordedRoot> &get_roots() const { return roots; }
+
+  // Count the inotify events within every recorded batch. Loading has already rejected any buffer whose events
+  // overrun it.
+  size_t count_events() const;
+
+  const std::string &get_error() const { return err; }
+
+  ReplayInotifySource(const ReplayInotifySource &) = delete;
+  ReplayInotifySource(ReplayInotifySource &&) = delete;
+  ReplayInotifySource &operator=(const ReplayInotifySource &) = delete;
+  ReplayInotifySource &operator=(ReplayInotifySource &&) = delete;
+
+private:
+  struct RecordedRead
+  {
+    ssize_t result;
+    int read_errno;
+    std::string bytes;
+  };
+
+  // The reads made by a single call to `WatchRegistry::consume()`, ending with the one that returned no events. An
+  // empty batch marks the expiry of rename cookies.
+  using RecordedBatch = std::vector<RecordedRead>;
+
+  struct RecordedWatch
+  {
+    int wd;
+    int watch_errno;
+  };
+
+  struct RecordedListing
+  {
+    int list_errno;
+    std::vector<std::string> names;
+  };
+
+  struct RecordedStat
+  {
+    int lstat_err;
+    uint64_t mode;
+    uint64_t ino;
+    uint64_t size;
+  };
+
+  // The results recorded for a single path, and the position of the next one to be returned.
+  template <class Reply>
+  struct Replies
+  {
+    std::vector<Reply> replies;
+    size_t next{0};
+
+    const Reply *take() { return next < replies.size() ? &replies[next++] : nullptr; }
+  };
+
+  std::vector<RecordedRoot> roots;
+  std::vector<RecordedBatch> batches;
+  std::unordered_map<std::string, Replies<RecordedWatch>> watches;
+  std::unordered_map<std::string, Replies<RecordedListing>> listings;
+  std::unordered_map<std::string, Replies<RecordedStat>> stats;
+
+  size_t next_batch{0};
+  size_t next_read{0};
+
+  std::string err;
+};
+
+#endif
@@ -4,20 +4,26 @@
 #include <string>
 #include <vector>
 
+#include "../../gitignore.h"
 #include "../../helper/linux/helper.h"
+#include "../../latency_histogram.h"
 #include "../../log.h"
 #include "../../message.h"
 #include "../../result.h"
+#include "../../status.h"
+#include "../../trace.h"
 #include "../recent_file_cache.h"
 #include "../worker_platform.h"
 #include "../worker_thread.h"
 #include "cookie_jar.h"
+#include "inotify_source.h"
 #include "pipe.h"
 #include "side_effect.h"
 #include "watch_registry.h"
 
 using std::endl;
 using std::ostream;
+using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
 using std::vector;
@@ -31,8 +37,12 @@ const int RENAME_TIMEOUT = 500;
 class LinuxWorkerPlatform : public WorkerPlatform
 {
 public:
-  LinuxWorkerPlatform(WorkerThread *thread) : WorkerPlatform(thread), cache{DEFAULT_CACHE_SIZE}
+  LinuxWorkerPlatform(WorkerThread *thread) :
+    WorkerPlatform(thread),
+    registry{InotifySource::from_env("WATCHER_RECORD_INOTIFY")},
+    cache{DEFAULT_CACHE_SIZE}
   {
+    cache.set_stat_source(registry.get_source());
     report_errable(pipe);
     report_errable(registry);
     freeze();
@@ -53,7 +63,11 @@ public:
     to_poll[1].revents = 0;
 
     while (true) {
-      int result = poll(to_poll, 2, RENAME_TIMEOUT);
+      int result = 0;
+      {
+        TRACE_SPAN("poll wait");
+        result = poll(to_poll, 2, RENAME_TIMEOUT);
+      }
 
       if (result < 0) {
         return errno_result<>("Unable to poll");
@@ -62,6 +76,7 @@ public:
       if (result == 0) {
         // Poll timeout. Cycle the CookieJar.
         MessageBuffer messages;
+        registry.get_source()->cookies_expired();
         jar.flush_oldest_batch(messages, cache);
 
         if (!messages.empty()) {
@@ -84,7 +99,9 @@ public:
       if ((to_poll[1].revents & (POLLIN | POLLERR)) != 0u) {
         MessageBuffer messages;
 
+        uint64_t consume_start = monotonic_ns();
         Result<> cr = registry.consume(messages, jar, cache);
+        consume_durations.record_since(consume_start);
         if (cr.is_error()) LOGGER << cr << endl;
 
         if (!messages.empty()) {
@@ -101,7 +118,10 @@ public:
   Result<bool> handle_add_command(CommandID /*command*/,
     ChannelID channel,
     const string &root_path,
-    bool recursive) override
+    bool recursive,
+    EventMask events,
+    const shared_ptr<const PathMatcher> &exclusions,
+    bool gitignore) override
   {
     Timer t;
     vector<string> poll;
@@ -112,7 +132,10 @@ public:
     }
     logline << " at channel " << channel << "." << endl;
 
-    Result<> r = registry.add(channel, string(root_path), recursive, poll);
+    shared_ptr<GitIgnore> ignored;
+    if (gitignore) ignored.reset(new GitIgnore(string(root_path)));
+
+    Result<> r = registry.add(channel, string(root_path), recursive, events, exclusions, ignored, poll);
     if (r.is_error()) return r.propagate<bool>();
 
     if (!poll.empty()) {
@@ -120,8 +143,9 @@ public:
       poll_messages.reserve(poll.size());
 
       for (string &poll_root : poll) {
-        poll_messages.emplace_back(
-          CommandPayloadBuilder::add(channel, move(poll_root), recursive, poll.size()).build());
+        CommandPayloadBuilder builder = CommandPayloadBuilder::add(channel, move(poll_root), recursive, poll.size());
+        builder.set_events(events).set_exclusions(exclusions).set_gitignore(gitignore);
+        poll_messages.emplace_back(builder.build());
       }
 
       t.stop();
@@ -141,6 +165,11 @@ public:
     return registry.remove(channel).propagate(true);
   }
 
+  void populate_status(Status &status) override
+  {
+    registry.populate_status(status);
+  }
+
 private:
   Pipe pipe;
   WatchRegistry registry;
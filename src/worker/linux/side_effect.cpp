@@ -8,6 +8,7 @@
 #include "../../result.h"
 #include "side_effect.h"
 #include "watch_registry.h"
+#include "watched_directory.h"
 
 using std::move;
 using std::shared_ptr;
@@ -31,12 +32,28 @@ void SideEffect::enact_in(const shared_ptr<WatchedDirectory> &parent, WatchRegis
       continue;
     }
 
+    // Copy the channel's settings, because adding the subdirectory may change the parent's subscriptions.
+    const WatchedDirectory::Subscription *found = parent->subscription_for(subdir.channel_id);
+    if (found == nullptr) continue;
+    WatchedDirectory::Subscription subscription(*found);
+
     vector<string> poll_roots;
-    Result<> r = registry->add(subdir.channel_id, parent, subdir.basename, true, poll_roots);
+    Result<> r = registry->add(subdir.channel_id,
+      parent,
+      subdir.basename,
+      true,
+      subscription.events,
+      subscription.exclusions,
+      subscription.gitignore,
+      poll_roots);
     if (r.is_error()) messages.error(subdir.channel_id, string(r.get_error()), false);
 
     for (string &poll_root : poll_roots) {
-      messages.add(Message(CommandPayloadBuilder::add(subdir.channel_id, move(poll_root), true, 1).build()));
+      CommandPayloadBuilder builder = CommandPayloadBuilder::add(subdir.channel_id, move(poll_root), true, 1);
+      builder.set_events(subscription.events)
+        .set_exclusions(subscription.exclusions)
+        .set_gitignore(subscription.gitignore != nullptr);
+      messages.add(Message(builder.build()));
     }
   }
 }
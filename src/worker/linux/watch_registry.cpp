@@ -1,21 +1,27 @@
 #include <cerrno>
-#include <dirent.h>
 #include <iostream>
 #include <memory>
-#include <set>
 #include <sstream>
 #include <string>
 #include <sys/inotify.h>
 #include <sys/types.h>
 #include <unistd.h>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include "../../channel_stats.h"
+#include "../../gitignore.h"
 #include "../../helper/linux/helper.h"
 #include "../../log.h"
 #include "../../message.h"
 #include "../../message_buffer.h"
+#include "../../metrics.h"
+#include "../../path_matcher.h"
 #include "../../result.h"
+#include "../../status.h"
+#include "../../probes.h"
+#include "../../trace.h"
 #include "../recent_file_cache.h"
 #include "cookie_jar.h"
 #include "side_effect.h"
@@ -23,17 +29,15 @@
 #include "watched_directory.h"
 
 using std::endl;
+using std::move;
 using std::ostream;
 using std::ostringstream;
-using std::set;
 using std::shared_ptr;
 using std::string;
-using std::unordered_multimap;
+using std::unique_ptr;
 using std::vector;
 
 using WatchedDirectoryPtr = shared_ptr<WatchedDirectory>;
-using WDMap = unordered_multimap<int, WatchedDirectoryPtr>;
-using WDIter = WDMap::iterator;
 
 static ostream &operator<<(ostream &out, const inotify_event *event)
 {
@@ -65,9 +69,43 @@ static ostream &operator<<(ostream &out, const inotify_event *event)
   return out;
 }
 
-WatchRegistry::WatchRegistry()
+// Choose the inotify events needed to deliver a channel's event classes. Creation and rename events are always needed
+// within recursively watched trees to discover new subdirectories. Watch descriptors are shared among every channel
+// that watches the same directory, so use IN_MASK_ADD to extend an existing descriptor's mask rather than replacing
+// it. `WatchRegistry::narrow()` replaces it once a channel lets go.
+static uint32_t inotify_mask(EventMask events, bool recursive, bool gitignore)
 {
-  inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  uint32_t mask = IN_DELETE_SELF | IN_MOVE_SELF | IN_DONT_FOLLOW | IN_EXCL_UNLINK | IN_ONLYDIR | IN_MASK_ADD;
+
+  if ((events & EVENT_CREATED) != 0u || recursive) mask |= IN_CREATE;
+  if ((events & EVENT_DELETED) != 0u) mask |= IN_DELETE;
+  if ((events & (EVENT_CREATED | EVENT_DELETED | EVENT_RENAMED)) != 0u || recursive) {
+    mask |= IN_MOVED_FROM | IN_MOVED_TO;
+  }
+  if ((events & EVENT_SETTLED) != 0u) {
+    mask |= IN_CLOSE_WRITE;
+  } else if ((events & EVENT_MODIFIED) != 0u) {
+    mask |= IN_MODIFY;
+  }
+  if ((events & EVENT_ATTRIBUTES) != 0u) mask |= IN_ATTRIB;
+
+  // Learn about every change to a .gitignore file, whether or not it will be reported.
+  if (gitignore) mask |= IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE;
+
+  return mask;
+}
+
+static bool is_excluded(const string &path,
+  const shared_ptr<const PathMatcher> &exclusions,
+  const shared_ptr<GitIgnore> &gitignore)
+{
+  if (exclusions && exclusions->excludes(path, true)) return true;
+  return gitignore && gitignore->excludes(path, true);
+}
+
+WatchRegistry::WatchRegistry(unique_ptr<InotifySource> source) : source{move(source)}
+{
+  inotify_fd = this->source->init();
 
   if (inotify_fd == -1) {
     report_if_error(errno_result("Unable to initialize inotify"));
@@ -86,10 +124,13 @@ Result<> WatchRegistry::add(ChannelID channel_id,
   const shared_ptr<WatchedDirectory> &parent,
   const string &name,
   bool recursive,
+  EventMask events,
+  const shared_ptr<const PathMatcher> &exclusions,
+  const shared_ptr<GitIgnore> &gitignore,
   vector<string> &poll)
 {
-  uint32_t mask = IN_ATTRIB | IN_CREATE | IN_DELETE | IN_DELETE_SELF | IN_MODIFY | IN_MOVE_SELF | IN_MOVED_FROM
-    | IN_MOVED_TO | IN_DONT_FOLLOW | IN_EXCL_UNLINK | IN_ONLYDIR;
+  TRACE_SPAN("WatchRegistry::add");
+  uint32_t mask = inotify_mask(events, recursive, gitignore != nullptr);
 
   ostringstream absolute_builder;
   if (parent) {
@@ -98,21 +139,40 @@ Result<> WatchRegistry::add(ChannelID channel_id,
   absolute_builder << name;
   string absolute = absolute_builder.str();
 
-  ostream &logline = LOGGER << "Watching path [" << absolute << "]";
-  if (!recursive) logline << " (non-recursively)";
-  logline << "." << endl;
+  bool excluded = is_excluded(absolute, exclusions, gitignore);
+  if (excluded && !parent) {
+    LOG_AT(LOG_LEVEL_INFO, LOG_GENERAL)
+      << "Excluding path [" << absolute << "] from channel " << channel_id << "." << endl;
+    return ok_result();
+  }
+
+  if (!parent) source->root_added(channel_id, absolute, recursive, events);
+
+  if (excluded) {
+    LOG_AT(LOG_LEVEL_DEBUG, LOG_GENERAL)
+      << "Excluding path [" << absolute << "] from channel " << channel_id << "." << endl;
+
+    // The directory may be one that this channel already watches, renamed to an excluded name. Look up its watch
+    // descriptor without widening the events that it reports.
+    mask = inotify_mask(0, false, false);
+  } else {
+    LOG_AT(parent ? LOG_LEVEL_DEBUG : LOG_LEVEL_INFO, LOG_GENERAL)
+      << "Watching path [" << absolute << "]" << (recursive ? "" : " (non-recursively)") << "." << endl;
+  }
 
-  int wd = inotify_add_watch(inotify_fd, absolute.c_str(), mask);
+  int wd = source->add_watch(inotify_fd, absolute, mask);
   if (wd == -1) {
     int watch_errno = errno;
 
     if (watch_errno == ENOENT || watch_errno == EACCES) {
-      LOGGER << "Directory " << absolute << " is no longer accessible. Ignoring." << endl;
+      LOG_AT(LOG_LEVEL_DEBUG, LOG_GENERAL) << "Directory " << absolute << " is no longer accessible. Ignoring." << endl;
       return ok_result();
     }
 
+    if (excluded) return ok_result();
+
     if (watch_errno == ENOSPC) {
-      LOGGER << "Falling back to polling for directory " << absolute << "." << endl;
+      LOG_AT(LOG_LEVEL_INFO, LOG_GENERAL) << "Falling back to polling for directory " << absolute << "." << endl;
       poll.push_back(absolute);
       return ok_result();
     }
@@ -120,64 +180,88 @@ Result<> WatchRegistry::add(ChannelID channel_id,
     return errno_result("Unable to watch directory", watch_errno);
   }
 
-  LOGGER << "Assigned watch descriptor " << wd << " at [" << absolute << "] on channel " << channel_id << "." << endl;
+  auto existing = by_wd.find(wd);
+  if (excluded) {
+    if (existing == by_wd.end()) {
+      // No channel watches this directory, so the descriptor was created just to find that out.
+      source->remove_watch(inotify_fd, wd);
+      return ok_result();
+    }
 
-  auto range = by_wd.equal_range(wd);
-  bool updated = false;
-  for (auto existing = range.first; existing != range.second; ++existing) {
-    shared_ptr<WatchedDirectory> &other = existing->second;
-    if (other->get_channel_id() == channel_id) {
-      assert(parent != nullptr);
-      updated = true;
-      other->was_renamed(parent, name);
+    WatchedDirectoryPtr watched_dir = existing->second;
+    if (watched_dir->subscription_for(channel_id) != nullptr) {
+      // This channel watched the directory under its former name. Other channels sharing it may still cover its new
+      // location, so move it within the shared tree before this channel lets go of it.
+      watched_dir->was_renamed(parent, name);
+      unsubscribe_within(channel_id, watched_dir);
+      if (watched_dir->get_subscriptions().empty()) return ok_result();
+      prune_moved(watched_dir);
     }
+    return ok_result();
   }
-  if (updated) return ok_result();
 
-  shared_ptr<WatchedDirectory> watched_dir(new WatchedDirectory(wd, channel_id, parent, string(name), recursive));
+  LOG_AT(LOG_LEVEL_DEBUG, LOG_GENERAL)
+    << "Assigned watch descriptor " << wd << " at [" << absolute << "] on channel " << channel_id << "." << endl;
 
-  by_wd.emplace(wd, watched_dir);
+  WatchedDirectory::Subscription subscription{channel_id,
+    parent == nullptr,
+    parent == nullptr ? absolute : string(),
+    recursive,
+    events,
+    exclusions,
+    gitignore,
+    &channel_stats[channel_id]};
+
+  shared_ptr<WatchedDirectory> watched_dir;
+  if (existing != by_wd.end()) {
+    watched_dir = existing->second;
+
+    if (watched_dir->subscription_for(channel_id) != nullptr) {
+      // This channel already watches this directory, so it must have been renamed within the channel's tree.
+      assert(parent != nullptr);
+      watched_dir->was_renamed(parent, name);
+      prune_moved(watched_dir);
+      return ok_result();
+    }
+
+    // Another channel already watches this directory. Join the shared tree, adopting this channel's parent if the
+    // directory was only known as the root of another channel's watch.
+    if (parent && watched_dir->get_parent() == nullptr) watched_dir->was_renamed(parent, name);
+    LOG_AT(LOG_LEVEL_DEBUG, LOG_GENERAL) << "Sharing watch descriptor " << wd << " with "
+           << plural(watched_dir->get_subscriptions().size(), "other channel") << "." << endl;
+  } else {
+    watched_dir.reset(new WatchedDirectory(wd, parent, string(name)));
+    by_wd.emplace(wd, watched_dir);
+    Metrics::get().worker_watch_count.set(by_wd.size());
+  }
+
+  watched_dir->set_mask(watched_dir->get_mask() | (mask & ~IN_MASK_ADD));
+  watched_dir->subscribe(move(subscription));
   by_channel.emplace(channel_id, watched_dir);
 
   if (recursive) {
-    DIR *dir = opendir(absolute.c_str());
-    if (dir == nullptr) {
-      int open_errno = errno;
-      if (open_errno != EACCES && open_errno != ENOENT && open_errno != ENOTDIR) {
-        return errno_result("Unable to recurse into directory " + absolute, open_errno);
-      }
-    } else {
-      errno = 0;
-      dirent *entry = readdir(dir);
-      while (entry != nullptr) {
-        string basename(entry->d_name);
-
-        if (basename == "." || basename == "..") {
-          entry = readdir(dir);
-          continue;
-        }
-
-#ifdef _DIRENT_HAVE_D_TYPE
-        if (entry->d_type == DT_DIR || entry->d_type == DT_UNKNOWN) {
-          Result<> add_r = add(channel_id, watched_dir, basename, recursive, poll);
-          if (add_r.is_error()) {
-            LOGGER << "Unable to recurse into " << absolute << "/" << basename << ": " << add_r << "." << endl;
-          }
-        }
-#else
-        Result<> add_r = add(channel_id, watched_dir, basename, recursive, poll);
-        if (add_r.is_error()) {
-          LOGGER << "Unable to recurse into " << absolute << "/" << basename << ": " << add_r << "." << endl;
-        }
-#endif
-
-        errno = 0;
-        entry = readdir(dir);
+    vector<string> subdirectories;
+    int list_errno = source->list_directories(absolute, subdirectories);
+    if (list_errno == EACCES || list_errno == ENOENT || list_errno == ENOTDIR) return ok_result();
+
+    for (const string &basename : subdirectories) {
+      // A subdirectory found by this crawl can't already be watched by this channel, so leave excluded ones alone
+      // before making any system calls for them.
+      if ((exclusions || gitignore) && is_excluded(absolute + "/" + basename, exclusions, gitignore)) {
+        LOG_AT(LOG_LEVEL_DEBUG, LOG_GENERAL)
+          << "Excluding path [" << absolute << "/" << basename << "] from channel " << channel_id << "." << endl;
+        continue;
       }
-      if (errno != 0) {
-        return errno_result("Unable to iterate entries of directory " + absolute);
+
+      Result<> add_r = add(channel_id, watched_dir, basename, recursive, events, exclusions, gitignore, poll);
+      if (add_r.is_error()) {
+        LOG_AT(LOG_LEVEL_ERROR, LOG_GENERAL)
+          << "Unable to recurse into " << absolute << "/" << basename << ": " << add_r << "." << endl;
       }
-      closedir(dir);
+    }
+
+    if (list_errno != 0) {
+      return errno_result("Unable to iterate entries of directory " + absolute, list_errno);
     }
   }
 
@@ -187,41 +271,120 @@ Result<> WatchRegistry::add(ChannelID channel_id,
 Result<> WatchRegistry::remove(ChannelID channel_id)
 {
   auto its = by_channel.equal_range(channel_id);
-  set<int> wds;
+  vector<WatchedDirectoryPtr> watched_dirs;
   for (auto it = its.first; it != its.second; ++it) {
-    wds.insert(it->second->get_descriptor());
+    watched_dirs.push_back(it->second);
   }
 
-  LOGGER << "Stopping " << plural(wds.size(), "inotify watch descriptor") << "." << endl;
+  LOG_AT(LOG_LEVEL_INFO, LOG_GENERAL)
+    << "Stopping " << plural(watched_dirs.size(), "inotify watch descriptor") << "." << endl;
 
   by_channel.erase(channel_id);
-  for (auto &wd : wds) {
-    auto wd_matches = by_wd.equal_range(wd);
+  for (WatchedDirectoryPtr &watched_dir : watched_dirs) {
+    unsubscribe(channel_id, watched_dir);
+  }
+  channel_stats.erase(channel_id);
 
-    vector<WDIter> to_erase;
-    for (auto each_wd = wd_matches.first; each_wd != wd_matches.second; ++each_wd) {
-      if (each_wd->second->get_channel_id() == channel_id) {
-        to_erase.push_back(each_wd);
-      }
-    }
-    for (WDIter &it : to_erase) {
-      by_wd.erase(it);
-    }
+  LOG_AT(LOG_LEVEL_INFO, LOG_GENERAL) << "Channel " << channel_id << " has been unwatched." << endl;
+  return ok_result();
+}
 
-    if (by_wd.count(wd) == 0) {
-      int err = inotify_rm_watch(inotify_fd, wd);
-      if (err == -1) {
-        LOGGER << "Unable to remove watch descriptor " << wd << ": " << errno_result<>("") << "." << endl;
-      }
+void WatchRegistry::release(const WatchedDirectoryPtr &watched_dir)
+{
+  int wd = watched_dir->get_descriptor();
+
+  auto existing = by_wd.find(wd);
+  if (existing == by_wd.end() || existing->second != watched_dir) return;
+  by_wd.erase(existing);
+  Metrics::get().worker_watch_count.set(by_wd.size());
+
+  int err = source->remove_watch(inotify_fd, wd);
+  if (err == -1) {
+    LOG_AT(LOG_LEVEL_ERROR, LOG_GENERAL)
+      << "Unable to remove watch descriptor " << wd << ": " << errno_result<>("") << "." << endl;
+  }
+}
+
+void WatchRegistry::prune_moved(const WatchedDirectoryPtr &watched_dir)
+{
+  const WatchedDirectoryPtr &parent = watched_dir->get_parent();
+
+  // Channels that still cover the new location, and channels rooted at the directory itself, keep their subscriptions.
+  vector<ChannelID> departed;
+  for (const WatchedDirectory::Subscription &subscription : watched_dir->get_subscriptions()) {
+    if (subscription.root) continue;
+
+    const WatchedDirectory::Subscription *covering = nullptr;
+    if (parent) covering = parent->subscription_for(subscription.channel_id);
+    if (covering == nullptr || !covering->recursive) departed.push_back(subscription.channel_id);
+  }
+
+  for (ChannelID channel_id : departed) {
+    LOG_AT(LOG_LEVEL_DEBUG, LOG_GENERAL) << "Directory [" << watched_dir->get_absolute_path()
+                                         << "] has left the tree watched by channel " << channel_id << "." << endl;
+    unsubscribe_within(channel_id, watched_dir);
+  }
+}
+
+void WatchRegistry::unsubscribe_within(ChannelID channel_id, const WatchedDirectoryPtr &watched_dir)
+{
+  auto its = by_channel.equal_range(channel_id);
+  auto it = its.first;
+  while (it != its.second) {
+    WatchedDirectoryPtr each = it->second;
+    if (!each->is_within(watched_dir.get())) {
+      ++it;
+      continue;
     }
+
+    it = by_channel.erase(it);
+    unsubscribe(channel_id, each);
   }
+}
 
-  LOGGER << "Channel " << channel_id << " has been unwatched." << endl;
-  return ok_result();
+void WatchRegistry::unsubscribe(ChannelID channel_id, const WatchedDirectoryPtr &watched_dir)
+{
+  if (watched_dir->unsubscribe(channel_id)) {
+    release(watched_dir);
+  } else {
+    narrow(watched_dir);
+  }
+}
+
+void WatchRegistry::narrow(const WatchedDirectoryPtr &watched_dir)
+{
+  uint32_t mask = 0;
+  for (const WatchedDirectory::Subscription &subscription : watched_dir->get_subscriptions()) {
+    mask |= inotify_mask(subscription.events, subscription.recursive, subscription.gitignore != nullptr);
+  }
+  mask &= ~IN_MASK_ADD;
+  if (mask == watched_dir->get_mask()) return;
+
+  // Without IN_MASK_ADD, the new mask replaces the old one.
+  int wd = watched_dir->get_descriptor();
+  string absolute = watched_dir->get_absolute_path();
+  int result = source->add_watch(inotify_fd, absolute, mask);
+  if (result == wd) {
+    watched_dir->set_mask(mask);
+    return;
+  }
+
+  if (result == -1) {
+    LOG_AT(LOG_LEVEL_ERROR, LOG_GENERAL)
+      << "Unable to narrow watch descriptor " << wd << " at [" << absolute << "]: " << errno_result<>("") << "."
+      << endl;
+    return;
+  }
+
+  // The path no longer leads to this directory. Don't leave a watch on whatever it leads to now.
+  LOG_AT(LOG_LEVEL_DEBUG, LOG_GENERAL)
+    << "Directory [" << absolute << "] has moved. Leaving the mask of watch descriptor " << wd << " as it is." << endl;
+  if (by_wd.find(result) == by_wd.end()) source->remove_watch(inotify_fd, result);
 }
 
 Result<> WatchRegistry::consume(MessageBuffer &messages, CookieJar &jar, RecentFileCache &cache)
 {
+  TRACE_SPAN("WatchRegistry::consume");
   Timer t;
   const size_t BUFSIZE = 2048 * sizeof(inotify_event);
   char buf[BUFSIZE] __attribute__((aligned(__alignof__(struct inotify_event))));
@@ -230,15 +393,17 @@ Result<> WatchRegistry::consume(MessageBuffer &messages, CookieJar &jar, RecentF
   size_t event_count = 0;
 
   while (true) {
-    result = read(inotify_fd, &buf, BUFSIZE);
+    result = source->read_events(inotify_fd, buf, BUFSIZE);
 
     if (result <= 0) {
       jar.flush_oldest_batch(messages, cache);
+      Metrics::get().worker_events_read.add(event_count);
 
       t.stop();
-      LOGGER << plural(batch_count, "filesystem event batch", "filesystem event batches") << " containing "
-             << plural(event_count, "event") << " completed. " << plural(messages.size(), "message") << " produced in "
-             << t << "." << endl;
+      LOG_AT(LOG_LEVEL_DEBUG, LOG_EVENTS)
+        << plural(batch_count, "filesystem event batch", "filesystem event batches") << " containing "
+        << plural(event_count, "event") << " completed. " << plural(messages.size(), "message") << " produced in " << t
+        << "." << endl;
     }
 
     if (result < 0) {
@@ -258,38 +423,57 @@ Result<> WatchRegistry::consume(MessageBuffer &messages, CookieJar &jar, RecentF
 
     // At least one inotify event to read.
     batch_count++;
+    size_t event_count_before = event_count;
     char *current = buf;
     inotify_event *event = nullptr;
     while (current < buf + result) {
       event = reinterpret_cast<inotify_event *>(current);
       current += sizeof(inotify_event) + event->len;
 
-      LOGGER << "Received inotify event: " << event << "." << endl;
+      LOG_AT(LOG_LEVEL_DEBUG, LOG_EVENTS) << "Received inotify event: " << event << "." << endl;
 
       if ((event->mask & IN_Q_OVERFLOW) == IN_Q_OVERFLOW) {
-        LOGGER << "Event queue overflow. Some events have been missed." << endl;
+        LOG_AT(LOG_LEVEL_ERROR, LOG_EVENTS) << "Event queue overflow. Some events have been missed." << endl;
         continue;
       }
 
-      auto its = by_wd.equal_range(event->wd);
-      if (its.first == by_wd.end() && its.second == by_wd.end()) {
-        LOGGER << "Received event for unknown watch descriptor " << event->wd << "." << endl;
+      auto found = by_wd.find(event->wd);
+      if (found == by_wd.end()) {
+        LOG_AT(LOG_LEVEL_DEBUG, LOG_EVENTS) << "Received event for unknown watch descriptor " << event->wd << "."
+                                            << endl;
         continue;
       }
 
       event_count++;
 
-      vector<shared_ptr<WatchedDirectory>> watched_directories;
-      for (auto it = its.first; it != its.second; ++it) {
-        watched_directories.emplace_back(it->second);
-      }
+      // Hold a reference in case a side effect releases this directory.
+      WatchedDirectoryPtr watched_directory = found->second;
 
-      for (shared_ptr<WatchedDirectory> &watched_directory : watched_directories) {
-        SideEffect side;
-        Result<> r = watched_directory->accept_event(messages, jar, side, cache, *event);
-        if (r.is_error()) LOGGER << "Unable to process event: " << r << "." << endl;
-        side.enact_in(watched_directory, this, messages);
-      }
+      SideEffect side;
+      Result<> r = watched_directory->accept_event(messages, jar, side, cache, *event);
+      if (r.is_error()) LOG_AT(LOG_LEVEL_ERROR, LOG_EVENTS) << "Unable to process event: " << r << "." << endl;
+
+      side.enact_in(watched_directory, this, messages);
     }
+    WATCHER_PROBE2(inotify_read, result, event_count - event_count_before);
+  }
+}
+
+void WatchRegistry::populate_status(Status &status) const
+{
+  status.worker_watch_descriptor_count = by_wd.size();
+
+  for (auto &pair : by_channel) {
+    ChannelStats &stats = status.channel_stats[pair.first];
+    stats.worker_watch_count++;
+  }
+  status.worker_channel_count = status.channel_stats.size();
+
+  for (auto &pair : channel_stats) {
+    auto existing = status.channel_stats.find(pair.first);
+    if (existing == status.channel_stats.end()) continue;
+
+    existing->second.worker_events_read = pair.second.worker_events_read;
+    existing->second.worker_stats = pair.second.worker_stats;
   }
 }
@@ -7,32 +7,46 @@
 #include <unordered_map>
 #include <vector>
 
+#include "../../channel_stats.h"
 #include "../../errable.h"
 #include "../../message_buffer.h"
 #include "../../result.h"
+#include "../../status.h"
 #include "../recent_file_cache.h"
 #include "cookie_jar.h"
+#include "inotify_source.h"
 #include "side_effect.h"
 #include "watched_directory.h"
 
-// Manage the set of open inotify watch descriptors.
+// Manage the set of open inotify watch descriptors. Channels with overlapping watches share a single tree of
+// WatchedDirectories, each carrying a Subscription for every channel that covers it.
 class WatchRegistry : public Errable
 {
 public:
   // Initialize inotify. Enter an error state if inotify initialization fails.
-  WatchRegistry();
+  WatchRegistry() : WatchRegistry(std::unique_ptr<InotifySource>(new SystemInotifySource())) {}
+
+  // Initialize inotify through `source`, which makes every system call on the registry's behalf.
+  explicit WatchRegistry(std::unique_ptr<InotifySource> source);
 
   // Stop inotify and release all kernel resources associated with it.
   ~WatchRegistry() override;
 
   // Begin watching a root path. If `recursive` is `true`, recursively watch all subdirectories as well. If inotify
   // watch descriptors are exhausted before the entire directory tree can be watched, the unsuccessfully watched roots
-  // will be accumulated into the `poll` vector.
+  // will be accumulated into the `poll` vector. Only request the inotify events necessary to deliver the event classes
+  // within `events`.
   //
   // `root` must name a directory if `recursive` is `true`.
-  Result<> add(ChannelID channel_id, const std::string &root, bool recursive, std::vector<std::string> &poll)
+  Result<> add(ChannelID channel_id,
+    const std::string &root,
+    bool recursive,
+    EventMask events,
+    const std::shared_ptr<const PathMatcher> &exclusions,
+    const std::shared_ptr<GitIgnore> &gitignore,
+    std::vector<std::string> &poll)
   {
-    return add(channel_id, nullptr, root, recursive, poll);
+    return add(channel_id, nullptr, root, recursive, events, exclusions, gitignore, poll);
   }
 
   // Begin watching path beneath an existing WatchedDirectory. If `recursive` is `true`, recursively watch all
@@ -44,6 +58,9 @@ public:
     const std::shared_ptr<WatchedDirectory> &parent,
     const std::string &name,
     bool recursive,
+    EventMask events,
+    const std::shared_ptr<const PathMatcher> &exclusions,
+    const std::shared_ptr<GitIgnore> &gitignore,
     std::vector<std::string> &poll);
 
   // Uninstall inotify watchers used to deliver events on a specified channel.
@@ -59,15 +76,48 @@ public:
   // available.
   int get_read_fd() { return inotify_fd; }
 
+  // Return the source of system calls, to share it with the RecentFileCache used alongside this registry.
+  InotifySource *get_source() { return source.get(); }
+
+  // Report the number of watch descriptors and channels, and the work done on behalf of each channel.
+  void populate_status(Status &status) const;
+
   WatchRegistry(const WatchRegistry &) = delete;
   WatchRegistry(WatchRegistry &&) = delete;
   WatchRegistry &operator=(const WatchRegistry &) = delete;
   WatchRegistry &operator=(WatchRegistry &&) = delete;
 
 private:
+  // Stop delivering events on `watched_dir` to a channel. Release it if no other channel remains subscribed, or narrow
+  // its mask to the events that the remaining channels need.
+  void unsubscribe(ChannelID channel_id, const std::shared_ptr<WatchedDirectory> &watched_dir);
+
+  // Stop watching a directory that no channel is subscribed to any longer.
+  void release(const std::shared_ptr<WatchedDirectory> &watched_dir);
+
+  // Replace the mask of a directory's watch descriptor with the union of the masks needed by its subscriptions, so
+  // that the kernel stops queueing events that only a departed channel wanted.
+  void narrow(const std::shared_ptr<WatchedDirectory> &watched_dir);
+
+  // A directory has been renamed to a new parent. Unsubscribe channels whose watches no longer cover its new location
+  // from it and everything beneath it.
+  void prune_moved(const std::shared_ptr<WatchedDirectory> &watched_dir);
+
+  // Unsubscribe a channel from `watched_dir` and everything beneath it, releasing any directories left unwatched.
+  void unsubscribe_within(ChannelID channel_id, const std::shared_ptr<WatchedDirectory> &watched_dir);
+
+  std::unique_ptr<InotifySource> source;
+
   int inotify_fd;
-  std::unordered_multimap<int, std::shared_ptr<WatchedDirectory>> by_wd;
+
+  // Each watched directory is shared by every channel that watches it, so a kernel event is only interpreted once.
+  std::unordered_map<int, std::shared_ptr<WatchedDirectory>> by_wd;
   std::unordered_multimap<ChannelID, std::shared_ptr<WatchedDirectory>> by_channel;
+
+  // Events read and `lstat()` calls made on behalf of each channel, counted by WatchedDirectory through the pointer
+  // held by each Subscription. Elements of an unordered_map stay put when it rehashes. Watch descriptor counts are
+  // filled in by `populate_status()`.
+  std::unordered_map<ChannelID, ChannelStats> channel_stats;
 };
 
 #endif
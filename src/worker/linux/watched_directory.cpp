@@ -1,11 +1,15 @@
+#include <dirent.h>
 #include <memory>
 #include <sstream>
 #include <string>
 #include <sys/inotify.h>
 #include <utility>
 
+#include "../../gitignore.h"
 #include "../../message.h"
 #include "../../message_buffer.h"
+#include "../../metrics.h"
+#include "../../path_matcher.h"
 #include "../../result.h"
 #include "../recent_file_cache.h"
 #include "cookie_jar.h"
@@ -17,12 +21,8 @@ using std::ostringstream;
 using std::shared_ptr;
 using std::string;
 
-WatchedDirectory::WatchedDirectory(int wd,
-  ChannelID channel_id,
-  shared_ptr<WatchedDirectory> parent,
-  string &&name,
-  bool recursive) :
-  wd{wd}, channel_id{channel_id}, parent{parent}, name{move(name)}, recursive{recursive}
+WatchedDirectory::WatchedDirectory(int wd, shared_ptr<WatchedDirectory> parent, string &&name) :
+  wd{wd}, mask{0}, parent{move(parent)}, name{move(name)}
 {
   //
 }
@@ -33,79 +33,213 @@ Result<> WatchedDirectory::accept_event(MessageBuffer &buffer,
   RecentFileCache &cache,
   const inotify_event &event)
 {
-  string basename{event.name};
   string path = absolute_event_path(event);
-
   bool dir_hint = (event.mask & IN_ISDIR) == IN_ISDIR;
 
-  // Read or refresh the cached lstat() entry primarily to determine if this entry is a symlink or not.
-  shared_ptr<StatResult> stat = cache.former_at_path(path, !dir_hint, dir_hint, false);
-  if (stat->is_absent()) {
-    stat = cache.current_at_path(path, !dir_hint, dir_hint, false);
-    cache.apply();
+  // A .gitignore may change without any events being reported, so check for one before filtering.
+  const uint32_t changes = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE;
+  if (event.len > 0 && (event.mask & changes) != 0u) {
+    for (const Subscription &subscription : subscriptions) {
+      if (subscription.gitignore && subscription.gitignore->changed(path) && subscription.recursive) {
+        retrack_subdirectories(side, subscription.channel_id);
+      }
+    }
   }
-  EntryKind kind = stat->get_entry_kind();
+
+  // Read the cached lstat() entry lazily, and only once no matter how many channels are subscribed.
+  shared_ptr<StatResult> stat;
+
+  for (const Subscription &subscription : subscriptions) {
+    subscription.stats->worker_events_read++;
+    if (!is_relevant(subscription, event)) continue;
+
+    // Drop events on excluded entries before paying for a stat() or tracking any subdirectories they create.
+    if (event.len > 0 && is_excluded(subscription, path, dir_hint)) {
+      // A directory renamed to an excluded name may be one this channel already watches. Let the registry find out,
+      // so that it stops reporting events beneath the directory's former path.
+      if ((event.mask & IN_MOVED_TO) == IN_MOVED_TO && dir_hint && subscription.recursive) {
+        side.track_subdirectory(string(event.name), subscription.channel_id);
+      }
+      continue;
+    }
+
+    // Read or refresh the cached lstat() entry primarily to determine if this entry is a symlink or not.
+    if (!stat) {
+      stat = cache.former_at_path(path, !dir_hint, dir_hint, false);
+      if (stat->is_absent()) {
+        uint64_t stats_before = Metrics::get().worker_stats.get();
+        stat = cache.current_at_path(path, !dir_hint, dir_hint, false);
+        cache.apply();
+        subscription.stats->worker_stats += Metrics::get().worker_stats.get() - stats_before;
+      }
+    }
+
+    deliver(subscription, buffer, jar, side, cache, event, path, stat->get_entry_kind());
+  }
+
+  return ok_result();
+}
+
+void WatchedDirectory::deliver(const Subscription &subscription,
+  MessageBuffer &buffer,
+  CookieJar &jar,
+  SideEffect &side,
+  RecentFileCache &cache,
+  const inotify_event &event,
+  const string &path,
+  EntryKind kind)
+{
+  ChannelID channel_id = subscription.channel_id;
+  EventMask events = subscription.events;
+  bool recursive = subscription.recursive;
 
   if ((event.mask & IN_CREATE) == IN_CREATE) {
     // create entry inside directory
     if (kind == KIND_DIRECTORY && recursive) {
-      side.track_subdirectory(basename, channel_id);
+      side.track_subdirectory(string(event.name), channel_id);
     }
-    buffer.created(channel_id, move(path), kind);
-    return ok_result();
+    if ((events & EVENT_CREATED) != 0u) buffer.created(channel_id, string(path), kind);
+    return;
   }
 
   if ((event.mask & IN_DELETE) == IN_DELETE) {
     // delete entry inside directory
     cache.evict(path);
-    buffer.deleted(channel_id, move(path), kind);
-    return ok_result();
+    buffer.deleted(channel_id, string(path), kind);
+    return;
   }
 
-  if ((event.mask & (IN_MODIFY | IN_ATTRIB)) != 0u) {
-    // modify entry inside directory or attribute change for directory or entry inside directory
-    buffer.modified(channel_id, move(path), kind);
-    return ok_result();
-  }
-
-  if ((event.mask & (IN_DELETE_SELF | IN_UNMOUNT)) != 0u) {
-    if (is_root()) {
-      side.remove_channel(channel_id);
-      cache.evict(get_absolute_path());
-      buffer.deleted(channel_id, get_absolute_path(), KIND_DIRECTORY);
-    }
-    return ok_result();
+  if ((event.mask & (IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE)) != 0u) {
+    // modify entry inside directory, a writer closing an entry inside directory, or attribute change for directory
+    // or entry inside directory
+    buffer.modified(channel_id, string(path), kind);
+    return;
   }
 
-  if ((event.mask & IN_MOVE_SELF) == IN_MOVE_SELF) {
-    // directory itself was renamed
-    if (is_root()) {
+  if ((event.mask & (IN_DELETE_SELF | IN_UNMOUNT | IN_MOVE_SELF)) != 0u) {
+    // directory itself was deleted, unmounted, or renamed
+    if (subscription.root) {
       side.remove_channel(channel_id);
-      cache.evict(get_absolute_path());
-      buffer.deleted(channel_id, get_absolute_path(), KIND_DIRECTORY);
+      cache.evict(subscription.root_path);
+      buffer.deleted(channel_id, string(subscription.root_path), KIND_DIRECTORY);
     }
-    return ok_result();
+    return;
   }
 
   if ((event.mask & IN_MOVED_FROM) == IN_MOVED_FROM) {
     // rename source for directory or entry inside directory
     cache.evict(path);
-    jar.moved_from(buffer, channel_id, event.cookie, move(path), kind);
-    return ok_result();
+    if ((events & EVENT_RENAMED) != 0u) {
+      jar.moved_from(buffer, channel_id, event.cookie, string(path), kind);
+    } else if ((events & EVENT_DELETED) != 0u) {
+      buffer.deleted(channel_id, string(path), kind);
+    }
+    return;
   }
 
   if ((event.mask & IN_MOVED_TO) == IN_MOVED_TO) {
     // rename destination for directory or entry inside directory
     if (kind == KIND_DIRECTORY && recursive) {
-      side.track_subdirectory(basename, channel_id);
+      side.track_subdirectory(string(event.name), channel_id);
+    }
+    if ((events & EVENT_RENAMED) != 0u) {
+      jar.moved_to(buffer, channel_id, event.cookie, string(path), kind);
+    } else if ((events & EVENT_CREATED) != 0u) {
+      buffer.created(channel_id, string(path), kind);
     }
-    jar.moved_to(buffer, channel_id, event.cookie, move(path), kind);
-    return ok_result();
+    return;
   }
 
   // IN_IGNORED
+}
 
-  return ok_result();
+bool WatchedDirectory::subscribe(Subscription &&subscription)
+{
+  if (subscription_for(subscription.channel_id) != nullptr) return false;
+
+  subscriptions.push_back(move(subscription));
+  return true;
+}
+
+bool WatchedDirectory::unsubscribe(ChannelID channel_id)
+{
+  for (auto it = subscriptions.begin(); it != subscriptions.end(); ++it) {
+    if (it->channel_id == channel_id) {
+      subscriptions.erase(it);
+      break;
+    }
+  }
+  return subscriptions.empty();
+}
+
+const WatchedDirectory::Subscription *WatchedDirectory::subscription_for(ChannelID channel_id) const
+{
+  for (const Subscription &subscription : subscriptions) {
+    if (subscription.channel_id == channel_id) return &subscription;
+  }
+  return nullptr;
+}
+
+bool WatchedDirectory::is_within(const WatchedDirectory *ancestor) const
+{
+  const WatchedDirectory *current = this;
+  while (current != nullptr) {
+    if (current == ancestor) return true;
+    current = current->parent.get();
+  }
+  return false;
+}
+
+bool WatchedDirectory::is_excluded(const Subscription &subscription, const string &path, bool directory)
+{
+  if (subscription.exclusions && subscription.exclusions->excludes(path, directory)) return true;
+  return subscription.gitignore && subscription.gitignore->excludes(path, directory);
+}
+
+void WatchedDirectory::retrack_subdirectories(SideEffect &side, ChannelID channel_id)
+{
+  string absolute = get_absolute_path();
+  DIR *dir = opendir(absolute.c_str());
+  if (dir == nullptr) return;
+
+  dirent *entry = readdir(dir);
+  while (entry != nullptr) {
+    string entry_name(entry->d_name);
+    if (entry_name != "." && entry_name != "..") {
+#ifdef _DIRENT_HAVE_D_TYPE
+      if (entry->d_type == DT_DIR || entry->d_type == DT_UNKNOWN) {
+        side.track_subdirectory(move(entry_name), channel_id);
+      }
+#else
+      side.track_subdirectory(move(entry_name), channel_id);
+#endif
+    }
+    entry = readdir(dir);
+  }
+  closedir(dir);
+}
+
+bool WatchedDirectory::is_relevant(const Subscription &subscription, const inotify_event &event)
+{
+  EventMask events = subscription.events;
+  bool recursive = subscription.recursive;
+
+  if ((event.mask & IN_CREATE) == IN_CREATE) return (events & EVENT_CREATED) != 0u || recursive;
+  if ((event.mask & IN_DELETE) == IN_DELETE) return (events & EVENT_DELETED) != 0u;
+  if ((event.mask & (IN_MOVED_FROM | IN_MOVED_TO)) != 0u) {
+    return (events & (EVENT_CREATED | EVENT_DELETED | EVENT_RENAMED)) != 0u || recursive;
+  }
+
+  EventMask wanted = 0;
+  if ((event.mask & IN_MODIFY) == IN_MODIFY && (events & (EVENT_MODIFIED | EVENT_SETTLED)) == EVENT_MODIFIED) {
+    wanted |= EVENT_MODIFIED;
+  }
+  if ((event.mask & IN_CLOSE_WRITE) == IN_CLOSE_WRITE) wanted |= events & EVENT_SETTLED;
+  if ((event.mask & IN_ATTRIB) == IN_ATTRIB) wanted |= events & EVENT_ATTRIBUTES;
+  if ((event.mask & (IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB)) != 0u) return wanted != 0u;
+
+  // IN_DELETE_SELF, IN_MOVE_SELF, IN_UNMOUNT, and IN_IGNORED are always relevant.
+  return true;
 }
 
 string WatchedDirectory::get_absolute_path()
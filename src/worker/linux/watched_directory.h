@@ -7,21 +7,46 @@
 #include <sys/inotify.h>
 #include <vector>
 
+#include "../../channel_stats.h"
+#include "../../gitignore.h"
 #include "../../message_buffer.h"
+#include "../../path_matcher.h"
 #include "../../result.h"
 #include "../recent_file_cache.h"
 #include "cookie_jar.h"
 #include "side_effect.h"
 
 // Associate resources used to watch inotify events that are delivered with a single watch descriptor.
+//
+// Every channel whose watch covers a directory shares its WatchedDirectory, and with it the parent links that are used
+// to reconstruct absolute paths. Each kernel event is decoded and stat'ed once, then offered to each channel's
+// Subscription in turn.
 class WatchedDirectory
 {
 public:
-  WatchedDirectory(int wd,
-    ChannelID channel_id,
-    std::shared_ptr<WatchedDirectory> parent,
-    std::string &&name,
-    bool recursive);
+  // The state of a single channel's interest in this directory.
+  struct Subscription
+  {
+    ChannelID channel_id;
+
+    // This directory is the root of the channel's watch. `root_path` records the absolute path it was watched at, so
+    // that its deletion can be reported at that path even if another channel has since observed it being renamed.
+    bool root;
+    std::string root_path;
+
+    bool recursive;
+    EventMask events;
+
+    // Patterns and `.gitignore` rules that prune entries from this channel. Either may be null.
+    std::shared_ptr<const PathMatcher> exclusions;
+    std::shared_ptr<GitIgnore> gitignore;
+
+    // Work done on the channel's behalf. Owned by the WatchRegistry, which keeps it alive for as long as the channel
+    // has any subscriptions.
+    ChannelStats *stats;
+  };
+
+  WatchedDirectory(int wd, std::shared_ptr<WatchedDirectory> parent, std::string &&name);
 
   ~WatchedDirectory() = default;
 
@@ -41,14 +66,29 @@ public:
     name = new_name;
   }
 
-  // Access the Channel ID this WatchedDirectory will broadcast on.
-  ChannelID get_channel_id() { return channel_id; }
+  // Begin delivering events on this directory to a channel. Return `false` if the channel is already subscribed.
+  bool subscribe(Subscription &&subscription);
+
+  // Stop delivering events on this directory to a channel. Return `true` if no channels remain subscribed.
+  bool unsubscribe(ChannelID channel_id);
+
+  // Access the subscription of a channel to this directory, or null if it isn't subscribed.
+  const Subscription *subscription_for(ChannelID channel_id) const;
+
+  const std::vector<Subscription> &get_subscriptions() const { return subscriptions; }
+
+  const std::shared_ptr<WatchedDirectory> &get_parent() const { return parent; }
+
+  // Return true if `ancestor` is this directory or one of its parents.
+  bool is_within(const WatchedDirectory *ancestor) const;
 
   // Access the watch descriptor that corresponds to this directory.
   int get_descriptor() { return wd; }
 
-  // Return true if this directory is the root of a recursively watched subtree.
-  bool is_root() { return parent == nullptr; }
+  // Access the inotify event mask that the watch descriptor was last given, without `IN_MASK_ADD`.
+  uint32_t get_mask() const { return mask; }
+
+  void set_mask(uint32_t new_mask) { mask = new_mask; }
 
   // Return the full absolute path to this directory.
   std::string get_absolute_path();
@@ -61,14 +101,36 @@ public:
 private:
   void build_absolute_path(std::ostringstream &stream);
 
+  // Buffer the messages and enqueue the side effects produced by an event for a single channel. `path` is the
+  // absolute path of the event's entry and `kind` its type, both computed once for every subscriber.
+  void deliver(const Subscription &subscription,
+    MessageBuffer &buffer,
+    CookieJar &jar,
+    SideEffect &side,
+    RecentFileCache &cache,
+    const inotify_event &event,
+    const std::string &path,
+    EntryKind kind);
+
+  // Return true if an inotify event may produce a message or side effect on a subscriber's channel. Watch descriptors
+  // are shared among channels, so the kernel may deliver event classes that this channel didn't ask for.
+  static bool is_relevant(const Subscription &subscription, const inotify_event &event);
+
+  // Return true if the entry at `path` has been excluded from a subscriber's channel.
+  static bool is_excluded(const Subscription &subscription, const std::string &path, bool directory);
+
+  // A `.gitignore` within this directory has changed, so its subdirectories may no longer be excluded. Enqueue each of
+  // them to be watched on `channel_id`. Subdirectories that are already watched or are still excluded will be skipped.
+  void retrack_subdirectories(SideEffect &side, ChannelID channel_id);
+
   // Translate the relative path within an inotify event into an absolute path within this directory.
   std::string absolute_event_path(const inotify_event &event);
 
   int wd;
-  ChannelID channel_id;
+  uint32_t mask;
   std::shared_ptr<WatchedDirectory> parent;
   std::string name;
-  bool recursive;
+  std::vector<Subscription> subscriptions;
 };
 
 #endif
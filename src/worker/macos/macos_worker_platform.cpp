@@ -11,11 +11,15 @@
 #include <unordered_map>
 #include <utility>
 
+#include "../../gitignore.h"
 #include "../../helper/macos/helper.h"
+#include "../../latency_histogram.h"
 #include "../../log.h"
 #include "../../message.h"
 #include "../../message_buffer.h"
+#include "../../metrics.h"
 #include "../../result.h"
+#include "../../trace.h"
 #include "../recent_file_cache.h"
 #include "../worker_platform.h"
 #include "../worker_thread.h"
@@ -96,7 +100,10 @@ public:
   Result<bool> handle_add_command(CommandID command_id,
     ChannelID channel_id,
     const string &root_path,
-    bool recursive) override
+    bool recursive,
+    EventMask events,
+    const shared_ptr<const PathMatcher> &exclusions,
+    bool gitignore) override
   {
     ostream &logline = LOGGER << "Adding watcher for path " << root_path;
     if (!recursive) {
@@ -152,12 +159,20 @@ public:
       LOGGER << "Falling back to polling for watch root " << root_path << "." << endl;
 
       // Emit an Add command for the polling thread to pick up
-      emit(Message(CommandPayloadBuilder::add(channel_id, string(root_path), true, 1).set_id(command_id).build()));
+      emit(Message(CommandPayloadBuilder::add(channel_id, string(root_path), true, 1)
+                     .set_id(command_id)
+                     .set_events(events)
+                     .set_exclusions(exclusions)
+                     .set_gitignore(gitignore)
+                     .build()));
       return ok_result(false);
     }
 
     static_cast<void>(info.release());
-    subscriptions.emplace(channel_id, Subscription(channel_id, recursive, string(root_path), move(event_stream)));
+    shared_ptr<GitIgnore> ignored(gitignore ? new GitIgnore(string(root_path)) : nullptr);
+    subscriptions.emplace(
+      channel_id, Subscription(channel_id, recursive, string(root_path), exclusions, ignored, move(event_stream)));
+    Metrics::get().worker_watch_count.set(subscriptions.size());
 
     cache.prepopulate(root_path, DEFAULT_CACHE_PREPOPULATION, recursive);
     return ok_result(true);
@@ -173,6 +188,7 @@ public:
       return ok_result(true);
     }
     subscriptions.erase(maybe_sub);
+    Metrics::get().worker_watch_count.set(subscriptions.size());
     return ok_result(true);
   }
 
@@ -203,18 +219,23 @@ public:
     const FSEventStreamEventFlags *event_flags,
     const FSEventStreamEventId * /*event_ids*/)
   {
+    TRACE_SPAN("MacOSWorkerPlatform::fs_event_triggered");
     auto **paths = reinterpret_cast<char **>(event_paths);
-    MessageBuffer buffer;
-    ChannelMessageBuffer message_buffer(buffer, channel_id);
+    uint64_t consume_start = monotonic_ns();
     Timer t;
 
-    LOGGER << "Filesystem event batch of size " << num_events << " received." << endl;
+    LOG_AT(LOG_LEVEL_DEBUG, LOG_EVENTS) << "Filesystem event batch of size " << num_events << " received." << endl;
     auto sub = subscriptions.find(channel_id);
     if (sub == subscriptions.end()) {
       LOGGER << "No active subscription for channel " << channel_id << "." << endl;
       return FN_KEEP;
     }
 
+    // FSEvents can't prune excluded subtrees, so discard their events as they're buffered.
+    MessageBuffer buffer;
+    ChannelMessageBuffer message_buffer(
+      buffer, channel_id, sub->second.get_exclusions(), sub->second.get_gitignore());
+
     message_buffer.reserve(num_events);
 
     BatchHandler handler(message_buffer, cache, rename_buffer, sub->second.get_recursive(), sub->second.get_root());
@@ -253,6 +274,8 @@ public:
       static_cast<void>(info.release());
     }
 
+    consume_durations.record_since(consume_start);
+    Metrics::get().worker_events_read.add(num_events);
     Result<> er = emit_all(message_buffer.begin(), message_buffer.end());
     if (er.is_error()) {
       LOGGER << "Unable to emit filesystem event messages: " << er << "." << endl;
@@ -260,8 +283,9 @@ public:
     }
     t.stop();
 
-    LOGGER << "Filesystem event batch of size " << num_events << " completed. "
-           << plural(message_buffer.size(), "message") << " produced in " << t << "." << endl;
+    LOG_AT(LOG_LEVEL_DEBUG, LOG_EVENTS) << "Filesystem event batch of size " << num_events << " completed. "
+                                        << plural(message_buffer.size(), "message") << " produced in " << t << "."
+                                        << endl;
     cache.prune();
 
     return FN_KEEP;
@@ -274,8 +298,16 @@ public:
     LOGGER << "Expiring " << plural(keys->size(), "rename entry", "rename entries") << " on channel " << channel_id
            << "." << endl;
 
+    shared_ptr<const PathMatcher> exclusions;
+    shared_ptr<GitIgnore> gitignore;
+    auto sub = subscriptions.find(channel_id);
+    if (sub != subscriptions.end()) {
+      exclusions = sub->second.get_exclusions();
+      gitignore = sub->second.get_gitignore();
+    }
+
     MessageBuffer buffer;
-    ChannelMessageBuffer message_buffer(buffer, channel_id);
+    ChannelMessageBuffer message_buffer(buffer, channel_id, exclusions, gitignore);
 
     shared_ptr<set<RenameBuffer::Key>> next = rename_buffer.flush_unmatched(message_buffer, cache, keys);
     assert(next->empty());
@@ -1,4 +1,5 @@
 #include <CoreServices/CoreServices.h>
+#include <memory>
 #include <utility>
 
 #include "../../helper/macos/helper.h"
@@ -6,13 +7,21 @@
 #include "subscription.h"
 
 using std::move;
+using std::shared_ptr;
 using std::string;
 
 Subscription::Subscription(ChannelID channel_id,
   bool recursive,
   string &&root,
+  shared_ptr<const PathMatcher> exclusions,
+  shared_ptr<GitIgnore> gitignore,
   RefHolder<FSEventStreamRef> &&event_stream) :
-  channel_id{channel_id}, root{move(root)}, recursive{recursive}, event_stream{move(event_stream)}
+  channel_id{channel_id},
+  root{move(root)},
+  recursive{recursive},
+  exclusions{move(exclusions)},
+  gitignore{move(gitignore)},
+  event_stream{move(event_stream)}
 {
   //
 }
@@ -21,6 +30,8 @@ Subscription::Subscription(Subscription &&original) noexcept :
   channel_id{original.channel_id},
   root{move(original.root)},
   recursive{original.recursive},
+  exclusions{move(original.exclusions)},
+  gitignore{move(original.gitignore)},
   event_stream{move(original.event_stream)}
 {
   //
@@ -2,14 +2,22 @@
 #define SUBSCRIPTION_H
 
 #include "../../helper/macos/helper.h"
+#include "../../gitignore.h"
 #include "../../message.h"
+#include "../../path_matcher.h"
 #include <CoreServices/CoreServices.h>
+#include <memory>
 #include <string>
 
 class Subscription
 {
 public:
-  Subscription(ChannelID channel_id, bool recursive, std::string &&root, RefHolder<FSEventStreamRef> &&event_stream);
+  Subscription(ChannelID channel_id,
+    bool recursive,
+    std::string &&root,
+    std::shared_ptr<const PathMatcher> exclusions,
+    std::shared_ptr<GitIgnore> gitignore,
+    RefHolder<FSEventStreamRef> &&event_stream);
 
   Subscription(Subscription &&original) noexcept;
 
@@ -21,6 +29,10 @@ public:
 
   const bool &get_recursive() { return recursive; }
 
+  const std::shared_ptr<const PathMatcher> &get_exclusions() { return exclusions; }
+
+  const std::shared_ptr<GitIgnore> &get_gitignore() { return gitignore; }
+
   const RefHolder<FSEventStreamRef> &get_event_stream() { return event_stream; }
 
   Subscription(const Subscription &) = delete;
@@ -31,6 +43,8 @@ private:
   ChannelID channel_id;
   std::string root;
   bool recursive;
+  std::shared_ptr<const PathMatcher> exclusions;
+  std::shared_ptr<GitIgnore> gitignore;
   RefHolder<FSEventStreamRef> event_stream;
 };
 
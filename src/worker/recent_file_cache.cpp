@@ -15,6 +15,8 @@
 #include "../helper/common.h"
 #include "../helper/libuv.h"
 #include "../log.h"
+#include "../metrics.h"
+#include "../probes.h"
 
 using std::endl;
 using std::move;
@@ -30,11 +32,18 @@ using std::chrono::minutes;
 using std::chrono::steady_clock;
 using std::chrono::time_point;
 
-shared_ptr<StatResult> StatResult::at(string &&path, bool file_hint, bool directory_hint, bool symlink_hint)
+shared_ptr<StatResult> StatResult::at(string &&path,
+  bool file_hint,
+  bool directory_hint,
+  bool symlink_hint,
+  StatSource *source)
 {
   FSReq lstat_req;
+  uv_stat_t &stat = lstat_req.req.statbuf;
 
-  int lstat_err = uv_fs_lstat(nullptr, &lstat_req.req, path.c_str(), nullptr);
+  Metrics::get().worker_stats.add(1);
+  int lstat_err = source != nullptr ? source->lstat(path, stat)
+                                    : uv_fs_lstat(nullptr, &lstat_req.req, path.c_str(), nullptr);
 
   if (lstat_err != 0) {
     // Ignore lstat() errors on entries that:
@@ -45,7 +54,7 @@ shared_ptr<StatResult> StatResult::at(string &&path, bool file_hint, bool direct
     // Log any other errno that we see.
     if (lstat_err != UV_ENOENT && lstat_err != UV_EACCES && lstat_err != UV_ELOOP && lstat_err != UV_ENAMETOOLONG
       && lstat_err != UV_ENOTDIR && lstat_err != UV_EBUSY && lstat_err != UV_EPERM) {
-      LOGGER << "lstat(" << path << ") failed: " << uv_strerror(lstat_err) << "." << endl;
+      LOG_AT(LOG_LEVEL_DEBUG, LOG_CACHE) << "lstat(" << path << ") failed: " << uv_strerror(lstat_err) << "." << endl;
     }
 
     EntryKind guessed_kind = KIND_UNKNOWN;
@@ -55,7 +64,6 @@ shared_ptr<StatResult> StatResult::at(string &&path, bool file_hint, bool direct
     return shared_ptr<StatResult>(new AbsentEntry(move(path), guessed_kind));
   }
 
-  uv_stat_t &stat = lstat_req.req.statbuf;
   EntryKind kind = kind_from_stat(stat);
   return shared_ptr<StatResult>(new PresentEntry(move(path), kind, stat.st_ino, stat.st_size));
 }
@@ -192,10 +200,15 @@ shared_ptr<StatResult> RecentFileCache::current_at_path(const string &path,
 {
   auto maybe_pending = pending.find(path);
   if (maybe_pending != pending.end()) {
+    Metrics::get().worker_cache_hits.add(1);
+    WATCHER_PROBE1(cache_hit, pending.size());
     return maybe_pending->second;
   }
+  Metrics::get().worker_cache_misses.add(1);
+  WATCHER_PROBE1(cache_miss, pending.size());
 
-  shared_ptr<StatResult> stat_result = StatResult::at(string(path), file_hint, directory_hint, symlink_hint);
+  shared_ptr<StatResult> stat_result =
+    StatResult::at(string(path), file_hint, directory_hint, symlink_hint, stat_source);
   if (stat_result->is_present()) {
     pending.emplace(path, static_pointer_cast<PresentEntry>(stat_result));
   }
@@ -209,6 +222,9 @@ shared_ptr<StatResult> RecentFileCache::former_at_path(const string &path,
 {
   auto maybe = by_path.find(path);
   if (maybe == by_path.end()) {
+    Metrics::get().worker_cache_misses.add(1);
+    WATCHER_PROBE1(cache_miss, by_path.size());
+
     EntryKind kind = KIND_UNKNOWN;
     if (symlink_hint) kind = KIND_SYMLINK;
     if (file_hint && !directory_hint && !symlink_hint) kind = KIND_FILE;
@@ -217,6 +233,8 @@ shared_ptr<StatResult> RecentFileCache::former_at_path(const string &path,
     return shared_ptr<StatResult>(new AbsentEntry(string(path), kind));
   }
 
+  Metrics::get().worker_cache_hits.add(1);
+  WATCHER_PROBE1(cache_hit, by_path.size());
   return maybe->second;
 }
 
@@ -288,7 +306,8 @@ void RecentFileCache::prune()
   Timer t;
   size_t to_remove = by_path.size() - maximum_size;
 
-  LOGGER << "Cache currently contains " << plural(by_path.size(), "entry", "entries") << ". Pruning triggered." << endl;
+  LOG_AT(LOG_LEVEL_INFO, LOG_CACHE) << "Cache currently contains " << plural(by_path.size(), "entry", "entries")
+                                    << ". Pruning triggered." << endl;
 
   auto last = by_timestamp.begin();
   for (size_t i = 0; i < to_remove && last != by_timestamp.end(); i++) {
@@ -302,8 +321,8 @@ void RecentFileCache::prune()
   by_timestamp.erase(by_timestamp.begin(), last);
 
   t.stop();
-  LOGGER << "Pruned " << plural(to_remove, "entry", "entries") << " in " << t << ". "
-         << plural(by_path.size(), "entry", "entries") << " remain." << endl;
+  LOG_AT(LOG_LEVEL_INFO, LOG_CACHE) << "Pruned " << plural(to_remove, "entry", "entries") << " in " << t << ". "
+                                    << plural(by_path.size(), "entry", "entries") << " remain." << endl;
 }
 
 void RecentFileCache::prepopulate(const string &root, size_t max, bool recursive)
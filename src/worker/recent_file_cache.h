@@ -13,10 +13,33 @@
 #include "../helper/libuv.h"
 #include "../message.h"
 
+// Performs the `lstat()` calls that identify the entries events refer to. Replaced to record a workload's results, or
+// to replay them without touching the disk.
+class StatSource
+{
+public:
+  StatSource() = default;
+
+  virtual ~StatSource() = default;
+
+  // Populate `stat` with the status of the entry at `path` without following symlinks. Return 0 or a libuv error code.
+  virtual int lstat(const std::string &path, uv_stat_t &stat) = 0;
+
+  StatSource(const StatSource &) = delete;
+  StatSource(StatSource &&) = delete;
+  StatSource &operator=(const StatSource &) = delete;
+  StatSource &operator=(StatSource &&) = delete;
+};
+
 class StatResult
 {
 public:
-  static std::shared_ptr<StatResult> at(std::string &&path, bool file_hint, bool directory_hint, bool symlink_hint);
+  // Identify the entry at `path`, using `source` to learn its status if one is provided, or `lstat()` if not.
+  static std::shared_ptr<StatResult> at(std::string &&path,
+    bool file_hint,
+    bool directory_hint,
+    bool symlink_hint,
+    StatSource *source = nullptr);
 
   virtual ~StatResult() = default;
 
@@ -137,6 +160,9 @@ public:
 
   size_t size() { return by_path.size(); }
 
+  // Direct the `lstat()` calls made on cache misses to `source`, which must outlive the cache.
+  void set_stat_source(StatSource *source) { stat_source = source; }
+
   RecentFileCache(const RecentFileCache &) = delete;
   RecentFileCache(RecentFileCache &&) = delete;
   RecentFileCache &operator=(const RecentFileCache &) = delete;
@@ -147,6 +173,8 @@ private:
 
   size_t maximum_size;
 
+  StatSource *stat_source{nullptr};
+
   std::map<std::string, std::shared_ptr<PresentEntry>> pending;
 
   std::unordered_map<std::string, std::shared_ptr<PresentEntry>> by_path;
@@ -12,6 +12,7 @@
 using std::endl;
 using std::ostream;
 using std::ostringstream;
+using std::shared_ptr;
 using std::string;
 using std::wostringstream;
 using std::wstring;
@@ -23,6 +24,8 @@ Subscription::Subscription(ChannelID channel,
   HANDLE root,
   const wstring &path,
   bool recursive,
+  const shared_ptr<const PathMatcher> &exclusions,
+  const shared_ptr<GitIgnore> &gitignore,
   WindowsWorkerPlatform *platform) :
   command{0},
   channel{channel},
@@ -31,6 +34,8 @@ Subscription::Subscription(ChannelID channel,
   root{root},
   terminating{false},
   recursive{recursive},
+  exclusions{exclusions},
+  gitignore{gitignore},
   buffer_size{DEFAULT_BUFFER_SIZE},
   buffer{new BYTE[buffer_size]},
   written{new BYTE[buffer_size]},
@@ -6,7 +6,9 @@
 #include <string>
 #include <utility>
 
+#include "../../gitignore.h"
 #include "../../message.h"
+#include "../../path_matcher.h"
 #include "../../result.h"
 
 class WindowsWorkerPlatform;
@@ -18,6 +20,8 @@ public:
     HANDLE root,
     const std::wstring &path,
     bool recursive,
+    const std::shared_ptr<const PathMatcher> &exclusions,
+    const std::shared_ptr<GitIgnore> &gitignore,
     WindowsWorkerPlatform *platform);
 
   ~Subscription();
@@ -42,6 +46,10 @@ public:
 
   const bool &is_recursive() const { return recursive; }
 
+  const std::shared_ptr<const PathMatcher> &get_exclusions() const { return exclusions; }
+
+  const std::shared_ptr<GitIgnore> &get_gitignore() const { return gitignore; }
+
   const bool &is_terminating() const { return terminating; }
 
   void remember_old_path(std::string &&old_path, EntryKind kind)
@@ -74,6 +82,8 @@ private:
   OVERLAPPED overlapped;
   bool recursive;
   bool terminating;
+  std::shared_ptr<const PathMatcher> exclusions;
+  std::shared_ptr<GitIgnore> gitignore;
 
   DWORD buffer_size;
   std::unique_ptr<BYTE[]> buffer;
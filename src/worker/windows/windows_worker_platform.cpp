@@ -10,11 +10,15 @@
 #include <vector>
 #include <windows.h>
 
+#include "../../gitignore.h"
 #include "../../helper/windows/helper.h"
+#include "../../latency_histogram.h"
 #include "../../lock.h"
 #include "../../log.h"
 #include "../../message.h"
 #include "../../message_buffer.h"
+#include "../../metrics.h"
+#include "../../trace.h"
 #include "../recent_file_cache.h"
 #include "../worker_platform.h"
 #include "../worker_thread.h"
@@ -107,7 +111,10 @@ public:
   Result<bool> handle_add_command(CommandID command,
     ChannelID channel,
     const string &root_path,
-    bool recursive) override
+    bool recursive,
+    EventMask events,
+    const shared_ptr<const PathMatcher> &exclusions,
+    bool gitignore) override
   {
     // Convert the path to a wide-character string
     Result<wstring> convr = to_wchar(root_path);
@@ -130,7 +137,8 @@ public:
     }
 
     // Allocate and persist the subscription
-    Subscription *sub = new Subscription(channel, root, root_path_w, recursive, this);
+    shared_ptr<GitIgnore> ignored(gitignore ? new GitIgnore(string(root_path)) : nullptr);
+    Subscription *sub = new Subscription(channel, root, root_path_w, recursive, exclusions, ignored, this);
     auto insert_result = subscriptions.insert(make_pair(channel, sub));
     if (!insert_result.second) {
       delete sub;
@@ -139,6 +147,7 @@ public:
       msg << channel;
       return Result<bool>::make_error(msg.str());
     }
+    Metrics::get().worker_watch_count.set(subscriptions.size());
 
     ostream &logline = LOGGER << "Added directory root " << root_path;
     if (!recursive) logline << " (non-recursive)";
@@ -149,8 +158,9 @@ public:
     if (!schedr.get_value()) {
       LOGGER << "Falling back to polling for watch root " << root_path << "." << endl;
 
-      return emit(Message(CommandPayloadBuilder::add(channel, string(root_path), recursive, 1).build()))
-        .propagate(false);
+      CommandPayloadBuilder builder = CommandPayloadBuilder::add(channel, string(root_path), recursive, 1);
+      builder.set_events(events).set_exclusions(exclusions).set_gitignore(gitignore);
+      return emit(Message(builder.build())).propagate(false);
     }
 
     cache.prepopulate(root_path, DEFAULT_CACHE_PREPOPULATION, recursive);
@@ -221,7 +231,7 @@ public:
     }
 
     if (num_bytes == 0) {
-      LOGGER << "Empty event batch received." << endl;
+      LOG_AT(LOG_LEVEL_DEBUG, LOG_EVENTS) << "Empty event batch received." << endl;
       return reschedule(sub);
     }
 
@@ -230,8 +240,10 @@ public:
     Result<> next = reschedule(sub);
 
     // Process received events.
+    TRACE_SPAN("WindowsWorkerPlatform::handle_fs_event");
+    uint64_t consume_start = monotonic_ns();
     MessageBuffer buffer;
-    ChannelMessageBuffer messages(buffer, channel);
+    ChannelMessageBuffer messages(buffer, channel, sub->get_exclusions(), sub->get_gitignore());
     size_t num_events = 0;
 
     while (true) {
@@ -251,6 +263,8 @@ public:
 
     cache.apply();
     cache.prune();
+    consume_durations.record_since(consume_start);
+    Metrics::get().worker_events_read.add(num_events);
 
     if (!messages.empty()) {
       Result<> er = emit_all(messages.begin(), messages.end());
@@ -258,8 +272,8 @@ public:
         LOGGER << "Unable to emit messages: " << er << "." << endl;
       } else {
         t.stop();
-        LOGGER << "Filesystem event batch of size " << num_events << " completed in " << t << ". "
-               << plural(messages.size(), "message") << " produced." << endl;
+        LOG_AT(LOG_LEVEL_DEBUG, LOG_EVENTS) << "Filesystem event batch of size " << num_events << " completed in " << t
+                                            << ". " << plural(messages.size(), "message") << " produced." << endl;
       }
     }
 
@@ -300,6 +314,7 @@ private:
     }
 
     subscriptions.erase(it);
+    Metrics::get().worker_watch_count.set(subscriptions.size());
     delete sub;
 
     if (sub->get_command_id() != NULL_COMMAND_ID) {
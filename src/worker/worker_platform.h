@@ -6,6 +6,7 @@
 #include <utility>
 
 #include "../errable.h"
+#include "../latency_histogram.h"
 #include "../message.h"
 #include "../result.h"
 #include "../status.h"
@@ -27,7 +28,10 @@ public:
   virtual Result<bool> handle_add_command(CommandID command,
     ChannelID channel,
     const std::string &root_path,
-    bool recursive) = 0;
+    bool recursive,
+    EventMask events,
+    const std::shared_ptr<const PathMatcher> &exclusions,
+    bool gitignore) = 0;
 
   virtual Result<bool> handle_remove_command(CommandID command, ChannelID channel) = 0;
 
@@ -35,6 +39,9 @@ public:
 
   virtual void populate_status(Status & /*status*/) {}
 
+  // Durations of each batch of native events translated into messages.
+  const LatencyHistogram &get_consume_durations() const { return consume_durations; }
+
   Result<> handle_commands() { return thread->handle_commands().propagate_as_void(); }
 
   WorkerPlatform(const WorkerPlatform &) = delete;
@@ -57,6 +64,9 @@ protected:
   }
 
   WorkerThread *thread{};
+
+  // Subclasses record the time spent on each batch of native events here.
+  LatencyHistogram consume_durations;
 };
 
 #endif
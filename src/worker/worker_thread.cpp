@@ -43,8 +43,13 @@ Result<> WorkerThread::body()
 
 Result<Thread::CommandOutcome> WorkerThread::handle_add_command(const CommandPayload *payload)
 {
-  Result<bool> r = platform->handle_add_command(
-    payload->get_id(), payload->get_channel_id(), payload->get_root(), payload->get_recursive());
+  Result<bool> r = platform->handle_add_command(payload->get_id(),
+    payload->get_channel_id(),
+    payload->get_root(),
+    payload->get_recursive(),
+    payload->get_events(),
+    payload->get_exclusions(),
+    payload->get_gitignore());
   return r.is_ok() ? r.propagate(r.get_value() ? ACK : NOTHING) : r.propagate<CommandOutcome>();
 }
 
@@ -71,6 +76,7 @@ Result<Thread::CommandOutcome> WorkerThread::handle_status_command(const Command
   status->worker_out_size = get_out_queue_size();
   status->worker_out_ok = get_out_queue_error();
 
+  status->worker_consume_duration = platform->get_consume_durations();
   platform->populate_status(*status);
 
   Result<> r = emit(Message(StatusPayload(payload->get_request_id(), move(status))));
@@ -1,7 +1,8 @@
 /* eslint-dev mocha */
 const fs = require('fs-extra')
 
-const { configure } = require('../lib/binding')
+const { configure, binaryLog, DISABLE } = require('../lib/binding')
+const { decodeLogFile } = require('../lib/log-decoder')
 const { Fixture } = require('./helper')
 
 describe('configuration', function () {
@@ -22,6 +23,20 @@ describe('configuration', function () {
     await assert.isRejected(configure(), /requires an option object/)
   })
 
+  it('validates the polling hot share', async function () {
+    await assert.isRejected(configure({ pollingHotShare: 150 }), /pollingHotShare/)
+    await assert.isRejected(configure({ pollingHotShare: 12.5 }), /pollingHotShare/)
+  })
+
+  it('validates the polling budget', async function () {
+    await assert.isRejected(configure({ pollingBudget: -1 }), /pollingBudget/)
+    await assert.isRejected(configure({ pollingBudget: '50' }), /pollingBudget/)
+  })
+
+  it('validates the polling snapshot directory', async function () {
+    await assert.isRejected(configure({ pollingSnapshots: 1 }), /pollingSnapshots/)
+  })
+
   it('configures the main thread logger', async function () {
     await configure({ mainLog: fixture.mainLogFile })
 
@@ -36,6 +51,16 @@ describe('configuration', function () {
     assert.match(contents, /FileLogger opened/)
   })
 
+  it('configures the worker thread to log binary records', async function () {
+    const binaryLogFile = fixture.fixturePath('logs', 'worker.test.wlog')
+    await configure({ workerLog: binaryLog(binaryLogFile) })
+
+    await until('the flusher thread writes the first record', async () => {
+      if (!await fs.pathExists(binaryLogFile)) return false
+      return decodeLogFile(binaryLogFile).some(line => /\[.*binary_logger\.cpp:\d+\] BinaryLogger opened/.test(line))
+    })
+  })
+
   it('fails if the main log file cannot be written', async function () {
     await assert.isRejected(configure({ mainLog: badPath }), /No such file or directory/)
   })
@@ -44,6 +69,33 @@ describe('configuration', function () {
     await assert.isRejected(configure({ workerLog: badPath }), /No such file or directory/)
   })
 
+  describe('log levels', function () {
+    afterEach(async function () {
+      await configure({ mainLogLevel: 'debug', workerLogLevel: 'debug', pollingLogLevel: 'debug' })
+    })
+
+    it('validates its arguments', async function () {
+      assert.throws(() => configure({ workerLogLevel: 5 }), /workerLogLevel/)
+      await assert.isRejected(configure({ mainLogLevel: 'loud' }), /Unrecognized log level loud/)
+      await assert.isRejected(configure({ workerLogLevel: 'noise=debug' }), /Unrecognized log subsystem noise/)
+    })
+
+    it('filters the lines written by the worker thread', async function () {
+      await fs.mkdirs(fixture.watchPath('quiet'))
+      await fs.mkdirs(fixture.watchPath('loud'))
+
+      // Levels set while a log is disabled apply once it's enabled.
+      await configure({ workerLog: DISABLE, workerLogLevel: 'off,general=error' })
+      await configure({ workerLog: fixture.workerLogFile })
+      await fixture.watch(['quiet'], {}, () => {})
+      assert.notMatch(await fs.readFile(fixture.workerLogFile, { encoding: 'utf8' }), /Watching path/)
+
+      await configure({ workerLogLevel: 'info' })
+      await fixture.watch(['loud'], {}, () => {})
+      assert.match(await fs.readFile(fixture.workerLogFile, { encoding: 'utf8' }), /Watching path \[.*loud\]/)
+    })
+  })
+
   describe('for the polling thread', function () {
     describe("while it's stopped", function () {
       it('configures the logger', async function () {
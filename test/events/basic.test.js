@@ -55,16 +55,9 @@ const { EventMatcher } = require('../matcher');
 
       await fs.rename(oldPath, newPath)
 
-      if (poll) {
-        await until('the deletion and creation events arrive', matcher.allEvents(
-          { action: 'deleted', kind: 'file', path: oldPath },
-          { action: 'created', kind: 'file', path: newPath }
-        ))
-      } else {
-        await until('the rename event arrives', matcher.allEvents({
-          action: 'renamed', kind: 'file', oldPath, path: newPath
-        }))
-      }
+      await until('the rename event arrives', matcher.allEvents({
+        action: 'renamed', kind: 'file', oldPath, path: newPath
+      }))
     })
 
     it('when a file is deleted', async function () {
@@ -101,16 +94,9 @@ const { EventMatcher } = require('../matcher');
       ))
 
       await fs.rename(oldDir, newDir)
-      if (poll) {
-        await until('directory creation and deletion events arrive', matcher.allEvents(
-          { action: 'deleted', kind: 'directory', path: oldDir },
-          { action: 'created', kind: 'directory', path: newDir }
-        ))
-      } else {
-        await until('directory rename event arrives', matcher.allEvents(
-          { action: 'renamed', kind: 'directory', oldPath: oldDir, path: newDir }
-        ))
-      }
+      await until('directory rename event arrives', matcher.allEvents(
+        { action: 'renamed', kind: 'directory', oldPath: oldDir, path: newDir }
+      ))
     })
 
     it('when a directory is deleted', async function () {
@@ -174,16 +160,9 @@ const { EventMatcher } = require('../matcher');
 
       fs.rename(originalName, finalName)
 
-      if (poll) {
-        await until('symlink deletion and creation arrive', matcher.allEvents(
-          { action: 'deleted', kind: 'symlink', path: originalName },
-          { action: 'created', kind: 'symlink', path: finalName }
-        ))
-      } else {
-        await until('rename event arrives', matcher.allEvents(
-          { action: 'renamed', kind: 'symlink', oldPath: originalName, path: finalName }
-        ))
-      }
+      await until('rename event arrives', matcher.allEvents(
+        { action: 'renamed', kind: 'symlink', oldPath: originalName, path: finalName }
+      ))
     })
 
     if (process.platform === 'win32') {
@@ -0,0 +1,124 @@
+const fs = require('fs-extra')
+
+const { Fixture } = require('../helper')
+const { EventMatcher } = require('../matcher');
+
+[false, true].forEach(poll => {
+  describe(`event class filtering with poll = ${poll}`, function () {
+    let fixture
+
+    beforeEach(async function () {
+      fixture = new Fixture()
+      await fixture.before()
+      await fixture.log()
+    })
+
+    afterEach(async function () {
+      await fixture.after(this.currentTest)
+    })
+
+    it('only delivers events of the requested classes', async function () {
+      const matcher = new EventMatcher(fixture)
+      await matcher.watch([], { poll, events: ['created'] })
+
+      const existingPath = fixture.watchPath('existing.txt')
+      await fs.writeFile(existingPath, 'before\n')
+      await until('creation event arrives', matcher.allEvents(
+        { action: 'created', kind: 'file', path: existingPath }
+      ))
+
+      const flagPath = fixture.watchPath('flag.txt')
+      await fs.appendFile(existingPath, 'after\n')
+      await fs.unlink(existingPath)
+      await fs.writeFile(flagPath, 'flag\n')
+
+      await until('flag creation event arrives', matcher.allEvents(
+        { action: 'created', kind: 'file', path: flagPath }
+      ))
+      assert.isTrue(matcher.noEvents(
+        { action: 'modified', path: existingPath },
+        { action: 'deleted', path: existingPath }
+      ))
+    })
+
+    it('delivers attribute changes apart from content changes', async function () {
+      await Promise.all([fs.mkdirs(fixture.watchPath('attrs')), fs.mkdirs(fixture.watchPath('mods'))])
+
+      const attrMatcher = new EventMatcher(fixture)
+      await attrMatcher.watch(['attrs'], { poll, events: ['created', 'attributes'] })
+      const modMatcher = new EventMatcher(fixture)
+      await modMatcher.watch(['mods'], { poll, events: ['created', 'modified'] })
+
+      const attrWritten = fixture.watchPath('attrs', 'written.txt')
+      const attrChmodded = fixture.watchPath('attrs', 'chmodded.txt')
+      const modWritten = fixture.watchPath('mods', 'written.txt')
+      const modChmodded = fixture.watchPath('mods', 'chmodded.txt')
+      await Promise.all([attrWritten, attrChmodded, modWritten, modChmodded].map(p => fs.writeFile(p, 'before\n')))
+
+      await until('attrs creation events arrive', attrMatcher.allEvents(
+        { action: 'created', kind: 'file', path: attrWritten },
+        { action: 'created', kind: 'file', path: attrChmodded }
+      ))
+      await until('mods creation events arrive', modMatcher.allEvents(
+        { action: 'created', kind: 'file', path: modWritten },
+        { action: 'created', kind: 'file', path: modChmodded }
+      ))
+
+      await fs.appendFile(attrWritten, 'after\n')
+      await fs.chmod(attrChmodded, 0o600)
+      await until('attribute change arrives', attrMatcher.allEvents(
+        { action: 'modified', kind: 'file', path: attrChmodded }
+      ))
+      assert.isTrue(attrMatcher.noEvents({ action: 'modified', path: attrWritten }))
+
+      await fs.chmod(modChmodded, 0o600)
+      await fs.appendFile(modWritten, 'after\n')
+      await until('content change arrives', modMatcher.allEvents(
+        { action: 'modified', kind: 'file', path: modWritten }
+      ))
+      assert.isTrue(modMatcher.noEvents({ action: 'modified', path: modChmodded }))
+    })
+
+    it('rejects unrecognized event classes', async function () {
+      const matcher = new EventMatcher(fixture)
+      await assert.isRejected(matcher.watch([], { poll, events: ['bogus'] }), /unrecognized event class/)
+    })
+  })
+})
+
+if (process.platform === 'linux') {
+  describe('settled modification events', function () {
+    let fixture, matcher
+
+    beforeEach(async function () {
+      fixture = new Fixture()
+      await fixture.before()
+      await fixture.log()
+
+      matcher = new EventMatcher(fixture)
+      await matcher.watch([], { events: ['created', 'modified', 'settled'] })
+    })
+
+    afterEach(async function () {
+      await fixture.after(this.currentTest)
+    })
+
+    it('reports a modification once the writer closes the file', async function () {
+      const filePath = fixture.watchPath('file.txt')
+      const fd = await fs.open(filePath, 'w')
+      await until('creation event arrives', matcher.allEvents(
+        { action: 'created', kind: 'file', path: filePath }
+      ))
+
+      for (let i = 0; i < 10; i++) {
+        await fs.write(fd, `line ${i}\n`)
+      }
+      assert.isTrue(matcher.noEvents({ action: 'modified', path: filePath }))
+
+      await fs.close(fd)
+      await until('modification event arrives', matcher.allEvents(
+        { action: 'modified', kind: 'file', path: filePath }
+      ))
+    })
+  })
+}
@@ -0,0 +1,105 @@
+const path = require('path')
+const fs = require('fs-extra')
+
+const { Fixture } = require('../helper')
+const { EventMatcher } = require('../matcher');
+
+[false, true].forEach(poll => {
+  describe(`excluded paths with poll = ${poll}`, function () {
+    let fixture, matcher
+
+    beforeEach(async function () {
+      fixture = new Fixture()
+      await fixture.before()
+      await fixture.log()
+
+      await Promise.all([
+        fs.mkdirs(fixture.watchPath('node_modules', 'dep')),
+        fs.mkdirs(fixture.watchPath('src', 'build')),
+        fs.mkdirs(fixture.watchPath('build'))
+      ])
+
+      matcher = new EventMatcher(fixture)
+      await matcher.watch([], { poll, exclude: ['node_modules', '/build/', '*.log', '!keep.log'] })
+    })
+
+    afterEach(async function () {
+      await fixture.after(this.currentTest)
+    })
+
+    it('ignores events within excluded subtrees', async function () {
+      const depFile = fixture.watchPath('node_modules', 'dep', 'index.js')
+      const buildFile = fixture.watchPath('build', 'out.o')
+      const flagFile = fixture.watchPath('flag.txt')
+
+      await fs.writeFile(depFile, 'nope\n')
+      await fs.writeFile(buildFile, 'nope\n')
+      await fs.writeFile(flagFile, 'yes\n')
+
+      await until('flag creation event arrives', matcher.allEvents(
+        { action: 'created', kind: 'file', path: flagFile }
+      ))
+      assert.isTrue(matcher.noEvents(
+        { path: depFile },
+        { path: buildFile }
+      ))
+    })
+
+    it('applies anchored patterns only at the watch root', async function () {
+      const nestedBuildFile = fixture.watchPath('src', 'build', 'out.o')
+
+      await fs.writeFile(nestedBuildFile, 'yes\n')
+
+      await until('nested creation event arrives', matcher.allEvents(
+        { action: 'created', kind: 'file', path: nestedBuildFile }
+      ))
+    })
+
+    it('re-includes entries with negated patterns', async function () {
+      const debugLog = fixture.watchPath('debug.log')
+      const keepLog = fixture.watchPath('keep.log')
+
+      await fs.writeFile(debugLog, 'nope\n')
+      await fs.writeFile(keepLog, 'yes\n')
+
+      await until('re-included creation event arrives', matcher.allEvents(
+        { action: 'created', kind: 'file', path: keepLog }
+      ))
+      assert.isTrue(matcher.noEvents({ path: debugLog }))
+    })
+
+    it('stops reporting a directory renamed to an excluded name', async function () {
+      const workDir = fixture.watchPath('work')
+      const logDir = fixture.watchPath('work.log')
+      const innerFile = fixture.watchPath('work.log', 'inner.txt')
+      const flagFile = fixture.watchPath('flag.txt')
+
+      await fs.mkdirs(fixture.watchPath('work', 'deep'))
+      await until('directory creation event arrives', matcher.allEvents(
+        { action: 'created', kind: 'directory', path: workDir }
+      ))
+
+      await fs.rename(workDir, logDir)
+      await until('departure event arrives', () => matcher.events.some(event => {
+        return (event.action === 'deleted' || event.action === 'renamed') &&
+          (event.path === workDir || event.oldPath === workDir)
+      }))
+
+      await fs.writeFile(innerFile, 'nope\n')
+      await fs.writeFile(fixture.watchPath('work.log', 'deep', 'nested.txt'), 'nope\n')
+      await fs.writeFile(flagFile, 'yes\n')
+
+      await until('flag creation event arrives', matcher.allEvents(
+        { action: 'created', kind: 'file', path: flagFile }
+      ))
+      assert.isTrue(matcher.events.every(event => {
+        return !event.path.startsWith(workDir + path.sep) && !event.path.startsWith(logDir + path.sep)
+      }))
+    })
+
+    it('rejects malformed patterns', async function () {
+      const other = new EventMatcher(fixture)
+      await assert.isRejected(other.watch([], { poll, exclude: 'node_modules' }), /must be an Array/)
+    })
+  })
+})
@@ -0,0 +1,77 @@
+const fs = require('fs-extra')
+
+const { Fixture } = require('../helper')
+const { EventMatcher } = require('../matcher');
+
+[false, true].forEach(poll => {
+  describe(`.gitignore files with poll = ${poll}`, function () {
+    let fixture, matcher
+
+    beforeEach(async function () {
+      fixture = new Fixture()
+      await fixture.before()
+      await fixture.log()
+
+      await Promise.all([
+        fs.mkdirs(fixture.watchPath('node_modules', 'dep')),
+        fs.mkdirs(fixture.watchPath('src', 'generated'))
+      ])
+      await Promise.all([
+        fs.writeFile(fixture.watchPath('.gitignore'), 'node_modules/\n*.log\n'),
+        fs.writeFile(fixture.watchPath('src', '.gitignore'), 'generated/\n!keep.log\n')
+      ])
+
+      matcher = new EventMatcher(fixture)
+      await matcher.watch([], { poll, gitignore: true })
+    })
+
+    afterEach(async function () {
+      await fixture.after(this.currentTest)
+    })
+
+    it('ignores entries matched by .gitignore files', async function () {
+      const depFile = fixture.watchPath('node_modules', 'dep', 'index.js')
+      const logFile = fixture.watchPath('debug.log')
+      const generatedFile = fixture.watchPath('src', 'generated', 'out.js')
+      const keepLog = fixture.watchPath('src', 'keep.log')
+
+      await fs.writeFile(depFile, 'nope\n')
+      await fs.writeFile(logFile, 'nope\n')
+      await fs.writeFile(generatedFile, 'nope\n')
+      await fs.writeFile(keepLog, 'yes\n')
+
+      await until('re-included creation event arrives', matcher.allEvents(
+        { action: 'created', kind: 'file', path: keepLog }
+      ))
+      assert.isTrue(matcher.noEvents(
+        { path: depFile },
+        { path: logFile },
+        { path: generatedFile }
+      ))
+    })
+
+    it('reads a .gitignore file again when it changes', async function () {
+      const gitignore = fixture.watchPath('.gitignore')
+      const logFile = fixture.watchPath('debug.log')
+      const tmpFile = fixture.watchPath('scratch.tmp')
+
+      await fs.writeFile(gitignore, 'node_modules/\n*.tmp\n')
+      await until('.gitignore modification event arrives', matcher.allEvents(
+        { action: 'modified', kind: 'file', path: gitignore }
+      ))
+
+      await fs.writeFile(tmpFile, 'nope\n')
+      await fs.writeFile(logFile, 'yes\n')
+
+      await until('newly included creation event arrives', matcher.allEvents(
+        { action: 'created', kind: 'file', path: logFile }
+      ))
+      assert.isTrue(matcher.noEvents({ path: tmpFile }))
+    })
+
+    it('rejects a non-Boolean option', async function () {
+      const other = new EventMatcher(fixture)
+      await assert.isRejected(other.watch([], { poll, gitignore: 'yes' }), /must be a Boolean/)
+    })
+  })
+})
@@ -52,18 +52,10 @@ const { EventMatcher } = require('../matcher');
       await fs.rmdir(reusedPath)
       await fs.rename(oldFilePath, reusedPath)
 
-      if (poll) {
-        await until('deletion and creation events arrive', matcher.allEvents(
-          { action: 'deleted', kind: 'directory', path: reusedPath },
-          { action: 'deleted', kind: 'file', path: oldFilePath },
-          { action: 'created', kind: 'file', path: reusedPath }
-        ))
-      } else {
-        await until('deletion and rename events arrive', matcher.allEvents(
-          { action: 'deleted', kind: 'directory', path: reusedPath },
-          { action: 'renamed', kind: 'file', oldPath: oldFilePath, path: reusedPath }
-        ))
-      }
+      await until('deletion and rename events arrive', matcher.allEvents(
+        { action: 'deleted', kind: 'directory', path: reusedPath },
+        { action: 'renamed', kind: 'file', oldPath: oldFilePath, path: reusedPath }
+      ))
     })
 
     it('when a directory is renamed and a file is created in its place', async function () {
@@ -78,18 +70,10 @@ const { EventMatcher } = require('../matcher');
       await fs.rename(reusedPath, newDirPath)
       await fs.writeFile(reusedPath, 'oh look a file\n')
 
-      if (poll) {
-        await until('rename and creation events arrive', matcher.allEvents(
-          { action: 'deleted', kind: 'directory', path: reusedPath },
-          { action: 'created', kind: 'directory', path: newDirPath },
-          { action: 'created', kind: 'file', path: reusedPath }
-        ))
-      } else {
-        await until('rename and creation events arrive', matcher.allEvents(
-          { action: 'renamed', kind: 'directory', oldPath: reusedPath, path: newDirPath },
-          { action: 'created', kind: 'file', path: reusedPath }
-        ))
-      }
+      await until('rename and creation events arrive', matcher.allEvents(
+        { action: 'renamed', kind: 'directory', oldPath: reusedPath, path: newDirPath },
+        { action: 'created', kind: 'file', path: reusedPath }
+      ))
     })
 
     it('when a directory is renamed and a file is renamed in its place', async function () {
@@ -109,19 +93,10 @@ const { EventMatcher } = require('../matcher');
       await fs.rename(reusedPath, newDirPath)
       await fs.rename(oldFilePath, reusedPath)
 
-      if (poll) {
-        await until('deletion and creation events arrive', matcher.allEvents(
-          { action: 'deleted', kind: 'directory', path: reusedPath },
-          { action: 'created', kind: 'directory', path: newDirPath },
-          { action: 'deleted', kind: 'file', path: oldFilePath },
-          { action: 'created', kind: 'file', path: reusedPath }
-        ))
-      } else {
-        await until('rename events arrive', matcher.allEvents(
-          { action: 'renamed', kind: 'directory', oldPath: reusedPath, path: newDirPath },
-          { action: 'renamed', kind: 'file', oldPath: oldFilePath, path: reusedPath }
-        ))
-      }
+      await until('rename events arrive', matcher.allEvents(
+        { action: 'renamed', kind: 'directory', oldPath: reusedPath, path: newDirPath },
+        { action: 'renamed', kind: 'file', oldPath: oldFilePath, path: reusedPath }
+      ))
     })
 
     it('when a file is deleted and a directory is created in its place', async function () {
@@ -156,18 +131,10 @@ const { EventMatcher } = require('../matcher');
       await fs.unlink(reusedPath)
       await fs.rename(oldDirPath, reusedPath)
 
-      if (poll) {
-        await until('delete and create events arrive', matcher.allEvents(
-          { action: 'deleted', kind: 'file', path: reusedPath },
-          { action: 'deleted', kind: 'directory', path: oldDirPath },
-          { action: 'created', kind: 'directory', path: reusedPath }
-        ))
-      } else {
-        await until('delete and rename events arrive', matcher.allEvents(
-          { action: 'deleted', kind: 'file', path: reusedPath },
-          { action: 'renamed', kind: 'directory', oldPath: oldDirPath, path: reusedPath }
-        ))
-      }
+      await until('delete and rename events arrive', matcher.allEvents(
+        { action: 'deleted', kind: 'file', path: reusedPath },
+        { action: 'renamed', kind: 'directory', oldPath: oldDirPath, path: reusedPath }
+      ))
     })
 
     it('when a file is renamed and a directory is created in its place', async function () {
@@ -182,18 +149,10 @@ const { EventMatcher } = require('../matcher');
       await fs.rename(reusedPath, newFilePath)
       await fs.mkdir(reusedPath)
 
-      if (poll) {
-        await until('creation and deletion events arrive', matcher.allEvents(
-          { action: 'deleted', kind: 'file', path: reusedPath },
-          { action: 'created', kind: 'file', path: newFilePath },
-          { action: 'created', kind: 'directory', path: reusedPath }
-        ))
-      } else {
-        await until('rename and create events arrive', matcher.allEvents(
-          { action: 'renamed', kind: 'file', oldPath: reusedPath, path: newFilePath },
-          { action: 'created', kind: 'directory', path: reusedPath }
-        ))
-      }
+      await until('rename and create events arrive', matcher.allEvents(
+        { action: 'renamed', kind: 'file', oldPath: reusedPath, path: newFilePath },
+        { action: 'created', kind: 'directory', path: reusedPath }
+      ))
     })
 
     it('when a file is renamed and a directory is renamed in its place', async function () {
@@ -213,19 +172,10 @@ const { EventMatcher } = require('../matcher');
       await fs.rename(reusedPath, newFilePath)
       await fs.rename(oldDirPath, reusedPath)
 
-      if (poll) {
-        await until('creation and deletion events arrive', matcher.allEvents(
-          { action: 'deleted', kind: 'file', path: reusedPath },
-          { action: 'created', kind: 'file', path: newFilePath },
-          { action: 'deleted', kind: 'directory', path: oldDirPath },
-          { action: 'created', kind: 'directory', path: reusedPath }
-        ))
-      } else {
-        await until('rename events arrive', matcher.allEvents(
-          { action: 'renamed', kind: 'file', oldPath: reusedPath, path: newFilePath },
-          { action: 'renamed', kind: 'directory', oldPath: oldDirPath, path: reusedPath }
-        ))
-      }
+      await until('rename events arrive', matcher.allEvents(
+        { action: 'renamed', kind: 'file', oldPath: reusedPath, path: newFilePath },
+        { action: 'renamed', kind: 'directory', oldPath: oldDirPath, path: reusedPath }
+      ))
     })
   })
 })
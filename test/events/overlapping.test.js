@@ -0,0 +1,72 @@
+const fs = require('fs-extra')
+
+const { Fixture } = require('../helper')
+const { EventMatcher } = require('../matcher')
+
+describe('overlapping watch roots', function () {
+  let fixture, outer, inner
+
+  beforeEach(async function () {
+    fixture = new Fixture()
+    await fixture.before()
+    await fixture.log()
+
+    await fs.mkdirs(fixture.watchPath('pkg', 'sub'))
+
+    // Distinct options keep the two watchers on separate native channels that share watch descriptors.
+    outer = new EventMatcher(fixture)
+    await outer.watch([], {})
+
+    inner = new EventMatcher(fixture)
+    await inner.watch(['pkg'], { exclude: ['ignored'] })
+  })
+
+  afterEach(async function () {
+    await fixture.after(this.currentTest)
+  })
+
+  it('delivers events within the shared subtree to each channel', async function () {
+    const nestedFile = fixture.watchPath('pkg', 'sub', 'file.txt')
+    const topFile = fixture.watchPath('top.txt')
+
+    await fs.writeFile(nestedFile, 'both\n')
+    await fs.writeFile(topFile, 'outer\n')
+
+    await until('outer events arrive', outer.allEvents(
+      { action: 'created', kind: 'file', path: nestedFile },
+      { action: 'created', kind: 'file', path: topFile }
+    ))
+    await until('inner event arrives', inner.allEvents(
+      { action: 'created', kind: 'file', path: nestedFile }
+    ))
+    assert.isTrue(inner.noEvents({ path: topFile }))
+  })
+
+  it('applies each channel\'s filters independently', async function () {
+    const ignoredFile = fixture.watchPath('pkg', 'ignored')
+
+    await fs.writeFile(ignoredFile, 'outer only\n')
+
+    await until('outer event arrives', outer.allEvents(
+      { action: 'created', kind: 'file', path: ignoredFile }
+    ))
+    assert.isTrue(inner.noEvents({ path: ignoredFile }))
+  })
+
+  it('stops delivering events for directories renamed out of a channel\'s tree', async function () {
+    const oldDir = fixture.watchPath('pkg', 'sub')
+    const newDir = fixture.watchPath('moved')
+    const movedFile = fixture.watchPath('moved', 'file.txt')
+
+    await fs.rename(oldDir, newDir)
+    await until('outer rename event arrives', outer.allEvents(
+      { action: 'renamed', kind: 'directory', oldPath: oldDir, path: newDir }
+    ))
+
+    await fs.writeFile(movedFile, 'outer only\n')
+    await until('outer creation event arrives', outer.allEvents(
+      { action: 'created', kind: 'file', path: movedFile }
+    ))
+    assert.isTrue(inner.noEvents({ path: movedFile }))
+  })
+})
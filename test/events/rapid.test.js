@@ -142,22 +142,11 @@ const { EventMatcher } = require('../matcher');
         fs.rename(oldPath2, newPath2)
       ])
 
-      if (poll) {
-        await until('all deletion and creation events arrive', matcher.allEvents(
-          { action: 'deleted', kind: 'file', path: oldPath0 },
-          { action: 'deleted', kind: 'file', path: oldPath1 },
-          { action: 'deleted', kind: 'file', path: oldPath2 },
-          { action: 'created', kind: 'file', path: newPath0 },
-          { action: 'created', kind: 'file', path: newPath1 },
-          { action: 'created', kind: 'file', path: newPath2 }
-        ))
-      } else {
-        await until('all rename events arrive', matcher.allEvents(
-          { action: 'renamed', kind: 'file', oldPath: oldPath0, path: newPath0 },
-          { action: 'renamed', kind: 'file', oldPath: oldPath1, path: newPath1 },
-          { action: 'renamed', kind: 'file', oldPath: oldPath2, path: newPath2 }
-        ))
-      }
+      await until('all rename events arrive', matcher.allEvents(
+        { action: 'renamed', kind: 'file', oldPath: oldPath0, path: newPath0 },
+        { action: 'renamed', kind: 'file', oldPath: oldPath1, path: newPath1 },
+        { action: 'renamed', kind: 'file', oldPath: oldPath2, path: newPath2 }
+      ))
     })
   })
 })
@@ -0,0 +1,67 @@
+const fs = require('fs-extra')
+
+const { Fixture } = require('../helper')
+const { EventMatcher } = require('../matcher')
+const { status } = require('../../lib/binding')
+
+describe('watchers sharing a native watcher', function () {
+  let fixture, outer, inner
+
+  beforeEach(async function () {
+    fixture = new Fixture()
+    await fixture.before()
+    await fixture.log()
+
+    await fs.mkdirs(fixture.watchPath('pkg', 'sub'))
+
+    // Identical options let the registry attach the inner watcher to the outer watcher's native channel.
+    outer = new EventMatcher(fixture)
+    await outer.watch([], {})
+
+    inner = new EventMatcher(fixture)
+    await inner.watch(['pkg'], {})
+  })
+
+  afterEach(async function () {
+    await fixture.after(this.currentTest)
+  })
+
+  it('routes events natively to each watcher', async function () {
+    const s = await status()
+    assert.isAtLeast(s.routeCount, 2)
+
+    const nestedFile = fixture.watchPath('pkg', 'sub', 'file.txt')
+    const siblingFile = fixture.watchPath('pkg-sibling.txt')
+
+    await fs.writeFile(nestedFile, 'both\n')
+    await fs.writeFile(siblingFile, 'outer\n')
+
+    await until('outer events arrive', outer.allEvents(
+      { action: 'created', kind: 'file', path: nestedFile },
+      { action: 'created', kind: 'file', path: siblingFile }
+    ))
+    await until('inner event arrives', inner.allEvents(
+      { action: 'created', kind: 'file', path: nestedFile }
+    ))
+    assert.isTrue(inner.noEvents({ path: siblingFile }))
+  })
+
+  it('splits renames that cross a watcher\'s root', async function () {
+    const insideFile = fixture.watchPath('pkg', 'sub', 'file.txt')
+    const outsideFile = fixture.watchPath('file.txt')
+
+    await fs.writeFile(insideFile, 'contents\n')
+    await until('inner creation event arrives', inner.allEvents(
+      { action: 'created', kind: 'file', path: insideFile }
+    ))
+
+    await fs.rename(insideFile, outsideFile)
+    await until('outer rename event arrives', outer.allEvents(
+      { action: 'renamed', kind: 'file', oldPath: insideFile, path: outsideFile }
+    ))
+    await until('inner deletion event arrives', inner.allEvents(
+      { action: 'deleted', kind: 'file', path: insideFile }
+    ))
+    assert.isTrue(inner.noEvents({ path: outsideFile }))
+  })
+})
@@ -1,5 +1,9 @@
-const { status } = require('../lib/binding')
+const fs = require('fs-extra')
+const path = require('path')
+
+const { configure, status } = require('../lib/binding')
 const { Fixture } = require('./helper')
+const { EventMatcher } = require('./matcher')
 
 describe('polling', function () {
   let fixture
@@ -29,4 +33,259 @@ describe('polling', function () {
       await until(async () => (await status()).pollingThreadState === 'stopped')
     })
   })
+
+  describe('with a long polling interval', function () {
+    beforeEach(async function () {
+      await configure({ pollingInterval: 10000 })
+    })
+
+    afterEach(async function () {
+      await configure({ pollingInterval: 100 })
+    })
+
+    it('handles commands without waiting for the next cycle', async function () {
+      await fs.mkdirs(fixture.watchPath('one'))
+      await fs.mkdirs(fixture.watchPath('two'))
+      await fixture.watch(['one'], { poll: true }, () => {})
+
+      const start = Date.now()
+      await fixture.watch(['two'], { poll: true }, () => {})
+      const s = await status()
+      assert.equal(s.pollingRootCount, 2)
+      assert.isBelow(Date.now() - start, 5000)
+    })
+  })
+
+  describe('with several roots', function () {
+    const roots = ['one', 'two', 'three']
+
+    beforeEach(async function () {
+      await configure({ pollingWorkers: 2 })
+      for (const root of roots) {
+        await fs.mkdirs(fixture.watchPath(root))
+      }
+    })
+
+    afterEach(async function () {
+      await configure({ pollingWorkers: 4 })
+    })
+
+    it('shares them among the polling workers', async function () {
+      const matchers = []
+      for (const root of roots) {
+        const matcher = new EventMatcher(fixture)
+        await matcher.watch([root], { poll: true })
+        matchers.push(matcher)
+      }
+
+      const s = await status()
+      assert.equal(s.pollingWorkerCount, 2)
+      assert.equal(s.pollingRootCount, roots.length)
+
+      for (const root of roots) {
+        await fs.writeFile(fixture.watchPath(root, 'file.txt'), `${root}\n`)
+      }
+
+      for (let i = 0; i < roots.length; i++) {
+        const filePath = fixture.watchPath(roots[i], 'file.txt')
+        await until(`creation event in ${roots[i]} arrives`, matchers[i].allEvents(
+          { action: 'created', kind: 'file', path: filePath }
+        ))
+      }
+    })
+  })
+
+  describe('when only the structure of the tree is requested', function () {
+    it('reports entries that are created and deleted', async function () {
+      const subdir = fixture.watchPath('subdir')
+      await fs.mkdirs(subdir)
+
+      const matcher = new EventMatcher(fixture)
+      await matcher.watch([], { poll: true, events: ['created', 'deleted'] })
+
+      const filePath = path.join(subdir, 'file.txt')
+      await fs.writeFile(filePath, 'one\n')
+      await until('creation event arrives', matcher.allEvents({ action: 'created', kind: 'file', path: filePath }))
+
+      const nestedPath = path.join(subdir, 'nested')
+      await fs.mkdirs(nestedPath)
+      await fs.writeFile(path.join(nestedPath, 'inner.txt'), '')
+      await until('directory creation event arrives', matcher.allEvents(
+        { action: 'created', kind: 'directory', path: nestedPath }
+      ))
+
+      await fs.remove(filePath)
+      await until('deletion event arrives', matcher.allEvents({ action: 'deleted', path: filePath }))
+    })
+
+    if (process.platform !== 'win32') {
+      it('reports a directory replaced by a symlink without listing its target', async function () {
+        const subdir = fixture.watchPath('subdir')
+        const targetDir = fixture.watchPath('target')
+        await fs.mkdirs(subdir)
+        await fs.writeFile(path.join(subdir, 'file.txt'), '')
+        await fs.mkdirs(targetDir)
+
+        const matcher = new EventMatcher(fixture)
+        await matcher.watch([], { poll: true, events: ['created', 'deleted'] })
+
+        await fs.remove(subdir)
+        await fs.symlink(targetDir, subdir)
+        await until('replacement events arrive', matcher.allEvents(
+          { action: 'deleted', kind: 'directory', path: subdir },
+          { action: 'created', kind: 'symlink', path: subdir }
+        ))
+
+        const targetFile = path.join(targetDir, 'inner.txt')
+        await fs.writeFile(targetFile, '')
+        await until('target creation event arrives', matcher.allEvents(
+          { action: 'created', kind: 'file', path: targetFile }
+        ))
+        assert.isTrue(matcher.noEvents({ path: path.join(subdir, 'inner.txt') }))
+      })
+    }
+  })
+
+  describe('with a tree too large to poll in one cycle', function () {
+    beforeEach(async function () {
+      await configure({ pollingThrottle: 20, pollingHotShare: 50 })
+
+      for (let d = 0; d < 10; d++) {
+        const dirPath = fixture.watchPath(`quiet-${d}`)
+        await fs.mkdirs(dirPath)
+        for (let f = 0; f < 30; f++) {
+          await fs.writeFile(path.join(dirPath, `file-${f}.txt`), '')
+        }
+      }
+      await fs.mkdirs(fixture.watchPath('active'))
+    })
+
+    afterEach(async function () {
+      await configure({ pollingThrottle: 1000, pollingHotShare: 25 })
+    })
+
+    it('revisits recently changed directories between complete passes', async function () {
+      const matcher = new EventMatcher(fixture)
+      await matcher.watch([], { poll: true })
+
+      const filePath = fixture.watchPath('active', 'file.txt')
+      await fs.writeFile(filePath, 'one\n')
+      await until('creation event arrives', matcher.allEvents({ action: 'created', kind: 'file', path: filePath }))
+
+      const s = await status()
+      assert.isAtLeast(s.pollingHotDirectoryCount, 1)
+
+      await fs.appendFile(filePath, 'two\n')
+      await until('modification event arrives', matcher.allEvents({ action: 'modified', kind: 'file', path: filePath }))
+    })
+  })
+
+  describe('with a polling budget', function () {
+    beforeEach(async function () {
+      await configure({ pollingBudget: 10 })
+    })
+
+    afterEach(async function () {
+      await configure({ pollingBudget: 0 })
+    })
+
+    it('limits each cycle by time and reports its throughput', async function () {
+      await fs.writeFile(fixture.watchPath('existing.txt'), '')
+
+      const matcher = new EventMatcher(fixture)
+      await matcher.watch([], { poll: true })
+
+      const filePath = fixture.watchPath('file.txt')
+      await fs.writeFile(filePath, 'one\n')
+      await until('creation event arrives', matcher.allEvents({ action: 'created', kind: 'file', path: filePath }))
+
+      await until('throughput is measured', async () => (await status()).pollingThroughput > 0)
+    })
+  })
+
+  describe('with polling snapshots', function () {
+    beforeEach(async function () {
+      await configure({ pollingSnapshots: fixture.fixturePath('snapshots') })
+    })
+
+    afterEach(async function () {
+      await configure({ pollingSnapshots: '' })
+    })
+
+    it('reports changes made while the root was not being polled', async function () {
+      const modifiedPath = fixture.watchPath('modified.txt')
+      const deletedPath = fixture.watchPath('subdir', 'deleted.txt')
+      const createdPath = fixture.watchPath('subdir', 'created.txt')
+      await fs.mkdirs(fixture.watchPath('subdir'))
+      await fs.writeFile(modifiedPath, 'one\n')
+      await fs.writeFile(deletedPath, '')
+
+      const watcher = await fixture.watch([], { poll: true }, () => {})
+      await watcher.getNativeWatcher().stop(false)
+      await until(async () => (await status()).pollingThreadState === 'stopped')
+
+      await fs.appendFile(modifiedPath, 'two\n')
+      await fs.unlink(deletedPath)
+      await fs.writeFile(createdPath, '')
+
+      const matcher = new EventMatcher(fixture)
+      await matcher.watch([], { poll: true })
+
+      await until('offline events arrive', matcher.allEvents(
+        { action: 'modified', kind: 'file', path: modifiedPath },
+        { action: 'deleted', kind: 'file', path: deletedPath },
+        { action: 'created', kind: 'file', path: createdPath }
+      ))
+    })
+
+    describe('and a throttle too small to restore the tree in one cycle', function () {
+      beforeEach(async function () {
+        await configure({ pollingThrottle: 2 })
+      })
+
+      afterEach(async function () {
+        await configure({ pollingThrottle: 1000 })
+      })
+
+      it('reports changes made within nested directories while the root was not being polled', async function () {
+        const deletedPath = fixture.watchPath('sub', 'b.txt')
+        const deepDeletedPath = fixture.watchPath('sub', 'deep', 'c.txt')
+        const deepCreatedPath = fixture.watchPath('sub', 'deep', 'n.txt')
+        const oldPath = fixture.watchPath('sub', 'moved.txt')
+        const newPath = fixture.watchPath('sub', 'deep', 'moved.txt')
+        await fs.mkdirs(fixture.watchPath('sub', 'deep'))
+        for (let f = 0; f < 5; f++) {
+          await fs.writeFile(fixture.watchPath(`top-${f}.txt`), '')
+        }
+        await fs.writeFile(deletedPath, '')
+        await fs.writeFile(deepDeletedPath, '')
+        await fs.writeFile(oldPath, '')
+
+        const watcher = await fixture.watch([], { poll: true }, () => {})
+        await watcher.getNativeWatcher().stop(false)
+        await until(async () => (await status()).pollingThreadState === 'stopped')
+
+        await fs.unlink(deletedPath)
+        await fs.unlink(deepDeletedPath)
+        await fs.writeFile(deepCreatedPath, '')
+        await fs.rename(oldPath, newPath)
+
+        const matcher = new EventMatcher(fixture)
+        await matcher.watch([], { poll: true })
+
+        await until('offline events arrive', matcher.allEvents(
+          { action: 'deleted', kind: 'file', path: deletedPath },
+          { action: 'deleted', kind: 'file', path: deepDeletedPath },
+          { action: 'created', kind: 'file', path: deepCreatedPath },
+          { kind: 'file', path: newPath }
+        ))
+
+        // The move may be reported as a rename or as a deletion and a creation, depending on the cycles in which its
+        // two halves are found, but its source must not be forgotten.
+        await until('the source of the move is reported', () => matcher.events.some(event => {
+          return event.oldPath === oldPath || (event.action === 'deleted' && event.path === oldPath)
+        }))
+      })
+    })
+  })
 })
@@ -0,0 +1,40 @@
+const path = require('path')
+const fs = require('fs-extra')
+const { execFile } = require('child_process')
+
+const REPLAY = path.join(__dirname, '..', 'build', 'Release', 'inotify_replay')
+const FIXTURES = path.join(__dirname, '..', 'bench', 'fixtures')
+
+// Run the replay benchmark once over a recording, printing every message it produces.
+function replay (recording) {
+  return new Promise(resolve => {
+    execFile(REPLAY, [path.join(FIXTURES, recording), '1', 'print'], (err, stdout, stderr) => {
+      resolve({ code: err ? err.code : 0, stdout, stderr })
+    })
+  })
+}
+
+if (process.platform === 'linux') {
+  describe('inotify recordings', function () {
+    before(async function () {
+      // The replay tool is only built along with the benchmarks, by `npm run bench:build`.
+      if (!await fs.pathExists(REPLAY)) this.skip()
+    })
+
+    it('replays a recorded workload into the messages it produced', async function () {
+      const expected = await fs.readFile(path.join(FIXTURES, 'rename-workload.messages'), 'utf8')
+
+      const { code, stdout, stderr } = await replay('rename-workload.inotify')
+      assert.strictEqual(code, 0, stderr)
+      assert.strictEqual(stdout, expected)
+      assert.match(stderr, /^13 inotify events replayed/m)
+    })
+
+    it('rejects a recording with an event that overruns its buffer', async function () {
+      const { code, stdout, stderr } = await replay('malformed-event.inotify')
+      assert.strictEqual(code, 1)
+      assert.strictEqual(stdout, '')
+      assert.match(stderr, /malformed inotify event buffer/)
+    })
+  })
+}
@@ -0,0 +1,221 @@
+const fs = require('fs-extra')
+
+const { status, openMetrics, metrics, startTracing, stopTracing } = require('../lib/binding')
+const { Fixture } = require('./helper')
+const { EventMatcher } = require('./matcher')
+
+// Spans recorded by the worker thread of each platform as it handles native events.
+const WORKER_SPANS = {
+  linux: 'WatchRegistry::consume',
+  darwin: 'MacOSWorkerPlatform::fs_event_triggered',
+  win32: 'WindowsWorkerPlatform::handle_fs_event'
+}
+
+describe('status and metrics', function () {
+  let fixture
+
+  beforeEach(async function () {
+    fixture = new Fixture()
+    await fixture.before()
+    await fixture.log()
+  })
+
+  afterEach(async function () {
+    await fixture.after(this.currentTest)
+  })
+
+  // Watch the directory `name` within the watch root, then create `count` empty subdirectories within it. Each produces
+  // exactly one creation event. Resolve to the watcher's native channel once every event has arrived.
+  async function createDirectories (name, count, options = {}) {
+    await fs.mkdirs(fixture.watchPath(name))
+
+    const matcher = new EventMatcher(fixture)
+    const watcher = await matcher.watch([name], options)
+
+    const specs = []
+    for (let i = 0; i < count; i++) {
+      const dirPath = fixture.watchPath(name, `dir-${i}`)
+      await fs.mkdir(dirPath)
+      specs.push({ action: 'created', kind: 'directory', path: dirPath })
+    }
+    await until(`${count} creation events arrive`, matcher.allEvents(...specs))
+
+    return watcher.getNativeWatcher().channel
+  }
+
+  function assertOrderedPercentiles (histogram) {
+    assert.isAtMost(histogram.p50, histogram.p90)
+    assert.isAtMost(histogram.p90, histogram.p99)
+    assert.isAtMost(histogram.p99, histogram.p999)
+    assert.isAtMost(histogram.p999, histogram.max)
+  }
+
+  describe('delivery latency', function () {
+    it('records one sample for each event delivered on a channel', async function () {
+      const started = process.hrtime()
+      const channel = await createDirectories('busy', 5)
+      const [seconds, nanoseconds] = process.hrtime(started)
+      const elapsed = seconds * 1e9 + nanoseconds
+
+      const s = await status()
+      const latency = s.channelLatency[channel]
+      assert.strictEqual(latency.total.count, 5)
+      assert.strictEqual(latency.kernelToQueue.count, 5)
+      assert.strictEqual(latency.queueToMain.count, 5)
+
+      for (const histogram of [latency.kernelToQueue, latency.queueToMain, latency.total]) {
+        assertOrderedPercentiles(histogram)
+      }
+
+      // No event can have taken longer to deliver than the test took to produce it.
+      assert.isAtMost(latency.total.max, elapsed)
+      assert.isAtMost(latency.kernelToQueue.max, latency.total.max)
+      assert.isAtLeast(s.deliveryLatency.total.count, 5)
+    })
+
+    it('times the worker thread and the polling thread', async function () {
+      await createDirectories('native', 1)
+      await createDirectories('polled', 1, { poll: true })
+
+      const s = await status()
+      assert.isAbove(s.workerConsumeDuration.count, 0)
+      assertOrderedPercentiles(s.workerConsumeDuration)
+      assert.isAbove(s.pollingCycleDuration.count, 0)
+      assertOrderedPercentiles(s.pollingCycleDuration)
+    })
+  })
+
+  describe('metrics()', function () {
+    it('counts the events emitted by the worker thread', async function () {
+      const before = metrics()
+      await createDirectories('busy', 5)
+      const after = metrics()
+
+      assert.isAtLeast(after.workerEventsEmitted - before.workerEventsEmitted, 5)
+      assert.isAtLeast(after.workerEventsRead - before.workerEventsRead, 5)
+      if (process.platform === 'linux') {
+        // One watch descriptor for the root and one for each new subdirectory.
+        assert.isAtLeast(after.workerWatchCount, 6)
+      }
+      assert.strictEqual(after.pollingEventsEmitted, before.pollingEventsEmitted)
+    })
+
+    it('counts the events emitted by the polling thread', async function () {
+      const before = metrics()
+      await createDirectories('busy', 5, { poll: true })
+      const after = metrics()
+
+      assert.isAtLeast(after.pollingEventsEmitted - before.pollingEventsEmitted, 5)
+      assert.isAbove(after.pollingOperations, before.pollingOperations)
+      assert.isAtLeast(after.workerOutDepth, 0)
+      assert.isAtLeast(after.bytesInFlight, 0)
+    })
+  })
+
+  describe('per-channel status', function () {
+    it('ranks a busy channel above an idle one', async function () {
+      await fs.mkdirs(fixture.watchPath('idle'))
+      const idleWatcher = await fixture.watch(['idle'], {}, () => {})
+      const idleChannel = idleWatcher.getNativeWatcher().channel
+
+      const busyChannel = await createDirectories('busy', 5)
+
+      const s = await status({ perChannel: true })
+      const ranked = s.channels.map(channel => channel.channel)
+      assert.include(ranked, idleChannel)
+      assert.isBelow(ranked.indexOf(busyChannel), ranked.indexOf(idleChannel))
+
+      const [busiest] = s.channels
+      assert.strictEqual(busiest.created, 5)
+      assert.isAbove(busiest.eventsPerSecond, 0)
+      assert.isAtLeast(busiest.bytesEmitted, fixture.watchPath('busy', 'dir-0').length * 5)
+      if (process.platform === 'linux') {
+        assert.isAtLeast(busiest.workerWatchCount, 6)
+        assert.isAtLeast(busiest.workerEventsRead, 5)
+      }
+
+      const idle = s.channels[ranked.indexOf(idleChannel)]
+      assert.strictEqual(idle.created, 0)
+      assert.strictEqual(idle.eventsPerSecond, 0)
+    })
+
+    it('reports only the busiest channels when top is given', async function () {
+      await fs.mkdirs(fixture.watchPath('idle'))
+      await fixture.watch(['idle'], {}, () => {})
+      const busyChannel = await createDirectories('busy', 5)
+
+      const s = await status({ perChannel: true, top: 1 })
+      assert.deepEqual(s.channels.map(channel => channel.channel), [busyChannel])
+    })
+
+    it('reports the entries recorded by a polled channel', async function () {
+      await createDirectories('polled', 5, { poll: true })
+
+      const s = await status({ perChannel: true, top: 1 })
+      assert.isAtLeast(s.channels[0].pollingEntryCount, 6)
+    })
+  })
+
+  describe('openMetrics()', function () {
+    it('exports the counts of delivered events', async function () {
+      const channel = await createDirectories('busy', 5)
+
+      const text = await openMetrics({ perChannel: true })
+      assert.match(text, /^# TYPE watcher_events_read counter$/m)
+      assert.include(text, `\nwatcher_delivery_latency_seconds_count{channel="${channel}",stage="total"} 5\n`)
+      assert.include(text, `\nwatcher_channel_events_total{channel="${channel}",action="created"} 5\n`)
+      assert.include(text, `\nwatcher_channel_events_total{channel="${channel}",action="deleted"} 0\n`)
+      assert.match(text, /^watcher_thread_state\{thread="worker",watcher_thread_state="running"\} 1$/m)
+      assert.isTrue(text.endsWith('# EOF\n'))
+    })
+  })
+
+  describe('tracing', function () {
+    function spansByThread (trace) {
+      const threadNames = new Map()
+      for (const event of trace.traceEvents) {
+        if (event.ph === 'M') threadNames.set(event.tid, event.args.name)
+      }
+
+      const spans = new Map()
+      for (const event of trace.traceEvents) {
+        if (event.ph !== 'X') continue
+
+        assert.isAtLeast(event.ts, 0)
+        assert.isAtLeast(event.dur, 0)
+
+        const threadName = threadNames.get(event.tid)
+        if (!spans.has(threadName)) spans.set(threadName, new Set())
+        spans.get(threadName).add(event.name)
+      }
+      return spans
+    }
+
+    it('records the phases of the main and worker threads', async function () {
+      startTracing()
+      await createDirectories('busy', 5)
+      const spans = spansByThread(JSON.parse(stopTracing()))
+
+      assert.isTrue(spans.get('main thread').has('Hub::handle_events_from'))
+      assert.isTrue(spans.get('worker thread').has(WORKER_SPANS[process.platform]))
+    })
+
+    it('records the cycles of the polling thread', async function () {
+      startTracing()
+      await createDirectories('polled', 5, { poll: true })
+      const spans = spansByThread(JSON.parse(stopTracing()))
+
+      assert.isTrue(spans.get('polling thread').has('PollingThread::cycle'))
+    })
+
+    it('discards spans recorded before tracing was started again', async function () {
+      startTracing()
+      await createDirectories('first', 1)
+      stopTracing()
+
+      startTracing()
+      const trace = JSON.parse(stopTracing())
+      assert.isFalse(trace.traceEvents.some(event => event.ph === 'X' && event.name === 'Hub::handle_events_from'))
+    })
+  })
+})